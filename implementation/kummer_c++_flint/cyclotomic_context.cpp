@@ -0,0 +1,90 @@
+/*
+ * cyclotomic_context.cpp
+ */
+
+#include "cyclotomic_context.h"
+#include "nmod_cyclotomic_poly.h"
+#include "util.h"
+
+#include <map>
+#include <mutex>
+
+using namespace std;
+
+/**
+ * Builds a cyclotomic extension of the prime field by computing an irreducible
+ * factor of the $r$-th cyclotomic polynomial.
+ */
+CyclotomicContext::CyclotomicContext(slong r, mp_limb_t p) {
+	Util util;
+	NModCyclotomicPoly nModCyclotomicPoly;
+
+	this->r = r;
+	this->p = p;
+	degree = util.compute_multiplicative_order(p, r);
+
+	nmod_poly_init(modulus, p);
+	nModCyclotomicPoly.single_irred_factor(modulus, r, p);
+
+	root = 0;
+	if (degree == 1)
+		root = p - nmod_poly_get_coeff_ui(modulus, 0);
+	else
+		fq_nmod_ctx_init_modulus(ctx, modulus, "z");
+}
+
+CyclotomicContext::~CyclotomicContext() {
+	if (degree > 1)
+		fq_nmod_ctx_clear(ctx);
+	nmod_poly_clear(modulus);
+}
+
+static mutex cache_mutex;
+static map<pair<mp_limb_t, slong>, shared_ptr<const CyclotomicContext> > cache;
+
+shared_ptr<const CyclotomicContext> CyclotomicContext::get(slong r, mp_limb_t p) {
+	pair<mp_limb_t, slong> key(p, r);
+
+	{
+		lock_guard<mutex> lock(cache_mutex);
+		auto it = cache.find(key);
+		if (it != cache.end())
+			return it->second;
+	}
+
+	// factoring runs without the lock; if two threads race, the first
+	// context inserted wins
+	shared_ptr<const CyclotomicContext> context = make_shared<CyclotomicContext>(r, p);
+
+	lock_guard<mutex> lock(cache_mutex);
+	return cache.insert(make_pair(key, context)).first->second;
+}
+
+void CyclotomicContext::clear_cache() {
+	lock_guard<mutex> lock(cache_mutex);
+	cache.clear();
+}
+
+slong CyclotomicContext::get_r() const {
+	return r;
+}
+
+mp_limb_t CyclotomicContext::get_p() const {
+	return p;
+}
+
+slong CyclotomicContext::get_degree() const {
+	return degree;
+}
+
+const nmod_poly_struct * CyclotomicContext::get_modulus() const {
+	return modulus;
+}
+
+const fq_nmod_ctx_struct * CyclotomicContext::get_ctx() const {
+	return ctx;
+}
+
+mp_limb_t CyclotomicContext::get_root() const {
+	return root;
+}
@@ -0,0 +1,58 @@
+/*
+ * cyclotomic_context.h
+ *
+ *  The cyclotomic extension used by FFIsomPrimePower for extensions of
+ *  degree r over F_p: an irreducible factor of the r-th cyclotomic
+ *  polynomial and the field it defines, or the root of unity in F_p when
+ *  the factor is linear. A context is immutable once built and is shared
+ *  by reference counting, so one context serves all the isomorphisms with
+ *  the same (p, r), from any number of threads.
+ */
+
+#ifndef CYCLOTOMIC_CONTEXT_H_
+#define CYCLOTOMIC_CONTEXT_H_
+
+#include <flint/nmod_poly.h>
+#include <flint/fq_nmod.h>
+
+#include <memory>
+
+class CyclotomicContext {
+    slong r;
+    mp_limb_t p;
+    // the multiplicative order of p modulo r
+    slong degree;
+    nmod_poly_t modulus;
+    // defined by modulus, initialized only if degree > 1
+    fq_nmod_ctx_t ctx;
+    // the r-th root of unity in F_p, set only if degree = 1
+    mp_limb_t root;
+
+public:
+
+    CyclotomicContext(slong r, mp_limb_t p);
+    ~CyclotomicContext();
+
+    CyclotomicContext(const CyclotomicContext &) = delete;
+    CyclotomicContext & operator=(const CyclotomicContext &) = delete;
+
+    /**
+     * Returns the context of (p, r) from a process-wide cache, building it
+     * on the first request.
+     */
+    static std::shared_ptr<const CyclotomicContext> get(slong r, mp_limb_t p);
+
+    /**
+     * Empties the cache; contexts still in use stay valid.
+     */
+    static void clear_cache();
+
+    slong get_r() const;
+    mp_limb_t get_p() const;
+    slong get_degree() const;
+    const nmod_poly_struct * get_modulus() const;
+    const fq_nmod_ctx_struct * get_ctx() const;
+    mp_limb_t get_root() const;
+};
+
+#endif /* CYCLOTOMIC_CONTEXT_H_ */
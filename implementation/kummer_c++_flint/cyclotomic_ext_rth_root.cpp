@@ -7,6 +7,7 @@
 
 #include "cyclotomic_ext_rth_root.h"
 #include "util.h"
+#include "ff_isom_thresholds.h"
 #include <flint/fmpz.h>
 #include <iostream>
 #include <flint/profiler.h>
@@ -217,8 +218,7 @@ void CyclotomicExtRthRoot::compute_beta_coeffs_large_ext(fq_nmod_poly_t beta, sl
  * Given $\beta = \sum_i c_i(z)x^i$, computes $\beta = \sum_i c_i(z^{z_degree})x^i$.
  */
 void CyclotomicExtRthRoot::compute_beta_coeffs(fq_nmod_poly_t beta, slong zeta_degree) {
-	Util util;
-	if (util.is_small_cyclotomic_ext(r, ctx->modulus->mod.n))
+	if (small_ext)
 		compute_beta_coeffs_small_ext(beta, zeta_degree);
 	else
 		compute_beta_coeffs_large_ext(beta, zeta_degree);
@@ -519,6 +519,8 @@ void CyclotomicExtRthRoot::compute_rth_root(fq_nmod_t root, const fq_nmod_t a, s
 
 	this->ctx = ctx;
 	this->r = r;
+	Util util;
+	small_ext = util.is_small_cyclotomic_ext(r, ctx->modulus->mod.n, FFIsomThresholds::get().ext_comp_exponent);
 	fq_nmod_init(this->a, ctx);
 	fq_nmod_set(this->a, a, ctx);
 	fq_nmod_poly_init(beta_init, ctx);
@@ -21,6 +21,8 @@ class CyclotomicExtRthRoot {
     fq_nmod_t a;
     const fq_nmod_ctx_struct *ctx;
     slong r;
+    // the small extension variant of compute_beta_coeffs, decided once per root
+    bool small_ext;
 
     void compute_trace(fq_nmod_poly_t beta, fq_nmod_poly_t xi, slong n, const fq_nmod_poly_t modulus);
     void compute_trace(fq_nmod_poly_t trace, const fq_nmod_poly_t alpha, const fq_nmod_poly_t modulus);
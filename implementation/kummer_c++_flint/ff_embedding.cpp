@@ -4,6 +4,8 @@
 #include "ff_isom_prime_power_ext.h"
 #include "ff_isom_base_change.h"
 #include "ff_isom_artin_schreier.h"
+#include "thread_pool.h"
+#include "nmod_poly_compose_engine.h"
 #include <flint/profiler.h>
 
 #include <iostream>
@@ -33,9 +35,9 @@ void FFEmbedding::compute_xi_init(nmod_poly_t xi_init, const nmod_poly_t modulus
 	// compute x^{p^r} using a binary-powering scheme
 	for (slong i = 1; i < bit_length; i++) {
 		n >>= 1;
-		nmod_poly_compose_mod(temp_comp2, temp_comp2, temp_comp2, modulus);
+		NmodComposeEngine::compose_mod(temp_comp2, temp_comp2, temp_comp2, modulus);
 		if (n & 1)
-			nmod_poly_compose_mod(temp_comp2, temp_comp2, temp_comp1, modulus);
+			NmodComposeEngine::compose_mod(temp_comp2, temp_comp2, temp_comp1, modulus);
 	}
 
 	nmod_poly_set(xi_init, temp_comp2);
@@ -61,20 +63,44 @@ void FFEmbedding::compute_trace(nmod_poly_t alpha, nmod_poly_t xi, const nmod_po
 
 	if (i % 2 == 0) {
 		compute_trace(temp_alpha, temp_xi, alpha_init, xi_init, modulus, i / 2);
-		nmod_poly_compose_mod(alpha, temp_alpha, temp_xi, modulus);
+		NmodComposeEngine::compose_mod(alpha, temp_alpha, temp_xi, modulus);
 		nmod_poly_add(alpha, alpha, temp_alpha);
-		nmod_poly_compose_mod(xi, temp_xi, temp_xi, modulus);
+		NmodComposeEngine::compose_mod(xi, temp_xi, temp_xi, modulus);
 	} else {
 		compute_trace(temp_alpha, temp_xi, alpha_init, xi_init, modulus, i - 1);
-		nmod_poly_compose_mod(alpha, temp_alpha, xi_init, modulus);
+		NmodComposeEngine::compose_mod(alpha, temp_alpha, xi_init, modulus);
 		nmod_poly_add(alpha, alpha, alpha_init);
-		nmod_poly_compose_mod(xi, temp_xi, xi_init, modulus);
+		NmodComposeEngine::compose_mod(xi, temp_xi, xi_init, modulus);
 	}
 
 	nmod_poly_clear(temp_alpha);
 	nmod_poly_clear(temp_xi);
 }
 
+/**
+ * Tests whether {@code alpha}, an element of the subfield of degree d,
+ * generates it: {@code frobenius} holds x^{p^{d/q}} for the {@code num}
+ * primes q | d, and {@code alpha} generates iff none of them fixes it. Stops
+ * at the first one that does.
+ */
+bool FFEmbedding::is_subfield_generator(const nmod_poly_t alpha, const nmod_poly_struct *frobenius, slong num,
+		const nmod_poly_t modulus) {
+	if (nmod_poly_is_zero(alpha))
+		return false;
+
+	nmod_poly_t conjugate;
+	nmod_poly_init(conjugate, modulus->mod.n);
+
+	bool generator = true;
+	for (slong i = 0; i < num && generator; i++) {
+		NmodComposeEngine::compose_mod(conjugate, alpha, frobenius + i, modulus);
+		generator = !nmod_poly_equal(conjugate, alpha);
+	}
+
+	nmod_poly_clear(conjugate);
+	return generator;
+}
+
 void FFEmbedding::find_subfield(nmod_poly_t subfield_modulus, nmod_poly_t embedding_image,
 		const nmod_poly_t modulus, slong degree) {
 
@@ -92,15 +118,28 @@ void FFEmbedding::find_subfield(nmod_poly_t subfield_modulus, nmod_poly_t embedd
 	nmod_poly_t xi;
 	nmod_poly_t alpha_init;
 	nmod_poly_t xi_init;
-	nmod_poly_t min_poly;
+	nmod_poly_t modulus_inv_rev;
 
 	nmod_poly_init(alpha, modulus->mod.n);
 	nmod_poly_init(xi, modulus->mod.n);
 	nmod_poly_init(alpha_init, modulus->mod.n);
 	nmod_poly_init(xi_init, modulus->mod.n);
-	nmod_poly_init(min_poly, modulus->mod.n);
+	nmod_poly_init(modulus_inv_rev, modulus->mod.n);
 
 	compute_xi_init(xi_init, modulus, degree);
+	nmod_poly_reverse(modulus_inv_rev, modulus, nmod_poly_degree(modulus) + 1);
+	nmod_poly_inv_series_newton(modulus_inv_rev, modulus_inv_rev, nmod_poly_degree(modulus) - 1);
+
+	// x^{p^{degree / q}} for the primes q | degree, shared by all candidates
+	n_factor_t factors;
+	n_factor_init(&factors);
+	n_factor(&factors, degree, 1);
+	nmod_poly_struct *frobenius = (nmod_poly_struct *) flint_malloc(FLINT_MAX(factors.num, 1)
+			* sizeof(nmod_poly_struct));
+	for (slong i = 0; i < factors.num; i++) {
+		nmod_poly_init(frobenius + i, modulus->mod.n);
+		compute_xi_init(frobenius + i, modulus, degree / factors.p[i]);
+	}
 
 	flint_rand_t state;
 	flint_randinit(state);
@@ -110,36 +149,30 @@ void FFEmbedding::find_subfield(nmod_poly_t subfield_modulus, nmod_poly_t embedd
 	// the number of terms in the trace
 	slong n = nmod_poly_degree(modulus) / degree;
 
-//	timeit_t time;
 	while (true) {
 		nmod_poly_randtest(alpha_init, state, nmod_poly_degree(modulus));
-//		timeit_start(time);
 		compute_trace(alpha, xi, alpha_init, xi_init, modulus, n);
-//		timeit_stop(time);
-//		cout << "trace time: " << (double) time->wall / 1000.0 << "\n";
-		if (!nmod_poly_is_zero(alpha)) {
-//			timeit_start(time);
-			nmodMinPoly.minimal_polynomial(min_poly, alpha, modulus);
-//			timeit_stop(time);
-//			cout << "minpoly time: " << (double) time->wall / 1000.0 << "\n";
-			if (nmod_poly_degree(min_poly) == degree)
-				break;
-		}
+		if (is_subfield_generator(alpha, frobenius, factors.num, modulus))
+			break;
 	}
 
-	nmod_poly_set(subfield_modulus, min_poly);
+	// the minimal polynomial of a generator, of known degree
+	nmodMinPoly.minimal_polynomial_of_degree(subfield_modulus, alpha, modulus, modulus_inv_rev, degree);
 	nmod_poly_set(embedding_image, alpha);
 
+	for (slong i = 0; i < factors.num; i++)
+		nmod_poly_clear(frobenius + i);
+	flint_free(frobenius);
 	nmod_poly_clear(alpha);
 	nmod_poly_clear(xi);
 	nmod_poly_clear(alpha_init);
 	nmod_poly_clear(xi_init);
-	nmod_poly_clear(min_poly);
+	nmod_poly_clear(modulus_inv_rev);
 	flint_randclear(state);
 }
 
 
-void FFEmbedding::compute_generators(nmod_poly_t g1, nmod_poly_t g2, slong r) {
+void FFEmbedding::compute_generators(nmod_poly_t g1, nmod_poly_t g2, slong r, slong num_threads) {
 	nmod_poly_t subfield_modulus1;
 	nmod_poly_t subfield_modulus2;
 	nmod_poly_t subfield_embd_img1;
@@ -169,13 +202,13 @@ void FFEmbedding::compute_generators(nmod_poly_t g1, nmod_poly_t g2, slong r) {
 
 	} else {
 
-		FFIsomPrimePower ffIsomPrimePower(subfield_modulus1, subfield_modulus2, this->force_algo, this->derand);
+		FFIsomPrimePower ffIsomPrimePower(subfield_modulus1, subfield_modulus2, this->force_algo, this->derand, num_threads);
 		ffIsomPrimePower.compute_generators(subfield_gen1, subfield_gen2);
 	}
 
 	// compute generator for subfields in the larger fields
-	nmod_poly_compose_mod(g1, subfield_gen1, subfield_embd_img1, modulus1);
-	nmod_poly_compose_mod(g2, subfield_gen2, subfield_embd_img2, modulus2);
+	NmodComposeEngine::compose_mod(g1, subfield_gen1, subfield_embd_img1, modulus1);
+	NmodComposeEngine::compose_mod(g2, subfield_gen2, subfield_embd_img2, modulus2);
 
 	nmod_poly_clear(subfield_modulus1);
 	nmod_poly_clear(subfield_modulus2);
@@ -187,29 +220,90 @@ void FFEmbedding::compute_generators(nmod_poly_t g1, nmod_poly_t g2, slong r) {
 
 
 void FFEmbedding::compute_generators(nmod_poly_t g1, nmod_poly_t g2) {
+	// generators kept from a previous call or read from a file
+	if (num_factors > 0) {
+		nmod_poly_zero(g1);
+		nmod_poly_zero(g2);
+		for (slong i = 0; i < num_factors; i++) {
+			nmod_poly_add(g1, g1, factor_gen1 + i);
+			nmod_poly_add(g2, g2, factor_gen2 + i);
+		}
+		return;
+	}
+
 	slong m = nmod_poly_degree(modulus1);
 
 	n_factor_t factors;
 	n_factor_init(&factors);
 	n_factor(&factors, m, 1);
 
-	nmod_poly_t subfield_gen1;
-	nmod_poly_t subfield_gen2;
-	nmod_poly_init(subfield_gen1, modulus1->mod.n);
-	nmod_poly_init(subfield_gen2, modulus2->mod.n);
+	// one generator pair per prime power factor
+	nmod_poly_struct *subfield_gen1 = (nmod_poly_struct *) flint_malloc(factors.num * sizeof(nmod_poly_struct));
+	nmod_poly_struct *subfield_gen2 = (nmod_poly_struct *) flint_malloc(factors.num * sizeof(nmod_poly_struct));
+	for (slong i = 0; i < factors.num; i++) {
+		nmod_poly_init(subfield_gen1 + i, modulus1->mod.n);
+		nmod_poly_init(subfield_gen2 + i, modulus2->mod.n);
+	}
+
+	if (num_threads > 1 && factors.num > 1) {
+		// the factors are independent: each task only reads the moduli
+		ThreadPool pool(FLINT_MIN(num_threads, (slong) factors.num));
+		// the threads left over go to the isomorphism and the modular
+		// compositions of each task
+		slong compose_threads = FLINT_MAX(num_threads / pool.size(), 1);
+
+		// submit the largest (most expensive) factors first
+		for (slong i = factors.num - 1; i >= 0; i--) {
+			slong r = n_pow(factors.p[i], factors.exp[i]);
+			pool.submit([this, subfield_gen1, subfield_gen2, i, r, compose_threads] {
+				NmodComposeEngine::set_num_threads(compose_threads);
+				compute_generators(subfield_gen1 + i, subfield_gen2 + i, r, compose_threads);
+			});
+		}
+		pool.wait();
+	} else {
+		slong compose_threads = NmodComposeEngine::get_num_threads();
+		NmodComposeEngine::set_num_threads(num_threads);
+		for (slong i = 0; i < factors.num; i++) {
+			slong r = n_pow(factors.p[i], factors.exp[i]);
+			compute_generators(subfield_gen1 + i, subfield_gen2 + i, r, num_threads);
+		}
+		NmodComposeEngine::set_num_threads(compose_threads);
+	}
 
+	// reduce in factor order so that the result does not depend on scheduling
 	nmod_poly_zero(g1);
 	nmod_poly_zero(g2);
-
 	for (slong i = 0; i < factors.num; i++) {
-		slong r = n_pow(factors.p[i], factors.exp[i]);
-		compute_generators(subfield_gen1, subfield_gen2, r);
-		nmod_poly_add(g1, g1, subfield_gen1);
-		nmod_poly_add(g2, g2, subfield_gen2);
+		nmod_poly_add(g1, g1, subfield_gen1 + i);
+		nmod_poly_add(g2, g2, subfield_gen2 + i);
 	}
 
-	nmod_poly_clear(subfield_gen1);
-	nmod_poly_clear(subfield_gen2);
+	// keep the generators, e.g. to save them
+	detach();
+	clear_factor_generators();
+	num_factors = factors.num;
+	factor_degrees = (slong *) flint_malloc(factors.num * sizeof(slong));
+	for (slong i = 0; i < factors.num; i++)
+		factor_degrees[i] = n_pow(factors.p[i], factors.exp[i]);
+	factor_gen1 = subfield_gen1;
+	factor_gen2 = subfield_gen2;
+}
+
+void FFEmbedding::clear_factor_generators() {
+	for (slong i = 0; i < num_factors; i++) {
+		nmod_poly_clear(factor_gen1 + i);
+		nmod_poly_clear(factor_gen2 + i);
+	}
+	if (num_factors > 0) {
+		flint_free(factor_gen1);
+		flint_free(factor_gen2);
+		flint_free(factor_degrees);
+	}
+	num_factors = 0;
+	factor_gen1 = NULL;
+	factor_gen2 = NULL;
+	factor_degrees = NULL;
 }
 
 
@@ -218,9 +312,13 @@ void FFEmbedding::build_embedding(const nmod_poly_t g1, const nmod_poly_t g2) {
 	nmod_poly_init(x, modulus1->mod.n);
 	nmod_poly_set_coeff_ui(x, 1, 1);
 
+	detach();
+
 	FFIsomBaseChange ffIsomBaseChange;
 	ffIsomBaseChange.change_basis(x_image, g1, x, modulus1);
-	nmod_poly_compose_mod(x_image, x_image, g2, modulus2);
+	NmodComposeEngine::compose_mod(x_image, x_image, g2, modulus2);
+	image_block = 0;
+	clear_preimages();
 
 	nmod_poly_clear(x);
 }
@@ -229,24 +327,427 @@ void FFEmbedding::get_x_image(nmod_poly_t x_image) {
 	nmod_poly_set(x_image, this->x_image);
 }
 
+void FFEmbedding::set_x_image(const nmod_poly_t x_image) {
+	detach();
+	nmod_poly_set(this->x_image, x_image);
+	image_block = 0;
+	clear_preimages();
+}
+
+void FFEmbedding::compose(const FFEmbedding &first, const FFEmbedding &second) {
+	if (!nmod_poly_equal(first.modulus2, second.modulus1)) {
+		flint_printf("Exception (FFEmbedding::compose). The target of first is not the source of second.\n");
+		abort();
+	}
+	if (!nmod_poly_equal(modulus1, first.modulus1) || !nmod_poly_equal(modulus2, second.modulus2)) {
+		flint_printf("Exception (FFEmbedding::compose). Moduli differ from those of the composition.\n");
+		abort();
+	}
+
+	// x --> first(x) --> first(x)(second(x))
+	detach();
+	NmodComposeEngine::compose_mod(x_image, first.x_image, second.x_image, modulus2);
+	image_block = 0;
+	clear_preimages();
+}
+
 void FFEmbedding::compute_image(nmod_poly_t image, const nmod_poly_t f) {
-	nmod_poly_compose_mod(image, f, x_image, modulus2);
+	NmodComposeEngine::compose_mod(image, f, x_image, modulus2);
+}
+
+/**
+ * Prepares the composition by x_image for batches of {@code block} elements 
+ * of k. The number of baby steps balances the baby steps against the 
+ * size of the matrix product of a block.
+ */
+void FFEmbedding::prepare_images(slong block) {
+	slong m = nmod_poly_degree(modulus1);
+
+	nmod_poly_t inv;
+	nmod_poly_init(inv, modulus2->mod.n);
+	nmod_poly_reverse(inv, modulus2, modulus2->length);
+	nmod_poly_inv_series(inv, inv, modulus2->length);
+
+	image_compose.prepare(x_image, modulus2, inv, n_sqrt(m * block) + 1, m);
+	image_block = block;
+
+	nmod_poly_clear(inv);
+}
+
+void FFEmbedding::compute_images(nmod_poly_struct *images, const nmod_poly_struct *f, slong num) {
+	if (num <= 0)
+		return;
+
+	slong block = FLINT_MIN(num, IMAGE_BLOCK_SIZE);
+	if (block > image_block)
+		prepare_images(block);
+
+	Nmod_poly_compose_mod::Workspace workspace;
+	for (slong i = 0; i < num; i += block)
+		image_compose.apply(images + i, f + i, FLINT_MIN(block, num - i), workspace);
+}
+
+/**
+ * Computes the data shared by all preimages: the powers of the image of x,
+ * a random linear form $\ell$ on K such that its restriction $\lambda$ 
+ * to k is nonzero, and the inverse of the dual of $\lambda$.
+ */
+void FFEmbedding::prepare_preimages() {
+	slong m = nmod_poly_degree(modulus1);
+	slong n = nmod_poly_degree(modulus2);
+
+	init_preimage_tables();
+	mp_limb_t *sequence = _nmod_vec_init(m);
+
+	FFIsomBaseChange ffIsomBaseChange;
+	flint_rand_t state;
+	flint_randinit(state);
+
+	// the restriction of a random form vanishes with probability p^{-m}
+	do {
+		_nmod_vec_randtest(preimage_form, state, n, modulus2->mod);
+		preimage_projection.apply(sequence, preimage_form, m);
+		ffIsomBaseChange.dual_to_monomial(preimage_scale, sequence, modulus1, modulus1_derivative_inv);
+	} while (nmod_poly_is_zero(preimage_scale));
+
+	nmod_poly_invmod(preimage_scale, preimage_scale, modulus1);
+
+	flint_randclear(state);
+	_nmod_vec_clear(sequence);
 }
 
-FFEmbedding::FFEmbedding(const nmod_poly_t f1, const nmod_poly_t f2, slong force_algo, slong derand) {
+/**
+ * Allocates the data of the preimages and computes the part that does not
+ * depend on the linear form.
+ */
+void FFEmbedding::init_preimage_tables() {
+	slong m = nmod_poly_degree(modulus1);
+	slong n = nmod_poly_degree(modulus2);
+
+	clear_preimages();
+
+	nmod_poly_init(preimage_scale, modulus1->mod.n);
+	nmod_poly_init(modulus1_derivative_inv, modulus1->mod.n);
+	nmod_poly_init(modulus2_inv_rev, modulus2->mod.n);
+
+	// 1 / modulus1' mod modulus1
+	nmod_poly_derivative(modulus1_derivative_inv, modulus1);
+	nmod_poly_invmod(modulus1_derivative_inv, modulus1_derivative_inv, modulus1);
+
+	// 1 / rev(modulus2, n + 1) mod x^{n - 1}
+	nmod_poly_reverse(modulus2_inv_rev, modulus2, n + 1);
+	nmod_poly_inv_series_newton(modulus2_inv_rev, modulus2_inv_rev, FLINT_MAX(n - 1, 1));
+
+	preimage_projection.prepare(x_image, modulus2, modulus2_inv_rev, n_sqrt(m) + 1);
+
+	preimage_form = _nmod_vec_init(n);
+	// the tables are owned from here on, clear_preimages frees them
+	preimage_ready = true;
+}
+
+void FFEmbedding::clear_preimages() {
+	if (!preimage_ready)
+		return;
+
+	_nmod_vec_clear(preimage_form);
+	nmod_poly_clear(preimage_scale);
+	nmod_poly_clear(modulus1_derivative_inv);
+	nmod_poly_clear(modulus2_inv_rev);
+	preimage_ready = false;
+}
+
+/**
+ * Computes the preimages of {@code b[0]}, ..., {@code b[num - 1]}, with
+ * {@code forms} and {@code sequences} scratch space for {@code num} vectors
+ * of length deg(modulus2) and deg(modulus1).
+ */
+void FFEmbedding::compute_preimages_block(nmod_poly_struct *a, const nmod_poly_struct *b, slong num,
+		mp_limb_t **forms, mp_limb_t **sequences) {
+	slong m = nmod_poly_degree(modulus1);
+
+	NmodMinPoly nmodMinPoly;
+	FFIsomBaseChange ffIsomBaseChange;
+
+	// the forms b \circ \ell, then the sequences \ell(b g^i), all at once
+	for (slong i = 0; i < num; i++)
+		nmodMinPoly.transposed_mulmod(forms[i], preimage_form, b + i, modulus2, modulus2_inv_rev);
+	preimage_projection.apply(sequences, forms, num, m);
+
+	// the dual of a \circ \lambda is a times the dual of \lambda
+	for (slong i = 0; i < num; i++) {
+		ffIsomBaseChange.dual_to_monomial(a + i, sequences[i], modulus1, modulus1_derivative_inv);
+		nmod_poly_mulmod(a + i, a + i, preimage_scale, modulus1);
+	}
+}
+
+void FFEmbedding::compute_preimage(nmod_poly_t a, const nmod_poly_t b) {
+	compute_preimages(a, b, 1);
+}
+
+void FFEmbedding::compute_preimages(nmod_poly_struct *a, const nmod_poly_struct *b, slong num) {
+	if (num <= 0)
+		return;
+
+	if (!preimage_ready)
+		prepare_preimages();
+
+	slong block = FLINT_MIN(num, PREIMAGE_BLOCK_SIZE);
+	mp_limb_t **forms = new mp_limb_t*[block];
+	mp_limb_t **sequences = new mp_limb_t*[block];
+	for (slong i = 0; i < block; i++) {
+		forms[i] = _nmod_vec_init(nmod_poly_degree(modulus2));
+		sequences[i] = _nmod_vec_init(nmod_poly_degree(modulus1));
+	}
+
+	for (slong i = 0; i < num; i += block)
+		compute_preimages_block(a + i, b + i, FLINT_MIN(block, num - i), forms, sequences);
+
+	for (slong i = 0; i < block; i++) {
+		_nmod_vec_clear(forms[i]);
+		_nmod_vec_clear(sequences[i]);
+	}
+	delete[] forms;
+	delete[] sequences;
+}
+
+FFEmbedding::FFEmbedding(const nmod_poly_t f1, const nmod_poly_t f2, slong force_algo, slong derand,
+		slong num_threads) {
 	nmod_poly_init(modulus1, f1->mod.n);
 	nmod_poly_init(modulus2, f2->mod.n);
 	nmod_poly_set(modulus1, f1);
 	nmod_poly_set(modulus2, f2);
 	nmod_poly_init(x_image, modulus2->mod.n);
+	image_block = 0;
+	preimage_ready = false;
+	num_factors = 0;
+	factor_degrees = NULL;
+	factor_gen1 = NULL;
+	factor_gen2 = NULL;
 	this->force_algo = force_algo;
     this->derand = derand;
+	this->num_threads = num_threads;
+}
+
+/**
+ * An embedding with no moduli, filled in by {@code load}.
+ */
+FFEmbedding::FFEmbedding() {
+	nmod_poly_init(modulus1, 2);
+	nmod_poly_init(modulus2, 2);
+	nmod_poly_init(x_image, 2);
+	image_block = 0;
+	preimage_ready = false;
+	num_factors = 0;
+	factor_degrees = NULL;
+	factor_gen1 = NULL;
+	factor_gen2 = NULL;
+	force_algo = FORCE_NONE;
+	derand = 0;
+	num_threads = 1;
 }
 
 FFEmbedding::~FFEmbedding() {
+	forget_borrowed();
 	nmod_poly_clear(modulus1);
 	nmod_poly_clear(modulus2);
 	nmod_poly_clear(x_image);
+	clear_factor_generators();
+	clear_preimages();
+}
+
+/**
+ * Points {@code poly} to {@code len} coefficients owned by someone else.
+ */
+static void borrow(nmod_poly_t poly, const mp_limb_t *coeffs, slong len) {
+	poly->coeffs = (mp_ptr) coeffs;
+	poly->alloc = len;
+	poly->length = len;
+}
+
+/**
+ * Whether the {@code len} coefficients of section {@code i} are reduced
+ * modulo p and, if {@code normalised}, have a nonzero last one.
+ */
+static bool valid_section(const FFEmbeddingFile &file, slong i, mp_limb_t p, bool normalised) {
+	slong len = file.section(i).length;
+	const mp_limb_t *coeffs = file.data(i);
+	for (slong j = 0; j < len; j++)
+		if (coeffs[j] >= p)
+			return false;
+	return !normalised || len == 0 || coeffs[len - 1] != 0;
+}
+
+/**
+ * Replaces borrowed coefficients of {@code poly} by an owned copy.
+ */
+static void own(nmod_poly_t poly) {
+	slong len = poly->length;
+	mp_ptr coeffs = NULL;
+	if (len > 0) {
+		coeffs = _nmod_vec_init(len);
+		flint_mpn_copyi(coeffs, poly->coeffs, len);
+	}
+	poly->coeffs = coeffs;
+	poly->alloc = len;
+}
+
+/**
+ * Makes the embedding own all its coefficients.
+ */
+void FFEmbedding::detach() {
+	if (!backing)
+		return;
+
+	own(modulus1);
+	own(modulus2);
+	own(x_image);
+	for (slong i = 0; i < num_factors; i++) {
+		own(factor_gen1 + i);
+		own(factor_gen2 + i);
+	}
+	backing.reset();
+}
+
+/**
+ * Drops the borrowed coefficients without freeing them.
+ */
+void FFEmbedding::forget_borrowed() {
+	if (!backing)
+		return;
+
+	nmod_poly_struct *borrowed[3] = {modulus1, modulus2, x_image};
+	for (slong i = 0; i < 3; i++) {
+		borrowed[i]->coeffs = NULL;
+		borrowed[i]->alloc = 0;
+		borrowed[i]->length = 0;
+	}
+	for (slong i = 0; i < num_factors; i++) {
+		factor_gen1[i].coeffs = NULL;
+		factor_gen1[i].alloc = 0;
+		factor_gen2[i].coeffs = NULL;
+		factor_gen2[i].alloc = 0;
+	}
+	backing.reset();
+}
+
+bool FFEmbedding::save(const char *filename, bool with_preimage_data) {
+	FFEmbeddingFile file;
+
+	file.add_section(FF_EMBEDDING_SECTION_MODULUS1, 0, modulus1->coeffs, modulus1->length);
+	file.add_section(FF_EMBEDDING_SECTION_MODULUS2, 0, modulus2->coeffs, modulus2->length);
+	file.add_section(FF_EMBEDDING_SECTION_X_IMAGE, 0, x_image->coeffs, x_image->length);
+	for (slong i = 0; i < num_factors; i++) {
+		file.add_section(FF_EMBEDDING_SECTION_GENERATOR1, factor_degrees[i], factor_gen1[i].coeffs, factor_gen1[i].length);
+		file.add_section(FF_EMBEDDING_SECTION_GENERATOR2, factor_degrees[i], factor_gen2[i].coeffs, factor_gen2[i].length);
+	}
+
+	if (with_preimage_data) {
+		if (!preimage_ready)
+			prepare_preimages();
+		file.add_section(FF_EMBEDDING_SECTION_PREIMAGE_FORM, 0, preimage_form, nmod_poly_degree(modulus2));
+		file.add_section(FF_EMBEDDING_SECTION_PREIMAGE_SCALE, 0, preimage_scale->coeffs, preimage_scale->length);
+	}
+
+	return file.write(filename, modulus1->mod.n);
+}
+
+FFEmbedding * FFEmbedding::load(const char *filename, bool use_mmap, slong force_algo, slong derand, slong num_threads) {
+	shared_ptr<FFEmbeddingFile> file = make_shared<FFEmbeddingFile>();
+	if (!file->open(filename, use_mmap))
+		return NULL;
+
+	slong i1 = file->find(FF_EMBEDDING_SECTION_MODULUS1);
+	slong i2 = file->find(FF_EMBEDDING_SECTION_MODULUS2);
+	slong ix = file->find(FF_EMBEDDING_SECTION_X_IMAGE);
+	mp_limb_t p = file->get_characteristic();
+	if (i1 < 0 || i2 < 0 || ix < 0 || p < 2 || file->section(i1).length < 2 || file->section(i2).length < 2
+			|| file->section(ix).length >= file->section(i2).length)
+		return NULL;
+
+	// monic moduli of degree deg(modulus1) | deg(modulus2), and reduced data
+	slong m = file->section(i1).length - 1;
+	slong n = file->section(i2).length - 1;
+	if (file->data(i1)[m] != 1 || file->data(i2)[n] != 1 || n % m != 0 || !valid_section(*file, i1, p, true)
+			|| !valid_section(*file, i2, p, true) || !valid_section(*file, ix, p, true))
+		return NULL;
+
+	// the generators come in pairs, of prime power degrees dividing m
+	slong num_gens = 0, num_gens2 = 0;
+	for (slong i = 0; i < file->num_sections(); i++) {
+		const FFEmbeddingFile::Section &section = file->section(i);
+		if (section.type == FF_EMBEDDING_SECTION_GENERATOR1) {
+			if (section.param < 1 || m % section.param != 0 || (slong) section.length > m
+					|| !valid_section(*file, i, p, true))
+				return NULL;
+			num_gens++;
+		} else if (section.type == FF_EMBEDDING_SECTION_GENERATOR2) {
+			if ((slong) section.length > n || !valid_section(*file, i, p, true))
+				return NULL;
+			num_gens2++;
+		}
+	}
+	if (num_gens != num_gens2)
+		return NULL;
+
+	slong iform = file->find(FF_EMBEDDING_SECTION_PREIMAGE_FORM);
+	slong iscale = file->find(FF_EMBEDDING_SECTION_PREIMAGE_SCALE);
+	bool with_preimage_data = iform >= 0 && iscale >= 0 && (slong) file->section(iform).length == n;
+	if (with_preimage_data && ((slong) file->section(iscale).length > m || !valid_section(*file, iform, p, false)
+			|| !valid_section(*file, iscale, p, true)))
+		return NULL;
+
+	FFEmbedding *embedding = new FFEmbedding();
+	embedding->force_algo = force_algo;
+	embedding->derand = derand;
+	embedding->num_threads = num_threads;
+
+	nmod_poly_clear(embedding->modulus1);
+	nmod_poly_clear(embedding->modulus2);
+	nmod_poly_clear(embedding->x_image);
+	nmod_poly_init(embedding->modulus1, p);
+	nmod_poly_init(embedding->modulus2, p);
+	nmod_poly_init(embedding->x_image, p);
+
+	if (num_gens > 0) {
+		embedding->factor_degrees = (slong *) flint_malloc(num_gens * sizeof(slong));
+		embedding->factor_gen1 = (nmod_poly_struct *) flint_malloc(num_gens * sizeof(nmod_poly_struct));
+		embedding->factor_gen2 = (nmod_poly_struct *) flint_malloc(num_gens * sizeof(nmod_poly_struct));
+		for (slong i = 0; i < num_gens; i++) {
+			nmod_poly_init(embedding->factor_gen1 + i, p);
+			nmod_poly_init(embedding->factor_gen2 + i, p);
+		}
+		embedding->num_factors = num_gens;
+	}
+
+	// the generator sections come in pairs, in factor order
+	embedding->backing = file;
+	borrow(embedding->modulus1, file->data(i1), file->section(i1).length);
+	borrow(embedding->modulus2, file->data(i2), file->section(i2).length);
+	borrow(embedding->x_image, file->data(ix), file->section(ix).length);
+	slong j1 = 0, j2 = 0;
+	for (slong i = 0; i < file->num_sections(); i++) {
+		const FFEmbeddingFile::Section &section = file->section(i);
+		if (section.type == FF_EMBEDDING_SECTION_GENERATOR1) {
+			embedding->factor_degrees[j1] = section.param;
+			borrow(embedding->factor_gen1 + j1++, file->data(i), section.length);
+		} else if (section.type == FF_EMBEDDING_SECTION_GENERATOR2) {
+			borrow(embedding->factor_gen2 + j2++, file->data(i), section.length);
+		}
+	}
+
+	if (with_preimage_data) {
+		embedding->init_preimage_tables();
+		flint_mpn_copyi(embedding->preimage_form, file->data(iform), file->section(iform).length);
+		nmod_poly_fit_length(embedding->preimage_scale, file->section(iscale).length);
+		flint_mpn_copyi(embedding->preimage_scale->coeffs, file->data(iscale), file->section(iscale).length);
+		_nmod_poly_set_length(embedding->preimage_scale, file->section(iscale).length);
+	}
+
+	// without a mapping the file buffer goes away with the file
+	if (!use_mmap)
+		embedding->detach();
+
+	return embedding;
 }
 
 
@@ -9,7 +9,11 @@
 #define FF_EMBEDDING_H
 
 #include <flint/nmod_poly.h>
+#include <memory>
 #include "ff_isom_prime_power_ext.h"
+#include "nmod_poly_compose_mod.h"
+#include "nmod_poly_power_projection.h"
+#include "ff_embedding_file.h"
 
 class FFEmbedding {
     nmod_poly_t modulus1;
@@ -18,10 +22,56 @@ class FFEmbedding {
 
     slong force_algo;
     slong derand;
+    slong num_threads;
 
+    // the generators of the subfields of degree factor_degrees[i], kept by 
+    // compute_generators or read from a file
+    slong num_factors;
+    slong *factor_degrees;
+    nmod_poly_struct *factor_gen1;
+    nmod_poly_struct *factor_gen2;
+
+    // set when the moduli, x_image and the generators point into a mapped
+    // file; they are copied before any of them is written
+    std::shared_ptr<FFEmbeddingFile> backing;
+
+    FFEmbedding();
+    void detach();
+    void forget_borrowed();
+    void clear_factor_generators();
+
+    // composition by x_image, prepared by the first batch of images
+    Nmod_poly_compose_mod image_compose;
+    // the batch size image_compose was prepared for, 0 if not prepared
+    slong image_block;
+
+    static const slong IMAGE_BLOCK_SIZE = 256;
+    // the number of forms projected together by compute_preimages
+    static const slong PREIMAGE_BLOCK_SIZE = 32;
+
+    void prepare_images(slong block);
+
+    // data for the preimages, computed by the first preimage
+    bool preimage_ready;
+    // a random linear form on K, as its values on the monomials
+    mp_limb_t *preimage_form;
+    // the powers of x_image, projected on by the preimages
+    Nmod_poly_power_projection preimage_projection;
+    // inverse of the dual of the form restricted to k
+    nmod_poly_t preimage_scale;
+    nmod_poly_t modulus1_derivative_inv;
+    nmod_poly_t modulus2_inv_rev;
+
+    void init_preimage_tables();
+    void prepare_preimages();
+    void clear_preimages();
+    void compute_preimages_block(nmod_poly_struct *a, const nmod_poly_struct *b, slong num,
+	    mp_limb_t **forms, mp_limb_t **sequences);
     void compute_trace(nmod_poly_t alpha, nmod_poly_t xi, const nmod_poly_t alpha_init,
 	    const nmod_poly_t xi_init, const nmod_poly_t modulus, slong i);
     void compute_xi_init(nmod_poly_t xi_init, const nmod_poly_t modulus, slong r);
+    bool is_subfield_generator(const nmod_poly_t alpha, const nmod_poly_struct *frobenius, slong num,
+	    const nmod_poly_t modulus);
     void find_subfield(nmod_poly_t subfield_modulus, nmod_poly_t embedding_image,
 	    const nmod_poly_t modulus, slong degree);
 
@@ -30,8 +80,13 @@ public:
     /**
      * @param f1 Defining modulus for the first extension k
      * @param f2 Defining modulus for the second extension K
+     * @param num_threads Number of threads used to compute the subfield
+     *        isomorphisms of the distinct prime power factors concurrently;
+     *        the threads left over go to the modular compositions (see
+     *        NmodComposeEngine::set_num_threads)
      */
-    FFEmbedding(const nmod_poly_t f1, const nmod_poly_t f2, slong force_algo = FORCE_NONE, slong derand = 0);
+    FFEmbedding(const nmod_poly_t f1, const nmod_poly_t f2, slong force_algo = FORCE_NONE, slong derand = 0,
+	    slong num_threads = 1);
     ~FFEmbedding();
 
     /**
@@ -39,6 +94,9 @@ public:
      * h: k --> K
      *   g1 --> g2
      * is an embedding  
+     * If the embedding was built with {@code num_threads} > 1, the prime 
+     * power factors of the extension degree are handled in parallel and
+     * the results are summed in factor order.
      * @param g1
      * @param g2
      */
@@ -55,8 +113,9 @@ public:
      * @param r a prime power divisor of the extension degree
      * @param g1
      * @param g2
+     * @param num_threads the threads of the isomorphism of the subfields
      */
-    void compute_generators(nmod_poly_t g1, nmod_poly_t g2, slong r);
+    void compute_generators(nmod_poly_t g1, nmod_poly_t g2, slong r, slong num_threads = 1);
 
     /**
      * Given elements g1, g2 k, K respectively such that
@@ -76,6 +135,43 @@ public:
      */
     void get_x_image(nmod_poly_t x_image);
 
+    /**
+     * Sets the image of x under the embedding k --> K, e.g. to one found
+     * in a {@code FFEmbeddingRegistry}, instead of building it.
+     */
+    void set_x_image(const nmod_poly_t x_image);
+
+    /**
+     * Makes this embedding k --> L the composition of {@code first}: k --> K
+     * and {@code second}: K --> L, so that no generators are computed.
+     * Aborts if the moduli of {@code first} and {@code second} do not chain
+     * from k to L.
+     */
+    void compose(const FFEmbedding &first, const FFEmbedding &second);
+
+    /**
+     * Writes the moduli, the image of x and the generators of the prime 
+     * power subfields to {@code filename} (see {@code FFEmbeddingFile}).
+     * @param with_preimage_data also store the linear form and the scale
+     *        used by {@code compute_preimage}, computing them if needed
+     * @return false if the file could not be written
+     */
+    bool save(const char *filename, bool with_preimage_data = false);
+
+    /**
+     * Reads an embedding written by {@code save}. With {@code use_mmap} the
+     * coefficient arrays are used in place from the mapped file, which
+     * stays mapped as long as the embedding lives, and are only copied if
+     * the embedding is modified. If the file holds the generators,
+     * {@code compute_generators} returns them without recomputing.
+     * @return a new embedding to be deleted by the caller, or NULL if the
+     *         file cannot be read or is not valid: moduli not monic or of
+     *         degrees m, n with m not dividing n, coefficients not reduced
+     *         modulo p, or generators of k and K not paired
+     */
+    static FFEmbedding * load(const char *filename, bool use_mmap = true, slong force_algo = FORCE_NONE,
+            slong derand = 0, slong num_threads = 1);
+
     /**
      * Computes the image of {@code f} under the embedding k --> K
      * using modular composition.
@@ -83,6 +179,41 @@ public:
      * @param f
      */
     void compute_image(nmod_poly_t image, const nmod_poly_t f);
+
+    /**
+     * Computes the images of {@code f[0]}, ..., {@code f[num - 1]} under the
+     * embedding k --> K. The composition by the image of x is prepared once
+     * and kept for later calls; the elements are then mapped in blocks of 
+     * {@code IMAGE_BLOCK_SIZE}, using one matrix product per block. 
+     * The elements must be reduced modulo f1. 
+     * @param images initialized polynomials, may alias {@code f}
+     * @param f
+     * @param num
+     */
+    void compute_images(nmod_poly_struct *images, const nmod_poly_struct *f, slong num);
+
+    /**
+     * Computes the preimage {@code a} of {@code b} under the embedding 
+     * h: k --> K, that is $a(g) = b$ where g is the image of x. 
+     * Let $\ell$ be a random linear form on K, the sequences 
+     * $s_i = \ell(g^i)$ and $t_i = \ell(b g^i)$, $0 \le i < [k:\mathbb{F}_p]$, 
+     * define the linear forms $\lambda$ and $a \circ \lambda$ on k, 
+     * hence $a$ is the quotient of their duals. The form, the powers of g 
+     * and the dual of $\lambda$ are computed once per embedding; each 
+     * element then costs one transposed product and one power projection.
+     * @param a
+     * @param b an element of the image of k in K
+     */
+    void compute_preimage(nmod_poly_t a, const nmod_poly_t b);
+
+    /**
+     * Computes the preimages of {@code b[0]}, ..., {@code b[num - 1]}, as 
+     * in {@code compute_preimage}.
+     * @param a initialized polynomials, may alias {@code b}
+     * @param b
+     * @param num
+     */
+    void compute_preimages(nmod_poly_struct *a, const nmod_poly_struct *b, slong num);
 };
 
 
@@ -0,0 +1,215 @@
+/*
+ * ff_embedding_file.cpp
+ */
+
+#include "ff_embedding_file.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+static const char FF_EMBEDDING_MAGIC[8] = {'F', 'F', 'I', 'S', 'O', 'M', 'E', 'M'};
+static const uint32_t FF_EMBEDDING_BYTE_ORDER = 0x01020304;
+
+/**
+ * FNV-1a 64 of {@code len} bytes, continuing from {@code hash}.
+ */
+static uint64_t fnv1a(uint64_t hash, const unsigned char *data, size_t len) {
+	for (size_t i = 0; i < len; i++)
+		hash = (hash ^ data[i]) * UINT64_C(1099511628211);
+	return hash;
+}
+
+static const uint64_t FNV_OFFSET = UINT64_C(14695981039346656037);
+
+FFEmbeddingFile::FFEmbeddingFile() {
+	characteristic = 0;
+	buffer = NULL;
+	size = 0;
+	mapped = false;
+}
+
+FFEmbeddingFile::~FFEmbeddingFile() {
+	close();
+}
+
+void FFEmbeddingFile::close() {
+	if (buffer == NULL)
+		return;
+	if (mapped)
+		munmap(buffer, size);
+	else
+		flint_free(buffer);
+	buffer = NULL;
+	size = 0;
+}
+
+void FFEmbeddingFile::add_section(uint32_t type, uint64_t param, const mp_limb_t *data, slong length) {
+	Section section;
+	section.type = type;
+	section.flags = 0;
+	section.param = param;
+	section.length = length;
+	section.offset = 0;
+	sections.push_back(section);
+	pending.push_back(data);
+}
+
+bool FFEmbeddingFile::write(const char *filename, mp_limb_t characteristic) {
+	Header header;
+	memcpy(header.magic, FF_EMBEDDING_MAGIC, 8);
+	header.version = VERSION;
+	header.byte_order = FF_EMBEDDING_BYTE_ORDER;
+	header.limb_bits = FLINT_BITS;
+	header.num_sections = sections.size();
+	header.characteristic = characteristic;
+
+	uint64_t offset = sizeof(Header) + sections.size() * sizeof(Section);
+	for (size_t i = 0; i < sections.size(); i++) {
+		sections[i].offset = offset;
+		offset += sections[i].length * sizeof(mp_limb_t);
+	}
+
+	FILE *file = fopen(filename, "wb");
+	if (file == NULL)
+		return false;
+
+	bool ok = true;
+	uint64_t hash = FNV_OFFSET;
+
+	ok = ok && fwrite(&header, sizeof(Header), 1, file) == 1;
+	hash = fnv1a(hash, (const unsigned char *) &header, sizeof(Header));
+	if (!sections.empty()) {
+		ok = ok && fwrite(&sections[0], sizeof(Section), sections.size(), file) == sections.size();
+		hash = fnv1a(hash, (const unsigned char *) &sections[0], sections.size() * sizeof(Section));
+	}
+	for (size_t i = 0; i < sections.size(); i++) {
+		size_t len = sections[i].length;
+		if (len == 0)
+			continue;
+		ok = ok && fwrite(pending[i], sizeof(mp_limb_t), len, file) == len;
+		hash = fnv1a(hash, (const unsigned char *) pending[i], len * sizeof(mp_limb_t));
+	}
+	ok = ok && fwrite(&hash, sizeof(hash), 1, file) == 1;
+
+	ok = (fclose(file) == 0) && ok;
+	return ok;
+}
+
+bool FFEmbeddingFile::open(const char *filename, bool use_mmap) {
+	close();
+	sections.clear();
+	pending.clear();
+
+	int fd = ::open(filename, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < (off_t) (sizeof(Header) + sizeof(uint64_t))) {
+		::close(fd);
+		return false;
+	}
+	size = st.st_size;
+
+	if (use_mmap) {
+		void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (map == MAP_FAILED) {
+			::close(fd);
+			size = 0;
+			return false;
+		}
+		buffer = (unsigned char *) map;
+		mapped = true;
+	} else {
+		buffer = (unsigned char *) flint_malloc(size);
+		mapped = false;
+		size_t done = 0;
+		while (done < size) {
+			ssize_t got = read(fd, buffer + done, size - done);
+			if (got <= 0)
+				break;
+			done += got;
+		}
+		if (done < size) {
+			::close(fd);
+			close();
+			return false;
+		}
+	}
+	::close(fd);
+
+	if (!validate()) {
+		close();
+		sections.clear();
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Checks the header, that every section lies in the payload at a limb
+ * aligned offset, and the checksum.
+ */
+bool FFEmbeddingFile::validate() {
+	Header header;
+	memcpy(&header, buffer, sizeof(Header));
+
+	if (memcmp(header.magic, FF_EMBEDDING_MAGIC, 8) != 0 || header.version != VERSION
+			|| header.byte_order != FF_EMBEDDING_BYTE_ORDER || header.limb_bits != FLINT_BITS)
+		return false;
+
+	size_t payload_end = size - sizeof(uint64_t);
+	if (header.num_sections > (payload_end - sizeof(Header)) / sizeof(Section))
+		return false;
+
+	sections.resize(header.num_sections);
+	if (header.num_sections > 0)
+		memcpy(&sections[0], buffer + sizeof(Header), header.num_sections * sizeof(Section));
+
+	size_t table_end = sizeof(Header) + header.num_sections * sizeof(Section);
+	for (size_t i = 0; i < sections.size(); i++) {
+		if (sections[i].offset % sizeof(mp_limb_t) != 0 || sections[i].offset < table_end
+				|| sections[i].offset > payload_end
+				|| sections[i].length > (payload_end - sections[i].offset) / sizeof(mp_limb_t))
+			return false;
+	}
+
+	uint64_t checksum;
+	memcpy(&checksum, buffer + payload_end, sizeof(checksum));
+	if (fnv1a(FNV_OFFSET, buffer, payload_end) != checksum)
+		return false;
+
+	characteristic = header.characteristic;
+	return true;
+}
+
+mp_limb_t FFEmbeddingFile::get_characteristic() const {
+	return characteristic;
+}
+
+slong FFEmbeddingFile::num_sections() const {
+	return sections.size();
+}
+
+const FFEmbeddingFile::Section & FFEmbeddingFile::section(slong i) const {
+	return sections[i];
+}
+
+const mp_limb_t * FFEmbeddingFile::data(slong i) const {
+	if (buffer == NULL)
+		return pending[i];
+	return (const mp_limb_t *) (buffer + sections[i].offset);
+}
+
+slong FFEmbeddingFile::find(uint32_t type) const {
+	for (size_t i = 0; i < sections.size(); i++)
+		if (sections[i].type == type)
+			return i;
+	return -1;
+}
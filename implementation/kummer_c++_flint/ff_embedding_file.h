@@ -0,0 +1,111 @@
+/*
+ * ff_embedding_file.h
+ *
+ *  Binary container for computed embeddings. The layout is
+ *
+ *    header         magic "FFISOMEM", version, byte order mark, limb size,
+ *                   number of sections, characteristic       (32 bytes)
+ *    section table  type, flags, parameter, length in limbs, offset in
+ *                   bytes of each section                 (32 bytes each)
+ *    payload        the coefficient arrays, limb aligned
+ *    trailer        FNV-1a 64 checksum of everything before it
+ *
+ *  in native byte order; files written on a machine with another byte
+ *  order or limb size are rejected. A file opened with mmap is read in
+ *  place: the section data stay valid as long as the object lives.
+ */
+
+#ifndef FF_EMBEDDING_FILE_H_
+#define FF_EMBEDDING_FILE_H_
+
+#include <flint/flint.h>
+#include <stdint.h>
+#include <vector>
+
+enum {
+    FF_EMBEDDING_SECTION_MODULUS1 = 1,
+    FF_EMBEDDING_SECTION_MODULUS2,
+    FF_EMBEDDING_SECTION_X_IMAGE,
+    // parameter: the prime power r
+    FF_EMBEDDING_SECTION_GENERATOR1,
+    FF_EMBEDDING_SECTION_GENERATOR2,
+    FF_EMBEDDING_SECTION_PREIMAGE_FORM,
+    FF_EMBEDDING_SECTION_PREIMAGE_SCALE
+};
+
+class FFEmbeddingFile {
+public:
+
+    struct Section {
+        uint32_t type;
+        uint32_t flags;
+        uint64_t param;
+        uint64_t length;
+        uint64_t offset;
+    };
+
+private:
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order;
+        uint32_t limb_bits;
+        uint32_t num_sections;
+        uint64_t characteristic;
+    };
+
+    std::vector<Section> sections;
+    std::vector<const mp_limb_t *> pending;
+    uint64_t characteristic;
+
+    // the whole file, either mapped or read into memory
+    unsigned char *buffer;
+    size_t size;
+    bool mapped;
+
+    bool validate();
+    void close();
+
+public:
+
+    static const uint32_t VERSION = 1;
+
+    FFEmbeddingFile();
+    ~FFEmbeddingFile();
+
+    FFEmbeddingFile(const FFEmbeddingFile &) = delete;
+    FFEmbeddingFile & operator=(const FFEmbeddingFile &) = delete;
+
+    /**
+     * Adds a section to be written. {@code data} is not copied and must stay
+     * valid until {@code write} returns.
+     */
+    void add_section(uint32_t type, uint64_t param, const mp_limb_t *data, slong length);
+
+    /**
+     * Writes the sections added so far.
+     * @return false if the file could not be written
+     */
+    bool write(const char *filename, mp_limb_t characteristic);
+
+    /**
+     * Opens a file written by {@code write}, checking the header, the bounds
+     * of the sections and the checksum.
+     * @param use_mmap map the file instead of reading it into memory
+     * @return false if the file cannot be read or is not valid
+     */
+    bool open(const char *filename, bool use_mmap = true);
+
+    mp_limb_t get_characteristic() const;
+    slong num_sections() const;
+    const Section & section(slong i) const;
+    const mp_limb_t * data(slong i) const;
+
+    /**
+     * @return the index of the first section of type {@code type}, or -1
+     */
+    slong find(uint32_t type) const;
+};
+
+#endif /* FF_EMBEDDING_FILE_H_ */
@@ -0,0 +1,314 @@
+/*
+ * ff_embedding_fmpz.cpp
+ */
+
+#include "ff_embedding_fmpz.h"
+#include "ff_isom_prime_power_fmpz.h"
+#include "ff_isom_base_change_fmpz.h"
+#include "fmpz_mod_min_poly.h"
+#include "thread_pool.h"
+
+#include <flint/ulong_extras.h>
+
+/**
+ * Computes $x^{p^r}$ modulo {@code modulus}, by binary powering on the
+ * compositions by $x^p$.
+ */
+void FFEmbeddingFmpz::compute_xi_init(fmpz_mod_poly_t xi_init, const fmpz_mod_poly_t modulus, slong r) {
+	const fmpz *p = fmpz_mod_poly_modulus(modulus);
+
+	fmpz_mod_poly_t frobenius, power, inv;
+	fmpz_mod_poly_init(frobenius, p);
+	fmpz_mod_poly_init(power, p);
+	fmpz_mod_poly_init(inv, p);
+
+	fmpz_mod_poly_reverse(inv, modulus, modulus->length);
+	fmpz_mod_poly_inv_series_newton(inv, inv, modulus->length);
+	fmpz_mod_poly_powmod_x_fmpz_preinv(frobenius, p, modulus, inv);
+	fmpz_mod_poly_set(power, frobenius);
+
+	// reverse the bits of r, needed for binary-powering
+	slong bit_length = n_flog(r, 2) + 1;
+	slong n = n_revbin(r, bit_length);
+
+	for (slong i = 1; i < bit_length; i++) {
+		n >>= 1;
+		fmpz_mod_poly_compose_mod(power, power, power, modulus);
+		if (n & 1)
+			fmpz_mod_poly_compose_mod(power, power, frobenius, modulus);
+	}
+
+	fmpz_mod_poly_set(xi_init, power);
+
+	fmpz_mod_poly_clear(frobenius);
+	fmpz_mod_poly_clear(power);
+	fmpz_mod_poly_clear(inv);
+}
+
+/**
+ * Computes $\alpha = \sum_{j < i} \sigma^j(\alpha_{init})$ and
+ * $\xi = \sigma^i(x)$, where $\sigma$ is the composition by {@code xi_init}.
+ */
+void FFEmbeddingFmpz::compute_trace(fmpz_mod_poly_t alpha, fmpz_mod_poly_t xi, const fmpz_mod_poly_t alpha_init,
+		const fmpz_mod_poly_t xi_init, const fmpz_mod_poly_t modulus, slong i) {
+
+	if (i == 1) {
+		fmpz_mod_poly_set(alpha, alpha_init);
+		fmpz_mod_poly_set(xi, xi_init);
+		return;
+	}
+
+	const fmpz *p = fmpz_mod_poly_modulus(modulus);
+	fmpz_mod_poly_t temp_alpha;
+	fmpz_mod_poly_t temp_xi;
+	fmpz_mod_poly_init(temp_alpha, p);
+	fmpz_mod_poly_init(temp_xi, p);
+
+	if (i % 2 == 0) {
+		compute_trace(temp_alpha, temp_xi, alpha_init, xi_init, modulus, i / 2);
+		fmpz_mod_poly_compose_mod(alpha, temp_alpha, temp_xi, modulus);
+		fmpz_mod_poly_add(alpha, alpha, temp_alpha);
+		fmpz_mod_poly_compose_mod(xi, temp_xi, temp_xi, modulus);
+	} else {
+		compute_trace(temp_alpha, temp_xi, alpha_init, xi_init, modulus, i - 1);
+		fmpz_mod_poly_compose_mod(alpha, temp_alpha, xi_init, modulus);
+		fmpz_mod_poly_add(alpha, alpha, alpha_init);
+		fmpz_mod_poly_compose_mod(xi, temp_xi, xi_init, modulus);
+	}
+
+	fmpz_mod_poly_clear(temp_alpha);
+	fmpz_mod_poly_clear(temp_xi);
+}
+
+/**
+ * Tests whether {@code alpha}, an element of the subfield of degree d,
+ * generates it: {@code frobenius} holds x^{p^{d/q}} for the {@code num}
+ * primes q | d, and {@code alpha} generates iff none of them fixes it.
+ */
+bool FFEmbeddingFmpz::is_subfield_generator(const fmpz_mod_poly_t alpha, const fmpz_mod_poly_struct *frobenius,
+		slong num, const fmpz_mod_poly_t modulus) {
+	if (fmpz_mod_poly_is_zero(alpha))
+		return false;
+
+	fmpz_mod_poly_t conjugate;
+	fmpz_mod_poly_init(conjugate, fmpz_mod_poly_modulus(modulus));
+
+	bool generator = true;
+	for (slong i = 0; i < num && generator; i++) {
+		fmpz_mod_poly_compose_mod(conjugate, alpha, frobenius + i, modulus);
+		generator = !fmpz_mod_poly_equal(conjugate, alpha);
+	}
+
+	fmpz_mod_poly_clear(conjugate);
+	return generator;
+}
+
+/**
+ * Finds a generator of the subfield of degree {@code degree} as the trace
+ * of a random element, and its minimal polynomial.
+ */
+void FFEmbeddingFmpz::find_subfield(fmpz_mod_poly_t subfield_modulus, fmpz_mod_poly_t embedding_image,
+		const fmpz_mod_poly_t modulus, slong degree) {
+	const fmpz *p = fmpz_mod_poly_modulus(modulus);
+
+	// check if the subfield is not proper
+	if (degree == fmpz_mod_poly_degree(modulus)) {
+		fmpz_mod_poly_set(subfield_modulus, modulus);
+		// set to x
+		fmpz_mod_poly_zero(embedding_image);
+		fmpz_mod_poly_set_coeff_ui(embedding_image, 1, 1);
+		return;
+	}
+
+	fmpz_mod_poly_t alpha, xi, alpha_init, xi_init;
+	fmpz_mod_poly_init(alpha, p);
+	fmpz_mod_poly_init(xi, p);
+	fmpz_mod_poly_init(alpha_init, p);
+	fmpz_mod_poly_init(xi_init, p);
+
+	compute_xi_init(xi_init, modulus, degree);
+
+	// x^{p^{degree / q}} for the primes q | degree, shared by all candidates
+	n_factor_t factors;
+	n_factor_init(&factors);
+	n_factor(&factors, degree, 1);
+	fmpz_mod_poly_struct *frobenius = (fmpz_mod_poly_struct *) flint_malloc(FLINT_MAX(factors.num, 1)
+			* sizeof(fmpz_mod_poly_struct));
+	for (slong i = 0; i < factors.num; i++) {
+		fmpz_mod_poly_init(frobenius + i, p);
+		compute_xi_init(frobenius + i, modulus, degree / factors.p[i]);
+	}
+
+	flint_rand_t state;
+	flint_randinit(state);
+
+	// the number of terms in the trace
+	slong n = fmpz_mod_poly_degree(modulus) / degree;
+
+	do {
+		fmpz_mod_poly_randtest(alpha_init, state, fmpz_mod_poly_degree(modulus));
+		compute_trace(alpha, xi, alpha_init, xi_init, modulus, n);
+	} while (!is_subfield_generator(alpha, frobenius, factors.num, modulus));
+
+	// the minimal polynomial of a generator, of known degree
+	FmpzModMinPoly fmpzModMinPoly;
+	fmpzModMinPoly.minimal_polynomial_of_degree(subfield_modulus, alpha, modulus, degree);
+	fmpz_mod_poly_set(embedding_image, alpha);
+
+	for (slong i = 0; i < factors.num; i++)
+		fmpz_mod_poly_clear(frobenius + i);
+	flint_free(frobenius);
+	fmpz_mod_poly_clear(alpha);
+	fmpz_mod_poly_clear(xi);
+	fmpz_mod_poly_clear(alpha_init);
+	fmpz_mod_poly_clear(xi_init);
+	flint_randclear(state);
+}
+
+void FFEmbeddingFmpz::compute_generators(fmpz_mod_poly_t g1, fmpz_mod_poly_t g2, slong r, slong num_threads) {
+	const fmpz *p = fmpz_mod_poly_modulus(modulus1);
+
+	fmpz_mod_poly_t subfield_modulus1, subfield_modulus2;
+	fmpz_mod_poly_t subfield_embd_img1, subfield_embd_img2;
+	fmpz_mod_poly_t subfield_gen1, subfield_gen2;
+	fmpz_mod_poly_init(subfield_modulus1, p);
+	fmpz_mod_poly_init(subfield_modulus2, p);
+	fmpz_mod_poly_init(subfield_embd_img1, p);
+	fmpz_mod_poly_init(subfield_embd_img2, p);
+	fmpz_mod_poly_init(subfield_gen1, p);
+	fmpz_mod_poly_init(subfield_gen2, p);
+
+	find_subfield(subfield_modulus1, subfield_embd_img1, modulus1, r);
+	find_subfield(subfield_modulus2, subfield_embd_img2, modulus2, r);
+
+	// r is small, so it is prime to p: no Artin-Schreier case
+	FFIsomPrimePowerFmpz ffIsomPrimePowerFmpz(subfield_modulus1, subfield_modulus2, num_threads);
+	ffIsomPrimePowerFmpz.compute_generators(subfield_gen1, subfield_gen2);
+
+	// compute generator for subfields in the larger fields
+	fmpz_mod_poly_compose_mod(g1, subfield_gen1, subfield_embd_img1, modulus1);
+	fmpz_mod_poly_compose_mod(g2, subfield_gen2, subfield_embd_img2, modulus2);
+
+	fmpz_mod_poly_clear(subfield_modulus1);
+	fmpz_mod_poly_clear(subfield_modulus2);
+	fmpz_mod_poly_clear(subfield_embd_img1);
+	fmpz_mod_poly_clear(subfield_embd_img2);
+	fmpz_mod_poly_clear(subfield_gen1);
+	fmpz_mod_poly_clear(subfield_gen2);
+}
+
+void FFEmbeddingFmpz::compute_generators(fmpz_mod_poly_t g1, fmpz_mod_poly_t g2) {
+	const fmpz *p = fmpz_mod_poly_modulus(modulus1);
+	slong m = fmpz_mod_poly_degree(modulus1);
+
+	n_factor_t factors;
+	n_factor_init(&factors);
+	n_factor(&factors, m, 1);
+
+	// one generator pair per prime power factor
+	fmpz_mod_poly_struct *subfield_gen1 = (fmpz_mod_poly_struct *) flint_malloc(factors.num * sizeof(fmpz_mod_poly_struct));
+	fmpz_mod_poly_struct *subfield_gen2 = (fmpz_mod_poly_struct *) flint_malloc(factors.num * sizeof(fmpz_mod_poly_struct));
+	for (slong i = 0; i < factors.num; i++) {
+		fmpz_mod_poly_init(subfield_gen1 + i, p);
+		fmpz_mod_poly_init(subfield_gen2 + i, p);
+	}
+
+	if (num_threads > 1 && factors.num > 1) {
+		// the factors are independent: each task only reads the moduli
+		ThreadPool pool(FLINT_MIN(num_threads, (slong) factors.num));
+		// the threads left over go to the isomorphism of each task
+		slong task_threads = FLINT_MAX(num_threads / pool.size(), 1);
+
+		// submit the largest (most expensive) factors first
+		for (slong i = factors.num - 1; i >= 0; i--) {
+			slong r = n_pow(factors.p[i], factors.exp[i]);
+			pool.submit([this, subfield_gen1, subfield_gen2, i, r, task_threads] {
+				compute_generators(subfield_gen1 + i, subfield_gen2 + i, r, task_threads);
+			});
+		}
+		pool.wait();
+	} else {
+		for (slong i = 0; i < factors.num; i++) {
+			slong r = n_pow(factors.p[i], factors.exp[i]);
+			compute_generators(subfield_gen1 + i, subfield_gen2 + i, r, num_threads);
+		}
+	}
+
+	// reduce in factor order so that the result does not depend on scheduling
+	fmpz_mod_poly_zero(g1);
+	fmpz_mod_poly_zero(g2);
+	for (slong i = 0; i < factors.num; i++) {
+		fmpz_mod_poly_add(g1, g1, subfield_gen1 + i);
+		fmpz_mod_poly_add(g2, g2, subfield_gen2 + i);
+		fmpz_mod_poly_clear(subfield_gen1 + i);
+		fmpz_mod_poly_clear(subfield_gen2 + i);
+	}
+	flint_free(subfield_gen1);
+	flint_free(subfield_gen2);
+}
+
+void FFEmbeddingFmpz::build_embedding(const fmpz_mod_poly_t g1, const fmpz_mod_poly_t g2) {
+	const fmpz *p = fmpz_mod_poly_modulus(modulus1);
+
+	fmpz_mod_poly_t x, inv;
+	fmpz_mod_poly_init(x, p);
+	fmpz_mod_poly_init(inv, p);
+	fmpz_mod_poly_set_coeff_ui(x, 1, 1);
+
+	// x = h(g1), so that x --> h(g2)
+	FFIsomBaseChangeFmpz ffIsomBaseChangeFmpz;
+	ffIsomBaseChangeFmpz.change_basis(x_image, g1, x, modulus1);
+	fmpz_mod_poly_compose_mod(x_image, x_image, g2, modulus2);
+
+	fmpz_mod_poly_reverse(inv, modulus2, modulus2->length);
+	fmpz_mod_poly_inv_series_newton(inv, inv, modulus2->length);
+	image_compose.prepare(x_image, modulus2, inv);
+
+	fmpz_mod_poly_clear(x);
+	fmpz_mod_poly_clear(inv);
+}
+
+void FFEmbeddingFmpz::get_x_image(fmpz_mod_poly_t x_image) {
+	fmpz_mod_poly_set(x_image, this->x_image);
+}
+
+void FFEmbeddingFmpz::compute_image(fmpz_mod_poly_t image, const fmpz_mod_poly_t f) {
+	if (!image_compose.is_prepared()) {
+		flint_printf("Exception (FFEmbeddingFmpz::compute_image). Embedding not built.\n");
+		abort();
+	}
+
+	fmpz_mod_poly_t reduced;
+	fmpz_mod_poly_init(reduced, fmpz_mod_poly_modulus(modulus1));
+	fmpz_mod_poly_rem(reduced, f, modulus1);
+	image_compose.apply(image, reduced);
+	fmpz_mod_poly_clear(reduced);
+}
+
+FFEmbeddingFmpz::FFEmbeddingFmpz(const fmpz_mod_poly_t f1, const fmpz_mod_poly_t f2, slong num_threads) {
+	const fmpz *p = fmpz_mod_poly_modulus(f1);
+	slong m = fmpz_mod_poly_degree(f1);
+	slong n = fmpz_mod_poly_degree(f2);
+
+	if (!fmpz_equal(p, fmpz_mod_poly_modulus(f2))) {
+		flint_printf("Exception (FFEmbeddingFmpz). Different characteristics.\n");
+		abort();
+	}
+	if (m < 1 || n % m != 0) {
+		flint_printf("Exception (FFEmbeddingFmpz). The degree of f1 does not divide the one of f2.\n");
+		abort();
+	}
+
+	fmpz_mod_poly_init(modulus1, p);
+	fmpz_mod_poly_init(modulus2, p);
+	fmpz_mod_poly_init(x_image, p);
+	fmpz_mod_poly_set(modulus1, f1);
+	fmpz_mod_poly_set(modulus2, f2);
+	this->num_threads = num_threads;
+}
+
+FFEmbeddingFmpz::~FFEmbeddingFmpz() {
+	fmpz_mod_poly_clear(modulus1);
+	fmpz_mod_poly_clear(modulus2);
+	fmpz_mod_poly_clear(x_image);
+}
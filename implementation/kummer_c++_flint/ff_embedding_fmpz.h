@@ -0,0 +1,86 @@
+/*
+ * ff_embedding_fmpz.h
+ *
+ *  FFEmbedding for a prime of any size, on fmpz_mod_poly: the extension
+ *  degree is split into prime powers, each handled on a pair of subfields by
+ *  FFIsomPrimePowerFmpz, and the image of x is found by a change of basis.
+ */
+
+#ifndef FF_EMBEDDING_FMPZ_H_
+#define FF_EMBEDDING_FMPZ_H_
+
+#include <flint/fmpz_mod_poly.h>
+
+#include "fmpz_mod_poly_compose_mod.h"
+
+class FFEmbeddingFmpz {
+    fmpz_mod_poly_t modulus1;
+    fmpz_mod_poly_t modulus2;
+    fmpz_mod_poly_t x_image;
+
+    slong num_threads;
+
+    // composition by x_image, prepared by build_embedding
+    Fmpz_mod_poly_compose_mod image_compose;
+
+    void compute_xi_init(fmpz_mod_poly_t xi_init, const fmpz_mod_poly_t modulus, slong r);
+    void compute_trace(fmpz_mod_poly_t alpha, fmpz_mod_poly_t xi, const fmpz_mod_poly_t alpha_init,
+	    const fmpz_mod_poly_t xi_init, const fmpz_mod_poly_t modulus, slong i);
+    bool is_subfield_generator(const fmpz_mod_poly_t alpha, const fmpz_mod_poly_struct *frobenius, slong num,
+	    const fmpz_mod_poly_t modulus);
+    void find_subfield(fmpz_mod_poly_t subfield_modulus, fmpz_mod_poly_t embedding_image,
+	    const fmpz_mod_poly_t modulus, slong degree);
+
+public:
+
+    /**
+     * @param f1 Defining modulus for the first extension k, of degree m
+     * @param f2 Defining modulus for the second extension K, of degree a
+     *        multiple of m and the same characteristic; aborts otherwise
+     * @param num_threads Number of threads used to compute the subfield
+     *        isomorphisms of the distinct prime power factors of m
+     *        concurrently; the threads left over go to each isomorphism
+     */
+    FFEmbeddingFmpz(const fmpz_mod_poly_t f1, const fmpz_mod_poly_t f2, slong num_threads = 1);
+    ~FFEmbeddingFmpz();
+
+    FFEmbeddingFmpz(const FFEmbeddingFmpz &) = delete;
+    FFEmbeddingFmpz & operator=(const FFEmbeddingFmpz &) = delete;
+
+    /**
+     * Computes elements g1, g2 of k, K respectively such that
+     * h: k --> K
+     *   g1 --> g2
+     * is an embedding, as the sums of the generators of the subfields of
+     * prime power degree, in factor order.
+     * @param g1
+     * @param g2
+     */
+    void compute_generators(fmpz_mod_poly_t g1, fmpz_mod_poly_t g2);
+
+    /**
+     * Same as above for the subfields k1, K1 of k, K of degree {@code r}, a
+     * prime power divisor of the degree of k.
+     * @param num_threads the threads of the isomorphism of the subfields
+     */
+    void compute_generators(fmpz_mod_poly_t g1, fmpz_mod_poly_t g2, slong r, slong num_threads = 1);
+
+    /**
+     * Given elements g1, g2 of k, K such that g1 --> g2 is an embedding,
+     * builds the embedding x --> g for some g in K.
+     */
+    void build_embedding(const fmpz_mod_poly_t g1, const fmpz_mod_poly_t g2);
+
+    /**
+     * @param x_image The image of x under the embedding k --> K.
+     */
+    void get_x_image(fmpz_mod_poly_t x_image);
+
+    /**
+     * Computes the image of {@code f} under the embedding k --> K, once
+     * {@code build_embedding} has been called.
+     */
+    void compute_image(fmpz_mod_poly_t image, const fmpz_mod_poly_t f);
+};
+
+#endif /* FF_EMBEDDING_FMPZ_H_ */
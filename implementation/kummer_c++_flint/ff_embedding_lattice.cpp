@@ -0,0 +1,209 @@
+/*
+ * ff_embedding_lattice.cpp
+ */
+
+#include "ff_embedding_lattice.h"
+#include "ff_embedding.h"
+
+using namespace std;
+
+FFEmbeddingLattice::Element::Element(mp_limb_t p) {
+	nmod_poly_init(poly, p);
+}
+
+FFEmbeddingLattice::Element::~Element() {
+	nmod_poly_clear(poly);
+}
+
+FFEmbeddingLattice::Level::Level(mp_limb_t p) : modulus(p), next_image(p) {
+}
+
+FFEmbeddingLattice::Field::Field(mp_limb_t p) : modulus(p) {
+}
+
+/**
+ * The exponent of the prime {@code l} in {@code n}.
+ */
+static slong valuation(slong n, mp_limb_t l) {
+	slong k = 0;
+	while (n % l == 0) {
+		n /= l;
+		k++;
+	}
+	return k;
+}
+
+FFEmbeddingLattice::FFEmbeddingLattice(mp_limb_t p, slong force_algo, slong derand, slong num_threads) {
+	this->p = p;
+	this->force_algo = force_algo;
+	this->derand = derand;
+	this->num_threads = num_threads;
+	flint_randinit(state);
+}
+
+FFEmbeddingLattice::~FFEmbeddingLattice() {
+	flint_randclear(state);
+}
+
+/**
+ * Makes sure the reference fields of degree l, ..., l^k exist, each
+ * embedded in the next one.
+ */
+void FFEmbeddingLattice::extend_levels(mp_limb_t l, slong k) {
+	vector<unique_ptr<Level> > &chain = levels[l];
+
+	while ((slong) chain.size() < k) {
+		slong degree = n_pow(l, chain.size() + 1);
+		unique_ptr<Level> level(new Level(p));
+		nmod_poly_randtest_monic_irreducible(level->modulus.poly, state, degree + 1);
+
+		if (!chain.empty()) {
+			Level &previous = *chain.back();
+			nmod_poly_t g1, g2;
+			nmod_poly_init(g1, p);
+			nmod_poly_init(g2, p);
+
+			FFEmbedding ffEmbedding(previous.modulus.poly, level->modulus.poly, force_algo, derand, num_threads);
+			ffEmbedding.compute_generators(g1, g2);
+			ffEmbedding.build_embedding(g1, g2);
+			ffEmbedding.get_x_image(previous.next_image.poly);
+
+			nmod_poly_clear(g1);
+			nmod_poly_clear(g2);
+		}
+
+		chain.push_back(std::move(level));
+	}
+}
+
+/**
+ * Computes the image of x under R_j --> R_k, $j \le k$.
+ */
+void FFEmbeddingLattice::lift_x(nmod_poly_t result, mp_limb_t l, slong j, slong k) {
+	const vector<unique_ptr<Level> > &chain = levels[l];
+
+	nmod_poly_zero(result);
+	nmod_poly_set_coeff_ui(result, 1, 1);
+	for (slong i = j; i < k; i++)
+		nmod_poly_compose_mod(result, result, chain[i - 1]->next_image.poly, chain[i]->modulus.poly);
+}
+
+/**
+ * The canonical generator of the subfield of degree l^j of a field.
+ */
+const nmod_poly_struct * FFEmbeddingLattice::generator(slong field, mp_limb_t l, slong j) {
+	Field &f = *fields[field];
+	slong k = valuation(nmod_poly_degree(f.modulus.poly), l);
+	slong r_top = n_pow(l, k);
+	slong r = n_pow(l, j);
+
+	auto it = f.generators.find(r);
+	if (it != f.generators.end())
+		return it->second->poly;
+
+	// the image of x under R_k --> F, the only embedding computed per field
+	if (f.generators.find(r_top) == f.generators.end()) {
+		extend_levels(l, k);
+
+		unique_ptr<Element> image(new Element(p));
+		nmod_poly_t g1, g2;
+		nmod_poly_init(g1, p);
+		nmod_poly_init(g2, p);
+
+		FFEmbedding ffEmbedding(levels[l][k - 1]->modulus.poly, f.modulus.poly, force_algo, derand, num_threads);
+		ffEmbedding.compute_generators(g1, g2);
+		ffEmbedding.build_embedding(g1, g2);
+		ffEmbedding.get_x_image(image->poly);
+
+		nmod_poly_clear(g1);
+		nmod_poly_clear(g2);
+		f.generators[r_top] = std::move(image);
+	}
+
+	if (j == k)
+		return f.generators[r_top]->poly;
+
+	// R_j --> R_k --> F
+	unique_ptr<Element> image(new Element(p));
+	lift_x(image->poly, l, j, k);
+	nmod_poly_compose_mod(image->poly, image->poly, f.generators[r_top]->poly, f.modulus.poly);
+
+	const nmod_poly_struct *result = image->poly;
+	f.generators[r] = std::move(image);
+	return result;
+}
+
+slong FFEmbeddingLattice::add_field(const nmod_poly_t f) {
+	if (f->mod.n != p || nmod_poly_degree(f) < 1)
+		return -1;
+
+	for (size_t i = 0; i < fields.size(); i++)
+		if (nmod_poly_equal(fields[i]->modulus.poly, f))
+			return i;
+
+	unique_ptr<Field> field(new Field(p));
+	nmod_poly_set(field->modulus.poly, f);
+	fields.push_back(std::move(field));
+	return fields.size() - 1;
+}
+
+slong FFEmbeddingLattice::num_fields() const {
+	return fields.size();
+}
+
+void FFEmbeddingLattice::get_generator(nmod_poly_t g, slong field, slong r) {
+	n_factor_t factors;
+	n_factor_init(&factors);
+	n_factor(&factors, r, 1);
+
+	if (factors.num != 1 || nmod_poly_degree(fields[field]->modulus.poly) % r != 0) {
+		flint_printf("Exception (FFEmbeddingLattice::get_generator). Not a prime power dividing the degree.\n");
+		abort();
+	}
+
+	nmod_poly_set(g, generator(field, factors.p[0], factors.exp[0]));
+}
+
+bool FFEmbeddingLattice::get_x_image(nmod_poly_t x_image, slong from, slong to) {
+	const nmod_poly_struct *f1 = fields[from]->modulus.poly;
+	const nmod_poly_struct *f2 = fields[to]->modulus.poly;
+	slong m = nmod_poly_degree(f1);
+	slong n = nmod_poly_degree(f2);
+
+	if (n % m != 0)
+		return false;
+
+	// F_p itself: x is the root of f1
+	if (m == 1) {
+		nmod_poly_zero(x_image);
+		nmod_poly_set_coeff_ui(x_image, 0, nmod_neg(nmod_poly_get_coeff_ui(f1, 0), f1->mod));
+		return true;
+	}
+
+	if (from == to) {
+		nmod_poly_zero(x_image);
+		nmod_poly_set_coeff_ui(x_image, 1, 1);
+		return true;
+	}
+
+	n_factor_t factors;
+	n_factor_init(&factors);
+	n_factor(&factors, m, 1);
+
+	// the canonical generators of k and of their images in K
+	nmod_poly_t g1, g2;
+	nmod_poly_init(g1, p);
+	nmod_poly_init(g2, p);
+	for (slong i = 0; i < factors.num; i++) {
+		nmod_poly_add(g1, g1, generator(from, factors.p[i], factors.exp[i]));
+		nmod_poly_add(g2, g2, generator(to, factors.p[i], factors.exp[i]));
+	}
+
+	FFEmbedding ffEmbedding(f1, f2, force_algo, derand, num_threads);
+	ffEmbedding.build_embedding(g1, g2);
+	ffEmbedding.get_x_image(x_image);
+
+	nmod_poly_clear(g1);
+	nmod_poly_clear(g2);
+	return true;
+}
@@ -0,0 +1,109 @@
+/*
+ * ff_embedding_lattice.h
+ *
+ *  A lattice of extensions of F_p with compatible embeddings: for fields
+ *  k, K, L in the lattice with k --> K --> L, the embedding k --> L is the
+ *  composition of k --> K and K --> L.
+ *
+ *  For every prime l the lattice keeps reference fields R_1 --> R_2 --> ...
+ *  of degree l, l^2, ..., each embedded in the next. A field F of degree
+ *  divisible by exactly l^k gets one embedding R_k --> F, computed once;
+ *  the canonical generator of the subfield of degree r = l^j of F is the
+ *  image of x under R_j --> R_k --> F. The embedding k --> K is then the
+ *  one mapping the canonical generators of k to those of K, so that only
+ *  a change of basis is left to compute per pair.
+ */
+
+#ifndef FF_EMBEDDING_LATTICE_H_
+#define FF_EMBEDDING_LATTICE_H_
+
+#include <flint/nmod_poly.h>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "ff_isom_prime_power_ext.h"
+
+class FFEmbeddingLattice {
+
+    struct Element {
+        nmod_poly_t poly;
+
+        Element(mp_limb_t p);
+        ~Element();
+        Element(const Element &) = delete;
+        Element & operator=(const Element &) = delete;
+    };
+
+    struct Level {
+        // defining modulus of the reference field of degree l^k
+        Element modulus;
+        // the image of x in the next level, empty for the top level
+        Element next_image;
+
+        Level(mp_limb_t p);
+    };
+
+    struct Field {
+        Element modulus;
+        // canonical generators, indexed by the prime power r
+        std::map<slong, std::unique_ptr<Element> > generators;
+
+        Field(mp_limb_t p);
+    };
+
+    mp_limb_t p;
+    slong force_algo;
+    slong derand;
+    slong num_threads;
+
+    std::vector<std::unique_ptr<Field> > fields;
+    // the reference fields of degree l, l^2, ..., indexed by l
+    std::map<mp_limb_t, std::vector<std::unique_ptr<Level> > > levels;
+
+    flint_rand_t state;
+
+    void extend_levels(mp_limb_t l, slong k);
+    void lift_x(nmod_poly_t result, mp_limb_t l, slong j, slong k);
+    const nmod_poly_struct * generator(slong field, mp_limb_t l, slong j);
+
+public:
+
+    /**
+     * @param p the characteristic
+     * @param force_algo, derand, num_threads passed to the {@code FFEmbedding}
+     *        of the reference fields
+     */
+    FFEmbeddingLattice(mp_limb_t p, slong force_algo = FORCE_NONE, slong derand = 0, slong num_threads = 1);
+    ~FFEmbeddingLattice();
+
+    FFEmbeddingLattice(const FFEmbeddingLattice &) = delete;
+    FFEmbeddingLattice & operator=(const FFEmbeddingLattice &) = delete;
+
+    /**
+     * Adds the field defined by the irreducible {@code f}.
+     * @return the index of the field, the existing one if {@code f} was
+     *         already added, or -1 if the characteristic does not match
+     */
+    slong add_field(const nmod_poly_t f);
+
+    slong num_fields() const;
+
+    /**
+     * Computes the canonical generator of the subfield of degree {@code r}
+     * of a field of the lattice.
+     * @param r a prime power dividing the degree of the field
+     */
+    void get_generator(nmod_poly_t g, slong field, slong r);
+
+    /**
+     * Computes the image of x under the embedding of the field {@code from}
+     * into the field {@code to}.
+     * @return false if the degree of {@code from} does not divide that of
+     *         {@code to}
+     */
+    bool get_x_image(nmod_poly_t x_image, slong from, slong to);
+};
+
+#endif /* FF_EMBEDDING_LATTICE_H_ */
@@ -0,0 +1,175 @@
+/*
+ * ff_embedding_registry.cpp
+ */
+
+#include "ff_embedding_registry.h"
+#include "ff_embedding.h"
+
+using namespace std;
+
+bool FFEmbeddingRegistry::Key::operator==(const Key &other) const {
+	return p == other.p && modulus1 == other.modulus1 && modulus2 == other.modulus2;
+}
+
+/**
+ * FNV-1a over the characteristic and the coefficients of both moduli.
+ */
+size_t FFEmbeddingRegistry::KeyHash::operator()(const Key &key) const {
+	uint64_t hash = UINT64_C(14695981039346656037);
+	const uint64_t prime = UINT64_C(1099511628211);
+
+	hash = (hash ^ key.p) * prime;
+	hash = (hash ^ key.modulus1.size()) * prime;
+	for (size_t i = 0; i < key.modulus1.size(); i++)
+		hash = (hash ^ key.modulus1[i]) * prime;
+	for (size_t i = 0; i < key.modulus2.size(); i++)
+		hash = (hash ^ key.modulus2[i]) * prime;
+
+	return (size_t) hash;
+}
+
+void FFEmbeddingRegistry::make_key(Key &key, const nmod_poly_t modulus1, const nmod_poly_t modulus2) {
+	key.p = modulus1->mod.n;
+	key.modulus1.assign(modulus1->coeffs, modulus1->coeffs + modulus1->length);
+	key.modulus2.assign(modulus2->coeffs, modulus2->coeffs + modulus2->length);
+}
+
+/**
+ * Drops least recently used entries until the bound on the memory holds.
+ * The caller holds the lock.
+ */
+void FFEmbeddingRegistry::evict() {
+	while (used_bytes > max_bytes && !entries.empty()) {
+		used_bytes -= entries.back().bytes;
+		index.erase(entries.back().key);
+		entries.pop_back();
+	}
+}
+
+FFEmbeddingRegistry::FFEmbeddingRegistry(size_t max_bytes) {
+	this->max_bytes = max_bytes;
+	used_bytes = 0;
+	num_hits = 0;
+	num_misses = 0;
+}
+
+FFEmbeddingRegistry & FFEmbeddingRegistry::global() {
+	static FFEmbeddingRegistry registry;
+	return registry;
+}
+
+bool FFEmbeddingRegistry::lookup(nmod_poly_t x_image, const nmod_poly_t f1, const nmod_poly_t f2) {
+	Key key;
+	make_key(key, f1, f2);
+
+	lock_guard<std::mutex> lock(registry_mutex);
+	auto it = index.find(key);
+	if (it == index.end()) {
+		num_misses++;
+		return false;
+	}
+
+	num_hits++;
+	entries.splice(entries.begin(), entries, it->second);
+
+	const vector<mp_limb_t> &image = it->second->x_image;
+	nmod_poly_fit_length(x_image, image.size());
+	for (size_t i = 0; i < image.size(); i++)
+		x_image->coeffs[i] = image[i];
+	_nmod_poly_set_length(x_image, image.size());
+
+	return true;
+}
+
+void FFEmbeddingRegistry::insert(const nmod_poly_t f1, const nmod_poly_t f2, const nmod_poly_t x_image) {
+	Entry entry;
+	make_key(entry.key, f1, f2);
+	entry.x_image.assign(x_image->coeffs, x_image->coeffs + x_image->length);
+	entry.bytes = sizeof(Entry) + (entry.key.modulus1.size() + entry.key.modulus2.size()
+			+ entry.x_image.size()) * sizeof(mp_limb_t);
+
+	lock_guard<std::mutex> lock(registry_mutex);
+	auto it = index.find(entry.key);
+	if (it != index.end()) {
+		used_bytes -= it->second->bytes;
+		entries.erase(it->second);
+		index.erase(it);
+	}
+
+	entries.push_front(entry);
+	index[entries.front().key] = entries.begin();
+	used_bytes += entry.bytes;
+	evict();
+}
+
+void FFEmbeddingRegistry::get_x_image(nmod_poly_t x_image, const nmod_poly_t f1, const nmod_poly_t f2,
+		slong force_algo, slong derand, slong num_threads) {
+	if (lookup(x_image, f1, f2))
+		return;
+
+	nmod_poly_t g1, g2;
+	nmod_poly_init(g1, f1->mod.n);
+	nmod_poly_init(g2, f2->mod.n);
+
+	FFEmbedding ffEmbedding(f1, f2, force_algo, derand, num_threads);
+	ffEmbedding.compute_generators(g1, g2);
+	ffEmbedding.build_embedding(g1, g2);
+	ffEmbedding.get_x_image(x_image);
+
+	insert(f1, f2, x_image);
+
+	nmod_poly_clear(g1);
+	nmod_poly_clear(g2);
+}
+
+void FFEmbeddingRegistry::compose(nmod_poly_t x_image, const nmod_poly_t f1, const nmod_poly_t f2, const nmod_poly_t f3) {
+	if (lookup(x_image, f1, f3))
+		return;
+
+	nmod_poly_t inner, outer;
+	nmod_poly_init(inner, f2->mod.n);
+	nmod_poly_init(outer, f3->mod.n);
+
+	get_x_image(inner, f1, f2);
+	get_x_image(outer, f2, f3);
+
+	// x --> inner(x) --> inner(outer(x))
+	nmod_poly_compose_mod(x_image, inner, outer, f3);
+	insert(f1, f3, x_image);
+
+	nmod_poly_clear(inner);
+	nmod_poly_clear(outer);
+}
+
+void FFEmbeddingRegistry::clear() {
+	lock_guard<std::mutex> lock(registry_mutex);
+	entries.clear();
+	index.clear();
+	used_bytes = 0;
+}
+
+void FFEmbeddingRegistry::set_max_bytes(size_t max_bytes) {
+	lock_guard<std::mutex> lock(registry_mutex);
+	this->max_bytes = max_bytes;
+	evict();
+}
+
+size_t FFEmbeddingRegistry::bytes() {
+	lock_guard<std::mutex> lock(registry_mutex);
+	return used_bytes;
+}
+
+slong FFEmbeddingRegistry::size() {
+	lock_guard<std::mutex> lock(registry_mutex);
+	return entries.size();
+}
+
+slong FFEmbeddingRegistry::hits() {
+	lock_guard<std::mutex> lock(registry_mutex);
+	return num_hits;
+}
+
+slong FFEmbeddingRegistry::misses() {
+	lock_guard<std::mutex> lock(registry_mutex);
+	return num_misses;
+}
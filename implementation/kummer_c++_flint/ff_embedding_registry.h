@@ -0,0 +1,108 @@
+/*
+ * ff_embedding_registry.h
+ *
+ *  An in-process cache of embeddings k --> K, keyed by the characteristic
+ *  and the two defining moduli. Only the image of x is kept, which is all
+ *  that is needed to rebuild the embedding.
+ */
+
+#ifndef FF_EMBEDDING_REGISTRY_H_
+#define FF_EMBEDDING_REGISTRY_H_
+
+#include <flint/nmod_poly.h>
+
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "ff_isom_prime_power_ext.h"
+
+class FFEmbeddingRegistry {
+
+    struct Key {
+        mp_limb_t p;
+        std::vector<mp_limb_t> modulus1;
+        std::vector<mp_limb_t> modulus2;
+
+        bool operator==(const Key &other) const;
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key &key) const;
+    };
+
+    struct Entry {
+        Key key;
+        std::vector<mp_limb_t> x_image;
+        size_t bytes;
+    };
+
+    // most recently used first
+    std::list<Entry> entries;
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+    size_t max_bytes;
+    size_t used_bytes;
+    slong num_hits;
+    slong num_misses;
+    std::mutex registry_mutex;
+
+    static void make_key(Key &key, const nmod_poly_t modulus1, const nmod_poly_t modulus2);
+    void evict();
+
+public:
+
+    /**
+     * @param max_bytes bound on the memory used by the cached entries; the
+     *        least recently used entries are dropped when it is exceeded
+     */
+    FFEmbeddingRegistry(size_t max_bytes = 64 << 20);
+
+    FFEmbeddingRegistry(const FFEmbeddingRegistry &) = delete;
+    FFEmbeddingRegistry & operator=(const FFEmbeddingRegistry &) = delete;
+
+    /**
+     * A process-wide registry.
+     */
+    static FFEmbeddingRegistry & global();
+
+    /**
+     * Looks up the embedding defined by {@code f1}, {@code f2}.
+     * @return true and the image of x in {@code x_image} on a hit
+     */
+    bool lookup(nmod_poly_t x_image, const nmod_poly_t f1, const nmod_poly_t f2);
+
+    /**
+     * Records {@code x_image} as the image of x under the embedding
+     * defined by {@code f1}, {@code f2}.
+     */
+    void insert(const nmod_poly_t f1, const nmod_poly_t f2, const nmod_poly_t x_image);
+
+    /**
+     * Returns the image of x under the embedding defined by {@code f1},
+     * {@code f2}, computing it with {@code FFEmbedding} on a miss. The
+     * computation runs without holding the lock, so that lookups of other
+     * embeddings are not blocked; two threads missing on the same pair
+     * may both compute it.
+     */
+    void get_x_image(nmod_poly_t x_image, const nmod_poly_t f1, const nmod_poly_t f2,
+            slong force_algo = FORCE_NONE, slong derand = 0, slong num_threads = 1);
+
+    /**
+     * Computes the image of x under the embedding k --> L defined by
+     * {@code f1}, {@code f3} as the composition of k --> K and K --> L,
+     * where K is defined by {@code f2}. Both factors are taken from the
+     * registry (or computed and recorded), and so is the result.
+     */
+    void compose(nmod_poly_t x_image, const nmod_poly_t f1, const nmod_poly_t f2, const nmod_poly_t f3);
+
+    void clear();
+    void set_max_bytes(size_t max_bytes);
+
+    size_t bytes();
+    slong size();
+    slong hits();
+    slong misses();
+};
+
+#endif /* FF_EMBEDDING_REGISTRY_H_ */
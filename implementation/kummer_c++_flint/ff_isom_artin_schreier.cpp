@@ -1,6 +1,7 @@
 
 
 #include "ff_isom_artin_schreier.h"
+#include "nmod_poly_compose_engine.h"
 #include <flint/nmod_poly.h>
 
 void FFIsomArtinSchreier::compute_hilbert_90_expression(nmod_poly_t xi, nmod_poly_t beta_a, 
@@ -13,7 +14,7 @@ void FFIsomArtinSchreier::compute_hilbert_90_expression(nmod_poly_t xi, nmod_pol
 		nmod_poly_set(beta_theta, theta);
 		nmod_poly_set(beta_a, a);
 		
-		nmod_poly_compose_mod(alpha, theta, xi_init, modulus);
+		NmodComposeEngine::compose_mod(alpha, theta, xi_init, modulus);
 		nmod_poly_mulmod(alpha, alpha, a, modulus);
 		
 		return;
@@ -36,19 +37,19 @@ void FFIsomArtinSchreier::compute_hilbert_90_expression(nmod_poly_t xi, nmod_pol
 		compute_hilbert_90_expression(temp_xi, temp_beta_a, temp_beta_theta, 
 				temp_alpha, xi_init, a, theta, modulus, n / 2);
 		
-		nmod_poly_compose_mod(xi, temp_xi, temp_xi, modulus);
+		NmodComposeEngine::compose_mod(xi, temp_xi, temp_xi, modulus);
 		
-		nmod_poly_compose_mod(beta_a, temp_beta_a, temp_xi, modulus);
+		NmodComposeEngine::compose_mod(beta_a, temp_beta_a, temp_xi, modulus);
 		nmod_poly_add(beta_a, beta_a, temp_beta_a);	
 		
-		nmod_poly_compose_mod(beta_theta, temp_beta_theta, temp_xi, modulus);
+		NmodComposeEngine::compose_mod(beta_theta, temp_beta_theta, temp_xi, modulus);
 		// need this for computing alpha
 		nmod_poly_set(temp, beta_theta);
 		nmod_poly_add(beta_theta, beta_theta, temp_beta_theta);
 		
-		nmod_poly_compose_mod(temp, temp, xi_init, modulus);
+		NmodComposeEngine::compose_mod(temp, temp, xi_init, modulus);
 		nmod_poly_mulmod(temp, temp, temp_beta_a, modulus);
-		nmod_poly_compose_mod(alpha, temp_alpha, temp_xi, modulus);
+		NmodComposeEngine::compose_mod(alpha, temp_alpha, temp_xi, modulus);
 		nmod_poly_add(alpha, alpha, temp_alpha);
 		nmod_poly_add(alpha, alpha, temp);
 		
@@ -57,21 +58,21 @@ void FFIsomArtinSchreier::compute_hilbert_90_expression(nmod_poly_t xi, nmod_pol
 		compute_hilbert_90_expression(temp_xi, temp_beta_a, temp_beta_theta, 
 				temp_alpha, xi_init, a, theta, modulus, n - 1);
 		
-		nmod_poly_compose_mod(xi, temp_xi, xi_init, modulus);
+		NmodComposeEngine::compose_mod(xi, temp_xi, xi_init, modulus);
 		
-		nmod_poly_compose_mod(beta_a, temp_beta_a, xi_init, modulus);
+		NmodComposeEngine::compose_mod(beta_a, temp_beta_a, xi_init, modulus);
 		nmod_poly_add(beta_a, beta_a, a);
 		
-		nmod_poly_compose_mod(beta_theta, temp_beta_theta, xi_init, modulus);
+		NmodComposeEngine::compose_mod(beta_theta, temp_beta_theta, xi_init, modulus);
 		// need this for computing alpha
 		nmod_poly_set(temp, beta_theta);
 		nmod_poly_add(beta_theta, beta_theta, theta);
 		
-		nmod_poly_compose_mod(temp, temp, xi_init, modulus);
+		NmodComposeEngine::compose_mod(temp, temp, xi_init, modulus);
 		nmod_poly_mulmod(temp, temp, a, modulus);
-		nmod_poly_compose_mod(alpha, temp_alpha, xi_init, modulus);
+		NmodComposeEngine::compose_mod(alpha, temp_alpha, xi_init, modulus);
 		// compute alpha1, and add it
-		nmod_poly_compose_mod(temp_alpha, theta, xi_init, modulus);
+		NmodComposeEngine::compose_mod(temp_alpha, theta, xi_init, modulus);
 		nmod_poly_mulmod(temp_alpha, temp_alpha, a, modulus);
 		nmod_poly_add(alpha, alpha, temp_alpha);
 		nmod_poly_add(alpha, alpha, temp);
@@ -109,7 +110,7 @@ void FFIsomArtinSchreier::compute_hilbert_90_solution(nmod_poly_t result, const
 				a, theta, modulus, r - 1);
 		
 		// compute the trace of theta
-		nmod_poly_compose_mod(theta, theta, xi, modulus);
+		NmodComposeEngine::compose_mod(theta, theta, xi, modulus);
 		nmod_poly_add(beta_theta, beta_theta, theta);
 		
 		if (!nmod_poly_is_zero(beta_theta))
@@ -130,9 +131,160 @@ void FFIsomArtinSchreier::compute_hilbert_90_solution(nmod_poly_t result, const
 }
 
 
+void FFIsomArtinSchreier::compute_hilbert_90_expression(Gf2Poly &xi, Gf2Poly &beta_a,
+		Gf2Poly &beta_theta, Gf2Poly &alpha, const Gf2Poly &xi_init,
+		const Gf2PolyComposeMod &compose_xi_init,
+		const Gf2Poly &a, const Gf2Poly &theta, const Gf2PolyModulus &modulus,
+		slong n){
+
+	if (n == 1) {
+		xi = xi_init;
+		beta_theta = theta;
+		beta_a = a;
+
+		compose_xi_init.apply(alpha, theta);
+		modulus.mulmod(alpha, alpha, a);
+
+		return;
+	}
+
+	Gf2Poly temp_xi;
+	Gf2Poly temp_beta_a;
+	Gf2Poly temp_beta_theta;
+	Gf2Poly temp_alpha;
+	Gf2Poly temp;
+
+	if ((n & 1) == 0) {
+
+		compute_hilbert_90_expression(temp_xi, temp_beta_a, temp_beta_theta,
+				temp_alpha, xi_init, compose_xi_init, a, theta, modulus, n / 2);
+
+		Gf2PolyComposeMod compose_xi(temp_xi, modulus);
+		compose_xi.apply(xi, temp_xi);
+
+		compose_xi.apply(beta_a, temp_beta_a);
+		Gf2Poly::add(beta_a, beta_a, temp_beta_a);
+
+		compose_xi.apply(beta_theta, temp_beta_theta);
+		// need this for computing alpha
+		temp = beta_theta;
+		Gf2Poly::add(beta_theta, beta_theta, temp_beta_theta);
+
+		compose_xi_init.apply(temp, temp);
+		modulus.mulmod(temp, temp, temp_beta_a);
+		compose_xi.apply(alpha, temp_alpha);
+		Gf2Poly::add(alpha, alpha, temp_alpha);
+		Gf2Poly::add(alpha, alpha, temp);
+
+	} else {
+
+		compute_hilbert_90_expression(temp_xi, temp_beta_a, temp_beta_theta,
+				temp_alpha, xi_init, compose_xi_init, a, theta, modulus, n - 1);
+
+		compose_xi_init.apply(xi, temp_xi);
+
+		compose_xi_init.apply(beta_a, temp_beta_a);
+		Gf2Poly::add(beta_a, beta_a, a);
+
+		compose_xi_init.apply(beta_theta, temp_beta_theta);
+		// need this for computing alpha
+		temp = beta_theta;
+		Gf2Poly::add(beta_theta, beta_theta, theta);
+
+		compose_xi_init.apply(temp, temp);
+		modulus.mulmod(temp, temp, a);
+		compose_xi_init.apply(alpha, temp_alpha);
+		// compute alpha1, and add it
+		compose_xi_init.apply(temp_alpha, theta);
+		modulus.mulmod(temp_alpha, temp_alpha, a);
+		Gf2Poly::add(alpha, alpha, temp_alpha);
+		Gf2Poly::add(alpha, alpha, temp);
+	}
+}
+
+void FFIsomArtinSchreier::compute_hilbert_90_solution(Gf2Poly &result, const Gf2Poly &a,
+		const Gf2Poly &xi_init, const Gf2PolyComposeMod &compose_xi_init, const Gf2PolyModulus &modulus) {
+
+	slong r = modulus.degree();
+	Gf2Poly xi;
+	Gf2Poly beta_a;
+	Gf2Poly beta_theta;
+	Gf2Poly alpha;
+	Gf2Poly theta;
+
+	flint_rand_t state;
+	flint_randinit(state);
+
+	while (true) {
+		theta.zero();
+		for (slong i = 0; i < r; i++)
+			if (n_randint(state, 2))
+				theta.set_coeff(i, 1);
+		if (theta.is_zero())
+			continue;
+
+		compute_hilbert_90_expression(xi, beta_a, beta_theta, alpha, xi_init,
+				compose_xi_init, a, theta, modulus, r - 1);
+
+		// compute the trace of theta
+		Gf2PolyComposeMod(xi, modulus).apply(theta, theta);
+		Gf2Poly::add(beta_theta, beta_theta, theta);
+
+		// the trace is in GF(2), so a nonzero trace is 1
+		if (!beta_theta.is_zero())
+			break;
+	}
+
+	result = alpha;
+	flint_randclear(state);
+}
+
+/**
+ * The tower of the odd case degenerates for p = 2 (its first constant is
+ * zero); this follows Wiedemann's tower instead, x_{i+1} + 1 / x_{i+1} = x_i
+ * with x_0 = 1. Writing x_{i+1} = x_i y, y is a root of y^2 + y = 1 / x_i^2.
+ */
+void FFIsomArtinSchreier::compute_generator_gf2(nmod_poly_t result, const nmod_poly_t modulus,
+		slong exponent){
+
+	Gf2PolyModulus gf2_modulus(modulus);
+
+	Gf2Poly root;
+	root.one();
+
+	Gf2Poly const_coeff;
+	Gf2Poly solution;
+
+	Gf2Poly xi_init;
+	xi_init.set_coeff(1, 1);
+	gf2_modulus.mulmod(xi_init, xi_init, xi_init);
+	Gf2PolyComposeMod compose_xi_init(xi_init, gf2_modulus);
+
+	nmod_poly_t inverse;
+	nmod_poly_init(inverse, modulus->mod.n);
+
+	for (slong i = 0; i < exponent; i++) {
+		root.get(inverse);
+		nmod_poly_invmod(inverse, inverse, modulus);
+		const_coeff.set(inverse);
+		gf2_modulus.mulmod(const_coeff, const_coeff, const_coeff);
+
+		compute_hilbert_90_solution(solution, const_coeff, xi_init, compose_xi_init, gf2_modulus);
+		gf2_modulus.mulmod(root, root, solution);
+	}
+
+	root.get(result);
+	nmod_poly_clear(inverse);
+}
+
 void FFIsomArtinSchreier::compute_generator(nmod_poly_t result, const nmod_poly_t modulus,
 		slong exponent){
 	
+	if (modulus->mod.n == 2) {
+		compute_generator_gf2(result, modulus, exponent);
+		return;
+	}
+
 	nmod_poly_t const_coeff;
 	nmod_poly_init(const_coeff, modulus->mod.n);
 	nmod_poly_one(const_coeff);
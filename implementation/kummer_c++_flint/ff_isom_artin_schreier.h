@@ -9,6 +9,7 @@
 #define FF_ISOM_ARTIN_SCHREIER_H
 
 #include <flint/nmod_poly.h>
+#include "gf2_poly.h"
 
 class FFIsomArtinSchreier {
     nmod_poly_t modulus1;
@@ -22,6 +23,19 @@ class FFIsomArtinSchreier {
 	    const nmod_poly_t xi_init, const nmod_poly_t modulus);
     void compute_generator(nmod_poly_t result, const nmod_poly_t modulus, slong exponent);
 
+    /**
+     * The same recursion for p = 2, on packed polynomials, with the
+     * compositions by xi_init prepared once.
+     */
+    void compute_hilbert_90_expression(Gf2Poly &xi, Gf2Poly &beta_a,
+	    Gf2Poly &beta_theta, Gf2Poly &alpha, const Gf2Poly &xi_init,
+	    const Gf2PolyComposeMod &compose_xi_init,
+	    const Gf2Poly &a, const Gf2Poly &theta, const Gf2PolyModulus &modulus,
+	    slong n);
+    void compute_hilbert_90_solution(Gf2Poly &result, const Gf2Poly &a,
+	    const Gf2Poly &xi_init, const Gf2PolyComposeMod &compose_xi_init, const Gf2PolyModulus &modulus);
+    void compute_generator_gf2(nmod_poly_t result, const nmod_poly_t modulus, slong exponent);
+
 public:
 
     /**
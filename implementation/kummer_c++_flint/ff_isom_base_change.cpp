@@ -7,6 +7,7 @@
 
 #include "ff_isom_base_change.h"
 #include "nmod_min_poly.h"
+#include "nmod_poly_power_projection.h"
 #include <iostream>
 
 using namespace std;
@@ -39,6 +40,20 @@ void FFIsomBaseChange::monomial_to_dual(mp_limb_t *dual, const nmod_poly_t a, co
  * in monomial basis modulo {@code modulus} 
  */
 void FFIsomBaseChange::dual_to_monomial(nmod_poly_t result, const mp_limb_t *dual, const nmod_poly_t modulus) {
+	nmod_poly_t temp;
+	nmod_poly_init(temp, modulus->mod.n);
+
+	// compute 1 / modulus'
+	nmod_poly_derivative(temp, modulus);
+	nmod_poly_invmod(temp, temp, modulus);
+
+	dual_to_monomial(result, dual, modulus, temp);
+
+	nmod_poly_clear(temp);
+}
+
+void FFIsomBaseChange::dual_to_monomial(nmod_poly_t result, const mp_limb_t *dual, const nmod_poly_t modulus,
+		const nmod_poly_t modulus_derivative_inv) {
 	nmod_poly_t temp1;
 	nmod_poly_t temp2;
 	nmod_poly_init(temp1, modulus->mod.n);
@@ -53,11 +68,7 @@ void FFIsomBaseChange::dual_to_monomial(nmod_poly_t result, const mp_limb_t *dua
 
 	nmod_poly_reverse(temp2, temp1, m);
 
-	// compute 1 / modulus'
-	nmod_poly_derivative(temp1, modulus);
-	nmod_poly_invmod(temp1, temp1, modulus);
-
-	nmod_poly_mulmod(result, temp1, temp2, modulus);
+	nmod_poly_mulmod(result, modulus_derivative_inv, temp2, modulus);
 
 	nmod_poly_clear(temp1);
 	nmod_poly_clear(temp2);
@@ -81,9 +92,12 @@ void FFIsomBaseChange::change_basis(nmod_poly_t result, const nmod_poly_t f, con
 	nmod_poly_reverse(modulus_inv_rev2, modulus, degree + 1);
 	nmod_poly_inv_series_newton(modulus_inv_rev2, modulus_inv_rev2, degree - 1);
 
+	// the powers of f, shared by its minimal polynomial and the projection below
+	Nmod_poly_power_projection projection(f, modulus, modulus_inv_rev2, n_sqrt(2 * degree) + 1);
+
 	// compute the minimal polynomial of f
 	NmodMinPoly nmodMinPoly;
-	nmodMinPoly.minimal_polynomial(min_poly, f, modulus, modulus_inv_rev2);
+	nmodMinPoly.minimal_polynomial(min_poly, f, modulus, modulus_inv_rev2, projection);
 
 	mp_limb_t *dual = new mp_limb_t[degree];
 	for (slong i = 0; i < degree; i++)
@@ -93,7 +107,7 @@ void FFIsomBaseChange::change_basis(nmod_poly_t result, const nmod_poly_t f, con
 	monomial_to_dual(dual, g, modulus, modulus_inv_rev1);
 
 	// compute the power projection <dual, f>
-	nmodMinPoly.project_powers(dual, dual, degree, f, modulus, modulus_inv_rev2);
+	projection.apply(dual, dual, degree);
 
 	// compute result such that result(f) = x
 	dual_to_monomial(result, dual, min_poly);
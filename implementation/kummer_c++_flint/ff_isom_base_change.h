@@ -11,11 +11,30 @@
 #include <flint/nmod_poly.h>
 
 class FFIsomBaseChange {
+public:
+
+    /**
+     * Computes the dual representation of {@code a} modulo {@code modulus}, 
+     * that is the values of the linear form $u \mapsto \tau(a u)$ on the
+     * monomials, where $\tau$ is the trace form twisted by {@code modulus}'.
+     */
     void monomial_to_dual(mp_limb_t *dual, const nmod_poly_t a, const nmod_poly_t modulus,
             const nmod_poly_t modulus_inv_rev);
+
+    /**
+     * Inverse of {@code monomial_to_dual}: computes the element whose
+     * dual representation is {@code dual}. Since the map is linear over
+     * $\mathbb{F}_p[X]/(modulus)$, the dual of $b \circ \ell$ is $b$ times
+     * the dual of $\ell$.
+     */
     void dual_to_monomial(nmod_poly_t result, const mp_limb_t *dual, const nmod_poly_t modulus);
 
-public:
+    /**
+     * Same as above, with $1 / modulus'$ mod modulus precomputed in
+     * {@code modulus_derivative_inv}.
+     */
+    void dual_to_monomial(nmod_poly_t result, const mp_limb_t *dual, const nmod_poly_t modulus,
+            const nmod_poly_t modulus_derivative_inv);
 
     /**
      * Given {@code f} and {@code g} polynomials in $\mathbb{F}_p[X]/(modulus)$, computes
@@ -0,0 +1,79 @@
+/*
+ * ff_isom_base_change_fmpz.cpp
+ */
+
+#include "ff_isom_base_change_fmpz.h"
+#include "fmpz_mod_min_poly.h"
+
+void FFIsomBaseChangeFmpz::monomial_to_dual(fmpz *dual, const fmpz_mod_poly_t a, const fmpz_mod_poly_t modulus,
+		const fmpz_mod_poly_t modulus_inv_rev) {
+	fmpz_mod_poly_t temp;
+	fmpz_mod_poly_init(temp, fmpz_mod_poly_modulus(modulus));
+
+	slong m = fmpz_mod_poly_degree(modulus);
+
+	fmpz_mod_poly_derivative(temp, modulus);
+	fmpz_mod_poly_mulmod(temp, temp, a, modulus);
+	fmpz_mod_poly_reverse(temp, temp, m);
+	fmpz_mod_poly_mullow(temp, temp, modulus_inv_rev, m);
+
+	for (slong i = 0; i < m; i++)
+		fmpz_mod_poly_get_coeff_fmpz(dual + i, temp, i);
+
+	fmpz_mod_poly_clear(temp);
+}
+
+void FFIsomBaseChangeFmpz::dual_to_monomial(fmpz_mod_poly_t result, const fmpz *dual, const fmpz_mod_poly_t modulus) {
+	fmpz_mod_poly_t temp1;
+	fmpz_mod_poly_t temp2;
+	fmpz_mod_poly_init(temp1, fmpz_mod_poly_modulus(modulus));
+	fmpz_mod_poly_init(temp2, fmpz_mod_poly_modulus(modulus));
+
+	slong m = fmpz_mod_poly_degree(modulus);
+	for (slong i = m - 1; i >= 0; i--)
+		fmpz_mod_poly_set_coeff_fmpz(temp1, i, dual + i);
+
+	fmpz_mod_poly_reverse(temp2, modulus, m + 1);
+	fmpz_mod_poly_mullow(temp1, temp1, temp2, m);
+	fmpz_mod_poly_reverse(temp2, temp1, m);
+
+	// times 1 / modulus'
+	fmpz_mod_poly_derivative(temp1, modulus);
+	fmpz_mod_poly_invmod(temp1, temp1, modulus);
+	fmpz_mod_poly_mulmod(result, temp1, temp2, modulus);
+
+	fmpz_mod_poly_clear(temp1);
+	fmpz_mod_poly_clear(temp2);
+}
+
+void FFIsomBaseChangeFmpz::change_basis(fmpz_mod_poly_t result, const fmpz_mod_poly_t f, const fmpz_mod_poly_t g,
+		const fmpz_mod_poly_t modulus) {
+	const fmpz *p = fmpz_mod_poly_modulus(modulus);
+	slong degree = fmpz_mod_poly_degree(modulus);
+
+	fmpz_mod_poly_t min_poly, modulus_inv_rev, one;
+	fmpz_mod_poly_init(min_poly, p);
+	fmpz_mod_poly_init(modulus_inv_rev, p);
+	fmpz_mod_poly_init(one, p);
+	fmpz_mod_poly_one(one);
+
+	// compute 1 / rev(modulus, degree + 1) mod x^degree
+	fmpz_mod_poly_reverse(modulus_inv_rev, modulus, degree + 1);
+	fmpz_mod_poly_inv_series_newton(modulus_inv_rev, modulus_inv_rev, degree);
+
+	FmpzModMinPoly fmpzModMinPoly;
+	fmpzModMinPoly.minimal_polynomial(min_poly, f, modulus);
+
+	// the dual of g, projected on the powers of f
+	fmpz *dual = _fmpz_vec_init(degree);
+	monomial_to_dual(dual, g, modulus, modulus_inv_rev);
+	fmpzModMinPoly.project_powers(dual, dual, degree, one, f, modulus);
+
+	// result(f) = g
+	dual_to_monomial(result, dual, min_poly);
+
+	_fmpz_vec_clear(dual, degree);
+	fmpz_mod_poly_clear(min_poly);
+	fmpz_mod_poly_clear(modulus_inv_rev);
+	fmpz_mod_poly_clear(one);
+}
@@ -0,0 +1,40 @@
+/*
+ * ff_isom_base_change_fmpz.h
+ *
+ *  FFIsomBaseChange for a prime of any size, on fmpz_mod_poly.
+ */
+
+#ifndef FF_ISOM_BASE_CHANGE_FMPZ_H_
+#define FF_ISOM_BASE_CHANGE_FMPZ_H_
+
+#include <flint/fmpz_vec.h>
+#include <flint/fmpz_mod_poly.h>
+
+class FFIsomBaseChangeFmpz {
+public:
+
+    /**
+     * Computes the dual representation of {@code a} modulo {@code modulus},
+     * that is the values of the linear form $u \mapsto \tau(a u)$ on the
+     * monomials, where $\tau$ is the trace form twisted by {@code modulus}'.
+     * @param modulus_inv_rev 1 / rev(modulus, m + 1) mod x^m where m = deg(modulus)
+     */
+    void monomial_to_dual(fmpz *dual, const fmpz_mod_poly_t a, const fmpz_mod_poly_t modulus,
+            const fmpz_mod_poly_t modulus_inv_rev);
+
+    /**
+     * Inverse of {@code monomial_to_dual}: computes the element whose
+     * dual representation is {@code dual}.
+     */
+    void dual_to_monomial(fmpz_mod_poly_t result, const fmpz *dual, const fmpz_mod_poly_t modulus);
+
+    /**
+     * Given {@code f} and {@code g} polynomials in $\mathbb{F}_p[X]/(modulus)$,
+     * {@code f} generating it, computes a polynomial
+     * $h \in \mathbb{F}_p[X]/(modulus)$ such that $h(f) = g$.
+     */
+    void change_basis(fmpz_mod_poly_t result, const fmpz_mod_poly_t f, const fmpz_mod_poly_t g,
+            const fmpz_mod_poly_t modulus);
+};
+
+#endif /* FF_ISOM_BASE_CHANGE_FMPZ_H_ */
@@ -6,6 +6,7 @@
  */
 
 #include "nmod_poly_compose_mod.h"
+#include "nmod_poly_compose_engine.h"
 #include "nmod_poly_automorphism_evaluation.h"
 #include "ff_isom_prime_power_ext.h"
 #include "fq_nmod_poly_eval.h"
@@ -13,17 +14,49 @@
 #include "ff_isom_base_change.h"
 #include "nmod_cyclotomic_poly.h"
 #include "util.h"
+#include "ff_isom_thresholds.h"
+#include "nmod_tower_element.h"
+#include "fq_nmod_poly_ks.h"
+#include "scratch_arena.h"
+#include "nmod_min_poly.h"
 #include <iostream>
+#include <thread>
 #include <flint/profiler.h>
 
 using namespace std;
 
+// number of columns of the Frobenius matrices written at once
+static const slong FROB_TILE = 32;
+
+// degree above which the linalg semi-traces find their kernel vector by
+// Wiedemann's algorithm: the dense matrices take r^2 limbs each
+static const slong LINALG_DENSE_CUTOFF = 1000;
+
+// number of random projections of the Wiedemann sequences
+static const slong WIEDEMANN_PROJECTIONS = 4;
+
+// number of random candidates whose modcomp semi-traces are computed
+// together once x gives zero
+static const slong SEMI_TRACE_RETRY_BATCH = 4;
+
+/**
+ * The threads left to one semi-trace: the two semi-traces of an isomorphism
+ * are computed concurrently when more than one thread is allowed.
+ */
+slong FFIsomPrimePower::semi_trace_threads() const {
+	return num_threads > 1 ? num_threads / 2 : 1;
+}
+
+slong FFIsomPrimePower::get_wiedemann_kernels() const {
+	return wiedemann_kernels;
+}
+
 /**
  * Solve HT90 using linear algebra over F_p.
  *
  * This is not restricted to prime power degree extension.
  */
-void FFIsomPrimePower::compute_semi_trace_trivial_linalg(fq_nmod_t theta, const fq_nmod_ctx_t ctx, mp_limb_t z) {
+void FFIsomPrimePower::compute_semi_trace_trivial_linalg(fq_nmod_t theta, const fq_nmod_t xi_init, const fq_nmod_ctx_t ctx, mp_limb_t z) {
         slong r = fq_nmod_ctx_degree(ctx);
         nmod_mat_t frob_auto;
         nmod_mat_init(frob_auto, r, r, ctx->modulus->mod.n);
@@ -75,12 +108,12 @@ void FFIsomPrimePower::compute_semi_trace_trivial_linalg(fq_nmod_t theta, const
  *
  * This is done recursively using modular composition.
  */
-void FFIsomPrimePower::compute_semi_trace_trivial_modcomp(fq_nmod_t theta, const fq_nmod_t a, const fq_nmod_ctx_t ctx, mp_limb_t z) {
+void FFIsomPrimePower::compute_semi_trace_trivial_modcomp(fq_nmod_t theta, const fq_nmod_t a, const fq_nmod_t xi_init, 
+		const fq_nmod_ctx_t ctx, mp_limb_t z) {
 	fq_nmod_t xi;
 	fq_nmod_init(xi, ctx);
-	fq_nmod_set(delta_init_trivial, a, ctx);
 
-	_compute_semi_trace_trivial_modcomp(theta, xi, fq_nmod_ctx_degree(ctx), ctx, z);
+	_compute_semi_trace_trivial_modcomp(theta, xi, fq_nmod_ctx_degree(ctx), a, xi_init, ctx, z);
 
 	fq_nmod_clear(xi, ctx);
 }
@@ -91,10 +124,11 @@ void FFIsomPrimePower::compute_semi_trace_trivial_modcomp(fq_nmod_t theta, const
  * After recursion level i, $\delta_n = a + z^{r - 1}\sigma(a) + z^{r - 2}\sigma^2(a) + \cdots + 
  * z^{r - i + 1}\sigma^{i - 1}(a)$ and $\xi_i = x^{p^i}$.
  */
-void FFIsomPrimePower::_compute_semi_trace_trivial_modcomp(fq_nmod_t delta, fq_nmod_t xi, slong n, const fq_nmod_ctx_t ctx, const mp_limb_t z) {
+void FFIsomPrimePower::_compute_semi_trace_trivial_modcomp(fq_nmod_t delta, fq_nmod_t xi, slong n, const fq_nmod_t delta_init,
+		const fq_nmod_t xi_init, const fq_nmod_ctx_t ctx, const mp_limb_t z) {
 
 	if (n == 1) {
-		fq_nmod_set(delta, delta_init_trivial, ctx);
+		fq_nmod_set(delta, delta_init, ctx);
 		fq_nmod_set(xi, xi_init, ctx);
 
 		return;
@@ -108,27 +142,27 @@ void FFIsomPrimePower::_compute_semi_trace_trivial_modcomp(fq_nmod_t delta, fq_n
 
 	if (n % 2 == 0) {
 
-		_compute_semi_trace_trivial_modcomp(delta, xi, n / 2, ctx, z);
+		_compute_semi_trace_trivial_modcomp(delta, xi, n / 2, delta_init, xi_init, ctx, z);
 		fq_nmod_set(temp_delta, delta, ctx);
 		fq_nmod_set(temp_xi, xi, ctx);
 		z_degree = fq_nmod_ctx_degree(ctx) - n / 2;
 
 	} else {
 
-		_compute_semi_trace_trivial_modcomp(delta, xi, n - 1, ctx, z);
-		fq_nmod_set(temp_delta, delta_init_trivial, ctx);
+		_compute_semi_trace_trivial_modcomp(delta, xi, n - 1, delta_init, xi_init, ctx, z);
+		fq_nmod_set(temp_delta, delta_init, ctx);
 		fq_nmod_set(temp_xi, xi_init, ctx);
 		z_degree = fq_nmod_ctx_degree(ctx) - 1;
 
 	}
 
 	// compute delta
-	nmod_poly_compose_mod(delta, delta, temp_xi, ctx->modulus);
+	NmodComposeEngine::compose_mod(delta, delta, temp_xi, ctx->modulus);
 	fq_nmod_mul_ui(delta, delta, nmod_pow_ui(z, z_degree, ctx->modulus->mod), ctx);
 	fq_nmod_add(delta, delta, temp_delta, ctx);
 
 	//compute xi
-	nmod_poly_compose_mod(xi, xi, temp_xi, ctx->modulus);
+	NmodComposeEngine::compose_mod(xi, xi, temp_xi, ctx->modulus);
 
 	fq_nmod_clear(temp_delta, ctx);
 	fq_nmod_clear(temp_xi, ctx);
@@ -139,7 +173,7 @@ void FFIsomPrimePower::_compute_semi_trace_trivial_modcomp(fq_nmod_t delta, fq_n
  *
  * This is not restricted to prime power degree extension.
  */
-void FFIsomPrimePower::compute_semi_trace_linalg_cyclo(fq_nmod_poly_t theta, const fq_nmod_ctx_t ctx) {
+void FFIsomPrimePower::compute_semi_trace_linalg_cyclo(fq_nmod_poly_t theta, const fq_nmod_t xi_init, const fq_nmod_ctx_t ctx) {
     slong r = fq_nmod_ctx_degree(ctx);
     fq_nmod_mat_t frob_auto;
     fq_nmod_mat_init(frob_auto, r, r, cyclo_ctx);
@@ -194,29 +228,43 @@ void FFIsomPrimePower::compute_semi_trace_linalg_cyclo(fq_nmod_poly_t theta, con
     return;
 }
 
-void FFIsomPrimePower::compute_frob_auto(nmod_mat_t frob_auto, const fq_nmod_ctx_t ctx) {
+/**
+ * The matrix of the Frobenius $x \mapsto x^p$ on the basis $1, x, \dots, x^{r - 1}$:
+ * column i holds $x^{ip}$. The columns are split in blocks over the threads
+ * of {@code pool}, each block starting from a power of {@code xi_init}; a
+ * block writes its columns a tile at a time, so that the rows of the matrix
+ * are filled in contiguous runs.
+ */
+void FFIsomPrimePower::compute_frob_auto(nmod_mat_t frob_auto, const fq_nmod_t xi_init, ThreadPool & pool, const fq_nmod_ctx_t ctx) {
     slong r = fq_nmod_ctx_degree(ctx);
+    slong num_blocks = FLINT_MAX(pool.size(), 1);
+    slong block = (r + num_blocks - 1) / num_blocks;
+
+    for (slong start = 0; start < r; start += block) {
+        slong end = FLINT_MIN(start + block, r);
+        pool.submit([frob_auto, xi_init, ctx, r, start, end] {
+            ScratchArena arena;
+            fq_nmod_struct *tile = arena.fq_nmod_vec(FROB_TILE, ctx);
+
+            fq_nmod_t power;
+            fq_nmod_init(power, ctx);
+            fq_nmod_pow_ui(power, xi_init, start, ctx);
+
+            for (slong col = start; col < end; col += FROB_TILE) {
+                slong width = FLINT_MIN(FROB_TILE, end - col);
+                for (slong t = 0; t < width; t++) {
+                    fq_nmod_set(tile + t, power, ctx);
+                    fq_nmod_mul(power, power, xi_init, ctx);
+                }
+                for (slong j = 0; j < r; j++)
+                    for (slong t = 0; t < width; t++)
+                        nmod_mat_entry(frob_auto, j, col + t) = j < tile[t].length ? tile[t].coeffs[j] : 0;
+            }
 
-    fq_nmod_t temp;
-    fq_nmod_init(temp, ctx);
-    fq_nmod_set(temp, xi_init, ctx);
-
-    {
-        nmod_mat_entry(frob_auto, 0, 0) = 1;
-    }
-    for (slong i = 1; i < r - 1; i++) {
-        for (slong j = 0; j < r; j++) {
-            nmod_mat_entry(frob_auto, j, i) = nmod_poly_get_coeff_ui(temp, j);
-        }
-        fq_nmod_mul(temp, temp, xi_init, ctx);
+            fq_nmod_clear(power, ctx);
+        });
     }
-    {
-        for (slong j = 0; j < r; j++) {
-            nmod_mat_entry(frob_auto, j, r-1) = nmod_poly_get_coeff_ui(temp, j);
-        }
-    }
-
-    return;
+    pool.wait();
 }
 
 
@@ -229,9 +277,9 @@ void FFIsomPrimePower::lift_ht90_linalg(fq_nmod_poly_t theta, const fq_nmod_t a,
 	slong r = fq_nmod_ctx_degree(ctx);
 	slong s = fq_nmod_ctx_degree(cyclo_ctx);
 
-    nmod_mat_t amat[s];
+    nmod_mat_struct *amat = (nmod_mat_struct *) flint_malloc(s * sizeof(nmod_mat_struct));
     for (slong i = 0; i < s; i++)
-        nmod_mat_init(amat[i], r, 1, ctx->modulus->mod.n);
+        nmod_mat_init(amat + i, r, 1, ctx->modulus->mod.n);
 
     if (true) {
     // Luca's formula.
@@ -240,7 +288,7 @@ void FFIsomPrimePower::lift_ht90_linalg(fq_nmod_poly_t theta, const fq_nmod_t a,
 
     // a_{s-1} = a
     for (slong i = 0; i < r; i++)
-        nmod_mat_entry(amat[s-1], i, 0) = nmod_poly_get_coeff_ui(a, i);
+        nmod_mat_entry(amat + s - 1, i, 0) = nmod_poly_get_coeff_ui(a, i);
     } else {
     // PARI/GP's suboptimal formula
     // a_0 = a
@@ -249,18 +297,18 @@ void FFIsomPrimePower::lift_ht90_linalg(fq_nmod_poly_t theta, const fq_nmod_t a,
 
     // a_0 = a
     for (slong i = 0; i < r; i++)
-        nmod_mat_entry(amat[0], i, 0) = nmod_poly_get_coeff_ui(a, i);
+        nmod_mat_entry(amat + 0, i, 0) = nmod_poly_get_coeff_ui(a, i);
 
     // a_{s-1} = -1/b_0 frob(a_0)
     mp_limb_t inv_b0 = nmod_neg(nmod_inv(nmod_poly_get_coeff_ui(cyclo_mod, 0), ctx->modulus->mod), ctx->modulus->mod);
-    nmod_mat_mul(amat[s-1], frob_auto, amat[0]);
-    nmod_mat_scalar_mul(amat[s-1], amat[s-1], inv_b0);
+    nmod_mat_mul(amat + s - 1, frob_auto, amat + 0);
+    nmod_mat_scalar_mul(amat + s - 1, amat + s - 1, inv_b0);
     }
 
     // a_i = frob(a_{i+1}) + b_{i+1} a_{s-1}
     for (slong i = s-2; i >= (true?0:1); i--) {
-       nmod_mat_mul(amat[i], frob_auto, amat[i+1]);
-       nmod_mat_scalar_mul_add(amat[i], amat[i], nmod_poly_get_coeff_ui(cyclo_mod, i+1), amat[s-1]);
+       nmod_mat_mul(amat + i, frob_auto, amat + i + 1);
+       nmod_mat_scalar_mul_add(amat + i, amat + i, nmod_poly_get_coeff_ui(cyclo_mod, i+1), amat + s - 1);
     }
 
     // construct theta from vectors
@@ -268,123 +316,287 @@ void FFIsomPrimePower::lift_ht90_linalg(fq_nmod_poly_t theta, const fq_nmod_t a,
     fq_nmod_init(temp, ctx);
     for (slong i = 0; i < s; i++) {
         for (slong j = 0; j < r; j++)
-            nmod_poly_set_coeff_ui(temp, j, nmod_mat_entry(amat[i], j, 0));
+            nmod_poly_set_coeff_ui(temp, j, nmod_mat_entry(amat + i, j, 0));
         fq_nmod_poly_set_coeff(theta, i, temp, ctx);
     }
     fq_nmod_clear(temp, ctx);
 
     for (slong i = 0; i < s; i++)
-        nmod_mat_clear(amat[i]);
+        nmod_mat_clear(amat + i);
+    flint_free(amat);
 
     return;
 }
 
-void FFIsomPrimePower::compute_frob_powers(fq_nmod_t *frob_powers, slong s, const nmod_mat_t frob_auto, const fq_nmod_ctx_t ctx) {
+/**
+ * $x^{p^i}$ for i from 0 to {@code s}, each from the previous one by
+ * composition with {@code xi_init} = $x^p$.
+ */
+void FFIsomPrimePower::compute_frob_powers(fq_nmod_struct *frob_powers, slong s, const fq_nmod_t xi_init, const fq_nmod_ctx_t ctx) {
     slong r = fq_nmod_ctx_degree(ctx);
 
-    nmod_mat_t frob_power;
-    nmod_mat_init(frob_power, r, 1, ctx->modulus->mod.n);
-    for (slong j = 0; j < r; j++)
-        nmod_mat_entry(frob_power, j, 0) = nmod_poly_get_coeff_ui(xi_init, j);
-
-    // x^(p^i) for i from 0 to s
-    // s r²
-    nmod_poly_set_coeff_ui(frob_powers[0], 1, 1);
-    fq_nmod_set(frob_powers[1], xi_init, ctx);
-    for (slong i = 2; i <= s; i++) {
-        nmod_mat_mul(frob_power, frob_auto, frob_power);
-        for (slong j = 0; j < r; j++)
-            nmod_poly_set_coeff_ui(frob_powers[i], j, nmod_mat_entry(frob_power, j, 0));
-    }
-
-    nmod_mat_clear(frob_power);
-}
+    fq_nmod_zero(frob_powers + 0, ctx);
+    nmod_poly_set_coeff_ui(frob_powers + 0, 1, 1);
+    if (s == 0)
+        return;
+    fq_nmod_set(frob_powers + 1, xi_init, ctx);
 
-void FFIsomPrimePower::update_frob_powers(fq_nmod_t *frob_powers, slong s, const fq_nmod_t *frob_powers_init, const fq_nmod_ctx_t ctx) {
-    // s M(r)
-    for (slong j = 0; j <= s; j++)
-        fq_nmod_mul(frob_powers[j], frob_powers[j], frob_powers_init[j], ctx);
+    Nmod_poly_compose_mod compose(xi_init, ctx->modulus, ctx->inv, n_sqrt(r) + 1);
+    Nmod_poly_compose_mod::Workspace workspace;
+    for (slong i = 2; i <= s; i++)
+        compose.apply(frob_powers + i, frob_powers + i - 1, workspace);
 }
 
-void FFIsomPrimePower::evaluate_poly_frob(nmod_mat_t cyclo_frob, const nmod_poly_t cyclo_mod, const nmod_mat_t frob_auto, const fq_nmod_ctx_t ctx) {
+/**
+ * The matrix of {@code cyclo_mod} evaluated at the Frobenius, without the
+ * Frobenius matrix: column i is $\sum_j b_j (x^{p^j})^i$, where $b_j$ are
+ * the coefficients of {@code cyclo_mod}. The columns are split in blocks over
+ * the threads of {@code pool}, and accumulated a tile at a time as in
+ * {@code compute_frob_auto}.
+ */
+void FFIsomPrimePower::evaluate_poly_frob(nmod_mat_t cyclo_frob, const nmod_poly_t cyclo_mod, const fq_nmod_t xi_init,
+		ThreadPool & pool, const fq_nmod_ctx_t ctx) {
     slong r = fq_nmod_ctx_degree(ctx);
     slong s = nmod_poly_degree(cyclo_mod);
 
-    // x^(p^i) for i from 0 to s
-    // s r²
-    fq_nmod_t frob_powers[s+1];
-    for (slong i = 0; i <= s; i++)
-        fq_nmod_init(frob_powers[i], ctx);
-    compute_frob_powers(frob_powers, s, frob_auto, ctx);
-
-    // backup copy for updating
-    fq_nmod_t frob_powers_init[s+1];
-    for (slong i = 0; i <= s; i++) {
-        fq_nmod_init(frob_powers_init[i], ctx);
-        fq_nmod_set(frob_powers_init[i], frob_powers[i], ctx);
+    // x^(p^j) for j from 0 to s
+    ScratchArena arena;
+    fq_nmod_struct *frob_powers = arena.fq_nmod_vec(s + 1, ctx);
+    compute_frob_powers(frob_powers, s, xi_init, ctx);
+
+    slong num_blocks = FLINT_MAX(pool.size(), 1);
+    slong block = (r + num_blocks - 1) / num_blocks;
+
+    // r s M(r) in total
+    for (slong start = 0; start < r; start += block) {
+        slong end = FLINT_MIN(start + block, r);
+        pool.submit([cyclo_frob, cyclo_mod, frob_powers, ctx, r, s, start, end] {
+            ScratchArena arena;
+            // (x^(p^j))^col, for the current column
+            fq_nmod_struct *powers = arena.fq_nmod_vec(s + 1, ctx);
+            for (slong j = 0; j <= s; j++)
+                fq_nmod_pow_ui(powers + j, frob_powers + j, start, ctx);
+            mp_ptr tile = arena.limbs(FROB_TILE * r);
+
+            for (slong col = start; col < end; col += FROB_TILE) {
+                slong width = FLINT_MIN(FROB_TILE, end - col);
+                _nmod_vec_zero(tile, width * r);
+                for (slong t = 0; t < width; t++) {
+                    for (slong j = 0; j <= s; j++) {
+                        _nmod_vec_scalar_addmul_nmod(tile + t * r, powers[j].coeffs, powers[j].length,
+                                nmod_poly_get_coeff_ui(cyclo_mod, j), ctx->mod);
+                        fq_nmod_mul(powers + j, powers + j, frob_powers + j, ctx);
+                    }
+                }
+                for (slong i = 0; i < r; i++)
+                    for (slong t = 0; t < width; t++)
+                        nmod_mat_entry(cyclo_frob, i, col + t) = tile[t * r + i];
+            }
+        });
     }
+    pool.wait();
+}
 
-    // evaluate poly column by column
-    // r s (r + M(r))
-    fq_nmod_t add, sum;
-    fq_nmod_init(add, ctx);
-    fq_nmod_init(sum, ctx);
-    // first column
-    {
-        mp_limb_t sum = 0;
-        for (slong j = 0; j <= s; j++)
-            sum = nmod_add(sum, nmod_poly_get_coeff_ui(cyclo_mod, j), cyclo_mod->mod);
-        nmod_mat_entry(cyclo_frob, 0, 0) = sum;
+/**
+ * Sets {@code starts}[t] to $\sigma^{t \cdot block}(b)$ for t < {@code count}, where
+ * $\sigma$ is the Frobenius: $x^{p^{block}}$ is obtained by doubling through
+ * compositions, and each start from the previous one by composition with it.
+ */
+void FFIsomPrimePower::compute_frobenius_starts(fq_nmod_struct *starts, const fq_nmod_t b, slong block, slong count,
+		const fq_nmod_t xi_init, const fq_nmod_ctx_t ctx) {
+    slong sz = n_sqrt(fq_nmod_ctx_degree(ctx)) + 1;
+
+    fq_nmod_set(starts + 0, b, ctx);
+    if (count == 1)
+        return;
+
+    fq_nmod_t xi, acc;
+    fq_nmod_init(xi, ctx);
+    fq_nmod_init(acc, ctx);
+    Nmod_poly_compose_mod compose;
+    Nmod_poly_compose_mod::Workspace workspace;
+
+    // acc = x^{p^a}, xi = x^{p^{2^j}}, and acc(xi) = x^{p^{a + 2^j}}
+    nmod_poly_set_coeff_ui(acc, 1, 1);
+    fq_nmod_set(xi, xi_init, ctx);
+    for (slong e = block; e > 0; e >>= 1) {
+        compose.prepare(xi, ctx->modulus, ctx->inv, sz);
+        if (e & 1)
+            compose.apply(acc, acc, workspace);
+        if (e > 1)
+            compose.apply(xi, xi, workspace);
     }
-    for (slong i = 1; i < r - 1; i++) {
-        // could use nmod_vec_dot or _nmod_vec_scalar_addmul_mod
-        for (slong j = 0; j <= s; j++) {
-            nmod_poly_scalar_mul_nmod(add, frob_powers[j], nmod_poly_get_coeff_ui(cyclo_mod, j));
-            fq_nmod_add(sum, sum, add, ctx);
+
+    compose.prepare(acc, ctx->modulus, ctx->inv, sz);
+    for (slong t = 1; t < count; t++)
+        compose.apply(starts + t, starts + t - 1, workspace);
+
+    fq_nmod_clear(xi, ctx);
+    fq_nmod_clear(acc, ctx);
+}
+
+/**
+ * Finds a nonzero {@code a} in the kernel of cyclo_mod($\sigma$), where $\sigma$
+ * is the Frobenius of {@code ctx}, without forming its matrix.
+ *
+ * The Frobenius is only applied to vectors, as a p-th power. For a random
+ * b, the sequences $u_k(\sigma^i(b))$, i < 2r, for a few random projections
+ * $u_k$ give through Berlekamp-Massey the minimal polynomial m of b, as the
+ * lcm of their minimal polynomials; if cyclo_mod divides m, then
+ * a = (m / cyclo_mod)($\sigma$)(b) is in the kernel. The sequences and the
+ * sum are split by ranges of i over the threads of {@code pool}, each range
+ * starting from $\sigma^i(b)$ computed by {@code compute_frobenius_starts};
+ * the memory used is O(r) per thread and projection.
+ */
+void FFIsomPrimePower::compute_ht90_kernel_wiedemann(fq_nmod_t a, const fq_nmod_t xi_init, ThreadPool & pool,
+		const fq_nmod_ctx_t ctx) {
+    slong r = fq_nmod_ctx_degree(ctx);
+    slong len = 2 * r;
+    mp_limb_t p = ctx->mod.n;
+    nmod_t mod = ctx->mod;
+    slong num_blocks = FLINT_MAX(pool.size(), 1);
+    wiedemann_kernels++;
+
+    flint_rand_t state;
+    flint_randinit(state);
+
+    ScratchArena arena;
+    fq_nmod_struct *starts = arena.fq_nmod_vec(num_blocks, ctx);
+    mp_ptr projections = arena.limbs(WIEDEMANN_PROJECTIONS * r);
+    mp_ptr sequences = arena.limbs(WIEDEMANN_PROJECTIONS * len);
+    mp_ptr partial = arena.limbs(num_blocks * r);
+    nmod_poly_struct *min_polys = arena.nmod_poly_vec(WIEDEMANN_PROJECTIONS, mod);
+
+    fq_nmod_t b, check;
+    fq_nmod_init(b, ctx);
+    fq_nmod_init(check, ctx);
+    nmod_poly_t m, q, rem;
+    nmod_poly_init(m, p);
+    nmod_poly_init(q, p);
+    nmod_poly_init(rem, p);
+
+    Nmod_poly_automorphism_evaluation eval;
+    eval.prepare(cyclo_mod->length, ctx->modulus, ctx->inv);
+
+    bool found = false;
+    while (!found) {
+        fq_nmod_randtest_not_zero(b, state, ctx);
+        for (slong i = 0; i < WIEDEMANN_PROJECTIONS * r; i++)
+            projections[i] = n_randint(state, p);
+
+        // u_k(sigma^i(b)) for i < 2r
+        slong block = (len + num_blocks - 1) / num_blocks;
+        compute_frobenius_starts(starts, b, block, num_blocks, xi_init, ctx);
+        for (slong t = 0; t < num_blocks; t++) {
+            pool.submit([starts, projections, sequences, ctx, mod, r, len, p, block, t] {
+                int nlimbs = _nmod_vec_dot_bound_limbs(r, mod);
+                fq_nmod_t v;
+                fq_nmod_init(v, ctx);
+                fq_nmod_set(v, starts + t, ctx);
+                for (slong i = t * block; i < FLINT_MIN((t + 1) * block, len); i++) {
+                    for (slong k = 0; k < WIEDEMANN_PROJECTIONS; k++)
+                        sequences[k * len + i] = _nmod_vec_dot(projections + k * r, v->coeffs, v->length, mod, nlimbs);
+                    fq_nmod_pow_ui(v, v, p, ctx);
+                }
+                fq_nmod_clear(v, ctx);
+            });
         }
-        for (slong j = 0; j < r; j++)
-            nmod_mat_entry(cyclo_frob, j, i) = nmod_poly_get_coeff_ui(sum, j);
-        update_frob_powers(frob_powers, s, frob_powers_init, ctx);
-    }
-    // last column
-    {
-        for (slong j = 0; j <= s; j++) {
-            nmod_poly_scalar_mul_nmod(add, frob_powers[j], nmod_poly_get_coeff_ui(cyclo_mod, j));
-            fq_nmod_add(sum, sum, add, ctx);
+        pool.wait();
+
+        for (slong k = 0; k < WIEDEMANN_PROJECTIONS; k++) {
+            pool.submit([sequences, min_polys, len, r, k] {
+                if (_nmod_vec_is_zero(sequences + k * len, len)) {
+                    nmod_poly_one(min_polys + k);
+                    return;
+                }
+                NmodMinPoly nmodMinPoly;
+                nmodMinPoly.minimal_polynomial(min_polys + k, sequences + k * len, r);
+            });
         }
-        for (slong j = 0; j < r; j++)
-            nmod_mat_entry(cyclo_frob, j, r-1) = nmod_poly_get_coeff_ui(sum, j);
+        pool.wait();
+
+        // m = lcm of the minimal polynomials
+        nmod_poly_set(m, min_polys + 0);
+        for (slong k = 1; k < WIEDEMANN_PROJECTIONS; k++) {
+            nmod_poly_gcd(q, m, min_polys + k);
+            nmod_poly_mul(m, m, min_polys + k);
+            nmod_poly_div(m, m, q);
+        }
+
+        nmod_poly_divrem(q, rem, m, cyclo_mod);
+        if (!nmod_poly_is_zero(rem))
+            continue;
+
+        // a = q(sigma)(b)
+        block = (q->length + num_blocks - 1) / num_blocks;
+        compute_frobenius_starts(starts, b, block, num_blocks, xi_init, ctx);
+        for (slong t = 0; t < num_blocks; t++) {
+            pool.submit([starts, partial, &q, ctx, mod, r, p, block, t] {
+                mp_ptr sum = partial + t * r;
+                _nmod_vec_zero(sum, r);
+                fq_nmod_t v;
+                fq_nmod_init(v, ctx);
+                fq_nmod_set(v, starts + t, ctx);
+                for (slong i = t * block; i < FLINT_MIN((t + 1) * block, q->length); i++) {
+                    _nmod_vec_scalar_addmul_nmod(sum, v->coeffs, v->length, q->coeffs[i], mod);
+                    fq_nmod_pow_ui(v, v, p, ctx);
+                }
+                fq_nmod_clear(v, ctx);
+            });
+        }
+        pool.wait();
+
+        nmod_poly_fit_length(a, r);
+        _nmod_vec_zero(a->coeffs, r);
+        for (slong t = 0; t < num_blocks; t++)
+            _nmod_vec_add(a->coeffs, a->coeffs, partial + t * r, r, mod);
+        a->length = r;
+        _nmod_poly_normalise(a);
+
+        // m may be a proper factor of the minimal polynomial of b
+        eval.apply(check, cyclo_mod, a);
+        found = !fq_nmod_is_zero(a, ctx) && fq_nmod_is_zero(check, ctx);
     }
-    fq_nmod_clear(add, ctx);
-    fq_nmod_clear(sum, ctx);
 
-    for (slong i = 0; i <= s; i++)
-        fq_nmod_clear(frob_powers_init[i], ctx);
-    for (slong i = 0; i <= s; i++)
-        fq_nmod_clear(frob_powers[i], ctx);
+    fq_nmod_clear(b, ctx);
+    fq_nmod_clear(check, ctx);
+    nmod_poly_clear(m);
+    nmod_poly_clear(q);
+    nmod_poly_clear(rem);
+    flint_randclear(state);
 }
 
 /**
  * Solve HT90 using linear algebra over F_p and lifting from F_q to F_q[z].
  */
-void FFIsomPrimePower::compute_semi_trace_linalg_only(fq_nmod_poly_t theta, const fq_nmod_ctx_t ctx) {
+void FFIsomPrimePower::compute_semi_trace_linalg_only(fq_nmod_poly_t theta, const fq_nmod_t xi_init, const fq_nmod_ctx_t ctx) {
 
     slong r = fq_nmod_ctx_degree(ctx);
 
     fq_nmod_t temp;
     fq_nmod_init(temp, ctx);
 
+    ThreadPool pool(semi_trace_threads() > 1 ? semi_trace_threads() : 0);
+
+    // too large for dense matrices
+    if (r >= LINALG_DENSE_CUTOFF) {
+        compute_ht90_kernel_wiedemann(temp, xi_init, pool, ctx);
+        lift_ht90_modexp(theta, temp, ctx);
+        fq_nmod_clear(temp, ctx);
+        return;
+    }
+
     // Frobenius matrix: 1, x^p, x^2p, ..., x^(r-1)p
     // M(r) log(p) + (r-1) M(r)
     nmod_mat_t frob_auto;
     nmod_mat_init(frob_auto, r, r, ctx->modulus->mod.n);
-    compute_frob_auto(frob_auto, ctx);
+    compute_frob_auto(frob_auto, xi_init, pool, ctx);
 
-    // Evaluate cyclotomic poly on the frobenius matrix
-    // s r ( 2 r + M(r))
+    // Evaluate cyclotomic poly on the frobenius
+    // s r M(r)
     nmod_mat_t cyclo_frob;
     nmod_mat_init(cyclo_frob, r, r, ctx->modulus->mod.n);
-    evaluate_poly_frob(cyclo_frob, cyclo_mod, frob_auto, ctx);
+    evaluate_poly_frob(cyclo_frob, cyclo_mod, xi_init, pool, ctx);
 
     // Kernel
     // r^w
@@ -460,32 +672,128 @@ void FFIsomPrimePower::lift_ht90_modexp(fq_nmod_poly_t theta, const fq_nmod_t a,
     fq_nmod_clear(temp, ctx);
 }
 
-void FFIsomPrimePower::evaluate_poly_mat(nmod_mat_t cyclo_frob, const nmod_poly_t cyclo_mod, const nmod_mat_t frob_auto, const fq_nmod_ctx_t ctx) {
-    // Uses Horner or Paterson/Stockmeyer
-    nmod_poly_evaluate_mat(cyclo_frob, cyclo_mod, frob_auto);
+/**
+ * {@code C} = {@code A B}, the rows of {@code A} and {@code C} being split in
+ * blocks over the threads of {@code pool}; {@code C} must not alias the
+ * operands.
+ */
+static void nmod_mat_mul_pooled(nmod_mat_t C, const nmod_mat_t A, const nmod_mat_t B, ThreadPool & pool) {
+    slong rows = A->r;
+    slong num_blocks = FLINT_MAX(pool.size(), 1);
+    slong block = (rows + num_blocks - 1) / num_blocks;
+
+    if (num_blocks == 1) {
+        nmod_mat_mul(C, A, B);
+        return;
+    }
+
+    for (slong start = 0; start < rows; start += block) {
+        pool.submit([A, B, C, start, block, rows] {
+            nmod_mat_struct A_block = *A;
+            nmod_mat_struct C_block = *C;
+            A_block.rows = A->rows + start;
+            C_block.rows = C->rows + start;
+            A_block.r = FLINT_MIN(block, rows - start);
+            C_block.r = A_block.r;
+            nmod_mat_mul(&C_block, &A_block, B);
+        });
+    }
+    pool.wait();
+}
+
+/**
+ * {@code cyclo_frob} = {@code cyclo_mod}({@code frob_auto}), by Paterson and
+ * Stockmeyer: with $k = \lceil \sqrt{s + 1} \rceil$, the powers $M^i$ for
+ * $i \le k$ are computed once, the blocks $B_j = \sum_{i < k} b_{jk + i} M^i$
+ * are formed row by row, and $\sum_j B_j (M^k)^j$ is evaluated by Horner's
+ * rule; about $2\sqrt{s}$ matrix products instead of s. The products and the
+ * blocks are split by rows over the threads of {@code pool}.
+ */
+void FFIsomPrimePower::evaluate_poly_mat(nmod_mat_t cyclo_frob, const nmod_poly_t cyclo_mod, const nmod_mat_t frob_auto,
+		ThreadPool & pool) {
+    slong r = frob_auto->r;
+    slong s = nmod_poly_degree(cyclo_mod);
+    slong k = n_sqrt(s + 1);
+    if (k * k < s + 1)
+        k++;
+    slong num_blocks = (s + k) / k;
+    nmod_t mod = frob_auto->mod;
+
+    // M^i for 1 <= i <= k, M^k only if there is more than one block; the
+    // identity is added on the diagonal
+    slong top = num_blocks > 1 ? k : k - 1;
+    nmod_mat_struct *powers = (nmod_mat_struct *) flint_malloc((k + 1) * sizeof(nmod_mat_struct));
+    for (slong i = 1; i <= top; i++)
+        nmod_mat_init(powers + i, r, r, mod.n);
+    nmod_mat_set(powers + 1, frob_auto);
+    for (slong i = 2; i <= top; i++)
+        nmod_mat_mul_pooled(powers + i, powers + i - 1, frob_auto, pool);
+
+    nmod_mat_t temp;
+    nmod_mat_init(temp, r, r, mod.n);
+
+    slong row_blocks = FLINT_MAX(pool.size(), 1);
+    slong block = (r + row_blocks - 1) / row_blocks;
+
+    for (slong j = num_blocks - 1; j >= 0; j--) {
+        // cyclo_frob = cyclo_frob M^k + B_j, with cyclo_frob = 0 at first
+        if (j < num_blocks - 1)
+            nmod_mat_mul_pooled(temp, cyclo_frob, powers + k, pool);
+        else
+            nmod_mat_zero(temp);
+
+        for (slong start = 0; start < r; start += block) {
+            pool.submit([cyclo_frob, cyclo_mod, powers, &temp, mod, r, k, s, j, start, block] {
+                for (slong row = start; row < FLINT_MIN(start + block, r); row++) {
+                    mp_ptr res = cyclo_frob->rows[row];
+                    _nmod_vec_set(res, temp->rows[row], r);
+                    for (slong i = 1; i < k && j * k + i <= s; i++)
+                        _nmod_vec_scalar_addmul_nmod(res, powers[i].rows[row], r,
+                                nmod_poly_get_coeff_ui(cyclo_mod, j * k + i), mod);
+                    res[row] = nmod_add(res[row], nmod_poly_get_coeff_ui(cyclo_mod, j * k), mod);
+                }
+            });
+        }
+        pool.wait();
+    }
+
+    nmod_mat_clear(temp);
+    for (slong i = 1; i <= top; i++)
+        nmod_mat_clear(powers + i);
+    flint_free(powers);
 }
 
 /**
  * Solve HT90 using linear algebra over F_p and lifting from F_q to F_q[z].
  */
-void FFIsomPrimePower::compute_semi_trace_linalg(fq_nmod_poly_t theta, const fq_nmod_ctx_t ctx) {
+void FFIsomPrimePower::compute_semi_trace_linalg(fq_nmod_poly_t theta, const fq_nmod_t xi_init, const fq_nmod_ctx_t ctx) {
 
     slong r = fq_nmod_ctx_degree(ctx);
 
     fq_nmod_t temp;
     fq_nmod_init(temp, ctx);
 
+    ThreadPool pool(semi_trace_threads() > 1 ? semi_trace_threads() : 0);
+
+    // too large for dense matrices
+    if (r >= LINALG_DENSE_CUTOFF) {
+        compute_ht90_kernel_wiedemann(temp, xi_init, pool, ctx);
+        lift_ht90_modexp(theta, temp, ctx);
+        fq_nmod_clear(temp, ctx);
+        return;
+    }
+
     // Frobenius matrix: 1, x^p, x^2p, ..., x^(r-1)p
     // M(r) log(p) + (r-1) M(r)
     nmod_mat_t frob_auto;
     nmod_mat_init(frob_auto, r, r, ctx->modulus->mod.n);
-    compute_frob_auto(frob_auto, ctx);
+    compute_frob_auto(frob_auto, xi_init, pool, ctx);
 
     // Evaluate cyclotomic poly on the frobenius matrix
     // sqrt(s) r^w
     nmod_mat_t cyclo_frob;
     nmod_mat_init(cyclo_frob, r, r, ctx->modulus->mod.n);
-    evaluate_poly_mat(cyclo_frob, cyclo_mod, frob_auto, ctx);
+    evaluate_poly_mat(cyclo_frob, cyclo_mod, frob_auto, pool);
 
     // Kernel
     // r^w
@@ -534,12 +842,16 @@ void FFIsomPrimePower::compute_semi_trace_cofactor_naive(fq_nmod_poly_t theta, c
     return;
 }
 
-void FFIsomPrimePower::compute_semi_trace_cofactor(fq_nmod_poly_t theta, const fq_nmod_t alpha, const nmod_poly_t cofactor, const fq_nmod_ctx_t ctx) {
+/**
+ * {@code eval} is prepared for {@code cofactor} and the modulus of {@code ctx},
+ * so that retries with other {@code alpha} only redo the part depending on it.
+ */
+void FFIsomPrimePower::compute_semi_trace_cofactor(fq_nmod_poly_t theta, const fq_nmod_t alpha, const nmod_poly_t cofactor, 
+		Nmod_poly_automorphism_evaluation & eval, const fq_nmod_ctx_t ctx) {
     fq_nmod_t a0;
     fq_nmod_init(a0, ctx);
 
-    Nmod_poly_automorphism_evaluation eval = Nmod_poly_automorphism_evaluation();
-    eval.compose(a0, cofactor, alpha, ctx->modulus, ctx->inv);
+    eval.apply(a0, cofactor, alpha);
 
     if (fq_nmod_is_zero(a0, ctx))
         fq_nmod_poly_zero(theta, ctx);
@@ -551,235 +863,162 @@ void FFIsomPrimePower::compute_semi_trace_cofactor(fq_nmod_poly_t theta, const f
 }
 
 /**
- * Computes the value $\delta_r = a + z^{r - 1}\sigma(a) + z^{r - 2}\sigma^2(a) + \cdots + 
- * z^{1}\sigma^{r - 1}(a)$ where $a \in \mathbb{F}_p[x][z]$, and $r$ is the degree of
- * the extension {@code ctx}.
- *
- * This is done recursively using modular composition.
+ * Prepares the compositions of the modcomp semi-trace, which depend only on
+ * the field {@code ctx}: by $\xi_1 = x^p$, and by $\xi_{n/2}$ at each doubling
+ * step of the recursion, in the order {@code _compute_semi_trace_modcomp}
+ * uses them. {@code sz} is the number of baby steps.
  */
-void FFIsomPrimePower::compute_semi_trace_modcomp(fq_nmod_poly_t theta, const fq_nmod_poly_t a, const fq_nmod_ctx_t ctx,
-		const fq_nmod_poly_t cyclo_mod_lift) {
-
+void FFIsomPrimePower::compute_frobenius_chain(FrobeniusChain & chain, const fq_nmod_t xi_init, slong sz, 
+					       const fq_nmod_ctx_t ctx) {
 	fq_nmod_t xi;
 	fq_nmod_init(xi, ctx);
+	Nmod_poly_compose_mod::Workspace workspace;
 
-	fq_nmod_poly_set(delta_init, a, ctx);
-
-	long delta_degree = fq_nmod_poly_degree(delta_init, ctx);
-	Nmod_poly_compose_mod compose_xi_init;
-	compose_xi_init.nmod_poly_compose_mod_brent_kung_vec_preinv_prepare(xi_init, ctx->modulus, ctx->inv,  
-									    n_sqrt( nmod_poly_degree(ctx->modulus) * (delta_degree+2)) + 1);
-
-	_compute_semi_trace_modcomp(theta, xi, fq_nmod_ctx_degree(ctx), compose_xi_init, ctx, cyclo_mod_lift);
+	chain.doubling.clear();
+	chain.doubling.reserve(n_clog(fq_nmod_ctx_degree(ctx), 2) + 1);
+	chain.compose_xi_init.prepare(xi_init, ctx->modulus, ctx->inv, sz);
+	_compute_frobenius_chain(chain, xi, fq_nmod_ctx_degree(ctx), xi_init, sz, workspace, ctx);
 
 	fq_nmod_clear(xi, ctx);
 }
 
-
 /**
- * Computes the value $\delta_n = a + z^{r - 1}\sigma(a) + z^{r - 2}\sigma^2(a) + \cdots + 
- * z^{r - n + 1}\sigma^{n - 1}(a)$ where $a \in \mathbb{F}_p[x][z]$ is such that $\delta_init = a$.
- * After recursion level i, $\delta_n = a + z^{r - 1}\sigma(a) + z^{r - 2}\sigma^2(a) + \cdots + 
- * z^{r - i + 1}\sigma^{i - 1}(a)$ and $\xi_i = x^{p^i}$.
+ * The recursion of {@code _compute_semi_trace_modcomp} on $\xi$ alone: after
+ * it, $\xi = x^{p^n}$.
  */
-void FFIsomPrimePower::_compute_semi_trace_modcomp(fq_nmod_poly_t delta, fq_nmod_t xi, slong n, 
-						   const Nmod_poly_compose_mod & compose_xi_init, 
-						   const fq_nmod_ctx_t ctx,
-						   const fq_nmod_poly_t cyclo_mod_lift) {
-
+void FFIsomPrimePower::_compute_frobenius_chain(FrobeniusChain & chain, fq_nmod_t xi, slong n, const fq_nmod_t xi_init,
+						slong sz, Nmod_poly_compose_mod::Workspace & workspace,
+						const fq_nmod_ctx_t ctx) {
 	if (n == 1) {
-		fq_nmod_poly_set(delta, delta_init, ctx);
 		fq_nmod_set(xi, xi_init, ctx);
 		return;
 	}
 
-	slong z_degree = 0;
-	fq_nmod_poly_t temp_delta;
-	fq_nmod_t temp_xi;
-
-	fq_nmod_poly_init(temp_delta, ctx);
-	fq_nmod_init(temp_xi, ctx);
-
-
 	if (n % 2 == 0) {
-
-	  _compute_semi_trace_modcomp(delta, xi, n / 2, compose_xi_init, ctx, cyclo_mod_lift);
-	  fq_nmod_poly_set(temp_delta, delta, ctx);
-	  fq_nmod_set(temp_xi, xi, ctx);
-	  z_degree = fq_nmod_ctx_degree(ctx) - n / 2;
-
-	  if (true){
-	    long delta_degree = fq_nmod_poly_degree(delta, ctx);
-	    Nmod_poly_compose_mod compose;
-	    compose.nmod_poly_compose_mod_brent_kung_vec_preinv_prepare(xi, ctx->modulus, ctx->inv,  
-									n_sqrt( nmod_poly_degree(ctx->modulus) * (delta_degree+2)) + 1);
-	    compute_delta_and_xi(delta, xi, temp_xi, z_degree, compose, ctx, cyclo_mod_lift);
-	  } // we probably won't need this anymore
-	  else {
-	    compute_delta(delta, temp_xi, z_degree, ctx, cyclo_mod_lift);
-	    compute_xi(xi, temp_xi, ctx);
-	  }
-		
+		_compute_frobenius_chain(chain, xi, n / 2, xi_init, sz, workspace, ctx);
+		chain.doubling.emplace_back();
+		chain.doubling.back().prepare(xi, ctx->modulus, ctx->inv, sz);
+		chain.doubling.back().apply(xi, xi, workspace);
 	} else {
-	  
-	  _compute_semi_trace_modcomp(delta, xi, n - 1, compose_xi_init, ctx, cyclo_mod_lift);
-	  fq_nmod_poly_set(temp_delta, delta_init, ctx);
-	  fq_nmod_set(temp_xi, xi_init, ctx);
-	  z_degree = fq_nmod_ctx_degree(ctx) - 1;
-
-	  if (true) {
-	    compute_delta_and_xi(delta, xi, temp_xi, z_degree, compose_xi_init, ctx, cyclo_mod_lift);
-	  }
-	  else {
-	    compute_delta(delta, temp_xi, z_degree, ctx, cyclo_mod_lift);
-	    compute_xi(xi, temp_xi, ctx);
-	  }
-
-	  // an attempt to replace the modcomp's by a q-power. 
-	  // not so clear if it's useful at all, so I'll leave it out for the moment
-	  if (false) {
-	    nmod_poly_t tmp;
-	    nmod_poly_init(tmp, ctx->mod.n);
-	    slong deg_delta = fq_nmod_poly_degree(delta, ctx);
-	    
-	    for (long i = 0; i <= deg_delta; i++){
-	      fq_nmod_poly_get_coeff(tmp, delta, i, ctx);
-	      nmod_poly_powmod_ui_binexp_preinv(tmp, tmp, ctx->mod.n, ctx->modulus, ctx->inv);
-	      fq_nmod_poly_set_coeff(delta, i, tmp, ctx);
-	    }
-
-	    nmod_poly_powmod_ui_binexp_preinv(xi, xi, ctx->mod.n, ctx->modulus, ctx->inv);
-	    nmod_poly_clear(tmp);
-
-	    shift_delta(delta, z_degree, ctx);
-	  }
+		_compute_frobenius_chain(chain, xi, n - 1, xi_init, sz, workspace, ctx);
+		chain.compose_xi_init.apply(xi, xi, workspace);
 	}
-
-	fq_nmod_poly_add(delta, delta, temp_delta, ctx);
-	fq_nmod_poly_clear(temp_delta, ctx);
-	fq_nmod_clear(temp_xi, ctx);
 }
 
-
- /**
- * Given $\delta = \sum_i c_i(x)z^i$, this method computes 
- * $z^{z_degree}\delta(\xi) = z^{z_degree}\sum_i c_i(\xi)z^i$. 
- * and {@code xi} = {@code xi}({@code old_xi}).
+/**
+ * Computes the values $\delta_r = a + z^{r - 1}\sigma(a) + z^{r - 2}\sigma^2(a) + \cdots + 
+ * z^{1}\sigma^{r - 1}(a)$ for the {@code count} elements $a \in \mathbb{F}_p[x][z]$
+ * of {@code a}, where $r$ is the degree of the extension {@code ctx}.
+ *
+ * This is done recursively using modular composition, on dense tower elements;
+ * the coefficients of all the $\delta$ go through one vector composition at
+ * each step. The compositions are prepared in {@code chain} on the first call
+ * and reused afterwards.
  */
-void FFIsomPrimePower::compute_delta_and_xi(fq_nmod_poly_t delta, fq_nmod_t new_xi, const fq_nmod_t xi, slong z_degree, 
-					    const Nmod_poly_compose_mod & compose, 
-					    const fq_nmod_ctx_t ctx, const fq_nmod_poly_t cyclo_mod_lift) {
-
-	slong delta_degree = fq_nmod_poly_degree(delta, ctx);
-	slong nn = ctx->mod.n;
-
-	// inputs to multi-modcomp
-	nmod_poly_struct* input = (nmod_poly_struct *) flint_malloc((delta_degree+2)*sizeof(nmod_poly_struct));
-	for (long i = 0; i <= delta_degree; i++){
-	  nmod_poly_init(input + i, nn);
-	  fq_nmod_poly_get_coeff(input + i, delta, i, ctx);
+void FFIsomPrimePower::compute_semi_trace_modcomp(fq_nmod_poly_struct *theta, const fq_nmod_poly_struct *a, slong count,
+		const fq_nmod_t xi_init, FrobeniusChain & chain, const fq_nmod_ctx_t ctx) {
+
+	slong r = nmod_poly_degree(ctx->modulus);
+	slong s = nmod_poly_degree(cyclo_mod);
+
+	// the s coefficients of each delta are composed at once
+	if (!chain.compose_xi_init.is_prepared())
+		compute_frobenius_chain(chain, xi_init, n_sqrt(r * s * count) + 1, ctx);
+
+	// the scratch of the recursion is allocated once here: each level only
+	// uses it after the deeper levels are done
+	vector<unique_ptr<NmodTowerElement> > delta_store, delta_init_store, temp_store;
+	vector<NmodTowerElement *> delta, delta_init, temp;
+	for (slong i = 0; i < count; i++) {
+		delta_store.emplace_back(new NmodTowerElement(s, r, ctx->mod));
+		delta_init_store.emplace_back(new NmodTowerElement(s, r, ctx->mod));
+		temp_store.emplace_back(new NmodTowerElement(s, r, ctx->mod));
+		delta.push_back(delta_store.back().get());
+		delta_init.push_back(delta_init_store.back().get());
+		temp.push_back(temp_store.back().get());
+		delta_init[i]->set(a + i, ctx);
+		delta_init[i]->reduce(cyclo_mod);
 	}
-	nmod_poly_init(input + (delta_degree + 1), nn);
-	nmod_poly_set(input + (delta_degree + 1), new_xi);
+	vector<mp_ptr> rows(count * s);
 
-	// outputs of multi-modcomp
-	nmod_poly_struct* output = (nmod_poly_struct *) flint_malloc((delta_degree+2)*sizeof(nmod_poly_struct));
-	compose.nmod_poly_compose_mod_brent_kung_vec_preinv_precomp(output, input, delta_degree+2);
-
-	for (long i = 0; i <= delta_degree; i++){
-	  fq_nmod_poly_set_coeff(delta, i, output + i, ctx);
-	  nmod_poly_clear(output + i);
-	}
-	fq_nmod_set(new_xi, output + delta_degree + 1, ctx);
-	nmod_poly_clear(output + delta_degree + 1);
-	flint_free(output);
+	ThreadPool pool(semi_trace_threads() > 1 ? semi_trace_threads() : 0);
+	vector<Nmod_poly_compose_mod::Workspace> workspaces(FLINT_MAX(pool.size(), 1));
 
-	for (long i = 0; i < delta_degree+2; i++)
-	  nmod_poly_clear(input + i);
-	flint_free(input);
+	slong step = 0;
+	_compute_semi_trace_modcomp(delta.data(), count, fq_nmod_ctx_degree(ctx), delta_init.data(), chain, step,
+				    temp.data(), rows.data(), workspaces.data(), pool, ctx);
 
-	shift_delta(delta, z_degree, ctx);
+	for (slong i = 0; i < count; i++)
+		delta[i]->get(theta + i, ctx);
 }
 
 
 /**
- * Computes {@code xi} = {@code xi}({@code old_xi}).
- */
-void FFIsomPrimePower::compute_xi(fq_nmod_t xi, const fq_nmod_t old_xi, const fq_nmod_ctx_t ctx) {
-	nmod_poly_compose_mod(xi, xi, old_xi, ctx->modulus);
-}
-
-/**
- * Given $\delta = \sum_i c_i(x)z^i$, this method computes 
- * $z^{z_degree}\delta(\xi) = z^{z_degree}\sum_i c_i(\xi)z^i$. 
+ * Computes the values $\delta_n = a + z^{r - 1}\sigma(a) + z^{r - 2}\sigma^2(a) + \cdots + 
+ * z^{r - n + 1}\sigma^{n - 1}(a)$ where $a \in \mathbb{F}_p[x][z]$ is such that $\delta_init = a$,
+ * for each of the {@code count} elements of {@code delta_init}.
+ * After recursion level i, $\delta_n = a + z^{r - 1}\sigma(a) + z^{r - 2}\sigma^2(a) + \cdots + 
+ * z^{r - i + 1}\sigma^{i - 1}(a)$; {@code step} counts the doubling compositions of
+ * {@code chain} used so far. {@code temp} (count elements) and {@code rows}
+ * (count times the z length pointers) are scratch shared by all the levels.
  */
-void FFIsomPrimePower::compute_delta(fq_nmod_poly_t delta, const fq_nmod_t xi, slong z_degree, const fq_nmod_ctx_t ctx,
-		const fq_nmod_poly_t cyclo_mod_lift) {
-	// temporary elements for composition
-	fq_nmod_t temp_comp;
+void FFIsomPrimePower::_compute_semi_trace_modcomp(NmodTowerElement **delta, slong count, slong n, 
+						   NmodTowerElement * const *delta_init,
+						   const FrobeniusChain & chain, slong & step,
+						   NmodTowerElement **temp, mp_ptr *rows,
+						   Nmod_poly_compose_mod::Workspace * workspaces, ThreadPool & pool,
+						   const fq_nmod_ctx_t ctx) {
 
-	// temporary element for coefficients
-	fq_nmod_t temp_coeff;
+	if (n == 1) {
+		for (slong i = 0; i < count; i++)
+			delta[i]->set(*delta_init[i]);
+		return;
+	}
 
-	fq_nmod_init(temp_comp, ctx);
-	fq_nmod_init(temp_coeff, ctx);
-	fq_nmod_set(temp_comp, xi, ctx);
+	if (n % 2 == 0) {
 
-	slong delta_degree = fq_nmod_poly_degree(delta, ctx);
+	  _compute_semi_trace_modcomp(delta, count, n / 2, delta_init, chain, step, temp, rows, workspaces, pool, ctx);
+	  for (slong i = 0; i < count; i++)
+	    temp[i]->set(*delta[i]);
 
-	// do modular composition for each coefficient
-	for (slong i = 0; i <= delta_degree; i++) {
+	  compute_delta(delta, count, fq_nmod_ctx_degree(ctx) - n / 2, chain.doubling[step++], rows, workspaces, pool);
+		
+	} else {
+	  
+	  _compute_semi_trace_modcomp(delta, count, n - 1, delta_init, chain, step, temp, rows, workspaces, pool, ctx);
+	  for (slong i = 0; i < count; i++)
+	    temp[i]->set(*delta_init[i]);
 
-		fq_nmod_poly_get_coeff(temp_coeff, delta, i, ctx);
-		nmod_poly_compose_mod(temp_coeff, temp_coeff, temp_comp, ctx->modulus);
-		fq_nmod_poly_set_coeff(delta, i, temp_coeff, ctx);
+	  compute_delta(delta, count, fq_nmod_ctx_degree(ctx) - 1, chain.compose_xi_init, rows, workspaces, pool);
 	}
 
-	// compute z^{z_degree}delta
-	// TODO slightly better complexity can be obtained  
-	fq_nmod_poly_shift_left(delta, delta, z_degree, ctx);
-	fq_nmod_poly_rem(delta, delta, cyclo_mod_lift, ctx);
-
-	fq_nmod_clear(temp_comp, ctx);
-	fq_nmod_clear(temp_coeff, ctx);
+	for (slong i = 0; i < count; i++)
+		delta[i]->add(*temp[i]);
 }
 
 
-// compute z^{z_degree}*delta
-void FFIsomPrimePower::shift_delta(fq_nmod_poly_t delta, slong z_degree, const fq_nmod_ctx_t ctx) {
-  nmod_poly_t z, z_pow;
-  nmod_poly_init(z, ctx->mod.n);
-  nmod_poly_init(z_pow, ctx->mod.n);
-
-  long r = nmod_poly_degree(ctx->modulus);
-  long s = nmod_poly_degree(cyclo_mod);
-
-  // make sure all coeffs are allocated
-  fq_nmod_poly_fit_length(delta, s, ctx);
-  delta->length = s;
-
-  nmod_poly_set_coeff_ui(z, 1, 1);
-  nmod_poly_powmod_ui_binexp_preinv(z_pow, z, z_degree, cyclo_mod, cyclo_ctx->inv);
-  
-  nmod_poly_t coeff;
-  nmod_poly_init(coeff, ctx->mod.n);
-  for (long j = 0; j < r; j++){
-    for (long i = 0; i < s; i++)
-      nmod_poly_set_coeff_ui(coeff, i, nmod_poly_get_coeff_ui(delta->coeffs +i , j));
-
-    // the following aliasing changes the storage used for coeff
-    nmod_poly_mulmod(coeff, coeff, z_pow, cyclo_mod);
+ /**
+ * Given $\delta = \sum_i c_i(x)z^i$, this method computes 
+ * $z^{z_degree}\delta(\xi) = z^{z_degree}\sum_i c_i(\xi)z^i$, where $\xi$ is
+ * the argument of {@code compose}, for each of the {@code count} elements of
+ * {@code delta}. The coefficients of all of them are composed in place, as the
+ * rows of the tower elements, on the threads of {@code pool}; {@code rows} is
+ * scratch for the pointers to them.
+ */
+void FFIsomPrimePower::compute_delta(NmodTowerElement **delta, slong count, slong z_degree, 
+				     const Nmod_poly_compose_mod & compose, mp_ptr *rows,
+				     Nmod_poly_compose_mod::Workspace * workspaces, ThreadPool & pool) {
 
-    for (long i = 0; i < s; i++)
-      nmod_poly_set_coeff_ui(delta->coeffs +i , j, nmod_poly_get_coeff_ui(coeff,i));
-  }
+	slong s = delta[0]->get_z_len();
 
-  _fq_nmod_poly_normalise(delta, ctx);
+	for (slong j = 0; j < count; j++)
+		for (slong i = 0; i < s; i++)
+			rows[j * s + i] = delta[j]->row(i);
 
-  nmod_poly_clear(coeff);
+	compose.apply(rows, rows, count * s, workspaces, pool);
 
-  nmod_poly_clear(z);
-  nmod_poly_clear(z_pow);
+	for (slong j = 0; j < count; j++)
+		delta[j]->mul_z_power(z_degree, cyclo_mod);
 }
 
 /**
@@ -788,57 +1027,28 @@ void FFIsomPrimePower::shift_delta(fq_nmod_poly_t delta, slong z_degree, const f
  * the extension {@code ctx}.
  *
  * This is done using iterated frobenius computed naively.
- * But does not use fq_nmod_poly_t arithmetic.
+ * The powers are written to the rows of a tower element, which is then
+ * reduced modulo the cyclotomic polynomial.
  */
-void FFIsomPrimePower::compute_semi_trace_iterfrob_naive(fq_nmod_poly_t theta, const fq_nmod_t alpha, const fq_nmod_ctx_t ctx,
-		const fq_nmod_poly_t cyclo_mod_lift) {
+void FFIsomPrimePower::compute_semi_trace_iterfrob_naive(fq_nmod_poly_t theta, const fq_nmod_t alpha, const fq_nmod_ctx_t ctx) {
 
 	slong degree = fq_nmod_ctx_degree(ctx);
 
 	fq_nmod_t frobenius;
 	fq_nmod_init(frobenius, ctx);
-    fq_nmod_set(frobenius, alpha, ctx);
-
-    if (false) {
-    fq_nmod_poly_zero(theta, ctx);
-    fq_nmod_poly_set_coeff(theta, 0, alpha, ctx);
-    for (slong j = 1; j < degree; j++) {
-        fq_nmod_pow_ui(frobenius, frobenius, ctx->mod.n, ctx);
-        fq_nmod_poly_set_coeff(theta, degree-j, frobenius, ctx);
-    }
+	fq_nmod_set(frobenius, alpha, ctx);
 
-	fq_nmod_poly_rem(theta, theta, cyclo_mod_lift, ctx);
-    } else {
-    nmod_poly_t xicoeffs[degree];
-    for (slong i = 0; i < degree; i++)
-        fq_nmod_init(xicoeffs[i], cyclo_ctx);
-
-    // Compute Frobenii
-    for (slong i = 0; i < degree; i++)
-        nmod_poly_set_coeff_ui(xicoeffs[i], 0, nmod_poly_get_coeff_ui(alpha, i));
-    for (slong j = 1; j < degree; j++) {
-        fq_nmod_pow_ui(frobenius, frobenius, ctx->mod.n, ctx);
-        for (slong i = 0; i < degree; i++)
-            nmod_poly_set_coeff_ui(xicoeffs[i], degree-j, nmod_poly_get_coeff_ui(frobenius, i));
-    }
-
-    // Reduce modulo cyclo_mod
-    for (slong i = 0; i < degree; i++)
-        nmod_poly_rem(xicoeffs[i], xicoeffs[i], cyclo_ctx->modulus);
-
-    fq_nmod_poly_zero(theta, ctx);
-    for (slong j = 0; j < cyclo_deg; j++) {
-        for (slong i = 0;  i < degree; i++)
-            nmod_poly_set_coeff_ui(frobenius, i, nmod_poly_get_coeff_ui(xicoeffs[i], j));
-        fq_nmod_poly_set_coeff(theta, j, frobenius, ctx);
-    }
+	NmodTowerElement powers(degree, degree, ctx->mod);
+	_nmod_vec_set(powers.row(0), alpha->coeffs, alpha->length);
+	for (slong j = 1; j < degree; j++) {
+		fq_nmod_pow_ui(frobenius, frobenius, ctx->mod.n, ctx);
+		_nmod_vec_set(powers.row(degree - j), frobenius->coeffs, frobenius->length);
+	}
 
-    for (slong i = 0; i < degree; i++)
-        nmod_poly_clear(xicoeffs[i]);
+	powers.reduce(cyclo_mod);
+	powers.get(theta, ctx);
 
-    }
-
-    fq_nmod_clear(frobenius, ctx);
+	fq_nmod_clear(frobenius, ctx);
 }
 
 /**
@@ -846,51 +1056,51 @@ void FFIsomPrimePower::compute_semi_trace_iterfrob_naive(fq_nmod_poly_t theta, c
  * z\alpha^{p^{(r - 1)}$ where $\alpha \in \mathbb{F}_p[x]$, and $r$ is the degree of
  * the extension {@code ctx}.
  *
- * This is done using iterated frobenius through multi point evaluation.
- * Unfortunately fq_nmod_poly_t needed by MPE is slow in FLINT as it does
- * not implement double KS.
+ * This is done using iterated frobenius through multi point evaluation,
+ * whose products and remainders over {@code ctx} go through the double
+ * Kronecker substitution of FqNmodPolyKS. The conjugates of {@code alpha}
+ * are taken from {@code arena}, so that retries reuse their storage.
  */
-void FFIsomPrimePower::compute_semi_trace_iterfrob(fq_nmod_poly_t theta, const fq_nmod_t alpha, const fq_nmod_ctx_t ctx,
-		const fq_nmod_poly_t cyclo_mod_lift) {
+void FFIsomPrimePower::compute_semi_trace_iterfrob(fq_nmod_poly_t theta, const fq_nmod_t alpha, const fq_nmod_struct *powers,
+		ScratchArena & arena, const fq_nmod_ctx_t ctx) {
 
 	slong degree = fq_nmod_ctx_degree(ctx);
 
-	fq_nmod_struct frobenius[degree];
-	for (slong i = 0; i < degree; i++)
-		fq_nmod_init(frobenius + i, ctx);
+	ScratchArena::Frame frame(arena);
+	fq_nmod_struct *frobenius = arena.fq_nmod_vec(degree, ctx);
 
-	iterated_frobenius(frobenius, alpha, ctx, cyclo_deg);
-
-	fq_nmod_poly_zero(theta, ctx);
-	fq_nmod_poly_set_coeff(theta, 0, frobenius + 0, ctx);
-	for (slong i = 1; i < degree; i++) {
-		fq_nmod_poly_set_coeff(theta, i, frobenius + degree - i, ctx);
-	}
+	iterated_frobenius(frobenius, alpha, powers, ctx);
 
-    // Surely suboptimal. cyclo_mod_lift has coeffs in Fp (and is fixed).
-	fq_nmod_poly_rem(theta, theta, cyclo_mod_lift, ctx);
+	// cyclo_mod has coefficients in F_p: reduce the dense element instead
+	// of an fq_nmod_poly_t
+	NmodTowerElement tower(degree, degree, ctx->mod);
+	_nmod_vec_set(tower.row(0), frobenius[0].coeffs, frobenius[0].length);
+	for (slong i = 1; i < degree; i++)
+		_nmod_vec_set(tower.row(i), frobenius[degree - i].coeffs, frobenius[degree - i].length);
 
-	for (slong i = 0; i < degree; i++)
-		fq_nmod_clear(frobenius + i, ctx);
+	tower.reduce(cyclo_mod);
+	tower.get(theta, ctx);
 }
 
 /**
- * Given an elemenet {@code alpha} in the field {@code ctx}, this method computes
- * $\alpha^{p^i}$ for all $i = 0, \dots, r - 1$. The algorithm used is Algorithm 3.1
- * form Von Zur Gathen and Shoup, 1992. More precisely, this method implements the
+ * Computes $x^{p^i}$ for all $i = 0, \dots, r - 1$ in the field {@code ctx},
+ * given {@code xi_init} = $x^p$. The algorithm used is Algorithm 3.1 form
+ * Von Zur Gathen and Shoup, 1992. More precisely, this method implements the
  * case {q = p, R = ctx, t = p, m = r - 1} of the algorithm in the paper.
+ * The result depends only on the field, and is shared by all the elements
+ * whose Frobenius powers are wanted.
  */
-void FFIsomPrimePower::iterated_frobenius(fq_nmod_struct *result, const fq_nmod_t alpha, const fq_nmod_ctx_t ctx, slong s) {
+void FFIsomPrimePower::compute_frobenius_powers(fq_nmod_struct *powers, const fq_nmod_t xi_init, const fq_nmod_ctx_t ctx) {
 	fq_nmodPolyEval fq_nmodPolyEval;
 
 	fq_nmod_poly_t temp;
 	fq_nmod_poly_init(temp, ctx);
 
-	// set result[0] to x
-	fq_nmod_zero(result + 0, ctx);
-	nmod_poly_set_coeff_ui(result + 0, 1, 1);
-	// set result[1] to x^p
-	fq_nmod_set(result + 1, xi_init, ctx);
+	// set powers[0] to x
+	fq_nmod_zero(powers + 0, ctx);
+	nmod_poly_set_coeff_ui(powers + 0, 1, 1);
+	// set powers[1] to x^p
+	fq_nmod_set(powers + 1, xi_init, ctx);
 
 	slong l = n_clog(fq_nmod_ctx_degree(ctx) - 1, 2);
 	slong base = 0;
@@ -901,7 +1111,7 @@ void FFIsomPrimePower::iterated_frobenius(fq_nmod_struct *result, const fq_nmod_
 		base = 1 << (i - 1);
 
 		// build the polynomial for multipoint evaluation
-		convert(temp, result + base, ctx);
+		convert(temp, powers + base, ctx);
 
 		// make sure we stay in the bound
 		if (2 * base < fq_nmod_ctx_degree(ctx))
@@ -909,26 +1119,35 @@ void FFIsomPrimePower::iterated_frobenius(fq_nmod_struct *result, const fq_nmod_
 		else
 			length = fq_nmod_ctx_degree(ctx) - base - 1;
 
-        if (false) {
-            fq_nmod_poly_evaluate_fq_nmod_vec(result + base + 1, temp, result + 1, length, ctx);
-        } else {
-            fq_nmodPolyEval.multipoint_eval(result + base + 1, temp, result + 1, length, ctx);
-        }
+		fq_nmodPolyEval.multipoint_eval(powers + base + 1, temp, powers + 1, length, ctx);
 	}
 
-	// check the trivial case of alpha = x
-	if (!fq_nmod_equal(result + 0, alpha, ctx)) {
+	fq_nmod_poly_clear(temp, ctx);
+}
 
-		// build the polynomial for multipoint evaluation of alpha
-		convert(temp, alpha, ctx);
+/**
+ * Given an elemenet {@code alpha} in the field {@code ctx}, this method computes
+ * $\alpha^{p^i} = \alpha(x^{p^i})$ for all $i = 0, \dots, r - 1$, by multipoint
+ * evaluation at the {@code powers} computed by {@code compute_frobenius_powers}.
+ */
+void FFIsomPrimePower::iterated_frobenius(fq_nmod_struct *result, const fq_nmod_t alpha, const fq_nmod_struct *powers,
+		const fq_nmod_ctx_t ctx) {
 
-        if (false) {
-            fq_nmod_poly_evaluate_fq_nmod_vec(result, temp, result, fq_nmod_ctx_degree(ctx), ctx);
-        } else {
-            fq_nmodPolyEval.multipoint_eval(result, temp, result, fq_nmod_ctx_degree(ctx), ctx);
-        }
+	// check the trivial case of alpha = x
+	if (fq_nmod_equal(powers + 0, alpha, ctx)) {
+		for (slong i = 0; i < fq_nmod_ctx_degree(ctx); i++)
+			fq_nmod_set(result + i, powers + i, ctx);
+		return;
 	}
 
+	fq_nmodPolyEval fq_nmodPolyEval;
+	fq_nmod_poly_t temp;
+	fq_nmod_poly_init(temp, ctx);
+
+	// build the polynomial for multipoint evaluation of alpha
+	convert(temp, alpha, ctx);
+	fq_nmodPolyEval.multipoint_eval(result, temp, powers, fq_nmod_ctx_degree(ctx), ctx);
+
 	fq_nmod_poly_clear(temp, ctx);
 }
 
@@ -943,12 +1162,15 @@ void FFIsomPrimePower::compute_semi_trace(fq_nmod_t theta, const fq_nmod_ctx_t c
     fq_nmod_init(alpha, ctx);
     nmod_poly_set_coeff_ui(alpha, 1, 1);
     // set xi_init to x^p
+    fq_nmod_t xi_init;
+    fq_nmod_init(xi_init, ctx);
     fq_nmod_pow_ui(xi_init, alpha, ctx->modulus->mod.n, ctx);
 
     // use naive linear algebra for low-degree module
     if (fq_nmod_ctx_degree(ctx) < linalg_threshold) {
-        compute_semi_trace_trivial_linalg(theta, ctx, z);
+        compute_semi_trace_trivial_linalg(theta, xi_init, ctx, z);
         fq_nmod_clear(alpha, ctx);
+        fq_nmod_clear(xi_init, ctx);
         return;
     }
 
@@ -958,14 +1180,15 @@ void FFIsomPrimePower::compute_semi_trace(fq_nmod_t theta, const fq_nmod_ctx_t c
     fq_nmod_zero(theta, ctx);
     while (fq_nmod_is_zero(theta, ctx)) {
         fq_nmod_randtest(alpha, state, ctx);
-        compute_semi_trace_trivial_modcomp(theta, alpha, ctx, z);
+        compute_semi_trace_trivial_modcomp(theta, alpha, xi_init, ctx, z);
     }
 
     fq_nmod_clear(alpha, ctx);
+    fq_nmod_clear(xi_init, ctx);
     flint_randclear(state);
 }
 
-void FFIsomPrimePower::compute_semi_trace(fq_nmod_poly_t theta, const fq_nmod_ctx_t ctx, const fq_nmod_poly_t cyclo_mod_lift) {
+void FFIsomPrimePower::compute_semi_trace(fq_nmod_poly_t theta, const fq_nmod_ctx_t ctx) {
 
 	slong degree = fq_nmod_ctx_degree(ctx);
 	slong s = fq_nmod_ctx_degree(cyclo_ctx);
@@ -974,20 +1197,23 @@ void FFIsomPrimePower::compute_semi_trace(fq_nmod_poly_t theta, const fq_nmod_ct
 	fq_nmod_init(alpha, ctx);
 	nmod_poly_set_coeff_ui(alpha, 1, 1);
 	// computing xi_init = x^p
+	fq_nmod_t xi_init;
+	fq_nmod_init(xi_init, ctx);
 	fq_nmod_pow_ui(xi_init, alpha, ctx->modulus->mod.n, ctx);
     fq_nmod_clear(alpha, ctx);
 
 	// use naive linear algebra for low-degree moduli
 	if (degree*s < linalg_cyclo_threshold) {
-        compute_semi_trace_linalg_cyclo(theta, ctx);
-        return;
-	}	// use naive linear algebra for low-degree moduli
-	if (degree*s < linalg_only_threshold) {
-        compute_semi_trace_linalg(theta, ctx);
+        compute_semi_trace_linalg_cyclo(theta, xi_init, ctx);
+        fq_nmod_clear(xi_init, ctx);
         return;
 	}	// use naive linear algebra for low-degree moduli
 	if (degree*s < linalg_only_threshold) {
-        compute_semi_trace_linalg(theta, ctx);
+        if (linalg_only)
+            compute_semi_trace_linalg_only(theta, xi_init, ctx);
+        else
+            compute_semi_trace_linalg(theta, xi_init, ctx);
+        fq_nmod_clear(xi_init, ctx);
         return;
 	}
 	// then use modular composition
@@ -1002,15 +1228,36 @@ void FFIsomPrimePower::compute_semi_trace(fq_nmod_poly_t theta, const fq_nmod_ct
         fq_nmod_poly_init(alphapol, ctx);
         fq_nmod_poly_set_coeff(alphapol, 0, alpha, ctx);
 
-        compute_semi_trace_modcomp(theta, alphapol, ctx, cyclo_mod_lift);
-        // if the semi trace of x is zero then we try random cases
-        while (!derand && fq_nmod_poly_is_zero(theta, ctx)) {
-			fq_nmod_poly_randtest_not_zero(alphapol, state, s, ctx);
-			compute_semi_trace_modcomp(theta, alphapol, ctx, cyclo_mod_lift);
+        // the compositions by powers of x^p are prepared on the first call
+        FrobeniusChain chain;
+        compute_semi_trace_modcomp(theta, alphapol, 1, xi_init, chain, ctx);
+        // if the semi trace of x is zero then we try random cases, a batch
+        // at a time through the same vector compositions
+        if (!derand && fq_nmod_poly_is_zero(theta, ctx)) {
+            fq_nmod_poly_struct candidates[SEMI_TRACE_RETRY_BATCH];
+            fq_nmod_poly_struct thetas[SEMI_TRACE_RETRY_BATCH];
+            for (slong i = 0; i < SEMI_TRACE_RETRY_BATCH; i++) {
+                fq_nmod_poly_init(candidates + i, ctx);
+                fq_nmod_poly_init(thetas + i, ctx);
+            }
+
+            while (fq_nmod_poly_is_zero(theta, ctx)) {
+                for (slong i = 0; i < SEMI_TRACE_RETRY_BATCH; i++)
+                    fq_nmod_poly_randtest_not_zero(candidates + i, state, s, ctx);
+                compute_semi_trace_modcomp(thetas, candidates, SEMI_TRACE_RETRY_BATCH, xi_init, chain, ctx);
+                for (slong i = 0; i < SEMI_TRACE_RETRY_BATCH && fq_nmod_poly_is_zero(theta, ctx); i++)
+                    fq_nmod_poly_set(theta, thetas + i, ctx);
+            }
+
+            for (slong i = 0; i < SEMI_TRACE_RETRY_BATCH; i++) {
+                fq_nmod_poly_clear(candidates + i, ctx);
+                fq_nmod_poly_clear(thetas + i, ctx);
+            }
         }
 
         fq_nmod_poly_clear(alphapol, ctx);
         fq_nmod_clear(alpha, ctx);
+        fq_nmod_clear(xi_init, ctx);
 	    flint_randclear(state);
         return;
 	}
@@ -1029,15 +1276,20 @@ void FFIsomPrimePower::compute_semi_trace(fq_nmod_poly_t theta, const fq_nmod_ct
         nmod_poly_set_coeff_ui(cofactor, 0, nmod_neg(1, ctx->modulus->mod));
         nmod_poly_div(cofactor, cofactor, cyclo_mod);
 
-        compute_semi_trace_cofactor(theta, alpha, cofactor, ctx);
+        // x^{p^m} and the composition by it are computed once for all alpha
+        Nmod_poly_automorphism_evaluation eval;
+        eval.prepare(cofactor->length, ctx->modulus, ctx->inv);
+
+        compute_semi_trace_cofactor(theta, alpha, cofactor, eval, ctx);
         // if the semi trace of x is zero then we try random cases
         while (!derand && fq_nmod_poly_is_zero(theta, ctx)) {
             fq_nmod_randtest_not_zero(alpha, state, ctx);
-            compute_semi_trace_cofactor(theta, alpha, cofactor, ctx);
+            compute_semi_trace_cofactor(theta, alpha, cofactor, eval, ctx);
         }
 
         nmod_poly_clear(cofactor);
         fq_nmod_clear(alpha, ctx);
+        fq_nmod_clear(xi_init, ctx);
         flint_randclear(state);
         return;
 	}
@@ -1049,14 +1301,15 @@ void FFIsomPrimePower::compute_semi_trace(fq_nmod_poly_t theta, const fq_nmod_ct
         fq_nmod_init(alpha, ctx);
         nmod_poly_set_coeff_ui(alpha, 1, 1);
 
-        compute_semi_trace_iterfrob_naive(theta, alpha, ctx, cyclo_mod_lift);
+        compute_semi_trace_iterfrob_naive(theta, alpha, ctx);
         // if the semi trace of x is zero then we try random cases
         while (!derand && fq_nmod_poly_is_zero(theta, ctx)) {
             fq_nmod_randtest_not_zero(alpha, state, ctx);
-            compute_semi_trace_iterfrob_naive(theta, alpha, ctx, cyclo_mod_lift);
+            compute_semi_trace_iterfrob_naive(theta, alpha, ctx);
         }
 
         fq_nmod_clear(alpha, ctx);
+        fq_nmod_clear(xi_init, ctx);
         flint_randclear(state);
         return;
     }
@@ -1068,14 +1321,21 @@ void FFIsomPrimePower::compute_semi_trace(fq_nmod_poly_t theta, const fq_nmod_ct
         fq_nmod_init(alpha, ctx);
         nmod_poly_set_coeff_ui(alpha, 1, 1);
 
-        compute_semi_trace_iterfrob(theta, alpha, ctx, cyclo_mod_lift);
+        // the x^{p^i} are computed once for all alpha; they and the scratch
+        // of each try live in the arena, off the stack
+        ScratchArena arena;
+        fq_nmod_struct *powers = arena.fq_nmod_vec(degree, ctx);
+        compute_frobenius_powers(powers, xi_init, ctx);
+
+        compute_semi_trace_iterfrob(theta, alpha, powers, arena, ctx);
         // if the semi trace of x is zero then we try random cases
         while (!derand && fq_nmod_poly_is_zero(theta, ctx)) {
             fq_nmod_randtest_not_zero(alpha, state, ctx);
-            compute_semi_trace_iterfrob(theta, alpha, ctx, cyclo_mod_lift);
+            compute_semi_trace_iterfrob(theta, alpha, powers, arena, ctx);
         } 
 
         fq_nmod_clear(alpha, ctx);
+        fq_nmod_clear(xi_init, ctx);
         flint_randclear(state);
         return;
     }
@@ -1124,33 +1384,64 @@ void FFIsomPrimePower::convert(fq_nmod_poly_t result, const fq_nmod_t value, con
 	fq_nmod_clear(temp, ctx);
 }
 
+/**
+ * Computes $\eta = \theta^r \in \mathbb{F}_p[z] / (cyclo\_mod)$ for a semi-trace
+ * $\theta$ over {@code ctx}, where r is the degree of {@code ctx}. Since
+ * $\sigma(\theta) = z\theta$, the power is fixed by $\sigma$ and only the constant
+ * coefficients in x of its coefficients in z can be nonzero; they are read
+ * off directly into {@code eta}, an element of {@code cyclo_ctx}.
+ *
+ * The powering runs in the tower through the Kronecker substitution of
+ * FqNmodPolyKS; the engine and the inverse of the modulus are local, so
+ * that the powers over the two fields can run on separate threads.
+ */
+void FFIsomPrimePower::compute_kummer_power(fq_nmod_t eta, const fq_nmod_poly_t theta, const fq_nmod_poly_t cyclo_mod_lift,
+		const fq_nmod_ctx_t ctx) {
+
+	fq_nmod_poly_t power, cyclo_mod_lift_inv_rev;
+	fq_nmod_poly_init(power, ctx);
+	fq_nmod_poly_init(cyclo_mod_lift_inv_rev, ctx);
+
+	// cyclo_mod_lift has coefficients in F_p, so that it is valid over ctx
+	FqNmodPolyKS ks(ctx);
+	slong len = fq_nmod_poly_length(cyclo_mod_lift, ctx);
+	fq_nmod_poly_reverse(cyclo_mod_lift_inv_rev, cyclo_mod_lift, len, ctx);
+	ks.inv_series(cyclo_mod_lift_inv_rev, cyclo_mod_lift_inv_rev, len);
+
+	ks.powmod_ui_preinv(power, theta, fq_nmod_ctx_degree(ctx), cyclo_mod_lift, cyclo_mod_lift_inv_rev);
+
+	fq_nmod_zero(eta, cyclo_ctx);
+	for (slong i = 0; i < power->length; i++)
+		nmod_poly_set_coeff_ui(eta, i, nmod_poly_get_coeff_ui(power->coeffs + i, 0));
+
+	fq_nmod_poly_clear(power, ctx);
+	fq_nmod_poly_clear(cyclo_mod_lift_inv_rev, ctx);
+}
+
 /**
  * Compute the isomorphism between the two extensions of the form $\mathbb{F}_p[z][x] / (x^r - \eta)$.
  * The isomorphism is of the form $x \mapsto cx$ for some $c \in \mathbb{F}_p[z]$. 
+ * The powers $\theta_a^r$ and $\theta_b^r$ are independent, and computed
+ * concurrently when allowed.
  */
 void FFIsomPrimePower::compute_middle_isomorphism(fq_nmod_t c, const fq_nmod_poly_t theta_a, const fq_nmod_poly_t theta_b,
 		const fq_nmod_poly_t cyclo_mod_lift) {
 
-	fq_nmod_poly_t eta;
-	fq_nmod_poly_t cyclo_mod_lift_inv_rev;
-
-	fq_nmod_poly_init(cyclo_mod_lift_inv_rev, ctx_1);
-	fq_nmod_poly_init(eta, ctx_1);
-
 	fq_nmod_t temp;
 	fq_nmod_init(temp, cyclo_ctx);
 
-	fq_nmod_poly_reverse(cyclo_mod_lift_inv_rev, cyclo_mod_lift, fq_nmod_poly_length(cyclo_mod_lift, ctx_1), ctx_1);
-	fq_nmod_poly_inv_series_newton(cyclo_mod_lift_inv_rev, cyclo_mod_lift_inv_rev, fq_nmod_poly_length(cyclo_mod_lift, ctx_1), ctx_1);
-
-	// compute theta_a^r
-	fq_nmod_poly_powmod_ui_binexp_preinv(eta, theta_a, fq_nmod_ctx_degree(ctx_1), cyclo_mod_lift, cyclo_mod_lift_inv_rev, ctx_1);
-	// now eta is an element in the cyclotomic field
-	convert(c, eta, cyclo_ctx);
-
-	// compute theta_b^r
-	fq_nmod_poly_powmod_ui_binexp_preinv(eta, theta_b, fq_nmod_ctx_degree(ctx_2), cyclo_mod_lift, cyclo_mod_lift_inv_rev, ctx_2);
-	convert(temp, eta, cyclo_ctx);
+	// compute theta_a^r and theta_b^r
+	if (num_threads > 1) {
+		thread worker([this, c, theta_a, cyclo_mod_lift] {
+			compute_kummer_power(c, theta_a, cyclo_mod_lift, ctx_1);
+			flint_cleanup();
+		});
+		compute_kummer_power(temp, theta_b, cyclo_mod_lift, ctx_2);
+		worker.join();
+	} else {
+		compute_kummer_power(c, theta_a, cyclo_mod_lift, ctx_1);
+		compute_kummer_power(temp, theta_b, cyclo_mod_lift, ctx_2);
+	}
 
 	// compute c = theta_a^r / theta_b^r
 	fq_nmod_inv(temp, temp, cyclo_ctx);
@@ -1160,8 +1451,6 @@ void FFIsomPrimePower::compute_middle_isomorphism(fq_nmod_t c, const fq_nmod_pol
 	CyclotomicExtRthRoot cyclotomicExtRthRoot;
 	cyclotomicExtRthRoot.compute_rth_root(c, c, fq_nmod_ctx_degree(ctx_1), cyclo_ctx);
 
-	fq_nmod_poly_clear(eta, ctx_1);
-	fq_nmod_poly_clear(cyclo_mod_lift_inv_rev, ctx_1);
 	fq_nmod_clear(temp, cyclo_ctx);
 }
 
@@ -1177,8 +1466,19 @@ void FFIsomPrimePower::compute_extension_isomorphism(fq_nmod_poly_t f, fq_nmod_p
 	// timeit_t time;
 	// timeit_start(time);
 	
-	compute_semi_trace(f, ctx_1, cyclo_mod_lift);
-	compute_semi_trace(f_image, ctx_2, cyclo_mod_lift);
+	// the two semi-traces are independent, so when allowed the one
+	// in ctx_1 is computed on a second thread
+	if (num_threads > 1) {
+		thread worker([this, f] {
+			compute_semi_trace(f, ctx_1);
+			flint_cleanup();
+		});
+		compute_semi_trace(f_image, ctx_2);
+		worker.join();
+	} else {
+		compute_semi_trace(f, ctx_1);
+		compute_semi_trace(f_image, ctx_2);
+	}
 	// timeit_stop(time);
 	// cout << "trace time: " << (double) time->wall / 1000.0 << "\n";
 
@@ -1191,20 +1491,32 @@ void FFIsomPrimePower::compute_extension_isomorphism(fq_nmod_poly_t f, fq_nmod_p
 	compute_middle_isomorphism(c, f, f_image, cyclo_mod_lift);
 
 	convert(c_temp, c, ctx_2);
-	fq_nmod_poly_mulmod(f_image, f_image, c_temp, cyclo_mod_lift, ctx_2);
+	FqNmodPolyKS ks(ctx_2);
+	ks.mul(f_image, f_image, c_temp);
+	ks.rem(f_image, f_image, cyclo_mod_lift);
 
-	fq_nmod_poly_clear(cyclo_mod_lift, ctx_1);
 	fq_nmod_poly_clear(c_temp, ctx_2);
 	fq_nmod_clear(c, cyclo_ctx);
     }
+
+	fq_nmod_poly_clear(cyclo_mod_lift, ctx_1);
 }
 
 void FFIsomPrimePower::compute_extension_isomorphism(nmod_poly_t f, nmod_poly_t f_image) {
 	nmod_poly_t temp;
 	nmod_poly_init(temp, ext_char);
 
-	compute_semi_trace(f, ctx_1, cyclo_root);
-	compute_semi_trace(f_image, ctx_2, cyclo_root);
+	if (num_threads > 1) {
+		thread worker([this, f] {
+			compute_semi_trace(f, ctx_1, cyclo_root);
+			flint_cleanup();
+		});
+		compute_semi_trace(f_image, ctx_2, cyclo_root);
+		worker.join();
+	} else {
+		compute_semi_trace(f, ctx_1, cyclo_root);
+		compute_semi_trace(f_image, ctx_2, cyclo_root);
+	}
 
     if (!derand) {
 	// compute the middle isomorphism
@@ -1218,9 +1530,9 @@ void FFIsomPrimePower::compute_extension_isomorphism(nmod_poly_t f, nmod_poly_t
 	mp_limb_t root = cyclotomicExtRthRoot.compute_rth_root(c, ext_deg, ext_char);
 
 	nmod_poly_scalar_mul_nmod(f_image, f_image, root);
+    }
 
 	nmod_poly_clear(temp);
-    }
 }
 
 void FFIsomPrimePower::compute_generators_trivial(nmod_poly_t g1, nmod_poly_t g2) {
@@ -1267,27 +1579,12 @@ void FFIsomPrimePower::compute_generators(nmod_poly_t g1, nmod_poly_t g2) {
 
 }
 
-/**
- * Builds a cyclotomic extension of the prime field by computing an irreducible
- * factor of the $r$-th cyclotomic polynomial.
- */
-void FFIsomPrimePower::compute_cyclotomic_extension() {
-	NModCyclotomicPoly nModCyclotomicPoly;
-	nModCyclotomicPoly.single_irred_factor(cyclo_mod, ext_deg, ext_char);
-	fq_nmod_ctx_init_modulus(cyclo_ctx, cyclo_mod, "z");
-}
-
-void FFIsomPrimePower::compute_cyclotomic_root() {
-	NModCyclotomicPoly nModCyclotomicPoly;
-	nModCyclotomicPoly.single_irred_factor(cyclo_mod, ext_deg, ext_char);
-	cyclo_root = ext_char - nmod_poly_get_coeff_ui(cyclo_mod, 0);
-}
-
 FFIsomPrimePower::FFIsomPrimePower(const nmod_poly_t modulus1, 
 				   const nmod_poly_t modulus2,
-				slong force_algo, slong derand) {
-	Util util;
+				slong force_algo, slong derand, slong num_threads,
+				std::shared_ptr<const CyclotomicContext> cyclo) {
 
+	this->linalg_only = force_algo == FORCE_LINALG_ONLY;
 	switch (force_algo) {
 		case FORCE_LINALG_CYCLO:
 		this->linalg_cyclo_threshold = WORD_MAX;
@@ -1307,7 +1604,7 @@ FFIsomPrimePower::FFIsomPrimePower(const nmod_poly_t modulus1,
 		break;
 		case FORCE_LINALG:
 		this->linalg_cyclo_threshold = 0;
-		this->linalg_only_threshold = 0;
+		this->linalg_only_threshold = WORD_MAX;
 		this->linalg_threshold = WORD_MAX;
 		this->cofactor_threshold = WORD_MAX;
 		this->iterfrob_threshold = WORD_MAX;
@@ -1347,15 +1644,18 @@ FFIsomPrimePower::FFIsomPrimePower(const nmod_poly_t modulus1,
 		break;
 		case FORCE_NONE:
 		default:
-		this->linalg_cyclo_threshold = 10;
-		this->linalg_only_threshold = 100;
-		this->linalg_threshold = 1000;
-		this->cofactor_threshold = 10000;
-		this->iterfrob_threshold = 100000;
-		this->mpe_threshold = WORD_MAX;
+		FFIsomThresholds thresholds = FFIsomThresholds::get();
+		this->linalg_cyclo_threshold = thresholds.linalg_cyclo_threshold;
+		this->linalg_only_threshold = thresholds.linalg_only_threshold;
+		this->linalg_threshold = thresholds.linalg_threshold;
+		this->cofactor_threshold = thresholds.cofactor_threshold;
+		this->iterfrob_threshold = thresholds.iterfrob_threshold;
+		this->mpe_threshold = thresholds.mpe_threshold;
 	}
 
     this->derand = derand;
+    this->num_threads = num_threads;
+    wiedemann_kernels = 0;
 
     ext_char = modulus1->mod.n;
     ext_deg = nmod_poly_degree(modulus1);
@@ -1363,29 +1663,23 @@ FFIsomPrimePower::FFIsomPrimePower(const nmod_poly_t modulus1,
 	fq_nmod_ctx_init_modulus(ctx_1, modulus1, "x");
 	fq_nmod_ctx_init_modulus(ctx_2, modulus2, "x");
 
-	fq_nmod_poly_init(delta_init, ctx_1);
-	fq_nmod_init(xi_init, ctx_1);
-	fq_nmod_init(delta_init_trivial, ctx_1);
-
-	// check for the trivial cyclotomic extension case
-	cyclo_deg = util.compute_multiplicative_order(ext_char, ext_deg);
-	nmod_poly_init(cyclo_mod, ext_char);
-        if (cyclo_deg == 1) {
-		compute_cyclotomic_root();
-	} else {
-		compute_cyclotomic_extension();
+	if (!cyclo)
+		cyclo = CyclotomicContext::get(ext_deg, ext_char);
+	else if (cyclo->get_r() != ext_deg || cyclo->get_p() != ext_char) {
+		flint_printf("Exception (FFIsomPrimePower::FFIsomPrimePower). Cyclotomic context for another (p, r).\n");
+		abort();
 	}
+	this->cyclo = cyclo;
+
+	// cyclo_deg is 1 in the trivial cyclotomic extension case
+	cyclo_deg = cyclo->get_degree();
+	cyclo_mod = cyclo->get_modulus();
+	cyclo_ctx = cyclo->get_ctx();
+	cyclo_root = cyclo->get_root();
 
 }
 
 FFIsomPrimePower::~FFIsomPrimePower() {
-	fq_nmod_poly_clear(delta_init, ctx_1);
-	fq_nmod_clear(xi_init, ctx_1);
-	fq_nmod_clear(delta_init_trivial, ctx_1);
 	fq_nmod_ctx_clear(ctx_1);
 	fq_nmod_ctx_clear(ctx_2);
-	nmod_poly_clear(cyclo_mod);
-	if (cyclo_deg > 1) {
-	  fq_nmod_ctx_clear(cyclo_ctx);
-	}
 }
@@ -11,7 +11,16 @@
 #include <flint/fq_nmod.h>
 #include <flint/fq_nmod_poly.h>
 
+#include <atomic>
+#include <memory>
+#include <vector>
+
 #include "nmod_poly_compose_mod.h"
+#include "nmod_poly_automorphism_evaluation.h"
+#include "cyclotomic_context.h"
+#include "nmod_tower_element.h"
+#include "thread_pool.h"
+#include "scratch_arena.h"
 
 enum {FORCE_LINALG_CYCLO, FORCE_LINALG_ONLY, FORCE_LINALG, FORCE_MODCOMP, FORCE_COFACTOR, FORCE_ITERFROB, FORCE_MPE, FORCE_NONE};
 
@@ -21,74 +30,111 @@ class FFIsomPrimePower {
     fq_nmod_ctx_t ctx_1;
     fq_nmod_ctx_t ctx_2;
 
+    // shared with all the isomorphisms of the same degree and characteristic;
+    // cyclo_mod and cyclo_ctx point into it
+    std::shared_ptr<const CyclotomicContext> cyclo;
     slong cyclo_deg;
-    nmod_poly_t cyclo_mod;
-    fq_nmod_ctx_t cyclo_ctx;
+    const nmod_poly_struct *cyclo_mod;
+    const fq_nmod_ctx_struct *cyclo_ctx;
     mp_limb_t cyclo_root;
 
-    fq_nmod_poly_t delta_init;
-    fq_nmod_t delta_init_trivial;
-    fq_nmod_t xi_init;
-
     slong linalg_cyclo_threshold;
     slong linalg_only_threshold;
     slong linalg_threshold;
     slong cofactor_threshold;
     slong iterfrob_threshold;
     slong mpe_threshold;
+    // below linalg_only_threshold, compute_semi_trace_linalg_only instead of
+    // compute_semi_trace_linalg; only with FORCE_LINALG_ONLY
+    bool linalg_only;
 
     slong derand;
-
-    void compute_semi_trace_trivial_linalg(fq_nmod_t theta, const fq_nmod_ctx_t ctx, mp_limb_t z);
-    void compute_semi_trace_trivial_modcomp(fq_nmod_t theta, const fq_nmod_t a, const fq_nmod_ctx_t ctx, mp_limb_t z);
-    void _compute_semi_trace_trivial_modcomp(fq_nmod_t delta, fq_nmod_t xi, slong n, const fq_nmod_ctx_t ctx, const mp_limb_t z);
-    void compute_semi_trace_linalg_cyclo(fq_nmod_poly_t theta, const fq_nmod_ctx_t ctx);
+    slong num_threads;
+    // calls of compute_ht90_kernel_wiedemann, possibly from both semi-traces
+    // at once
+    std::atomic<slong> wiedemann_kernels;
+
+    slong semi_trace_threads() const;
+
+    void compute_semi_trace_trivial_linalg(fq_nmod_t theta, const fq_nmod_t xi_init, const fq_nmod_ctx_t ctx, mp_limb_t z);
+    void compute_semi_trace_trivial_modcomp(fq_nmod_t theta, const fq_nmod_t a, const fq_nmod_t xi_init, const fq_nmod_ctx_t ctx, mp_limb_t z);
+    void _compute_semi_trace_trivial_modcomp(fq_nmod_t delta, fq_nmod_t xi, slong n, const fq_nmod_t delta_init, 
+				      const fq_nmod_t xi_init, const fq_nmod_ctx_t ctx, const mp_limb_t z);
+    void compute_semi_trace_linalg_cyclo(fq_nmod_poly_t theta, const fq_nmod_t xi_init, const fq_nmod_ctx_t ctx);
     void lift_ht90_linalg(fq_nmod_poly_t theta, const fq_nmod_t a, const nmod_mat_t frob_auto, const fq_nmod_ctx_t ctx);
-    void compute_frob_auto(nmod_mat_t frob_auto, const fq_nmod_ctx_t ctx);
-    void compute_frob_powers(fq_nmod_t *frob_powers, slong s, const nmod_mat_t frob_auto, const fq_nmod_ctx_t ctx);
-    void update_frob_powers(fq_nmod_t *frob_powers, slong s, const fq_nmod_t *frob_powers_init, const fq_nmod_ctx_t ctx);
-    void evaluate_poly_frob(nmod_mat_t cyclo_frob, const nmod_poly_t cyclo_mod, const nmod_mat_t frob_auto, const fq_nmod_ctx_t ctx);
-    void compute_semi_trace_linalg_only(fq_nmod_poly_t theta, const fq_nmod_ctx_t ctx);
+    void compute_frob_auto(nmod_mat_t frob_auto, const fq_nmod_t xi_init, ThreadPool & pool, const fq_nmod_ctx_t ctx);
+    void compute_frob_powers(fq_nmod_struct *frob_powers, slong s, const fq_nmod_t xi_init, const fq_nmod_ctx_t ctx);
+    void evaluate_poly_frob(nmod_mat_t cyclo_frob, const nmod_poly_t cyclo_mod, const fq_nmod_t xi_init, ThreadPool & pool, const fq_nmod_ctx_t ctx);
+    void compute_frobenius_starts(fq_nmod_struct *starts, const fq_nmod_t b, slong block, slong count,
+				  const fq_nmod_t xi_init, const fq_nmod_ctx_t ctx);
+    void compute_ht90_kernel_wiedemann(fq_nmod_t a, const fq_nmod_t xi_init, ThreadPool & pool, const fq_nmod_ctx_t ctx);
+    void compute_semi_trace_linalg_only(fq_nmod_poly_t theta, const fq_nmod_t xi_init, const fq_nmod_ctx_t ctx);
     void lift_ht90_modexp(fq_nmod_poly_t theta, const fq_nmod_t a, const fq_nmod_ctx_t ctx);
-    void evaluate_poly_mat(nmod_mat_t cyclo_frob, const nmod_poly_t cyclo_mod, const nmod_mat_t frob_auto, const fq_nmod_ctx_t ctx);
-    void compute_semi_trace_linalg(fq_nmod_poly_t theta, const fq_nmod_ctx_t ctx);
+    void evaluate_poly_mat(nmod_mat_t cyclo_frob, const nmod_poly_t cyclo_mod, const nmod_mat_t frob_auto, ThreadPool & pool);
+    void compute_semi_trace_linalg(fq_nmod_poly_t theta, const fq_nmod_t xi_init, const fq_nmod_ctx_t ctx);
     void compute_semi_trace_cofactor_naive(fq_nmod_poly_t theta, const fq_nmod_t alpha, const nmod_poly_t cofactor, const fq_nmod_ctx_t ctx);
-    void compute_semi_trace_cofactor(fq_nmod_poly_t theta, const fq_nmod_t alpha, const nmod_poly_t cofactor, const fq_nmod_ctx_t ctx);
-    void compute_semi_trace_modcomp(fq_nmod_poly_t theta, const fq_nmod_poly_t a, const fq_nmod_ctx_t ctx, const fq_nmod_poly_t cyclo_mod_lift);
-    void _compute_semi_trace_modcomp(fq_nmod_poly_t delta, fq_nmod_t xi, slong n, 
-				     const Nmod_poly_compose_mod & compose_xi_init, 
-				     const fq_nmod_ctx_t ctx, const fq_nmod_poly_t cyclo_mod_lift);
-    void compute_xi(fq_nmod_t xi, const fq_nmod_t old_xi, const fq_nmod_ctx_t ctx);
-    void compute_delta(fq_nmod_poly_t delta, const fq_nmod_t xi, slong z_degree, const fq_nmod_ctx_t ctx, const fq_nmod_poly_t modulus);
-
-    void compute_delta_and_xi(fq_nmod_poly_t delta, fq_nmod_t new_xi, const fq_nmod_t xi, slong z_degree, 
-			      const Nmod_poly_compose_mod & compose_xi_init, 
-			      const fq_nmod_ctx_t ctx, const fq_nmod_poly_t modulus);
-
-    void shift_delta(fq_nmod_poly_t delta, slong z_degree, const fq_nmod_ctx_t ctx);
-    void compute_semi_trace_iterfrob_naive(fq_nmod_poly_t theta, const fq_nmod_t alpha, const fq_nmod_ctx_t ctx, const fq_nmod_poly_t modulus);
-    void compute_semi_trace_iterfrob(fq_nmod_poly_t theta, const fq_nmod_t alpha, const fq_nmod_ctx_t ctx, const fq_nmod_poly_t modulus);
-    void iterated_frobenius(fq_nmod_struct *result, const fq_nmod_t alpha, const fq_nmod_ctx_t ctx, slong s);
+    void compute_semi_trace_cofactor(fq_nmod_poly_t theta, const fq_nmod_t alpha, const nmod_poly_t cofactor,
+				     Nmod_poly_automorphism_evaluation & eval, const fq_nmod_ctx_t ctx);
+
+    /**
+     * The compositions of the modcomp semi-trace, which depend on the field
+     * only: by $x^p$, and by $x^{p^{n/2}}$ at each doubling step of the
+     * recursion, in the order they are used. Built once, and reused for
+     * every random retry.
+     */
+    struct FrobeniusChain {
+        Nmod_poly_compose_mod compose_xi_init;
+        std::vector<Nmod_poly_compose_mod> doubling;
+    };
+
+    void compute_frobenius_chain(FrobeniusChain & chain, const fq_nmod_t xi_init, slong sz, const fq_nmod_ctx_t ctx);
+    void _compute_frobenius_chain(FrobeniusChain & chain, fq_nmod_t xi, slong n, const fq_nmod_t xi_init,
+				  slong sz, Nmod_poly_compose_mod::Workspace & workspace, const fq_nmod_ctx_t ctx);
+    void compute_semi_trace_modcomp(fq_nmod_poly_struct *theta, const fq_nmod_poly_struct *a, slong count,
+				    const fq_nmod_t xi_init, FrobeniusChain & chain, const fq_nmod_ctx_t ctx);
+    void _compute_semi_trace_modcomp(NmodTowerElement **delta, slong count, slong n,
+				     NmodTowerElement * const *delta_init,
+				     const FrobeniusChain & chain, slong & step,
+				     NmodTowerElement **temp, mp_ptr *rows,
+				     Nmod_poly_compose_mod::Workspace * workspaces, ThreadPool & pool,
+				     const fq_nmod_ctx_t ctx);
+
+    void compute_delta(NmodTowerElement **delta, slong count, slong z_degree,
+		       const Nmod_poly_compose_mod & compose, mp_ptr *rows,
+		       Nmod_poly_compose_mod::Workspace * workspaces, ThreadPool & pool);
+
+    void compute_semi_trace_iterfrob_naive(fq_nmod_poly_t theta, const fq_nmod_t alpha, const fq_nmod_ctx_t ctx);
+    void compute_semi_trace_iterfrob(fq_nmod_poly_t theta, const fq_nmod_t alpha, const fq_nmod_struct *powers,
+				     ScratchArena & arena, const fq_nmod_ctx_t ctx);
+    void compute_frobenius_powers(fq_nmod_struct *powers, const fq_nmod_t xi_init, const fq_nmod_ctx_t ctx);
+    void iterated_frobenius(fq_nmod_struct *result, const fq_nmod_t alpha, const fq_nmod_struct *powers, const fq_nmod_ctx_t ctx);
     void compute_semi_trace(fq_nmod_t theta, const fq_nmod_ctx_t ctx, const mp_limb_t z);
 
-    void compute_semi_trace(fq_nmod_poly_t theta, const fq_nmod_ctx_t ctx, const fq_nmod_poly_t cyclo_mod_lift);
+    void compute_semi_trace(fq_nmod_poly_t theta, const fq_nmod_ctx_t ctx);
     void compute_semi_trace_all(fq_nmod_poly_t theta, const fq_nmod_ctx_t ctx, const fq_nmod_poly_t cyclo_mod_lift);
 
     void compute_extension_isomorphism(fq_nmod_poly_t f, fq_nmod_poly_t f_image);
+    void compute_kummer_power(fq_nmod_t eta, const fq_nmod_poly_t theta, const fq_nmod_poly_t cyclo_mod_lift, const fq_nmod_ctx_t ctx);
     void compute_middle_isomorphism(fq_nmod_t c, const fq_nmod_poly_t theta_a, const fq_nmod_poly_t theta_b, const fq_nmod_poly_t modulus);
     void convert(fq_nmod_t result, const fq_nmod_poly_t value, const fq_nmod_ctx_t ctx);
     void convert(fq_nmod_poly_t result, const fq_nmod_t value, const fq_nmod_ctx_t ctx);
     void compute_extension_isomorphism(nmod_poly_t f, nmod_poly_t f_image);
-    void compute_cyclotomic_extension();
-    void compute_cyclotomic_root();
 
 public:
 
     /**
      * @param f1 Defining modulus of the first extension
      * @param f2 Defining modulus of the second extension
+     * @param num_threads If greater than one, the semi-traces of both
+     *        extensions are computed concurrently on two threads, and the
+     *        modular compositions of each use half of the threads
+     * @param cyclo The cyclotomic context for the degree and characteristic
+     *        of the extensions; if empty, it is taken from the cache of
+     *        {@code CyclotomicContext::get}. Aborts if it was built for
+     *        another (p, r)
      */
-    FFIsomPrimePower(const nmod_poly_t f1, const nmod_poly_t f2, slong force_algo = FORCE_NONE, slong derand = 0);
+    FFIsomPrimePower(const nmod_poly_t f1, const nmod_poly_t f2, slong force_algo = FORCE_NONE, slong derand = 0,
+	    slong num_threads = 1, std::shared_ptr<const CyclotomicContext> cyclo = nullptr);
 
     /**
      * Computes generators g1 of ctx_1, and g2 of ctx_2 such that
@@ -102,6 +148,12 @@ public:
     void compute_generators_nontriv(nmod_poly_t g1, nmod_poly_t g2);
     void compute_generators(nmod_poly_t g1, nmod_poly_t g2);
 
+    /**
+     * The number of HT90 kernel vectors found so far by Wiedemann's
+     * algorithm rather than with dense matrices.
+     */
+    slong get_wiedemann_kernels() const;
+
     ~FFIsomPrimePower();
 };
 
@@ -0,0 +1,427 @@
+/*
+ * ff_isom_prime_power_fmpz.cpp
+ */
+
+#include "ff_isom_prime_power_fmpz.h"
+#include "fmpz_mod_rth_root.h"
+#include "util.h"
+
+#include <flint/fmpz_poly.h>
+
+#include <thread>
+
+using namespace std;
+
+/**
+ * Computes an irreducible factor of the $r$-th cyclotomic polynomial over
+ * $\mathbb{F}_p$, whose degree is the multiplicative order of $p$ modulo $r$,
+ * by splitting off factors of that degree until one is left.
+ */
+void FFIsomPrimePowerFmpz::compute_cyclotomic_factor() {
+	Util util;
+	cyclo_deg = util.compute_multiplicative_order(fmpz_fdiv_ui(ext_char, ext_deg), ext_deg);
+
+	fmpz_poly_t cyclotomic;
+	fmpz_poly_init(cyclotomic);
+	fmpz_poly_cyclotomic(cyclotomic, ext_deg);
+	fmpz_mod_poly_set_fmpz_poly(cyclo_mod, cyclotomic);
+	fmpz_poly_clear(cyclotomic);
+
+	fmpz_mod_poly_t factor, cofactor, rem;
+	fmpz_mod_poly_init(factor, ext_char);
+	fmpz_mod_poly_init(cofactor, ext_char);
+	fmpz_mod_poly_init(rem, ext_char);
+
+	flint_rand_t state;
+	flint_randinit(state);
+
+	while (fmpz_mod_poly_degree(cyclo_mod) > cyclo_deg) {
+		if (!fmpz_mod_poly_factor_equal_deg_prob(factor, state, cyclo_mod, cyclo_deg))
+			continue;
+
+		fmpz_mod_poly_divrem(cofactor, rem, cyclo_mod, factor);
+		if (fmpz_mod_poly_degree(factor) <= fmpz_mod_poly_degree(cofactor))
+			fmpz_mod_poly_swap(cyclo_mod, factor);
+		else
+			fmpz_mod_poly_swap(cyclo_mod, cofactor);
+	}
+	fmpz_mod_poly_make_monic(cyclo_mod, cyclo_mod);
+
+	flint_randclear(state);
+	fmpz_mod_poly_clear(factor);
+	fmpz_mod_poly_clear(cofactor);
+	fmpz_mod_poly_clear(rem);
+}
+
+/**
+ * A zero element of the tower, to be freed by {@code tower_clear}.
+ */
+fmpz_mod_poly_struct * FFIsomPrimePowerFmpz::tower_init(const fmpz_t p) {
+	fmpz_mod_poly_struct *a = (fmpz_mod_poly_struct *) flint_malloc(cyclo_deg * sizeof(fmpz_mod_poly_struct));
+	for (slong i = 0; i < cyclo_deg; i++)
+		fmpz_mod_poly_init(a + i, p);
+	return a;
+}
+
+void FFIsomPrimePowerFmpz::tower_clear(fmpz_mod_poly_struct *a) {
+	for (slong i = 0; i < cyclo_deg; i++)
+		fmpz_mod_poly_clear(a + i);
+	flint_free(a);
+}
+
+bool FFIsomPrimePowerFmpz::tower_is_zero(const fmpz_mod_poly_struct *a) {
+	for (slong i = 0; i < cyclo_deg; i++)
+		if (!fmpz_mod_poly_is_zero(a + i))
+			return false;
+	return true;
+}
+
+/**
+ * Computes {@code res = c a}, where $c \in \mathbb{F}_p[z]/(g(z))$: the
+ * coefficient of $z^j$ in {@code a} is multiplied by $c z^j \bmod g$.
+ * Supports aliasing.
+ */
+void FFIsomPrimePowerFmpz::tower_scalar_mul(fmpz_mod_poly_struct *res, const fmpz_mod_poly_struct *a, const fmpz_mod_poly_t c) {
+	fmpz_mod_poly_struct *result = tower_init(ext_char);
+	fmpz_mod_poly_t v, temp;
+	fmpz_mod_poly_init(v, ext_char);
+	fmpz_mod_poly_init(temp, ext_char);
+
+	fmpz_mod_poly_rem(v, c, cyclo_mod);
+	for (slong j = 0; j < cyclo_deg; j++) {
+		for (slong i = 0; i < v->length; i++) {
+			fmpz_mod_poly_scalar_mul_fmpz(temp, a + j, v->coeffs + i);
+			fmpz_mod_poly_add(result + i, result + i, temp);
+		}
+
+		if (j + 1 < cyclo_deg) {
+			fmpz_mod_poly_shift_left(v, v, 1);
+			fmpz_mod_poly_rem(v, v, cyclo_mod);
+		}
+	}
+
+	for (slong i = 0; i < cyclo_deg; i++)
+		fmpz_mod_poly_swap(res + i, result + i);
+
+	fmpz_mod_poly_clear(v);
+	fmpz_mod_poly_clear(temp);
+	tower_clear(result);
+}
+
+/**
+ * Computes {@code res} = $z^k$ {@code a}. Supports aliasing.
+ */
+void FFIsomPrimePowerFmpz::tower_mul_z_power(fmpz_mod_poly_struct *res, const fmpz_mod_poly_struct *a, slong k) {
+	fmpz_mod_poly_t z_power;
+	fmpz_mod_poly_init(z_power, ext_char);
+
+	fmpz_mod_poly_set_coeff_ui(z_power, 1, 1);
+	fmpz_mod_poly_rem(z_power, z_power, cyclo_mod);
+	fmpz_mod_poly_powmod_ui_binexp(z_power, z_power, k, cyclo_mod);
+	tower_scalar_mul(res, a, z_power);
+
+	fmpz_mod_poly_clear(z_power);
+}
+
+/**
+ * Packs the coefficients in $z$ of {@code a} into {@code res}, the one of
+ * $z^i$ at $x^{i \cdot stride}$.
+ */
+static void tower_pack(fmpz_mod_poly_t res, const fmpz_mod_poly_struct *a, slong s, slong stride) {
+	fmpz_mod_poly_zero(res);
+	fmpz_mod_poly_fit_length(res, s * stride);
+	// from the top, so that the length is set once
+	for (slong i = s - 1; i >= 0; i--)
+		for (slong j = a[i].length - 1; j >= 0; j--)
+			fmpz_mod_poly_set_coeff_fmpz(res, i * stride + j, a[i].coeffs + j);
+}
+
+/**
+ * Computes {@code res = a b} by Kronecker substitution: a and b, whose
+ * coefficients in $z$ are reduced modulo {@code modulus}, are packed at
+ * stride $2r - 1$ and multiplied once; the product is reduced by $g(z)$ one
+ * power of $x$ at a time, then each coefficient in $z$ by {@code modulus}.
+ * This takes $M(rs) + r M(s) + s M(r)$ instead of $s^2 M(r)$. Supports
+ * aliasing.
+ */
+void FFIsomPrimePowerFmpz::tower_mul(fmpz_mod_poly_struct *res, const fmpz_mod_poly_struct *a, const fmpz_mod_poly_struct *b,
+		const fmpz_mod_poly_t modulus) {
+	slong s = cyclo_deg;
+	if (s == 1) {
+		fmpz_mod_poly_mulmod(res, a, b, modulus);
+		return;
+	}
+
+	slong stride = 2 * ext_deg - 1;
+	fmpz_mod_poly_t product, b_packed, slice;
+	fmpz_mod_poly_init(product, ext_char);
+	fmpz_mod_poly_init(b_packed, ext_char);
+	fmpz_mod_poly_init(slice, ext_char);
+	fmpz_t coeff;
+	fmpz_init(coeff);
+
+	tower_pack(product, a, s, stride);
+	tower_pack(b_packed, b, s, stride);
+	fmpz_mod_poly_mul(product, product, b_packed);
+
+	fmpz_mod_poly_struct *result = tower_init(ext_char);
+	for (slong i = 0; i < s; i++)
+		fmpz_mod_poly_fit_length(result + i, stride);
+
+	// the coefficients of x^t of the 2s - 1 blocks form a polynomial in z
+	for (slong t = 0; t < stride; t++) {
+		fmpz_mod_poly_zero(slice);
+		for (slong k = 2 * s - 2; k >= 0; k--) {
+			fmpz_mod_poly_get_coeff_fmpz(coeff, product, k * stride + t);
+			fmpz_mod_poly_set_coeff_fmpz(slice, k, coeff);
+		}
+		fmpz_mod_poly_rem(slice, slice, cyclo_mod);
+		for (slong i = 0; i < slice->length; i++)
+			fmpz_mod_poly_set_coeff_fmpz(result + i, t, slice->coeffs + i);
+	}
+
+	for (slong i = 0; i < s; i++)
+		fmpz_mod_poly_rem(res + i, result + i, modulus);
+
+	tower_clear(result);
+	fmpz_clear(coeff);
+	fmpz_mod_poly_clear(product);
+	fmpz_mod_poly_clear(b_packed);
+	fmpz_mod_poly_clear(slice);
+}
+
+/**
+ * Computes the value $\theta = a + z^{r - 1}\sigma(a) + z^{r - 2}\sigma^2(a) + \cdots +
+ * z\sigma^{r - 1}(a)$ where $a$ is in the tower, and $r$ is the degree of
+ * {@code modulus}.
+ *
+ * This is done recursively using modular composition.
+ */
+void FFIsomPrimePowerFmpz::compute_semi_trace_modcomp(fmpz_mod_poly_struct *theta, const fmpz_mod_poly_struct *a,
+		const fmpz_mod_poly_t xi_init, const fmpz_mod_poly_t modulus, const fmpz_mod_poly_t modulus_inv) {
+	fmpz_mod_poly_t xi;
+	fmpz_mod_poly_init(xi, ext_char);
+
+	Fmpz_mod_poly_compose_mod compose_xi_init(xi_init, modulus, modulus_inv);
+	_compute_semi_trace_modcomp(theta, xi, ext_deg, a, xi_init, compose_xi_init, modulus, modulus_inv);
+
+	fmpz_mod_poly_clear(xi);
+}
+
+/**
+ * Computes the value $\delta_n = a + z^{r - 1}\sigma(a) + z^{r - 2}\sigma^2(a) + \cdots +
+ * z^{r - n + 1}\sigma^{n - 1}(a)$ where $a$ = {@code delta_init}, and $\xi_n = x^{p^n}$.
+ * The compositions by $\xi_1$ = {@code xi_init} of the odd steps share
+ * {@code compose_xi_init}.
+ */
+void FFIsomPrimePowerFmpz::_compute_semi_trace_modcomp(fmpz_mod_poly_struct *delta, fmpz_mod_poly_t xi, slong n,
+		const fmpz_mod_poly_struct *delta_init, const fmpz_mod_poly_t xi_init,
+		const Fmpz_mod_poly_compose_mod & compose_xi_init,
+		const fmpz_mod_poly_t modulus, const fmpz_mod_poly_t modulus_inv) {
+
+	if (n == 1) {
+		for (slong i = 0; i < cyclo_deg; i++)
+			fmpz_mod_poly_set(delta + i, delta_init + i);
+		fmpz_mod_poly_set(xi, xi_init);
+
+		return;
+	}
+
+	slong z_degree = 0;
+	fmpz_mod_poly_struct *temp_delta = tower_init(ext_char);
+	Fmpz_mod_poly_compose_mod compose_xi;
+	const Fmpz_mod_poly_compose_mod *compose;
+
+	if (n % 2 == 0) {
+
+		_compute_semi_trace_modcomp(delta, xi, n / 2, delta_init, xi_init, compose_xi_init, modulus, modulus_inv);
+		for (slong i = 0; i < cyclo_deg; i++)
+			fmpz_mod_poly_set(temp_delta + i, delta + i);
+		compose_xi.prepare(xi, modulus, modulus_inv);
+		compose = &compose_xi;
+		z_degree = ext_deg - n / 2;
+
+	} else {
+
+		_compute_semi_trace_modcomp(delta, xi, n - 1, delta_init, xi_init, compose_xi_init, modulus, modulus_inv);
+		for (slong i = 0; i < cyclo_deg; i++)
+			fmpz_mod_poly_set(temp_delta + i, delta_init + i);
+		compose = &compose_xi_init;
+		z_degree = ext_deg - 1;
+
+	}
+
+	// compute delta
+	compose->apply(delta, delta, cyclo_deg);
+	tower_mul_z_power(delta, delta, z_degree);
+	for (slong i = 0; i < cyclo_deg; i++)
+		fmpz_mod_poly_add(delta + i, delta + i, temp_delta + i);
+
+	// compute xi
+	compose->apply(xi, xi);
+
+	tower_clear(temp_delta);
+}
+
+/**
+ * Computes a nonzero semi-trace of a random element of the extension
+ * defined by {@code modulus}.
+ *
+ * @param theta		the resulting semi-trace
+ */
+void FFIsomPrimePowerFmpz::compute_semi_trace(fmpz_mod_poly_struct *theta, const fmpz_mod_poly_t modulus, const fmpz_mod_poly_t modulus_inv) {
+	// set xi_init to x^p
+	fmpz_mod_poly_t xi_init;
+	fmpz_mod_poly_init(xi_init, ext_char);
+	fmpz_mod_poly_powmod_x_fmpz_preinv(xi_init, ext_char, modulus, modulus_inv);
+
+	fmpz_mod_poly_struct *alpha = tower_init(ext_char);
+
+	flint_rand_t state;
+	flint_randinit(state);
+
+	for (slong i = 0; i < cyclo_deg; i++)
+		fmpz_mod_poly_zero(theta + i);
+	while (tower_is_zero(theta)) {
+		fmpz_mod_poly_randtest(alpha, state, ext_deg);
+		compute_semi_trace_modcomp(theta, alpha, xi_init, modulus, modulus_inv);
+	}
+
+	tower_clear(alpha);
+	fmpz_mod_poly_clear(xi_init);
+	flint_randclear(state);
+}
+
+/**
+ * Computes $\eta = \theta^r$, which lies in $\mathbb{F}_p[z]/(g(z))$.
+ */
+void FFIsomPrimePowerFmpz::compute_kummer_power(fmpz_mod_poly_t eta, const fmpz_mod_poly_struct *theta, const fmpz_mod_poly_t modulus) {
+	fmpz_mod_poly_struct *power = tower_init(ext_char);
+	for (slong i = 0; i < cyclo_deg; i++)
+		fmpz_mod_poly_set(power + i, theta + i);
+
+	for (slong b = FLINT_BIT_COUNT(ext_deg) - 2; b >= 0; b--) {
+		tower_mul(power, power, power, modulus);
+		if ((ext_deg >> b) & 1)
+			tower_mul(power, power, theta, modulus);
+	}
+
+	fmpz_t coeff;
+	fmpz_init(coeff);
+	fmpz_mod_poly_zero(eta);
+	for (slong i = 0; i < cyclo_deg; i++) {
+		fmpz_mod_poly_get_coeff_fmpz(coeff, power + i, 0);
+		fmpz_mod_poly_set_coeff_fmpz(eta, i, coeff);
+	}
+
+	fmpz_clear(coeff);
+	tower_clear(power);
+}
+
+/**
+ * Compute the isomorphism between the cyclotomic extensions of the two
+ * fields. The resulting isomorphism is $f \mapsto f_{image}$.
+ */
+void FFIsomPrimePowerFmpz::compute_extension_isomorphism(fmpz_mod_poly_struct *f, fmpz_mod_poly_struct *f_image) {
+
+	// the two semi-traces are independent, so when allowed the one of the
+	// first field is computed on a second thread
+	if (num_threads > 1) {
+		thread worker([this, f] {
+			compute_semi_trace(f, modulus_1, modulus_inv_1);
+			flint_cleanup();
+		});
+		compute_semi_trace(f_image, modulus_2, modulus_inv_2);
+		worker.join();
+	} else {
+		compute_semi_trace(f, modulus_1, modulus_inv_1);
+		compute_semi_trace(f_image, modulus_2, modulus_inv_2);
+	}
+
+	// compute the middle isomorphism
+	fmpz_mod_poly_t eta1, eta2, c;
+	fmpz_mod_poly_init(eta1, ext_char);
+	fmpz_mod_poly_init(eta2, ext_char);
+	fmpz_mod_poly_init(c, ext_char);
+
+	compute_kummer_power(eta1, f, modulus_1);
+	compute_kummer_power(eta2, f_image, modulus_2);
+	fmpz_mod_poly_invmod(c, eta2, cyclo_mod);
+	fmpz_mod_poly_mulmod(c, c, eta1, cyclo_mod);
+
+	FmpzModRthRoot fmpzModRthRoot;
+	fmpzModRthRoot.compute_rth_root(c, c, ext_deg, cyclo_mod);
+
+	tower_scalar_mul(f_image, f_image, c);
+
+	fmpz_mod_poly_clear(eta1);
+	fmpz_mod_poly_clear(eta2);
+	fmpz_mod_poly_clear(c);
+}
+
+void FFIsomPrimePowerFmpz::compute_generators(fmpz_mod_poly_t g1, fmpz_mod_poly_t g2) {
+	fmpz_mod_poly_struct *f = tower_init(ext_char);
+	fmpz_mod_poly_struct *f_image = tower_init(ext_char);
+
+	compute_extension_isomorphism(f, f_image);
+
+	fmpz_mod_poly_set(g1, f);
+	fmpz_mod_poly_set(g2, f_image);
+
+	tower_clear(f);
+	tower_clear(f_image);
+}
+
+FFIsomPrimePowerFmpz::FFIsomPrimePowerFmpz(const fmpz_mod_poly_t f1, const fmpz_mod_poly_t f2, slong num_threads) {
+	this->num_threads = num_threads;
+
+	fmpz_init_set(ext_char, fmpz_mod_poly_modulus(f1));
+	ext_deg = fmpz_mod_poly_degree(f1);
+
+	if (fmpz_mod_poly_degree(f2) != ext_deg || !fmpz_equal(ext_char, fmpz_mod_poly_modulus(f2))) {
+		flint_printf("Exception (FFIsomPrimePowerFmpz). Different degrees or characteristics.\n");
+		abort();
+	}
+
+	if (ext_deg < 2) {
+		flint_printf("Exception (FFIsomPrimePowerFmpz). Degree < 2.\n");
+		abort();
+	}
+
+	slong l = 2;
+	while (ext_deg % l != 0)
+		l++;
+	for (slong q = ext_deg; q > 1; q /= l)
+		if (q % l != 0) {
+			flint_printf("Exception (FFIsomPrimePowerFmpz). Degree not a prime power.\n");
+			abort();
+		}
+	if (fmpz_fdiv_ui(ext_char, l) == 0) {
+		flint_printf("Exception (FFIsomPrimePowerFmpz). Degree divisible by the characteristic.\n");
+		abort();
+	}
+
+	fmpz_mod_poly_init(modulus_1, ext_char);
+	fmpz_mod_poly_init(modulus_2, ext_char);
+	fmpz_mod_poly_init(modulus_inv_1, ext_char);
+	fmpz_mod_poly_init(modulus_inv_2, ext_char);
+	fmpz_mod_poly_set(modulus_1, f1);
+	fmpz_mod_poly_set(modulus_2, f2);
+	fmpz_mod_poly_reverse(modulus_inv_1, modulus_1, modulus_1->length);
+	fmpz_mod_poly_inv_series_newton(modulus_inv_1, modulus_inv_1, modulus_1->length);
+	fmpz_mod_poly_reverse(modulus_inv_2, modulus_2, modulus_2->length);
+	fmpz_mod_poly_inv_series_newton(modulus_inv_2, modulus_inv_2, modulus_2->length);
+
+	// cyclo_deg is 1 in the trivial cyclotomic extension case
+	fmpz_mod_poly_init(cyclo_mod, ext_char);
+	compute_cyclotomic_factor();
+}
+
+FFIsomPrimePowerFmpz::~FFIsomPrimePowerFmpz() {
+	fmpz_mod_poly_clear(modulus_1);
+	fmpz_mod_poly_clear(modulus_2);
+	fmpz_mod_poly_clear(modulus_inv_1);
+	fmpz_mod_poly_clear(modulus_inv_2);
+	fmpz_mod_poly_clear(cyclo_mod);
+	fmpz_clear(ext_char);
+}
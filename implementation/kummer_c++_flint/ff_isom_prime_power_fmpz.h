@@ -0,0 +1,94 @@
+/*
+ * ff_isom_prime_power_fmpz.h
+ *
+ *  FFIsomPrimePower for a prime of any size: the same Kummer construction,
+ *  on fmpz_mod_poly instead of nmod_poly, for characteristics which do not
+ *  fit in a word.
+ */
+
+#ifndef FF_ISOM_PRIME_POWER_FMPZ_H_
+#define FF_ISOM_PRIME_POWER_FMPZ_H_
+
+#include <flint/fmpz.h>
+#include <flint/fmpz_mod_poly.h>
+
+#include "fmpz_mod_poly_compose_mod.h"
+
+/**
+ * Isomorphisms between two extensions of degree $r$ of $\mathbb{F}_p$, for a
+ * prime power $r$ prime to $p$. Elements of the cyclotomic tower
+ * $\mathbb{F}_p[x]/(f)[z]/(g(z))$ are arrays of $s = \deg g$ polynomials in
+ * $x$, the coefficients in $z$; when $s = 1$ the tower is the field itself.
+ * The semi-traces are computed by the modular composition recursion of
+ * {@code FFIsomPrimePower}.
+ *
+ * Only prime power degrees $r \geq 2$ prime to $p$ are supported; other
+ * degrees are split into prime powers by {@code FFEmbeddingFmpz}. Aborts on
+ * any other degree.
+ */
+class FFIsomPrimePowerFmpz {
+    slong ext_deg;
+    fmpz_t ext_char;
+    fmpz_mod_poly_t modulus_1;
+    fmpz_mod_poly_t modulus_2;
+    // 1 / rev(modulus_i) mod x^{r + 1}
+    fmpz_mod_poly_t modulus_inv_1;
+    fmpz_mod_poly_t modulus_inv_2;
+
+    // an irreducible factor of the r-th cyclotomic polynomial, of degree s
+    slong cyclo_deg;
+    fmpz_mod_poly_t cyclo_mod;
+
+    slong num_threads;
+
+    void compute_cyclotomic_factor();
+
+    fmpz_mod_poly_struct * tower_init(const fmpz_t p);
+    void tower_clear(fmpz_mod_poly_struct *a);
+    bool tower_is_zero(const fmpz_mod_poly_struct *a);
+    void tower_scalar_mul(fmpz_mod_poly_struct *res, const fmpz_mod_poly_struct *a, const fmpz_mod_poly_t c);
+    void tower_mul_z_power(fmpz_mod_poly_struct *res, const fmpz_mod_poly_struct *a, slong k);
+    void tower_mul(fmpz_mod_poly_struct *res, const fmpz_mod_poly_struct *a, const fmpz_mod_poly_struct *b,
+		   const fmpz_mod_poly_t modulus);
+
+    void compute_semi_trace_modcomp(fmpz_mod_poly_struct *theta, const fmpz_mod_poly_struct *a, const fmpz_mod_poly_t xi_init,
+				    const fmpz_mod_poly_t modulus, const fmpz_mod_poly_t modulus_inv);
+    void _compute_semi_trace_modcomp(fmpz_mod_poly_struct *delta, fmpz_mod_poly_t xi, slong n,
+				     const fmpz_mod_poly_struct *delta_init, const fmpz_mod_poly_t xi_init,
+				     const Fmpz_mod_poly_compose_mod & compose_xi_init,
+				     const fmpz_mod_poly_t modulus, const fmpz_mod_poly_t modulus_inv);
+    void compute_semi_trace(fmpz_mod_poly_struct *theta, const fmpz_mod_poly_t modulus, const fmpz_mod_poly_t modulus_inv);
+
+    void compute_kummer_power(fmpz_mod_poly_t eta, const fmpz_mod_poly_struct *theta, const fmpz_mod_poly_t modulus);
+    void compute_extension_isomorphism(fmpz_mod_poly_struct *f, fmpz_mod_poly_struct *f_image);
+
+public:
+
+    /**
+     * @param f1 Defining modulus of the first extension, of prime power
+     *        degree at least 2 and prime to the characteristic
+     * @param f2 Defining modulus of the second extension, of the same
+     *        degree and characteristic
+     * @param num_threads If greater than one, the semi-traces of both
+     *        extensions are computed concurrently on two threads
+     */
+    FFIsomPrimePowerFmpz(const fmpz_mod_poly_t f1, const fmpz_mod_poly_t f2, slong num_threads = 1);
+
+    FFIsomPrimePowerFmpz(const FFIsomPrimePowerFmpz &) = delete;
+    FFIsomPrimePowerFmpz & operator=(const FFIsomPrimePowerFmpz &) = delete;
+
+    /**
+     * Computes generators g1 of the first extension, and g2 of the second
+     * such that
+     * h: F_p[x]/(f1) --> F_p[x]/(f2)
+     *       g1 --> g2
+     * is an isomorphism
+     * @param g1
+     * @param g2
+     */
+    void compute_generators(fmpz_mod_poly_t g1, fmpz_mod_poly_t g2);
+
+    ~FFIsomPrimePowerFmpz();
+};
+
+#endif /* FF_ISOM_PRIME_POWER_FMPZ_H_ */
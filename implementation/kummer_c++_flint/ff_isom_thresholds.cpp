@@ -0,0 +1,144 @@
+/*
+ * ff_isom_thresholds.cpp
+ */
+
+#include "ff_isom_thresholds.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mutex>
+
+using namespace std;
+
+FFIsomThresholds::FFIsomThresholds() {
+	linalg_threshold = 1000;
+	linalg_cyclo_threshold = 10;
+	linalg_only_threshold = 100;
+	cofactor_threshold = 10000;
+	iterfrob_threshold = 100000;
+	mpe_threshold = WORD_MAX;
+	ext_comp_exponent = 0.2;
+	rectangular_compose_threshold = 50000;
+	berlekamp_massey_threshold = 200;
+	block_min_poly_threshold = WORD_MAX;
+}
+
+/**
+ * Parses a threshold, {@code inf} being WORD_MAX.
+ */
+static bool parse_threshold(slong &value, const char *text) {
+	if (strcmp(text, "inf") == 0) {
+		value = WORD_MAX;
+		return true;
+	}
+
+	char *end;
+	long long parsed = strtoll(text, &end, 10);
+	if (end == text || *end != '\0' || parsed < 0)
+		return false;
+	value = parsed;
+	return true;
+}
+
+static void print_threshold(FILE *file, const char *name, slong value) {
+	if (value == WORD_MAX)
+		fprintf(file, "%s inf\n", name);
+	else
+		fprintf(file, "%s %lld\n", name, (long long) value);
+}
+
+bool FFIsomThresholds::load(const char *filename) {
+	FILE *file = fopen(filename, "r");
+	if (file == NULL)
+		return false;
+
+	FFIsomThresholds result = *this;
+	bool ok = true;
+	char line[256];
+
+	while (ok && fgets(line, sizeof(line), file) != NULL) {
+		char *comment = strchr(line, '#');
+		if (comment != NULL)
+			*comment = '\0';
+
+		char name[64], value[64], extra[2];
+		int fields = sscanf(line, "%63s %63s %1s", name, value, extra);
+		if (fields <= 0)
+			continue;
+		if (fields != 2) {
+			ok = false;
+			break;
+		}
+
+		if (strcmp(name, "linalg_threshold") == 0)
+			ok = parse_threshold(result.linalg_threshold, value);
+		else if (strcmp(name, "linalg_cyclo_threshold") == 0)
+			ok = parse_threshold(result.linalg_cyclo_threshold, value);
+		else if (strcmp(name, "linalg_only_threshold") == 0)
+			ok = parse_threshold(result.linalg_only_threshold, value);
+		else if (strcmp(name, "cofactor_threshold") == 0)
+			ok = parse_threshold(result.cofactor_threshold, value);
+		else if (strcmp(name, "iterfrob_threshold") == 0)
+			ok = parse_threshold(result.iterfrob_threshold, value);
+		else if (strcmp(name, "mpe_threshold") == 0)
+			ok = parse_threshold(result.mpe_threshold, value);
+		else if (strcmp(name, "rectangular_compose_threshold") == 0)
+			ok = parse_threshold(result.rectangular_compose_threshold, value);
+		else if (strcmp(name, "berlekamp_massey_threshold") == 0)
+			ok = parse_threshold(result.berlekamp_massey_threshold, value);
+		else if (strcmp(name, "block_min_poly_threshold") == 0)
+			ok = parse_threshold(result.block_min_poly_threshold, value);
+		else if (strcmp(name, "ext_comp_exponent") == 0) {
+			char *end;
+			result.ext_comp_exponent = strtod(value, &end);
+			ok = end != value && *end == '\0';
+		} else
+			ok = false;
+	}
+
+	fclose(file);
+	if (ok)
+		*this = result;
+	return ok;
+}
+
+bool FFIsomThresholds::save(const char *filename) const {
+	FILE *file = fopen(filename, "w");
+	if (file == NULL)
+		return false;
+
+	print_threshold(file, "linalg_threshold", linalg_threshold);
+	print_threshold(file, "linalg_cyclo_threshold", linalg_cyclo_threshold);
+	print_threshold(file, "linalg_only_threshold", linalg_only_threshold);
+	print_threshold(file, "cofactor_threshold", cofactor_threshold);
+	print_threshold(file, "iterfrob_threshold", iterfrob_threshold);
+	print_threshold(file, "mpe_threshold", mpe_threshold);
+	fprintf(file, "ext_comp_exponent %.17g\n", ext_comp_exponent);
+	print_threshold(file, "rectangular_compose_threshold", rectangular_compose_threshold);
+	print_threshold(file, "berlekamp_massey_threshold", berlekamp_massey_threshold);
+	print_threshold(file, "block_min_poly_threshold", block_min_poly_threshold);
+
+	return fclose(file) == 0;
+}
+
+static mutex thresholds_mutex;
+static bool thresholds_ready = false;
+static FFIsomThresholds thresholds;
+
+FFIsomThresholds FFIsomThresholds::get() {
+	lock_guard<mutex> lock(thresholds_mutex);
+	if (!thresholds_ready) {
+		const char *filename = getenv("FFISOM_THRESHOLDS");
+		if (filename != NULL && !thresholds.load(filename))
+			flint_printf("Warning (FFIsomThresholds::get). Cannot load %s, using the defaults.\n", filename);
+		thresholds_ready = true;
+	}
+	return thresholds;
+}
+
+void FFIsomThresholds::set(const FFIsomThresholds &values) {
+	lock_guard<mutex> lock(thresholds_mutex);
+	thresholds = values;
+	thresholds_ready = true;
+}
@@ -0,0 +1,81 @@
+/*
+ * ff_isom_thresholds.h
+ *
+ *  The crossover points used by FFIsomPrimePower to choose an algorithm
+ *  when no FORCE_* option is given, by CyclotomicExtRthRoot to choose
+ *  between its small and large extension variants, by NmodComposeEngine
+ *  to choose a modular composition, and by NmodMinPoly to choose a
+ *  Berlekamp-Massey algorithm.
+ *
+ *  The defaults can be replaced by a profile, a text file of lines
+ *
+ *    <name> <value>
+ *
+ *  with {@code #} starting a comment and {@code inf} standing for no bound.
+ *  Names missing from the file keep their default value. The profile named
+ *  by the environment variable FFISOM_THRESHOLDS is loaded on first use;
+ *  profiles are written by the tuning tool in tune/.
+ */
+
+#ifndef FF_ISOM_THRESHOLDS_H_
+#define FF_ISOM_THRESHOLDS_H_
+
+#include <flint/flint.h>
+
+struct FFIsomThresholds {
+    // trivial cyclotomic extension: linear algebra below this degree
+    slong linalg_threshold;
+    // otherwise, on degree * s where s is the degree of the cyclotomic
+    // extension: linear algebra over the cyclotomic extension, then over F_p
+    slong linalg_cyclo_threshold;
+    slong linalg_only_threshold;
+    // then on s: modular composition, cofactor, iterated Frobenius, and
+    // multipoint evaluation above mpe_threshold
+    slong cofactor_threshold;
+    slong iterfrob_threshold;
+    slong mpe_threshold;
+    // a cyclotomic extension of degree s is small if s < r^ext_comp_exponent
+    double ext_comp_exponent;
+    // modular compositions of this degree and above go to the rectangular
+    // engine of NmodComposeEngine, when it is AUTO and has more than one
+    // thread; WORD_MAX if the engine never wins
+    slong rectangular_compose_threshold;
+    // minimal polynomials of sequences of 2 * degree terms: quadratic
+    // Berlekamp-Massey below this degree, half-gcd from it
+    slong berlekamp_massey_threshold;
+    // minimal polynomials modulo a polynomial of this degree and above use
+    // block Wiedemann, when NmodMinPoly::minimal_polynomial is given more
+    // than one thread; WORD_MAX until measured by tune_min_poly
+    slong block_min_poly_threshold;
+
+    /**
+     * The built-in values.
+     */
+    FFIsomThresholds();
+
+    /**
+     * Reads the values found in a profile.
+     * @return false if the file cannot be read or has a malformed line, in
+     *         which case no value is changed
+     */
+    bool load(const char *filename);
+
+    /**
+     * @return false if the file cannot be written
+     */
+    bool save(const char *filename) const;
+
+    /**
+     * The values in use, the defaults updated by the profile named by
+     * FFISOM_THRESHOLDS, if any.
+     */
+    static FFIsomThresholds get();
+
+    /**
+     * Replaces the values in use; FFIsomPrimePower instances already
+     * constructed keep theirs.
+     */
+    static void set(const FFIsomThresholds &thresholds);
+};
+
+#endif /* FF_ISOM_THRESHOLDS_H_ */
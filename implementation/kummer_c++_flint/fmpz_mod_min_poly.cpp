@@ -0,0 +1,288 @@
+/*
+ * fmpz_mod_min_poly.cpp
+ */
+
+#include "fmpz_mod_min_poly.h"
+
+/**
+ * The sequence is assumed to be of length 2 * degree.
+ */
+void FmpzModMinPoly::minimal_polynomial(fmpz_mod_poly_t result, const fmpz *sequence, slong degree) {
+	slong length = 2 * degree;
+	const fmpz *p = fmpz_mod_poly_modulus(result);
+
+	fmpz_mod_poly_t C, B, T, temp;
+	fmpz_mod_poly_init(C, p);
+	fmpz_mod_poly_init(B, p);
+	fmpz_mod_poly_init(T, p);
+	fmpz_mod_poly_init(temp, p);
+	fmpz_mod_poly_one(C);
+	fmpz_mod_poly_one(B);
+
+	fmpz_t b, d, coeff;
+	fmpz_init_set_ui(b, 1);
+	fmpz_init(d);
+	fmpz_init(coeff);
+
+	// C is the connection polynomial, of degree at most L, and B its value
+	// at the last change of L, m steps ago, with discrepancy b
+	slong L = 0;
+	slong m = 1;
+	for (slong n = 0; n < length; n++) {
+		fmpz_set(d, sequence + n);
+		for (slong i = 1; i <= L && i < C->length; i++)
+			fmpz_addmul(d, C->coeffs + i, sequence + n - i);
+		fmpz_mod(d, d, p);
+
+		if (fmpz_is_zero(d)) {
+			m++;
+			continue;
+		}
+
+		fmpz_invmod(coeff, b, p);
+		fmpz_mul(coeff, coeff, d);
+		fmpz_mod(coeff, coeff, p);
+		fmpz_mod_poly_shift_left(temp, B, m);
+		fmpz_mod_poly_scalar_mul_fmpz(temp, temp, coeff);
+
+		if (2 * L <= n) {
+			fmpz_mod_poly_set(T, C);
+			fmpz_mod_poly_sub(C, C, temp);
+			L = n + 1 - L;
+			fmpz_mod_poly_swap(B, T);
+			fmpz_set(b, d);
+			m = 1;
+		} else {
+			fmpz_mod_poly_sub(C, C, temp);
+			m++;
+		}
+	}
+
+	// the minimal polynomial is the reverse of C, of degree L
+	fmpz_mod_poly_reverse(result, C, L + 1);
+	fmpz_mod_poly_make_monic(result, result);
+
+	fmpz_clear(b);
+	fmpz_clear(d);
+	fmpz_clear(coeff);
+	fmpz_mod_poly_clear(C);
+	fmpz_mod_poly_clear(B);
+	fmpz_mod_poly_clear(T);
+	fmpz_mod_poly_clear(temp);
+}
+
+/**
+ * The transposed product is the middle of rev(b) a.
+ */
+void FmpzModMinPoly::transposed_mul(fmpz_mod_poly_t result, const fmpz_mod_poly_t a, const fmpz_mod_poly_t b,
+		slong m) {
+	slong n = fmpz_mod_poly_degree(b);
+	if (n == -1 || m < 0) {
+		fmpz_mod_poly_zero(result);
+		return;
+	}
+
+	fmpz_mod_poly_t temp;
+	fmpz_mod_poly_init(temp, fmpz_mod_poly_modulus(b));
+
+	fmpz_mod_poly_reverse(temp, b, n + 1);
+	fmpz_mod_poly_mullow(temp, a, temp, m + n + 1);
+	fmpz_mod_poly_shift_right(result, temp, n);
+
+	fmpz_mod_poly_clear(temp);
+}
+
+void FmpzModMinPoly::transposed_rem(fmpz_mod_poly_t result, const fmpz_mod_poly_t a, const fmpz_mod_poly_t mod,
+		const fmpz_mod_poly_t mod_inv_rev, slong m) {
+	fmpz_mod_poly_t temp;
+	fmpz_mod_poly_init(temp, fmpz_mod_poly_modulus(mod));
+
+	slong n = fmpz_mod_poly_degree(mod);
+
+	transposed_mul(temp, a, mod, m - n);
+	fmpz_mod_poly_mullow(temp, temp, mod_inv_rev, m - n + 1);
+	fmpz_mod_poly_neg(temp, temp);
+	fmpz_mod_poly_shift_left(temp, temp, n);
+	fmpz_mod_poly_add(result, a, temp);
+
+	fmpz_mod_poly_clear(temp);
+}
+
+void FmpzModMinPoly::transposed_mulmod(fmpz *result, const fmpz *a, const fmpz_mod_poly_t b, const fmpz_mod_poly_t mod,
+		const fmpz_mod_poly_t mod_inv_rev) {
+	slong n = fmpz_mod_poly_degree(mod);
+	slong m = fmpz_mod_poly_degree(b);
+	const fmpz *p = fmpz_mod_poly_modulus(mod);
+
+	fmpz_mod_poly_t temp, rem;
+	fmpz_mod_poly_init(temp, p);
+	fmpz_mod_poly_init(rem, p);
+
+	fmpz_mod_poly_fit_length(temp, n);
+	for (slong i = n - 1; i >= 0; i--)
+		fmpz_mod_poly_set_coeff_fmpz(temp, i, a + i);
+
+	if (m == -1)
+		fmpz_mod_poly_zero(temp);
+	else {
+		transposed_rem(rem, temp, mod, mod_inv_rev, m + n - 1);
+		transposed_mul(temp, rem, b, n - 1);
+	}
+
+	for (slong i = 0; i < n; i++)
+		fmpz_mod_poly_get_coeff_fmpz(result + i, temp, i);
+
+	fmpz_mod_poly_clear(temp);
+	fmpz_mod_poly_clear(rem);
+}
+
+void FmpzModMinPoly::project_powers(fmpz *result, const fmpz *a, slong l, const fmpz_mod_poly_t tau,
+		const fmpz_mod_poly_t h, const fmpz_mod_poly_t modulus) {
+	const fmpz *p = fmpz_mod_poly_modulus(modulus);
+	slong n = fmpz_mod_poly_degree(modulus);
+	if (l <= 0)
+		return;
+
+	// in degree 1 every power is a constant
+	if (n < 2) {
+		fmpz_t value, power;
+		fmpz_init(value);
+		fmpz_init(power);
+		fmpz_mod_poly_t rem;
+		fmpz_mod_poly_init(rem, p);
+		fmpz_mod_poly_rem(rem, h, modulus);
+		fmpz_mod_poly_get_coeff_fmpz(value, rem, 0);
+		fmpz_mod_poly_rem(rem, tau, modulus);
+		fmpz_mod_poly_get_coeff_fmpz(power, rem, 0);
+		fmpz_mul(power, power, a);
+		for (slong i = 0; i < l; i++) {
+			fmpz_mod(result + i, power, p);
+			fmpz_mul(power, result + i, value);
+		}
+		fmpz_mod_poly_clear(rem);
+		fmpz_clear(value);
+		fmpz_clear(power);
+		return;
+	}
+
+	fmpz_mod_poly_t modulus_inv_rev;
+	fmpz_mod_poly_init(modulus_inv_rev, p);
+	fmpz_mod_poly_reverse(modulus_inv_rev, modulus, n + 1);
+	fmpz_mod_poly_inv_series_newton(modulus_inv_rev, modulus_inv_rev, n - 1);
+
+	// the baby steps 1, h, ..., h^{k - 1}, and the giant step h^k
+	slong k = n_sqrt(l) + 1;
+	fmpz_mod_poly_struct *powers = (fmpz_mod_poly_struct *) flint_malloc((k + 1) * sizeof(fmpz_mod_poly_struct));
+	for (slong i = 0; i <= k; i++)
+		fmpz_mod_poly_init(powers + i, p);
+	fmpz_mod_poly_one(powers + 0);
+	fmpz_mod_poly_rem(powers + 1, h, modulus);
+	for (slong i = 2; i <= k; i++)
+		fmpz_mod_poly_mulmod(powers + i, powers + i - 1, powers + 1, modulus);
+
+	fmpz *form = _fmpz_vec_init(n);
+	fmpz_mod_poly_rem(powers + 0, tau, modulus);
+	transposed_mulmod(form, a, powers + 0, modulus, modulus_inv_rev);
+	fmpz_mod_poly_one(powers + 0);
+
+	for (slong base = 0; base < l; base += k) {
+		for (slong j = 0; j < k && base + j < l; j++) {
+			fmpz_zero(result + base + j);
+			for (slong t = 0; t < powers[j].length; t++)
+				fmpz_addmul(result + base + j, form + t, powers[j].coeffs + t);
+			fmpz_mod(result + base + j, result + base + j, p);
+		}
+
+		if (base + k < l)
+			transposed_mulmod(form, form, powers + k, modulus, modulus_inv_rev);
+	}
+
+	_fmpz_vec_clear(form, n);
+	for (slong i = 0; i <= k; i++)
+		fmpz_mod_poly_clear(powers + i);
+	flint_free(powers);
+	fmpz_mod_poly_clear(modulus_inv_rev);
+}
+
+/**
+ * Projects the powers of {@code f} on random vectors until their minimal
+ * polynomials add up to the one of {@code f}, as in NmodMinPoly.
+ */
+void FmpzModMinPoly::minimal_polynomial(fmpz_mod_poly_t result, const fmpz_mod_poly_t f, const fmpz_mod_poly_t modulus) {
+	const fmpz *p = fmpz_mod_poly_modulus(modulus);
+
+	fmpz_mod_poly_t g;
+	fmpz_mod_poly_t temp_g;
+	fmpz_mod_poly_t tau;
+
+	fmpz_mod_poly_init(g, p);
+	fmpz_mod_poly_init(temp_g, p);
+	fmpz_mod_poly_init(tau, p);
+
+	fmpz_mod_poly_one(g);
+	fmpz_mod_poly_one(tau);
+
+	slong degree = fmpz_mod_poly_degree(modulus);
+	fmpz *a = _fmpz_vec_init(degree);
+	fmpz *sequence = _fmpz_vec_init(2 * degree);
+
+	flint_rand_t state;
+	flint_randinit(state);
+
+	slong l = 0;
+	while (true) {
+
+		for (slong i = 0; i < degree; i++)
+			fmpz_randm(a + i, state, p);
+
+		l = degree - fmpz_mod_poly_degree(g);
+		project_powers(sequence, a, l * 2, tau, f, modulus);
+		minimal_polynomial(temp_g, sequence, l);
+
+		fmpz_mod_poly_mul(g, g, temp_g);
+		if (fmpz_mod_poly_degree(g) == degree)
+			break;
+
+		fmpz_mod_poly_compose_mod(temp_g, temp_g, f, modulus);
+		fmpz_mod_poly_mulmod(tau, tau, temp_g, modulus);
+		if (fmpz_mod_poly_is_zero(tau))
+			break;
+	}
+
+	fmpz_mod_poly_set(result, g);
+
+	fmpz_mod_poly_clear(g);
+	fmpz_mod_poly_clear(temp_g);
+	fmpz_mod_poly_clear(tau);
+	_fmpz_vec_clear(a, degree);
+	_fmpz_vec_clear(sequence, 2 * degree);
+	flint_randclear(state);
+}
+
+void FmpzModMinPoly::minimal_polynomial_of_degree(fmpz_mod_poly_t result, const fmpz_mod_poly_t f,
+		const fmpz_mod_poly_t modulus, slong degree) {
+	const fmpz *p = fmpz_mod_poly_modulus(modulus);
+	slong n = fmpz_mod_poly_degree(modulus);
+
+	fmpz_mod_poly_t one;
+	fmpz_mod_poly_init(one, p);
+	fmpz_mod_poly_one(one);
+
+	fmpz *a = _fmpz_vec_init(n);
+	fmpz *sequence = _fmpz_vec_init(2 * degree);
+
+	flint_rand_t state;
+	flint_randinit(state);
+
+	do {
+		for (slong i = 0; i < n; i++)
+			fmpz_randm(a + i, state, p);
+		project_powers(sequence, a, 2 * degree, one, f, modulus);
+		minimal_polynomial(result, sequence, degree);
+	} while (fmpz_mod_poly_degree(result) != degree);
+
+	fmpz_mod_poly_clear(one);
+	_fmpz_vec_clear(a, n);
+	_fmpz_vec_clear(sequence, 2 * degree);
+	flint_randclear(state);
+}
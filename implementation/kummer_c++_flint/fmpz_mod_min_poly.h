@@ -0,0 +1,73 @@
+/*
+ * fmpz_mod_min_poly.h
+ *
+ *  Minimal polynomials over a prime field of any size: the multi-limb
+ *  counterpart of NmodMinPoly. The power sequences are projected by baby
+ *  steps and giant steps, the giant steps as transposed modular products,
+ *  and reduced by the quadratic Berlekamp-Massey algorithm.
+ */
+
+#ifndef FMPZ_MOD_MIN_POLY_H_
+#define FMPZ_MOD_MIN_POLY_H_
+
+#include <flint/fmpz_vec.h>
+#include <flint/fmpz_mod_poly.h>
+
+class FmpzModMinPoly {
+public:
+
+    /**
+     * Computes the minimal polynomial of the linearly recurrent sequence
+     * {@code sequence}, of length {@code 2 * degree}, whose minimal
+     * polynomial has degree at most {@code degree}.
+     */
+    void minimal_polynomial(fmpz_mod_poly_t result, const fmpz *sequence, slong degree);
+
+    /**
+     * Computes the transposed product of {@code a} and {@code b}, of degree
+     * at most {@code m}; deg(a) <= deg(b) + m.
+     */
+    void transposed_mul(fmpz_mod_poly_t result, const fmpz_mod_poly_t a, const fmpz_mod_poly_t b, slong m);
+
+    /**
+     * Computes the transposed remainder of {@code a}, of degree < n, by
+     * {@code mod} of degree n, to degree at most {@code m}.
+     * @param mod_inv_rev 1 / rev(mod, n) mod x^{n - 1}
+     */
+    void transposed_rem(fmpz_mod_poly_t result, const fmpz_mod_poly_t a, const fmpz_mod_poly_t mod,
+            const fmpz_mod_poly_t mod_inv_rev, slong m);
+
+    /**
+     * Computes the linear form {@code b}°{@code a}, $u \mapsto a(b u \bmod mod)$,
+     * {@code a} and {@code result} being vectors of length deg(mod). Supports
+     * aliasing.
+     * @param mod_inv_rev 1 / rev(mod, n) mod x^{n - 1} where n = deg(mod)
+     */
+    void transposed_mulmod(fmpz *result, const fmpz *a, const fmpz_mod_poly_t b, const fmpz_mod_poly_t mod,
+            const fmpz_mod_poly_t mod_inv_rev);
+
+    /**
+     * Computes the $l$ values $\langle a, \tau h^i \bmod modulus \rangle$ for
+     * $0 \le i < l$: the form $a$ is moved to $\tau$°$a$, then for each
+     * giant step projected on the baby steps $1, h, \dots, h^{k - 1}$,
+     * $k \approx \sqrt{l}$, and moved by the transposed product by $h^k$.
+     * {@code result} may alias {@code a}.
+     */
+    void project_powers(fmpz *result, const fmpz *a, slong l, const fmpz_mod_poly_t tau,
+            const fmpz_mod_poly_t h, const fmpz_mod_poly_t modulus);
+
+    /**
+     * Computes the minimal polynomial of {@code f} modulo {@code modulus}.
+     */
+    void minimal_polynomial(fmpz_mod_poly_t result, const fmpz_mod_poly_t f, const fmpz_mod_poly_t modulus);
+
+    /**
+     * Same as above when the minimal polynomial is known to have degree
+     * {@code degree}: random projections of 2 * degree powers are tried
+     * until one gives a generator of that degree.
+     */
+    void minimal_polynomial_of_degree(fmpz_mod_poly_t result, const fmpz_mod_poly_t f,
+            const fmpz_mod_poly_t modulus, slong degree);
+};
+
+#endif /* FMPZ_MOD_MIN_POLY_H_ */
@@ -0,0 +1,96 @@
+#include <flint/fmpz_mod_poly.h>
+#include "fmpz_mod_poly_compose_mod.h"
+
+/*------------------------------------------------------*/
+/* empty object, to be prepared                         */
+/*------------------------------------------------------*/
+Fmpz_mod_poly_compose_mod::Fmpz_mod_poly_compose_mod(){
+  prepared = false;
+  n = 0;
+}
+
+Fmpz_mod_poly_compose_mod::Fmpz_mod_poly_compose_mod(const fmpz_mod_poly_t arg,
+						     const fmpz_mod_poly_t poly,
+						     const fmpz_mod_poly_t polyinv){
+  prepared = false;
+  n = 0;
+  prepare(arg, poly, polyinv);
+}
+
+Fmpz_mod_poly_compose_mod::~Fmpz_mod_poly_compose_mod(){
+  release();
+}
+
+void Fmpz_mod_poly_compose_mod::release(){
+  if (prepared){
+    fmpz_mod_poly_clear(f);
+    fmpz_mod_poly_clear(f_inv);
+    fmpz_mat_clear(A);
+  }
+  prepared = false;
+}
+
+/*------------------------------------------------------*/
+/* precomputes the baby steps arg^i mod poly            */
+/*------------------------------------------------------*/
+void Fmpz_mod_poly_compose_mod::prepare(const fmpz_mod_poly_t arg,
+					const fmpz_mod_poly_t poly,
+					const fmpz_mod_poly_t polyinv){
+  slong n_in = fmpz_mod_poly_degree(poly);
+
+  if (n_in < 1){
+    flint_printf("Exception (Fmpz_mod_poly_compose_mod::prepare). Modulus of degree < 1.\n");
+    abort();
+  }
+
+  if (prepared && n_in != n)
+    release();
+
+  if (!prepared){
+    fmpz_mod_poly_init(f, fmpz_mod_poly_modulus(poly));
+    fmpz_mod_poly_init(f_inv, fmpz_mod_poly_modulus(poly));
+    fmpz_mat_init(A, n_sqrt(n_in) + 1, n_in);
+  }
+
+  n = n_in;
+  fmpz_mod_poly_set(f, poly);
+  fmpz_mod_poly_set(f_inv, polyinv);
+  fmpz_mod_poly_precompute_matrix(A, arg, f, f_inv);
+  prepared = true;
+}
+
+/*------------------------------------------------------*/
+/* computes res[i] = polys[i](arg) mod f, 0 <= i < len  */
+/*------------------------------------------------------*/
+void Fmpz_mod_poly_compose_mod::apply(fmpz_mod_poly_struct * res,
+				      const fmpz_mod_poly_struct * polys,
+				      slong len) const{
+  for (slong i = 0; i < len; i++)
+    apply(res + i, polys + i);
+}
+
+void Fmpz_mod_poly_compose_mod::apply(fmpz_mod_poly_t res, const fmpz_mod_poly_t poly) const{
+  if (!prepared){
+    flint_printf("Exception (Fmpz_mod_poly_compose_mod::apply). Not prepared.\n");
+    abort();
+  }
+
+  if (poly->length > n){
+    flint_printf("Exception (Fmpz_mod_poly_compose_mod::apply). Polynomial not reduced.\n");
+    abort();
+  }
+
+  if (res == poly){
+    fmpz_mod_poly_t temp;
+    fmpz_mod_poly_init(temp, fmpz_mod_poly_modulus(poly));
+    fmpz_mod_poly_compose_mod_brent_kung_precomp_preinv(temp, poly, A, f, f_inv);
+    fmpz_mod_poly_swap(res, temp);
+    fmpz_mod_poly_clear(temp);
+  }
+  else
+    fmpz_mod_poly_compose_mod_brent_kung_precomp_preinv(res, poly, A, f, f_inv);
+}
+
+bool Fmpz_mod_poly_compose_mod::is_prepared() const{
+  return prepared;
+}
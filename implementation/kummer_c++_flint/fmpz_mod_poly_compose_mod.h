@@ -0,0 +1,65 @@
+#ifndef FMPZ_MOD_POLY_COMPOSE_MOD_H_
+#define FMPZ_MOD_POLY_COMPOSE_MOD_H_
+
+#include <flint/fmpz_mod_poly.h>
+#include <flint/fmpz_mat.h>
+
+/*------------------------------------------------------------------------*/
+/* Brent-Kung modular composition by a fixed argument, for a prime of any */
+/* size: the multi-limb counterpart of Nmod_poly_compose_mod, on top of   */
+/* FLINT's precomputed fmpz_mod_poly composition                          */
+/*------------------------------------------------------------------------*/
+class Fmpz_mod_poly_compose_mod {
+ public:
+
+ Fmpz_mod_poly_compose_mod();
+
+ /**
+  * Same as calling {@code prepare(arg, poly, polyinv)} on an empty object.
+  */
+ Fmpz_mod_poly_compose_mod(const fmpz_mod_poly_t arg,
+			   const fmpz_mod_poly_t poly,
+			   const fmpz_mod_poly_t polyinv);
+
+ Fmpz_mod_poly_compose_mod(const Fmpz_mod_poly_compose_mod &) = delete;
+ Fmpz_mod_poly_compose_mod & operator=(const Fmpz_mod_poly_compose_mod &) = delete;
+
+ ~Fmpz_mod_poly_compose_mod();
+
+/*------------------------------------------------------------------------*/
+/* setup for modular composition by arg mod poly                          */
+/* polyinv = 1 /rev(poly) mod x^n                                         */
+/* the baby steps arg^i, i <= sqrt(n), are kept as the rows of a matrix   */
+/* may be called again; the matrix is reused when the degree agrees       */
+/*------------------------------------------------------------------------*/
+void prepare(const fmpz_mod_poly_t arg,
+	     const fmpz_mod_poly_t poly,
+	     const fmpz_mod_poly_t polyinv);
+
+/*------------------------------------------------------------------------*/
+/* res[i] = polys[i](arg) mod poly, i=0..len-1                            */
+/* deg(polys[i]) < deg(poly); res[i] must be initialized                  */
+/* res may alias polys                                                    */
+/*------------------------------------------------------------------------*/
+void apply(fmpz_mod_poly_struct * res,
+	   const fmpz_mod_poly_struct * polys,
+	   slong len) const;
+
+/*------------------------------------------------------------------------*/
+/* res = poly(arg) mod poly                                               */
+/*------------------------------------------------------------------------*/
+void apply(fmpz_mod_poly_t res, const fmpz_mod_poly_t poly) const;
+
+bool is_prepared() const;
+
+ private:
+ void release();
+
+ bool prepared;
+ slong n;
+ fmpz_mod_poly_t f, f_inv;
+ fmpz_mat_t A;  // baby steps
+};
+
+
+#endif
@@ -0,0 +1,195 @@
+/*
+ * fmpz_mod_rth_root.cpp
+ */
+
+#include "fmpz_mod_rth_root.h"
+
+/**
+ * {@code res = a^e} in the field, for $e \ge 0$.
+ */
+void FmpzModRthRoot::pow(fmpz_mod_poly_t res, const fmpz_mod_poly_t a, const fmpz_t e) {
+	if (fmpz_is_zero(e)) {
+		fmpz_mod_poly_one(res);
+		return;
+	}
+	fmpz_mod_poly_powmod_fmpz_binexp(res, a, e, modulus);
+}
+
+/**
+ * Computes a generator {@code g} of the Sylow $l$-subgroup of order $l^e$,
+ * as the $t$-th power of a random element which is not an $l$-th power,
+ * where $t$ is the cofactor of $l^e$ in the order of the group.
+ */
+void FmpzModRthRoot::compute_sylow_generator(fmpz_mod_poly_t g, const fmpz_t t, slong l, slong e) {
+	const fmpz *p = fmpz_mod_poly_modulus(modulus);
+	slong degree = fmpz_mod_poly_degree(modulus);
+
+	fmpz_mod_poly_t c, h, one;
+	fmpz_mod_poly_init(c, p);
+	fmpz_mod_poly_init(h, p);
+	fmpz_mod_poly_init(one, p);
+	fmpz_mod_poly_one(one);
+
+	fmpz_t order;
+	fmpz_init(order);
+	fmpz_set_ui(order, l);
+	fmpz_pow_ui(order, order, e - 1);
+
+	flint_rand_t state;
+	flint_randinit(state);
+
+	while (true) {
+		fmpz_mod_poly_randtest_not_zero(c, state, degree);
+		pow(g, c, t);
+		pow(h, g, order);
+		if (!fmpz_mod_poly_equal(h, one))
+			break;
+	}
+
+	flint_randclear(state);
+	fmpz_clear(order);
+	fmpz_mod_poly_clear(c);
+	fmpz_mod_poly_clear(h);
+	fmpz_mod_poly_clear(one);
+}
+
+/**
+ * Computes the discrete logarithm of {@code a} in base {@code g}, the
+ * generator of the Sylow $l$-subgroup of order $l^e$, one digit in base $l$
+ * at a time (Pohlig-Hellman).
+ */
+void FmpzModRthRoot::compute_sylow_log(fmpz_t log, const fmpz_mod_poly_t a, const fmpz_mod_poly_t g, slong l, slong e) {
+	const fmpz *p = fmpz_mod_poly_modulus(modulus);
+
+	fmpz_mod_poly_t gamma, g_inv, h, power;
+	fmpz_mod_poly_init(gamma, p);
+	fmpz_mod_poly_init(g_inv, p);
+	fmpz_mod_poly_init(h, p);
+	fmpz_mod_poly_init(power, p);
+
+	fmpz_t l_power, digit_power;
+	fmpz_init(l_power);
+	fmpz_init(digit_power);
+
+	// gamma = g^{l^{e - 1}} has order l
+	fmpz_set_ui(l_power, l);
+	fmpz_pow_ui(l_power, l_power, e - 1);
+	pow(gamma, g, l_power);
+	fmpz_mod_poly_invmod(g_inv, g, modulus);
+
+	fmpz_zero(log);
+	fmpz_one(digit_power);
+	for (slong j = 0; j < e; j++) {
+		// the j-th digit is the logarithm of (a g^{-log})^{l^{e - 1 - j}} in base gamma
+		pow(h, g_inv, log);
+		fmpz_mod_poly_mulmod(h, h, a, modulus);
+		fmpz_set_ui(l_power, l);
+		fmpz_pow_ui(l_power, l_power, e - 1 - j);
+		pow(h, h, l_power);
+
+		slong d = 0;
+		fmpz_mod_poly_one(power);
+		while (!fmpz_mod_poly_equal(power, h)) {
+			fmpz_mod_poly_mulmod(power, power, gamma, modulus);
+			d++;
+			if (d == l) {
+				flint_printf("Exception (FmpzModRthRoot::compute_sylow_log). Not in the subgroup.\n");
+				abort();
+			}
+		}
+
+		fmpz_addmul_ui(log, digit_power, d);
+		fmpz_mul_ui(digit_power, digit_power, l);
+	}
+
+	fmpz_clear(l_power);
+	fmpz_clear(digit_power);
+	fmpz_mod_poly_clear(gamma);
+	fmpz_mod_poly_clear(g_inv);
+	fmpz_mod_poly_clear(h);
+	fmpz_mod_poly_clear(power);
+}
+
+/**
+ * Supports aliasing.
+ */
+void FmpzModRthRoot::compute_rth_root(fmpz_mod_poly_t root, const fmpz_mod_poly_t a, slong r, const fmpz_mod_poly_t modulus) {
+	this->modulus = modulus;
+	const fmpz *p = fmpz_mod_poly_modulus(modulus);
+
+	if (fmpz_mod_poly_is_zero(a)) {
+		fmpz_mod_poly_zero(root);
+		this->modulus = NULL;
+		return;
+	}
+
+	// r = l^k
+	slong l = 2;
+	while (r % l != 0)
+		l++;
+	slong k = 0;
+	for (slong q = r; q > 1; q /= l) {
+		if (q % l != 0) {
+			flint_printf("Exception (FmpzModRthRoot::compute_rth_root). r is not a prime power.\n");
+			abort();
+		}
+		k++;
+	}
+
+	// the order of the group is l^e t with t prime to l
+	fmpz_t t, l_fmpz, m, log;
+	fmpz_init(t);
+	fmpz_init(l_fmpz);
+	fmpz_init(m);
+	fmpz_init(log);
+
+	fmpz_pow_ui(t, p, fmpz_mod_poly_degree(modulus));
+	fmpz_sub_ui(t, t, 1);
+	fmpz_set_ui(l_fmpz, l);
+	slong e = fmpz_remove(t, t, l_fmpz);
+	if (e < k) {
+		flint_printf("Exception (FmpzModRthRoot::compute_rth_root). r does not divide the order of the group.\n");
+		abort();
+	}
+
+	fmpz_mod_poly_t x, err, g;
+	fmpz_mod_poly_init(x, p);
+	fmpz_mod_poly_init(err, p);
+	fmpz_mod_poly_init(g, p);
+
+	// x = a^m with m = 1 / r mod t: x^r / a = a^{rm - 1} lies in the Sylow
+	// l-subgroup, and is an r-th power there since a is an r-th power
+	if (!fmpz_is_one(t)) {
+		fmpz_set_ui(m, r);
+		fmpz_invmod(m, m, t);
+	}
+	pow(x, a, m);
+	fmpz_mod_poly_invmod(err, a, modulus);
+	fmpz_set_ui(log, r);
+	pow(g, x, log);
+	fmpz_mod_poly_mulmod(err, err, g, modulus);
+
+	fmpz_mod_poly_one(g);
+	if (fmpz_mod_poly_equal(err, g)) {
+		fmpz_mod_poly_set(root, x);
+	} else {
+		// with err = g^{log} for a generator g, r divides log, and the root
+		// is x g^{-log / r}
+		compute_sylow_generator(g, t, l, e);
+		compute_sylow_log(log, err, g, l, e);
+		fmpz_divexact_ui(log, log, r);
+		fmpz_pow_ui(m, l_fmpz, e);
+		fmpz_sub(log, m, log);
+		pow(g, g, log);
+		fmpz_mod_poly_mulmod(root, x, g, modulus);
+	}
+
+	fmpz_clear(t);
+	fmpz_clear(l_fmpz);
+	fmpz_clear(m);
+	fmpz_clear(log);
+	fmpz_mod_poly_clear(x);
+	fmpz_mod_poly_clear(err);
+	fmpz_mod_poly_clear(g);
+	this->modulus = NULL;
+}
@@ -0,0 +1,43 @@
+/*
+ * fmpz_mod_rth_root.h
+ *
+ *  r-th roots in a cyclotomic extension of a prime field of any size: the
+ *  multi-limb counterpart of CyclotomicExtRthRoot.
+ */
+
+#ifndef FMPZ_MOD_RTH_ROOT_H_
+#define FMPZ_MOD_RTH_ROOT_H_
+
+#include <flint/fmpz_mod_poly.h>
+
+/**
+ * Takes $r$-th roots for a prime power $r = l^k$ in the field
+ * $\mathbb{F}_p[Z] / (g(Z))$, where $r$ divides the order of its
+ * multiplicative group, by the Adleman-Manders-Miller algorithm: an
+ * approximate root is corrected by a discrete logarithm in the Sylow
+ * $l$-subgroup, which costs $O(l)$ multiplications per digit in base $l$.
+ */
+class FmpzModRthRoot {
+    const fmpz_mod_poly_struct *modulus;
+
+    void pow(fmpz_mod_poly_t res, const fmpz_mod_poly_t a, const fmpz_t e);
+    void compute_sylow_generator(fmpz_mod_poly_t g, const fmpz_t t, slong l, slong e);
+    void compute_sylow_log(fmpz_t log, const fmpz_mod_poly_t a, const fmpz_mod_poly_t g, slong l, slong e);
+
+public:
+
+    /**
+     * Computes an $r$-th root of {@code a} in the field defined by the
+     * irreducible {@code modulus}, typically a factor of the $r$-th
+     * cyclotomic polynomial. This method does not check for $r$-th powers,
+     * and assumes {@code a} an $r$-th power.
+     *
+     * @param root     the computed $r$-th root, reduced modulo {@code modulus}
+     * @param a        an $r$-th power in the field
+     * @param r        a prime power dividing the order of the multiplicative group
+     * @param modulus  the defining polynomial of the field
+     */
+    void compute_rth_root(fmpz_mod_poly_t root, const fmpz_mod_poly_t a, slong r, const fmpz_mod_poly_t modulus);
+};
+
+#endif /* FMPZ_MOD_RTH_ROOT_H_ */
@@ -43,7 +43,8 @@ void fq_nmodPolyEval::clear_subproduct_tree(fq_nmod_poly_t **tree, slong num_poi
 	}
 }
 
-void fq_nmodPolyEval::build_subproduct_tree(fq_nmod_poly_t **tree, const fq_nmod_struct *points, slong num_points) {
+void fq_nmodPolyEval::build_subproduct_tree(fq_nmod_poly_t **tree, const fq_nmod_struct *points, slong num_points,
+		FqNmodPolyKS &ks) {
 
 	slong k = n_flog(num_points, 2) + 1;
 	slong length = num_points;
@@ -64,11 +65,11 @@ void fq_nmodPolyEval::build_subproduct_tree(fq_nmod_poly_t **tree, const fq_nmod
 
 	for (slong i = 1; i < k; i++) {
 		for (slong j = 0; j < length / 2; j++) {
-			fq_nmod_poly_mul(tree[i][j], tree[i - 1][2 * j], tree[i - 1][2 * j + 1], ctx);
+			ks.mul(tree[i][j], tree[i - 1][2 * j], tree[i - 1][2 * j + 1]);
 		}
 
 		if (length % 2 != 0)
-			fq_nmod_poly_mul(tree[i][length / 2 - 1], tree[i][length / 2 - 1], tree[i - 1][length - 1], ctx);
+			ks.mul(tree[i][length / 2 - 1], tree[i][length / 2 - 1], tree[i - 1][length - 1]);
 
 		length /= 2;
 	}
@@ -77,24 +78,25 @@ void fq_nmodPolyEval::build_subproduct_tree(fq_nmod_poly_t **tree, const fq_nmod
 	fq_nmod_clear(temp_coeff, ctx);
 }
 
-void fq_nmodPolyEval::go_down_subproduct_tree(fq_nmod_struct *results, const fq_nmod_poly_t f, fq_nmod_poly_t **tree, slong num_points) {
+void fq_nmodPolyEval::go_down_subproduct_tree(fq_nmod_struct *results, const fq_nmod_poly_t f, fq_nmod_poly_t **tree, slong num_points,
+		FqNmodPolyKS &ks) {
 
 	slong k = n_flog(num_points, 2) + 1;
 	slong rev_length = n_revbin(num_points, k);
 	;
 	slong length = 1;
 
-	fq_nmod_poly_rem(tree[k - 1][0], f, tree[k - 1][0], ctx);
+	ks.rem(tree[k - 1][0], f, tree[k - 1][0]);
 	rev_length >>= 1;
 
 	for (slong j = k - 2; j >= 0; j--) {
 		for (slong i = 0; i < length; i++) {
-			fq_nmod_poly_rem(tree[j][2 * i], tree[j + 1][i], tree[j][2 * i], ctx);
-			fq_nmod_poly_rem(tree[j][2 * i + 1], tree[j + 1][i], tree[j][2 * i + 1], ctx);
+			ks.rem(tree[j][2 * i], tree[j + 1][i], tree[j][2 * i]);
+			ks.rem(tree[j][2 * i + 1], tree[j + 1][i], tree[j][2 * i + 1]);
 		}
 
 		if (rev_length & 1)
-			fq_nmod_poly_rem(tree[j][2 * length], tree[j + 1][length - 1], tree[j][2 * length], ctx);
+			ks.rem(tree[j][2 * length], tree[j + 1][length - 1], tree[j][2 * length]);
 
 		length = 2 * length + (rev_length & 1);
 		rev_length >>= 1;
@@ -110,9 +112,10 @@ void fq_nmodPolyEval::multipoint_eval(fq_nmod_struct *results, const fq_nmod_pol
 
 	this->ctx = ctx;
 
+	FqNmodPolyKS ks(ctx);
 	fq_nmod_poly_t **tree = init_subproduct_tree(num_points);
-	build_subproduct_tree(tree, points, num_points);
-	go_down_subproduct_tree(results, f, tree, num_points);
+	build_subproduct_tree(tree, points, num_points, ks);
+	go_down_subproduct_tree(results, f, tree, num_points, ks);
 	clear_subproduct_tree(tree, num_points);
 
 	delete[] tree;
@@ -9,6 +9,7 @@
 #define fq_nmod_POLY_MULTIPPOINT_EVAL_H_
 
 #include <flint/fq_nmod_poly.h>
+#include "fq_nmod_poly_ks.h"
 
 /**
  * This class is fast multipoint evaluation over finite fields.
@@ -16,8 +17,9 @@
 class fq_nmodPolyEval {
     const fq_nmod_ctx_struct *ctx;
 
-    void build_subproduct_tree(fq_nmod_poly_t **tree, const fq_nmod_struct *points, slong num_points);
-    void go_down_subproduct_tree(fq_nmod_struct *results, const fq_nmod_poly_t f, fq_nmod_poly_t **tree, slong num_points);
+    void build_subproduct_tree(fq_nmod_poly_t **tree, const fq_nmod_struct *points, slong num_points, FqNmodPolyKS &ks);
+    void go_down_subproduct_tree(fq_nmod_struct *results, const fq_nmod_poly_t f, fq_nmod_poly_t **tree, slong num_points,
+            FqNmodPolyKS &ks);
     fq_nmod_poly_t ** init_subproduct_tree(slong num_points);
     void clear_subproduct_tree(fq_nmod_poly_t **tree, slong num_points);
 
@@ -27,7 +29,8 @@ public:
      * Evaluates {@code f} at the {@code n} elements {@code points} of the field
      * {@code ctx}, and store the results in {@code results}. It is assumed that
      * {@code n} < deg {@code f}. The algorithm used, is a divide and conquer 
-     * algorithm that builds a subproduct tree.   
+     * algorithm that builds a subproduct tree; the products and remainders
+     * are done by Kronecker substitution.
      * 
      * @param results	the result of evaluation
      * @param f			the given polynomial
@@ -0,0 +1,311 @@
+/*
+ * fq_nmod_poly_ks.cpp
+ */
+
+#include "fq_nmod_poly_ks.h"
+
+#include <flint/nmod_vec.h>
+
+// in KS_AUTO mode, the reciprocal packing is used while the packed
+// products are below this length: there the integer products are not yet
+// in the FFT range, and two half-size products are cheaper than one
+static const slong KS_RECIPROCAL_CUTOFF = 1 << 16;
+
+// moduli of at most this length are handled by FLINT's division
+static const slong KS_REM_CUTOFF = 8;
+
+FqNmodPolyKS::FqNmodPolyKS(const fq_nmod_ctx_t ctx, Variant variant) {
+	this->ctx = ctx;
+	this->variant = variant;
+
+	mp_limb_t p = ctx->mod.n;
+	nmod_poly_init(packed_a, p);
+	nmod_poly_init(packed_b, p);
+	nmod_poly_init(product, p);
+	nmod_poly_init(packed_rev_a, p);
+	nmod_poly_init(packed_rev_b, p);
+	nmod_poly_init(product_rev, p);
+}
+
+FqNmodPolyKS::~FqNmodPolyKS() {
+	nmod_poly_clear(packed_a);
+	nmod_poly_clear(packed_b);
+	nmod_poly_clear(product);
+	nmod_poly_clear(packed_rev_a);
+	nmod_poly_clear(packed_rev_b);
+	nmod_poly_clear(product_rev);
+}
+
+/**
+ * Packs the first {@code len} coefficients of {@code a}, the i-th at
+ * x^{i width}; with {@code reverse}, each coefficient c is replaced by
+ * x^{d - 1} c(1 / x).
+ */
+void FqNmodPolyKS::pack(nmod_poly_t res, const fq_nmod_poly_t a, slong len, slong width, bool reverse) {
+	slong d = fq_nmod_ctx_degree(ctx);
+	slong total = (len - 1) * width + d;
+
+	nmod_poly_fit_length(res, total);
+	_nmod_vec_zero(res->coeffs, total);
+
+	for (slong i = 0; i < len; i++) {
+		const fq_nmod_struct *c = a->coeffs + i;
+		mp_ptr slot = res->coeffs + i * width;
+		if (reverse) {
+			for (slong j = 0; j < c->length; j++)
+				slot[d - 1 - j] = c->coeffs[j];
+		} else
+			_nmod_vec_set(slot, c->coeffs, c->length);
+	}
+
+	_nmod_poly_set_length(res, total);
+	_nmod_poly_normalise(res);
+}
+
+/**
+ * Reduces the {@code len} limbs of {@code buffer} modulo f, in place, and
+ * sets {@code c} to the result.
+ */
+void FqNmodPolyKS::set_coeff(fq_nmod_struct *c, mp_ptr buffer, slong len) {
+	slong d = fq_nmod_ctx_degree(ctx);
+	if (len > d) {
+		_fq_nmod_reduce(buffer, len, ctx);
+		len = d;
+	}
+
+	nmod_poly_fit_length(c, len);
+	_nmod_vec_set(c->coeffs, buffer, len);
+	_nmod_poly_set_length(c, len);
+	_nmod_poly_normalise(c);
+}
+
+void FqNmodPolyKS::mul_single(fq_nmod_poly_t res, const fq_nmod_poly_t a, slong len_a, const fq_nmod_poly_t b, slong len_b) {
+	slong d = fq_nmod_ctx_degree(ctx);
+	slong width = 2 * d - 1;
+	slong len = len_a + len_b - 1;
+
+	pack(packed_a, a, len_a, width, false);
+	if (a == b && len_a == len_b)
+		nmod_poly_mul(product, packed_a, packed_a);
+	else {
+		pack(packed_b, b, len_b, width, false);
+		nmod_poly_mul(product, packed_a, packed_b);
+	}
+
+	// the operands are no longer read: res may alias them
+	mp_ptr buffer = _nmod_vec_init(width);
+	fq_nmod_poly_fit_length(res, len, ctx);
+	for (slong k = 0; k < len; k++) {
+		slong start = k * width;
+		slong slot_len = FLINT_MIN(width, product->length - start);
+		if (slot_len <= 0) {
+			nmod_poly_zero(res->coeffs + k);
+			continue;
+		}
+		_nmod_vec_set(buffer, product->coeffs + start, slot_len);
+		set_coeff(res->coeffs + k, buffer, slot_len);
+	}
+	_nmod_vec_clear(buffer);
+
+	_fq_nmod_poly_set_length(res, len, ctx);
+	_fq_nmod_poly_normalise(res, ctx);
+}
+
+/**
+ * With c_k = lo_k + x^d hi_k the unreduced coefficients of the product,
+ * slot k of the direct product holds lo_k + hi_{k - 1} and slot k of the
+ * reversed one holds the reverses of hi_k and lo_{k - 1}; both are peeled
+ * off from k = 0 upwards.
+ */
+void FqNmodPolyKS::mul_reciprocal(fq_nmod_poly_t res, const fq_nmod_poly_t a, slong len_a, const fq_nmod_poly_t b, slong len_b) {
+	slong d = fq_nmod_ctx_degree(ctx);
+	slong len = len_a + len_b - 1;
+	nmod_t mod = ctx->mod;
+
+	pack(packed_a, a, len_a, d, false);
+	pack(packed_rev_a, a, len_a, d, true);
+	if (a == b && len_a == len_b) {
+		nmod_poly_mul(product, packed_a, packed_a);
+		nmod_poly_mul(product_rev, packed_rev_a, packed_rev_a);
+	} else {
+		pack(packed_b, b, len_b, d, false);
+		pack(packed_rev_b, b, len_b, d, true);
+		nmod_poly_mul(product, packed_a, packed_b);
+		nmod_poly_mul(product_rev, packed_rev_a, packed_rev_b);
+	}
+
+	// lo, hi and the previous lo, hi; hi has d - 1 coefficients, the last
+	// limb stays zero
+	mp_ptr halves = _nmod_vec_init(4 * d);
+	mp_ptr buffer = _nmod_vec_init(2 * d);
+	_nmod_vec_zero(halves, 4 * d);
+	mp_ptr lo = halves, hi = halves + d, prev_lo = halves + 2 * d, prev_hi = halves + 3 * d;
+
+	fq_nmod_poly_fit_length(res, len, ctx);
+	for (slong k = 0; k < len; k++) {
+		for (slong t = 0; t < d; t++) {
+			slong i = k * d + t;
+			mp_limb_t value = i < product->length ? product->coeffs[i] : 0;
+			lo[t] = nmod_sub(value, prev_hi[t], mod);
+		}
+		for (slong j = 0; j < d - 1; j++) {
+			slong i = k * d + d - 2 - j;
+			mp_limb_t value = i < product_rev->length ? product_rev->coeffs[i] : 0;
+			hi[j] = nmod_sub(value, prev_lo[j], mod);
+		}
+
+		_nmod_vec_set(buffer, lo, d);
+		_nmod_vec_set(buffer + d, hi, d - 1);
+		set_coeff(res->coeffs + k, buffer, 2 * d - 1);
+
+		mp_ptr temp = prev_lo;
+		prev_lo = lo;
+		lo = temp;
+		temp = prev_hi;
+		prev_hi = hi;
+		hi = temp;
+	}
+	_nmod_vec_clear(halves);
+	_nmod_vec_clear(buffer);
+
+	_fq_nmod_poly_set_length(res, len, ctx);
+	_fq_nmod_poly_normalise(res, ctx);
+}
+
+void FqNmodPolyKS::_mul(fq_nmod_poly_t res, const fq_nmod_poly_t a, slong len_a, const fq_nmod_poly_t b, slong len_b) {
+	if (len_a == 0 || len_b == 0) {
+		fq_nmod_poly_zero(res, ctx);
+		return;
+	}
+
+	slong d = fq_nmod_ctx_degree(ctx);
+	bool reciprocal;
+	if (variant == KS_AUTO)
+		reciprocal = d > 1 && (len_a + len_b) * d < KS_RECIPROCAL_CUTOFF;
+	else
+		reciprocal = variant == KS_RECIPROCAL;
+
+	if (reciprocal)
+		mul_reciprocal(res, a, len_a, b, len_b);
+	else
+		mul_single(res, a, len_a, b, len_b);
+}
+
+void FqNmodPolyKS::mul(fq_nmod_poly_t res, const fq_nmod_poly_t a, const fq_nmod_poly_t b) {
+	_mul(res, a, a->length, b, b->length);
+}
+
+void FqNmodPolyKS::mullow(fq_nmod_poly_t res, const fq_nmod_poly_t a, const fq_nmod_poly_t b, slong n) {
+	_mul(res, a, FLINT_MIN(a->length, n), b, FLINT_MIN(b->length, n));
+	if (res->length > n)
+		fq_nmod_poly_truncate(res, n, ctx);
+}
+
+/**
+ * g <- g - g (a g - 1), doubling the precision at each step; the low
+ * half of a g - 1 vanishes and is skipped.
+ */
+void FqNmodPolyKS::inv_series(fq_nmod_poly_t res, const fq_nmod_poly_t a, slong n) {
+	fq_nmod_poly_t g, t;
+	fq_nmod_t c;
+	fq_nmod_poly_init(g, ctx);
+	fq_nmod_poly_init(t, ctx);
+	fq_nmod_init(c, ctx);
+
+	fq_nmod_poly_get_coeff(c, a, 0, ctx);
+	fq_nmod_inv(c, c, ctx);
+	fq_nmod_poly_set_coeff(g, 0, c, ctx);
+
+	for (slong k = 1; k < n;) {
+		slong k2 = FLINT_MIN(2 * k, n);
+
+		mullow(t, a, g, k2);
+		fq_nmod_poly_shift_right(t, t, k, ctx);
+		mullow(t, g, t, k2 - k);
+		fq_nmod_poly_shift_left(t, t, k, ctx);
+		fq_nmod_poly_sub(g, g, t, ctx);
+
+		k = k2;
+	}
+
+	fq_nmod_poly_set(res, g, ctx);
+
+	fq_nmod_poly_clear(g, ctx);
+	fq_nmod_poly_clear(t, ctx);
+	fq_nmod_clear(c, ctx);
+}
+
+void FqNmodPolyKS::rem_preinv(fq_nmod_poly_t res, const fq_nmod_poly_t a, const fq_nmod_poly_t m, const fq_nmod_poly_t m_inv) {
+	slong len_a = a->length;
+	slong len_m = m->length;
+	if (len_a < len_m) {
+		fq_nmod_poly_set(res, a, ctx);
+		return;
+	}
+
+	slong n = len_a - len_m + 1;
+	fq_nmod_poly_t q, t;
+	fq_nmod_poly_init(q, ctx);
+	fq_nmod_poly_init(t, ctx);
+
+	// the quotient is the reverse of rev(a) / rev(m) mod y^n
+	fq_nmod_poly_reverse(q, a, len_a, ctx);
+	mullow(q, q, m_inv, n);
+	fq_nmod_poly_reverse(q, q, n, ctx);
+
+	mullow(t, q, m, len_m - 1);
+	fq_nmod_poly_sub(res, a, t, ctx);
+	fq_nmod_poly_truncate(res, len_m - 1, ctx);
+
+	fq_nmod_poly_clear(q, ctx);
+	fq_nmod_poly_clear(t, ctx);
+}
+
+void FqNmodPolyKS::rem(fq_nmod_poly_t res, const fq_nmod_poly_t a, const fq_nmod_poly_t m) {
+	if (a->length < m->length) {
+		fq_nmod_poly_set(res, a, ctx);
+		return;
+	}
+	if (m->length <= KS_REM_CUTOFF) {
+		fq_nmod_poly_rem(res, a, m, ctx);
+		return;
+	}
+
+	fq_nmod_poly_t m_inv;
+	fq_nmod_poly_init(m_inv, ctx);
+	fq_nmod_poly_reverse(m_inv, m, m->length, ctx);
+	inv_series(m_inv, m_inv, a->length - m->length + 1);
+	rem_preinv(res, a, m, m_inv);
+	fq_nmod_poly_clear(m_inv, ctx);
+}
+
+void FqNmodPolyKS::mulmod_preinv(fq_nmod_poly_t res, const fq_nmod_poly_t a, const fq_nmod_poly_t b,
+		const fq_nmod_poly_t m, const fq_nmod_poly_t m_inv) {
+	mul(res, a, b);
+	rem_preinv(res, res, m, m_inv);
+}
+
+void FqNmodPolyKS::powmod_ui_preinv(fq_nmod_poly_t res, const fq_nmod_poly_t a, ulong e,
+		const fq_nmod_poly_t m, const fq_nmod_poly_t m_inv) {
+	if (e == 0) {
+		fq_nmod_poly_one(res, ctx);
+		return;
+	}
+
+	fq_nmod_poly_t base, power;
+	fq_nmod_poly_init(base, ctx);
+	fq_nmod_poly_init(power, ctx);
+	fq_nmod_poly_set(base, a, ctx);
+	fq_nmod_poly_set(power, a, ctx);
+
+	for (slong i = FLINT_BIT_COUNT(e) - 2; i >= 0; i--) {
+		mulmod_preinv(power, power, power, m, m_inv);
+		if ((e >> i) & 1)
+			mulmod_preinv(power, power, base, m, m_inv);
+	}
+
+	fq_nmod_poly_set(res, power, ctx);
+
+	fq_nmod_poly_clear(base, ctx);
+	fq_nmod_poly_clear(power, ctx);
+}
@@ -0,0 +1,106 @@
+/*
+ * fq_nmod_poly_ks.h
+ *
+ *  Arithmetic of polynomials in y over F_p[x]/(f(x)) by Kronecker
+ *  substitution: the coefficients, polynomials of degree < d in x, are
+ *  packed into a single nmod_poly_t, which is multiplied by FLINT (itself
+ *  through a substitution into the integers, hence "double" KS), and the
+ *  product is unpacked and reduced modulo f.
+ *
+ *  Two packings are implemented:
+ *
+ *    single      y = x^{2d - 1}, so that the coefficients of the product
+ *                do not overlap; one product of length about 2d la + 2d lb
+ *    reciprocal  y = x^d, together with the packing of the reversed
+ *                coefficients; the coefficients of the two products of
+ *                length about d la + d lb overlap, and are separated using
+ *                the low half of one and the high half of the other
+ *
+ *  The elements of ctx and the polynomials passed in are reduced; results
+ *  may alias the operands.
+ */
+
+#ifndef FQ_NMOD_POLY_KS_H_
+#define FQ_NMOD_POLY_KS_H_
+
+#include <flint/nmod_poly.h>
+#include <flint/fq_nmod.h>
+#include <flint/fq_nmod_poly.h>
+
+class FqNmodPolyKS {
+public:
+
+    enum Variant {
+        KS_AUTO, KS_SINGLE, KS_RECIPROCAL
+    };
+
+private:
+
+    const fq_nmod_ctx_struct *ctx;
+    Variant variant;
+
+    // packed operands and products, kept between calls
+    nmod_poly_t packed_a;
+    nmod_poly_t packed_b;
+    nmod_poly_t product;
+    nmod_poly_t packed_rev_a;
+    nmod_poly_t packed_rev_b;
+    nmod_poly_t product_rev;
+
+    void pack(nmod_poly_t res, const fq_nmod_poly_t a, slong len, slong width, bool reverse);
+    void set_coeff(fq_nmod_struct *c, mp_ptr buffer, slong len);
+    void mul_single(fq_nmod_poly_t res, const fq_nmod_poly_t a, slong len_a, const fq_nmod_poly_t b, slong len_b);
+    void mul_reciprocal(fq_nmod_poly_t res, const fq_nmod_poly_t a, slong len_a, const fq_nmod_poly_t b, slong len_b);
+    void _mul(fq_nmod_poly_t res, const fq_nmod_poly_t a, slong len_a, const fq_nmod_poly_t b, slong len_b);
+
+public:
+
+    /**
+     * An engine for polynomials over {@code ctx}, which must outlive it.
+     * Not thread safe: each thread uses its own engine.
+     */
+    FqNmodPolyKS(const fq_nmod_ctx_t ctx, Variant variant = KS_AUTO);
+    ~FqNmodPolyKS();
+
+    FqNmodPolyKS(const FqNmodPolyKS &) = delete;
+    FqNmodPolyKS & operator=(const FqNmodPolyKS &) = delete;
+
+    void mul(fq_nmod_poly_t res, const fq_nmod_poly_t a, const fq_nmod_poly_t b);
+
+    /**
+     * {@code res} = {@code a b} mod y^n.
+     */
+    void mullow(fq_nmod_poly_t res, const fq_nmod_poly_t a, const fq_nmod_poly_t b, slong n);
+
+    /**
+     * The inverse of {@code a} mod y^n by Newton iteration; the constant
+     * coefficient of {@code a} must be invertible.
+     */
+    void inv_series(fq_nmod_poly_t res, const fq_nmod_poly_t a, slong n);
+
+    /**
+     * {@code res} = {@code a} mod {@code m}, where {@code m_inv} is the
+     * inverse of the reverse of {@code m} to a precision at least
+     * len({@code a}) - len({@code m}) + 1.
+     */
+    void rem_preinv(fq_nmod_poly_t res, const fq_nmod_poly_t a, const fq_nmod_poly_t m, const fq_nmod_poly_t m_inv);
+
+    /**
+     * {@code res} = {@code a} mod {@code m}; the inverse needed is computed
+     * on the fly, and short moduli are handled by FLINT's division.
+     */
+    void rem(fq_nmod_poly_t res, const fq_nmod_poly_t a, const fq_nmod_poly_t m);
+
+    /**
+     * {@code res} = {@code a b} mod {@code m}, for {@code a}, {@code b}
+     * reduced modulo {@code m}, and {@code m_inv} to a precision at least
+     * len({@code m}) - 1.
+     */
+    void mulmod_preinv(fq_nmod_poly_t res, const fq_nmod_poly_t a, const fq_nmod_poly_t b,
+            const fq_nmod_poly_t m, const fq_nmod_poly_t m_inv);
+
+    void powmod_ui_preinv(fq_nmod_poly_t res, const fq_nmod_poly_t a, ulong e,
+            const fq_nmod_poly_t m, const fq_nmod_poly_t m_inv);
+};
+
+#endif /* FQ_NMOD_POLY_KS_H_ */
@@ -0,0 +1,638 @@
+/*
+ * gf2_poly.cpp
+ */
+
+#include "gf2_poly.h"
+
+#include <algorithm>
+
+#if defined(__x86_64__)
+#include <cpuid.h>
+#include <wmmintrin.h>
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+// below this many limbs, products are schoolbook
+static const slong KARATSUBA_CUTOFF = 16;
+
+static inline slong limbs_for(slong length) {
+	return (length + FLINT_BITS - 1) / FLINT_BITS;
+}
+
+/*
+ * Limb products: res[0], res[1] = a * b, carry-less.
+ */
+
+/**
+ * The portable product, by windows of 4 bits of {@code a}; the top bits of
+ * {@code b} shifted out of the window table are repaired at the end.
+ */
+static inline void clmul_portable(mp_limb_t a, mp_limb_t b, mp_limb_t *res) {
+	mp_limb_t u[16];
+	u[0] = 0;
+	u[1] = b;
+	for (slong i = 2; i < 16; i += 2) {
+		u[i] = u[i / 2] << 1;
+		u[i + 1] = u[i] ^ b;
+	}
+
+	mp_limb_t l = u[a & 15];
+	mp_limb_t h = 0;
+	for (slong i = 4; i < 64; i += 4) {
+		mp_limb_t t = u[(a >> i) & 15];
+		l ^= t << i;
+		h ^= t >> (64 - i);
+	}
+
+	h ^= ((a & UWORD(0xeeeeeeeeeeeeeeee)) >> 1) & (-((b >> 63) & 1));
+	h ^= ((a & UWORD(0xcccccccccccccccc)) >> 2) & (-((b >> 62) & 1));
+	h ^= ((a & UWORD(0x8888888888888888)) >> 3) & (-((b >> 61) & 1));
+
+	res[0] = l;
+	res[1] = h;
+}
+
+/**
+ * Schoolbook products; {@code res} has {@code na + nb} limbs, overwritten.
+ */
+static void mul_basecase_portable(mp_ptr res, mp_srcptr a, slong na, mp_srcptr b, slong nb) {
+	mp_limb_t p[2];
+	fill(res, res + na + nb, 0);
+	for (slong i = 0; i < na; i++)
+		for (slong j = 0; j < nb; j++) {
+			clmul_portable(a[i], b[j], p);
+			res[i + j] ^= p[0];
+			res[i + j + 1] ^= p[1];
+		}
+}
+
+#if defined(__x86_64__)
+__attribute__((target("pclmul,sse2")))
+static void mul_basecase_pclmul(mp_ptr res, mp_srcptr a, slong na, mp_srcptr b, slong nb) {
+	fill(res, res + na + nb, 0);
+	for (slong i = 0; i < na; i++) {
+		__m128i x = _mm_cvtsi64_si128(a[i]);
+		for (slong j = 0; j < nb; j++) {
+			__m128i z = _mm_clmulepi64_si128(x, _mm_cvtsi64_si128(b[j]), 0);
+			res[i + j] ^= _mm_cvtsi128_si64(z);
+			res[i + j + 1] ^= _mm_cvtsi128_si64(_mm_unpackhi_epi64(z, z));
+		}
+	}
+}
+
+static bool cpu_has_pclmul() {
+	unsigned int eax, ebx, ecx, edx;
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+		return false;
+	return (ecx & bit_PCLMUL) != 0;
+}
+#else
+static bool cpu_has_pclmul() {
+	return false;
+}
+#endif
+
+typedef void (*mul_basecase_t)(mp_ptr, mp_srcptr, slong, mp_srcptr, slong);
+
+static mul_basecase_t select_basecase(bool pclmul) {
+#if defined(__x86_64__)
+	if (pclmul && cpu_has_pclmul())
+		return mul_basecase_pclmul;
+#endif
+	return mul_basecase_portable;
+}
+
+static mul_basecase_t mul_basecase = select_basecase(true);
+
+bool Gf2Poly::use_pclmul(bool enable) {
+	mul_basecase = select_basecase(enable);
+	return mul_basecase != mul_basecase_portable;
+}
+
+/**
+ * {@code res} = {@code a b}, with {@code na + nb} limbs; Karatsuba above the
+ * cutoff, on slices of the longer operand when unbalanced. No aliasing.
+ */
+static void _gf2_mul(mp_ptr res, mp_srcptr a, slong na, mp_srcptr b, slong nb) {
+	if (na < nb) {
+		swap(a, b);
+		swap(na, nb);
+	}
+
+	if (nb == 0) {
+		fill(res, res + na, 0);
+		return;
+	}
+
+	if (nb < KARATSUBA_CUTOFF) {
+		mul_basecase(res, a, na, b, nb);
+		return;
+	}
+
+	if (na > nb) {
+		vector<mp_limb_t> temp(2 * nb);
+		fill(res, res + na + nb, 0);
+		for (slong offset = 0; offset < na; offset += nb) {
+			slong len = FLINT_MIN(nb, na - offset);
+			_gf2_mul(temp.data(), a + offset, len, b, nb);
+			for (slong i = 0; i < len + nb; i++)
+				res[offset + i] ^= temp[i];
+		}
+		return;
+	}
+
+	// a = a0 + a1 X, b = b0 + b1 X with X = x^{64 h}: the middle product is
+	// (a0 + a1)(b0 + b1) + a0 b0 + a1 b1
+	slong n = na;
+	slong h = (n + 1) / 2;
+	slong l = n - h;
+
+	_gf2_mul(res, a, h, b, h);
+	_gf2_mul(res + 2 * h, a + h, l, b + h, l);
+
+	vector<mp_limb_t> sum_a(a, a + h), sum_b(b, b + h), middle(2 * h);
+	for (slong i = 0; i < l; i++) {
+		sum_a[i] ^= a[h + i];
+		sum_b[i] ^= b[h + i];
+	}
+	_gf2_mul(middle.data(), sum_a.data(), h, sum_b.data(), h);
+
+	for (slong i = 0; i < 2 * h; i++)
+		middle[i] ^= res[i];
+	for (slong i = 0; i < 2 * l; i++)
+		middle[i] ^= res[2 * h + i];
+	for (slong i = 0; i < 2 * h; i++)
+		res[h + i] ^= middle[i];
+}
+
+static inline mp_limb_t bit_reverse(mp_limb_t x) {
+	x = ((x >> 1) & UWORD(0x5555555555555555)) | ((x & UWORD(0x5555555555555555)) << 1);
+	x = ((x >> 2) & UWORD(0x3333333333333333)) | ((x & UWORD(0x3333333333333333)) << 2);
+	x = ((x >> 4) & UWORD(0x0f0f0f0f0f0f0f0f)) | ((x & UWORD(0x0f0f0f0f0f0f0f0f)) << 4);
+	x = ((x >> 8) & UWORD(0x00ff00ff00ff00ff)) | ((x & UWORD(0x00ff00ff00ff00ff)) << 8);
+	x = ((x >> 16) & UWORD(0x0000ffff0000ffff)) | ((x & UWORD(0x0000ffff0000ffff)) << 16);
+	return (x >> 32) | (x << 32);
+}
+
+/**
+ * The 64 bits of {@code a} from bit {@code pos} on, zero past the end.
+ */
+static inline mp_limb_t limb_at(const vector<mp_limb_t> &a, slong pos) {
+	slong w = pos / FLINT_BITS;
+	slong s = pos % FLINT_BITS;
+	slong size = a.size();
+
+	mp_limb_t res = w < size ? a[w] >> s : 0;
+	if (s != 0 && w + 1 < size)
+		res |= a[w + 1] << (FLINT_BITS - s);
+	return res;
+}
+
+/*------------------------------------------------------------------------*/
+
+Gf2Poly::Gf2Poly() {
+	length = 0;
+}
+
+Gf2Poly::Gf2Poly(const nmod_poly_t a) {
+	set(a);
+}
+
+void Gf2Poly::normalise() {
+	while (!limbs.empty() && limbs.back() == 0)
+		limbs.pop_back();
+	length = limbs.empty() ? 0 : FLINT_BITS * (limbs.size() - 1) + FLINT_BIT_COUNT(limbs.back());
+}
+
+void Gf2Poly::set(const nmod_poly_t a) {
+	limbs.assign(limbs_for(a->length), 0);
+	for (slong i = 0; i < a->length; i++)
+		limbs[i / FLINT_BITS] |= (a->coeffs[i] & UWORD(1)) << (i % FLINT_BITS);
+	normalise();
+}
+
+void Gf2Poly::get(nmod_poly_t a) const {
+	nmod_poly_fit_length(a, length);
+	for (slong i = 0; i < length; i++)
+		a->coeffs[i] = get_coeff(i);
+	_nmod_poly_set_length(a, length);
+	_nmod_poly_normalise(a);
+}
+
+void Gf2Poly::zero() {
+	limbs.clear();
+	length = 0;
+}
+
+void Gf2Poly::one() {
+	limbs.assign(1, 1);
+	length = 1;
+}
+
+bool Gf2Poly::is_zero() const {
+	return length == 0;
+}
+
+slong Gf2Poly::degree() const {
+	return length - 1;
+}
+
+int Gf2Poly::get_coeff(slong i) const {
+	if (i >= length)
+		return 0;
+	return (limbs[i / FLINT_BITS] >> (i % FLINT_BITS)) & 1;
+}
+
+void Gf2Poly::set_coeff(slong i, int c) {
+	if (c & 1) {
+		if (i >= length)
+			limbs.resize(limbs_for(i + 1), 0);
+		limbs[i / FLINT_BITS] |= UWORD(1) << (i % FLINT_BITS);
+	} else if (i < length) {
+		limbs[i / FLINT_BITS] &= ~(UWORD(1) << (i % FLINT_BITS));
+	}
+	normalise();
+}
+
+void Gf2Poly::add(Gf2Poly &res, const Gf2Poly &a, const Gf2Poly &b) {
+	const Gf2Poly &longer = a.length >= b.length ? a : b;
+	const Gf2Poly &shorter = a.length >= b.length ? b : a;
+
+	vector<mp_limb_t> sum(longer.limbs);
+	for (size_t i = 0; i < shorter.limbs.size(); i++)
+		sum[i] ^= shorter.limbs[i];
+
+	res.limbs.swap(sum);
+	res.normalise();
+}
+
+void Gf2Poly::mul(Gf2Poly &res, const Gf2Poly &a, const Gf2Poly &b) {
+	if (a.is_zero() || b.is_zero()) {
+		res.zero();
+		return;
+	}
+
+	slong na = a.limbs.size();
+	slong nb = b.limbs.size();
+	vector<mp_limb_t> product(na + nb);
+	_gf2_mul(product.data(), a.limbs.data(), na, b.limbs.data(), nb);
+
+	res.limbs.swap(product);
+	res.normalise();
+}
+
+void Gf2Poly::shift_left(Gf2Poly &res, const Gf2Poly &a, slong n) {
+	if (a.is_zero()) {
+		res.zero();
+		return;
+	}
+
+	slong w = n / FLINT_BITS;
+	slong s = n % FLINT_BITS;
+	slong size = a.limbs.size();
+	vector<mp_limb_t> shifted(limbs_for(a.length + n), 0);
+
+	for (slong i = 0; i < size; i++) {
+		shifted[i + w] |= a.limbs[i] << s;
+		if (s != 0 && i + w + 1 < (slong) shifted.size())
+			shifted[i + w + 1] |= a.limbs[i] >> (FLINT_BITS - s);
+	}
+
+	res.limbs.swap(shifted);
+	res.normalise();
+}
+
+void Gf2Poly::shift_right(Gf2Poly &res, const Gf2Poly &a, slong n) {
+	if (n >= a.length) {
+		res.zero();
+		return;
+	}
+
+	slong size = limbs_for(a.length - n);
+	vector<mp_limb_t> shifted(size);
+	for (slong i = 0; i < size; i++)
+		shifted[i] = limb_at(a.limbs, n + FLINT_BITS * i);
+
+	res.limbs.swap(shifted);
+	res.normalise();
+}
+
+void Gf2Poly::truncate(Gf2Poly &a, slong n) {
+	if (n >= a.length)
+		return;
+
+	a.limbs.resize(limbs_for(n));
+	if (n % FLINT_BITS != 0)
+		a.limbs.back() &= (UWORD(1) << (n % FLINT_BITS)) - 1;
+	a.normalise();
+}
+
+void Gf2Poly::reverse(Gf2Poly &res, const Gf2Poly &a, slong n) {
+	if (n <= 0) {
+		res.zero();
+		return;
+	}
+
+	// the reverse over the whole limbs, then shifted down to length n
+	slong size = limbs_for(n);
+	Gf2Poly reversed;
+	reversed.limbs.assign(size, 0);
+	for (slong i = 0; i < (slong) a.limbs.size(); i++)
+		reversed.limbs[size - 1 - i] = bit_reverse(a.limbs[i]);
+	reversed.normalise();
+
+	shift_right(res, reversed, FLINT_BITS * size - n);
+}
+
+void Gf2Poly::inv_series(Gf2Poly &res, const Gf2Poly &a, slong n) {
+	// Newton iteration; in characteristic 2, g (2 - a g) = a g^2
+	Gf2Poly g, truncated;
+	g.one();
+	for (slong k = 1; k < n; ) {
+		k = FLINT_MIN(2 * k, n);
+		truncated = a;
+		truncate(truncated, k);
+		mul(g, g, g);
+		mul(g, g, truncated);
+		truncate(g, k);
+	}
+	res = g;
+}
+
+int Gf2Poly::inner_product(const Gf2Poly &a, const Gf2Poly &b) {
+	slong size = FLINT_MIN(a.limbs.size(), b.limbs.size());
+	mp_limb_t sum = 0;
+	for (slong i = 0; i < size; i++)
+		sum ^= a.limbs[i] & b.limbs[i];
+	return __builtin_parityll(sum);
+}
+
+/*------------------------------------------------------------------------*/
+
+Gf2PolyModulus::Gf2PolyModulus(const nmod_poly_t f) : Gf2PolyModulus(Gf2Poly(f)) {
+}
+
+Gf2PolyModulus::Gf2PolyModulus(const Gf2Poly &f) : f(f) {
+	n = f.degree();
+	if (n < 1) {
+		flint_printf("Exception (Gf2PolyModulus). Modulus of degree < 1.\n");
+		abort();
+	}
+
+	Gf2Poly::reverse(f_rev, f, n + 1);
+	Gf2Poly::inv_series(f_inv, f_rev, 2 * n);
+}
+
+slong Gf2PolyModulus::degree() const {
+	return n;
+}
+
+const Gf2Poly & Gf2PolyModulus::modulus() const {
+	return f;
+}
+
+/**
+ * Barrett reduction, by chunks of $\max(2n - 1, n + 1)$ coefficients from
+ * the top for longer polynomials, so that each chunk lowers the length when
+ * $n = 1$. Supports aliasing.
+ */
+void Gf2PolyModulus::rem(Gf2Poly &res, const Gf2Poly &a) const {
+	Gf2Poly r = a;
+	Gf2Poly high, q, temp;
+	slong chunk = FLINT_MAX(2 * n - 1, n + 1);
+
+	while (r.length > n) {
+		slong shift = FLINT_MAX(r.length - chunk, 0);
+		Gf2Poly::shift_right(high, r, shift);
+		Gf2Poly::truncate(r, shift);
+
+		// the quotient has m = len(high) - n coefficients
+		slong m = high.length - n;
+		Gf2Poly::reverse(q, high, high.length);
+		Gf2Poly::truncate(q, m);
+		Gf2Poly::mul(q, q, f_inv);
+		Gf2Poly::truncate(q, m);
+		Gf2Poly::reverse(q, q, m);
+		Gf2Poly::mul(temp, q, f);
+		Gf2Poly::add(high, high, temp);
+		Gf2Poly::truncate(high, n);
+
+		Gf2Poly::shift_left(high, high, shift);
+		Gf2Poly::add(r, r, high);
+	}
+
+	res = r;
+}
+
+void Gf2PolyModulus::mulmod(Gf2Poly &res, const Gf2Poly &a, const Gf2Poly &b) const {
+	Gf2Poly::mul(res, a, b);
+	rem(res, res);
+}
+
+/**
+ * The values $u_j = v(x^j \bmod f)$, $j < 2n - 1$, satisfy the recurrence of
+ * $f$: their series is $P / \mathrm{rev}(f)$ with $P = v \mathrm{rev}(f) \bmod x^n$.
+ * The form is then $w_i = \sum_j b_j u_{i + j}$, a middle product.
+ */
+void Gf2PolyModulus::transposed_mulmod(Gf2Poly &res, const Gf2Poly &v, const Gf2Poly &b) const {
+	Gf2Poly u, b_rev;
+
+	Gf2Poly::mul(u, v, f_rev);
+	Gf2Poly::truncate(u, n);
+	Gf2Poly::mul(u, u, f_inv);
+	Gf2Poly::truncate(u, 2 * n - 1);
+
+	Gf2Poly::reverse(b_rev, b, n);
+	Gf2Poly::mul(u, u, b_rev);
+	Gf2Poly::shift_right(res, u, n - 1);
+	Gf2Poly::truncate(res, n);
+}
+
+/*------------------------------------------------------------------------*/
+
+Gf2PolyComposeMod::Gf2PolyComposeMod(const Gf2Poly &arg, const Gf2PolyModulus &modulus) {
+	this->modulus = &modulus;
+	k = n_sqrt(modulus.degree()) + 1;
+
+	Gf2Poly reduced;
+	modulus.rem(reduced, arg);
+
+	baby.resize(k);
+	baby[0].one();
+	for (slong i = 1; i < k; i++)
+		modulus.mulmod(baby[i], baby[i - 1], reduced);
+	modulus.mulmod(giant, baby[k - 1], reduced);
+}
+
+void Gf2PolyComposeMod::apply(Gf2Poly &res, const Gf2Poly &h) const {
+	if (h.is_zero()) {
+		res.zero();
+		return;
+	}
+
+	slong size = limbs_for(modulus->degree());
+	slong m = (h.length + k - 1) / k;
+
+	// c_j = sum_{i < k} h_{jk + i} baby_i, eight baby steps at a time
+	vector<mp_limb_t> c(m * size, 0);
+	vector<mp_limb_t> table(256 * size);
+	for (slong t = 0; 8 * t < k; t++) {
+		slong count = FLINT_MIN(8, k - 8 * t);
+
+		fill(table.begin(), table.begin() + size, 0);
+		for (slong mask = 1; mask < (1 << count); mask++) {
+			const Gf2Poly &step = baby[8 * t + __builtin_ctzl(mask)];
+			mp_limb_t *entry = table.data() + mask * size;
+			const mp_limb_t *previous = table.data() + (mask & (mask - 1)) * size;
+			copy(previous, previous + size, entry);
+			for (size_t i = 0; i < step.limbs.size(); i++)
+				entry[i] ^= step.limbs[i];
+		}
+
+		for (slong j = 0; j < m; j++) {
+			slong bits = limb_at(h.limbs, j * k + 8 * t) & ((UWORD(1) << count) - 1);
+			if (bits == 0)
+				continue;
+			const mp_limb_t *entry = table.data() + bits * size;
+			mp_limb_t *c_j = c.data() + j * size;
+			for (slong i = 0; i < size; i++)
+				c_j[i] ^= entry[i];
+		}
+	}
+
+	// Horner in the giant step
+	Gf2Poly result, c_j;
+	result.limbs.assign(c.begin() + (m - 1) * size, c.begin() + m * size);
+	result.normalise();
+	for (slong j = m - 2; j >= 0; j--) {
+		modulus->mulmod(result, result, giant);
+		c_j.limbs.assign(c.begin() + j * size, c.begin() + (j + 1) * size);
+		c_j.normalise();
+		Gf2Poly::add(result, result, c_j);
+	}
+
+	res = result;
+}
+
+void Gf2PolyComposeMod::compose_mod(nmod_poly_t res, const nmod_poly_t a, const nmod_poly_t b, const nmod_poly_t f) {
+	Gf2PolyModulus modulus(f);
+	Gf2PolyComposeMod compose(Gf2Poly(b), modulus);
+	Gf2Poly result;
+	compose.apply(result, Gf2Poly(a));
+	result.get(res);
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+ * Berlekamp-Massey on the bits of the sequence. The discrepancies are inner
+ * products of the connection polynomial with a window of the reversed
+ * sequence.
+ */
+void Gf2MinPoly::minimal_polynomial(Gf2Poly &result, const Gf2Poly &sequence, slong degree) {
+	slong length = 2 * degree;
+
+	Gf2Poly reversed;
+	Gf2Poly truncated = sequence;
+	Gf2Poly::truncate(truncated, length);
+	Gf2Poly::reverse(reversed, truncated, length);
+
+	Gf2Poly C, B, T, temp;
+	C.one();
+	B.one();
+
+	slong L = 0;
+	slong m = 1;
+	for (slong n = 0; n < length; n++) {
+		// d = sum_{i <= L} C_i s_{n - i}, with s_{n - i} = reversed_{length - 1 - n + i}
+		slong offset = length - 1 - n;
+		mp_limb_t sum = 0;
+		for (size_t w = 0; w < C.limbs.size(); w++)
+			sum ^= C.limbs[w] & limb_at(reversed.limbs, offset + FLINT_BITS * w);
+
+		if (!__builtin_parityll(sum)) {
+			m++;
+			continue;
+		}
+
+		Gf2Poly::shift_left(temp, B, m);
+		if (2 * L <= n) {
+			T = C;
+			Gf2Poly::add(C, C, temp);
+			L = n + 1 - L;
+			B = T;
+			m = 1;
+		} else {
+			Gf2Poly::add(C, C, temp);
+			m++;
+		}
+	}
+
+	Gf2Poly::reverse(result, C, L + 1);
+}
+
+void Gf2MinPoly::project_powers(Gf2Poly &result, const Gf2Poly &v, slong l, const Gf2Poly &h, const Gf2PolyModulus &modulus) {
+	slong k = n_sqrt(l) + 1;
+
+	vector<Gf2Poly> baby(k);
+	Gf2Poly giant, form = v;
+	baby[0].one();
+	for (slong i = 1; i < k; i++)
+		modulus.mulmod(baby[i], baby[i - 1], h);
+	modulus.mulmod(giant, baby[k - 1], h);
+
+	result.limbs.assign(limbs_for(l), 0);
+	for (slong j = 0; j * k < l; j++) {
+		for (slong i = 0; i < k && j * k + i < l; i++)
+			if (Gf2Poly::inner_product(form, baby[i]))
+				result.limbs[(j * k + i) / FLINT_BITS] |= UWORD(1) << ((j * k + i) % FLINT_BITS);
+
+		if ((j + 1) * k < l)
+			modulus.transposed_mulmod(form, form, giant);
+	}
+	result.normalise();
+}
+
+void Gf2MinPoly::minimal_polynomial(nmod_poly_t result, const nmod_poly_t f, const nmod_poly_t modulus) {
+	Gf2PolyModulus gf2_modulus(modulus);
+	slong degree = gf2_modulus.degree();
+
+	Gf2Poly alpha, g, temp_g, tau, form, sequence;
+	gf2_modulus.rem(alpha, Gf2Poly(f));
+	Gf2PolyComposeMod compose(alpha, gf2_modulus);
+	g.one();
+	tau.one();
+
+	flint_rand_t state;
+	flint_randinit(state);
+
+	while (true) {
+
+		form.limbs.resize(limbs_for(degree));
+		for (size_t i = 0; i < form.limbs.size(); i++)
+			form.limbs[i] = n_randlimb(state);
+		form.length = FLINT_BITS * form.limbs.size();
+		Gf2Poly::truncate(form, degree);
+		form.normalise();
+
+		// project on v(tau .), as NmodMinPoly does
+		gf2_modulus.transposed_mulmod(form, form, tau);
+		slong l = degree - g.degree();
+		project_powers(sequence, form, 2 * l, alpha, gf2_modulus);
+		minimal_polynomial(temp_g, sequence, l);
+
+		Gf2Poly::mul(g, g, temp_g);
+		if (g.degree() == degree)
+			break;
+
+		compose.apply(temp_g, temp_g);
+		gf2_modulus.mulmod(tau, tau, temp_g);
+		if (tau.is_zero())
+			break;
+	}
+
+	g.get(result);
+	flint_randclear(state);
+}
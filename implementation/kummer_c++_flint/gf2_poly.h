@@ -0,0 +1,157 @@
+/*
+ * gf2_poly.h
+ *
+ *  Packed polynomials over GF(2), 64 coefficients per limb, for the
+ *  binary fields of FFEmbedding and FFIsomArtinSchreier: nmod_poly spends
+ *  a whole limb on each bit. Limb products go through the PCLMULQDQ
+ *  instruction when the processor has it, and through a portable
+ *  windowed product otherwise; the choice is made once, at run time.
+ */
+
+#ifndef GF2_POLY_H_
+#define GF2_POLY_H_
+
+#include <flint/nmod_poly.h>
+
+#include <vector>
+
+/**
+ * A polynomial over GF(2); bit i of limb j is the coefficient of
+ * $x^{64j + i}$. The limbs past the degree are not kept, and the bits past
+ * the degree in the top limb are zero.
+ */
+class Gf2Poly {
+public:
+    std::vector<mp_limb_t> limbs;
+    // the number of coefficients, degree + 1
+    slong length;
+
+    Gf2Poly();
+    explicit Gf2Poly(const nmod_poly_t a);
+
+    /**
+     * Sets this to {@code a} modulo 2.
+     */
+    void set(const nmod_poly_t a);
+    void get(nmod_poly_t a) const;
+
+    void zero();
+    void one();
+    bool is_zero() const;
+    slong degree() const;
+    int get_coeff(slong i) const;
+    void set_coeff(slong i, int c);
+
+    static void add(Gf2Poly &res, const Gf2Poly &a, const Gf2Poly &b);
+    static void mul(Gf2Poly &res, const Gf2Poly &a, const Gf2Poly &b);
+    static void shift_left(Gf2Poly &res, const Gf2Poly &a, slong n);
+    static void shift_right(Gf2Poly &res, const Gf2Poly &a, slong n);
+    static void truncate(Gf2Poly &a, slong n);
+
+    /**
+     * The reverse of {@code a} as a polynomial of length {@code n}, where
+     * {@code a} has length at most {@code n}.
+     */
+    static void reverse(Gf2Poly &res, const Gf2Poly &a, slong n);
+
+    /**
+     * {@code res} = 1 / {@code a} mod $x^n$, for {@code a} with constant
+     * coefficient 1.
+     */
+    static void inv_series(Gf2Poly &res, const Gf2Poly &a, slong n);
+
+    /**
+     * The parity of the coefficientwise product, i.e. the value at {@code b}
+     * of the linear form with coefficients {@code a}.
+     */
+    static int inner_product(const Gf2Poly &a, const Gf2Poly &b);
+
+    /**
+     * Selects the limb product: the carry-less multiplication instruction
+     * if {@code enable} and the processor has it, the portable one
+     * otherwise. Returns whether the instruction is used.
+     */
+    static bool use_pclmul(bool enable);
+
+    void normalise();
+};
+
+/**
+ * A modulus $f$ of degree $n$ with $1 / \mathrm{rev}(f) \bmod x^{2n}$, for
+ * Barrett reductions and transposed products.
+ */
+class Gf2PolyModulus {
+    Gf2Poly f;
+    Gf2Poly f_rev;
+    Gf2Poly f_inv;
+    slong n;
+
+public:
+    explicit Gf2PolyModulus(const nmod_poly_t f);
+    explicit Gf2PolyModulus(const Gf2Poly &f);
+
+    slong degree() const;
+    const Gf2Poly & modulus() const;
+
+    void rem(Gf2Poly &res, const Gf2Poly &a) const;
+    void mulmod(Gf2Poly &res, const Gf2Poly &a, const Gf2Poly &b) const;
+
+    /**
+     * Computes the linear form {@code res}: $h \mapsto v(bh \bmod f)$, where
+     * the linear form {@code v} and {@code b} are of length at most $n$.
+     */
+    void transposed_mulmod(Gf2Poly &res, const Gf2Poly &v, const Gf2Poly &b) const;
+};
+
+/**
+ * Brent-Kung composition by a fixed argument. The baby step combinations
+ * are sums of baby steps selected by the bits of the composed polynomial,
+ * taken eight at a time from tables of all their sums.
+ */
+class Gf2PolyComposeMod {
+    const Gf2PolyModulus *modulus;
+    slong k;
+    std::vector<Gf2Poly> baby;
+    Gf2Poly giant;
+
+public:
+    Gf2PolyComposeMod(const Gf2Poly &arg, const Gf2PolyModulus &modulus);
+
+    /**
+     * {@code res} = {@code h}(arg) mod f. Supports aliasing.
+     */
+    void apply(Gf2Poly &res, const Gf2Poly &h) const;
+
+    /**
+     * {@code res} = {@code a}({@code b}) mod {@code f}, the counterpart of
+     * {@code nmod_poly_compose_mod}, for $p = 2$.
+     */
+    static void compose_mod(nmod_poly_t res, const nmod_poly_t a, const nmod_poly_t b, const nmod_poly_t f);
+};
+
+/**
+ * Minimal polynomials over GF(2), by projected power sequences and the
+ * Berlekamp-Massey algorithm on packed sequences.
+ */
+class Gf2MinPoly {
+public:
+    /**
+     * The minimal polynomial of the first {@code 2 * degree} bits of
+     * {@code sequence}, assumed of degree at most {@code degree}.
+     */
+    void minimal_polynomial(Gf2Poly &result, const Gf2Poly &sequence, slong degree);
+
+    /**
+     * The {@code l} bits $v(h^i \bmod f)$, $0 \le i < l$, by baby steps and
+     * transposed giant steps.
+     */
+    void project_powers(Gf2Poly &result, const Gf2Poly &v, slong l, const Gf2Poly &h, const Gf2PolyModulus &modulus);
+
+    /**
+     * Computes the minimal polynomial of {@code f} modulo {@code modulus},
+     * as {@code NmodMinPoly} does.
+     */
+    void minimal_polynomial(nmod_poly_t result, const nmod_poly_t f, const nmod_poly_t modulus);
+};
+
+#endif /* GF2_POLY_H_ */
@@ -5,6 +5,7 @@
 #include <iostream>
 #include "nmod_poly_build_irred.h"
 #include "util.h"
+#include "scratch_arena.h"
 #include <flint/profiler.h>
 
 #define DEBUG 0
@@ -558,30 +559,27 @@ void NmodFastIrred::irred_prime_power_adleman_lenstra(nmod_poly_t irred, slong r
   if (prec==1) {
   slong q = p;
   nmod_t qmod = cyclo_mod->mod;
-  // compute root powers
-  fq_nmod_t conjpows[n];
-  for (slong i = 0; i < n; i++)
-    fq_nmod_init(conjpows[i], cyclo_ctx);
-  fq_nmod_set(conjpows[0], trace, cyclo_ctx);
+  // compute root powers, off the stack
+  ScratchArena arena;
+  fq_nmod_struct *conjpows = arena.fq_nmod_vec(n, cyclo_ctx);
+  fq_nmod_set(conjpows + 0, trace, cyclo_ctx);
   for (slong i = 1; i < n; i++)
-    fq_nmod_mul(conjpows[i], conjpows[i-1], conjpows[0], cyclo_ctx);
+    fq_nmod_mul(conjpows + i, conjpows + i - 1, conjpows + 0, cyclo_ctx);
   // compute (minus) newton sums, stored in reverse order
   mp_limb_t *newton_sums = _nmod_vec_init(n);
   slong B = p % m;
   slong Binv = n_invmod(B, m);
   for (slong i = 0; i < n; i++) {
-    mp_limb_t plus = n_mulmod2_preinv(n, nmod_poly_get_coeff_ui(conjpows[i], 0), q, qmod.ninv);
+    mp_limb_t plus = n_mulmod2_preinv(n, nmod_poly_get_coeff_ui(conjpows + i, 0), q, qmod.ninv);
     mp_limb_t minus = 0;
     // should not depend on the initial value of k
     slong k = 1;
     for (slong j = 0; j < n; j++) {
-      minus = n_addmod(minus, nmod_poly_get_coeff_ui(conjpows[i], k), q);
+      minus = n_addmod(minus, nmod_poly_get_coeff_ui(conjpows + i, k), q);
       k = (k*Binv) % m;
     }
     newton_sums[n-1-i] = nmod_sub(minus, plus, qmod);
   }
-  for (slong i = 0; i < n; i++)
-    fq_nmod_clear(conjpows[i], cyclo_ctx);
   // compute coeffs (quadratic)
   mp_limb_t *coeffs = _nmod_vec_init(n+1);
   mp_limb_t invq;
@@ -6,25 +6,112 @@
  */
 
 #include "nmod_min_poly.h"
+#include "ff_isom_thresholds.h"
+#include "gf2_poly.h"
+#include "nmod_poly_compose_engine.h"
+#include "nmod_poly_power_projection.h"
+#include "thread_pool.h"
 #include <math.h>
 #include <iostream>
+#include <algorithm>
+#include <vector>
 #include <flint/nmod_poly_mat.h>
 
 using namespace std;
 
 /**
- * Computes the minimal polynomial of the sequence {@code sequence}.
+ * Computes the minimal polynomial of the sequence {@code sequence}, by the
+ * quadratic Berlekamp-Massey algorithm for degrees below
+ * {@code berlekamp_massey_threshold} and by half-gcd above.
  * 
  * @param result	the minimal polynomial of degree <= degree
  * @param sequence	a sequence of length >= {@code 2 * degree}
  */
 void NmodMinPoly::minimal_polynomial(nmod_poly_t result, const mp_limb_t *sequence, slong degree) {
+	if (degree < FFIsomThresholds::get().berlekamp_massey_threshold)
+		minimal_polynomial_berlekamp_massey(result, sequence, degree);
+	else
+		minimal_polynomial_hgcd(result, sequence, degree);
+}
+
+/**
+ * Same as above, by the Berlekamp-Massey algorithm: O(degree^2) operations.
+ */
+void NmodMinPoly::minimal_polynomial_berlekamp_massey(nmod_poly_t result, const mp_limb_t *sequence, slong degree) {
+	slong length = 2 * degree;
+	nmod_t mod = result->mod;
+
+	// the connection polynomial C, and B the one before the last change of L
+	mp_limb_t *C = _nmod_vec_init(length + 1);
+	mp_limb_t *B = _nmod_vec_init(length + 1);
+	mp_limb_t *temp = _nmod_vec_init(length + 1);
+	_nmod_vec_zero(C, length + 1);
+	_nmod_vec_zero(B, length + 1);
+	C[0] = 1;
+	B[0] = 1;
+
+	slong L = 0;
+	slong lenB = 1;
+	slong shift = 1;
+	mp_limb_t last = 1;
+
+	for (slong n = 0; n < length; n++) {
+		// discrepancy of C at n
+		mp_limb_t d = sequence[n];
+		for (slong i = 1; i <= L; i++)
+			d = nmod_add(d, nmod_mul(C[i], sequence[n - i], mod), mod);
+
+		if (d == 0) {
+			shift++;
+			continue;
+		}
+
+		// C = C - d / last x^shift B
+		mp_limb_t c = nmod_neg(nmod_mul(d, n_invmod(last, mod.n), mod), mod);
+		if (2 * L <= n) {
+			_nmod_vec_set(temp, C, L + 1);
+			_nmod_vec_scalar_addmul_nmod(C + shift, B, lenB, c, mod);
+			mp_limb_t *swap = B;
+			B = temp;
+			temp = swap;
+			lenB = L + 1;
+			L = n + 1 - L;
+			last = d;
+			shift = 1;
+		} else {
+			_nmod_vec_scalar_addmul_nmod(C + shift, B, lenB, c, mod);
+			shift++;
+		}
+	}
+
+	// the minimal polynomial is x^L C(1/x)
+	nmod_poly_fit_length(result, L + 1);
+	for (slong i = 0; i <= L; i++)
+		result->coeffs[L - i] = C[i];
+	_nmod_poly_set_length(result, L + 1);
+
+	_nmod_vec_clear(C);
+	_nmod_vec_clear(B);
+	_nmod_vec_clear(temp);
+}
+
+/**
+ * Same as above, as the Pade approximant of the sequence given by the
+ * half-gcd of x^{2 degree} and the sequence: O(M(degree) log(degree)).
+ */
+void NmodMinPoly::minimal_polynomial_hgcd(nmod_poly_t result, const mp_limb_t *sequence, slong degree) {
 	slong length = 2 * degree;
 
 	slong slength = length;
 	while(slength > 0 && sequence[slength-1] == 0)
 		slength--;
 
+	// the half-gcd wants a nonzero sequence
+	if (slength == 0) {
+		nmod_poly_one(result);
+		return;
+	}
+
 	mp_limb_t *xpow;
 	xpow = (mp_limb_t *) malloc((length+1)*sizeof(mp_limb_t));
 	for (slong i = 0; i < length; i++)
@@ -45,6 +132,7 @@ void NmodMinPoly::minimal_polynomial(nmod_poly_t result, const mp_limb_t *sequen
 
 	_nmod_poly_hgcd(Minv, lenMinv, A, &lenA, B, &lenB, xpow, length+1, sequence, slength, result->mod);
 
+	nmod_poly_zero(result);
 	for (slong i = 0; i < lenMinv[0]; i++)
 		nmod_poly_set_coeff_ui(result, lenMinv[0]-1-i, Minv[0][i]);
 	nmod_poly_make_monic(result, result);
@@ -89,13 +177,50 @@ void NmodMinPoly::minimal_polynomial(nmod_poly_t result, const nmod_poly_t f, co
 }
 
 /**
- * Computes the minimal polynomial of {@code f} modulo {@code modulus}.
+ * Computes the minimal polynomial of {@code f} modulo {@code modulus}; with
+ * more than one thread and from block_min_poly_threshold (see
+ * ff_isom_thresholds.h, WORD_MAX unless tuned), by block Wiedemann with one
+ * block row per thread.
  * 
  * @param result			the minimal polynomial of {@code f}
  * @param modulus_inv_rev	1 / rev(d, modulus) mod x^{d - 1} where d = deg(modulus)
+ * @param num_threads		the threads of the block algorithm
  */
 void NmodMinPoly::minimal_polynomial(nmod_poly_t result, const nmod_poly_t f, const nmod_poly_t modulus,
+		const nmod_poly_t modulus_inv_rev, slong num_threads) {
+	if (modulus->mod.n != 2 && num_threads > 1
+			&& nmod_poly_degree(modulus) >= FFIsomThresholds::get().block_min_poly_threshold) {
+		// the block algorithm falls back to the scalar one by itself, so
+		// which of them produced the result does not matter here
+		minimal_polynomial_block(result, f, modulus, modulus_inv_rev, num_threads, num_threads);
+		return;
+	}
+
+	minimal_polynomial_scalar(result, f, modulus, modulus_inv_rev);
+}
+
+/**
+ * Same as above, by the scalar algorithm only.
+ */
+void NmodMinPoly::minimal_polynomial_scalar(nmod_poly_t result, const nmod_poly_t f, const nmod_poly_t modulus,
 		const nmod_poly_t modulus_inv_rev) {
+	if (modulus->mod.n == 2) {
+		Gf2MinPoly gf2MinPoly;
+		gf2MinPoly.minimal_polynomial(result, f, modulus);
+		return;
+	}
+
+	slong degree = nmod_poly_degree(modulus);
+	Nmod_poly_power_projection projection(f, modulus, modulus_inv_rev, n_sqrt(2 * degree) + 1);
+	minimal_polynomial(result, f, modulus, modulus_inv_rev, projection);
+}
+
+/**
+ * Same as above, with the powers of {@code f} prepared in {@code projection},
+ * e.g. to project other forms on them afterwards.
+ */
+void NmodMinPoly::minimal_polynomial(nmod_poly_t result, const nmod_poly_t f, const nmod_poly_t modulus,
+		const nmod_poly_t modulus_inv_rev, const Nmod_poly_power_projection &projection) {
 	nmod_poly_t g;
 	nmod_poly_t temp_g;
 	nmod_poly_t tau;
@@ -120,7 +245,7 @@ void NmodMinPoly::minimal_polynomial(nmod_poly_t result, const nmod_poly_t f, co
 
 		transposed_mulmod(sequence, sequence, tau, modulus, modulus_inv_rev);
 		l = degree - nmod_poly_degree(g);
-		project_powers(sequence, sequence, l * 2, f, modulus, modulus_inv_rev);
+		projection.apply(sequence, sequence, l * 2);
 		minimal_polynomial(temp_g, sequence, l);
 
 		nmod_poly_mul(g, g, temp_g);
@@ -143,6 +268,335 @@ void NmodMinPoly::minimal_polynomial(nmod_poly_t result, const nmod_poly_t f, co
 }
 
 
+/**
+ * Computes the minimal polynomial of {@code f} modulo {@code modulus}, known
+ * to be of degree {@code degree}: only 2 degree terms of the projection of
+ * the powers of {@code f} on a random form are needed, and a form fails
+ * with probability at most degree / p.
+ *
+ * @param modulus_inv_rev	1 / rev(d, modulus) mod x^{d - 1} where d = deg(modulus)
+ */
+void NmodMinPoly::minimal_polynomial_of_degree(nmod_poly_t result, const nmod_poly_t f, const nmod_poly_t modulus,
+		const nmod_poly_t modulus_inv_rev, slong degree) {
+	slong n = nmod_poly_degree(modulus);
+	mp_limb_t *form = _nmod_vec_init(n);
+	mp_limb_t *sequence = _nmod_vec_init(2 * degree);
+
+	flint_rand_t state;
+	flint_randinit(state);
+
+	Nmod_poly_power_projection projection(f, modulus, modulus_inv_rev, n_sqrt(2 * degree) + 1);
+	do {
+		_nmod_vec_randtest(form, state, n, f->mod);
+		projection.apply(sequence, form, 2 * degree);
+		minimal_polynomial(result, sequence, degree);
+	} while (nmod_poly_degree(result) != degree);
+
+	_nmod_vec_clear(form);
+	_nmod_vec_clear(sequence);
+	flint_randclear(state);
+}
+
+/*
+ * Block Wiedemann.
+ */
+
+// below this order, approximant bases are computed one order at a time
+static const slong PMBASIS_CUTOFF = 32;
+
+/**
+ * Multiplies {@code P} and the residual {@code R} = {@code P} F on the left
+ * by constant matrices and powers of x until {@code R} = 0 mod x^sigma,
+ * one order at a time, keeping {@code P} reduced for the shifted row
+ * degrees {@code shift}: Giorgi, Jeannerod and Villard's mbasis.
+ */
+static void mbasis(nmod_poly_mat_t P, nmod_poly_mat_t R, slong sigma, slong *shift, nmod_t mod) {
+	slong m = R->r;
+	slong n = R->c;
+
+	vector<slong> order(m);
+	vector<mp_limb_t> delta(n), reduced(m * n), comb(m * m);
+	vector<slong> pivot_col(m), pivot_row(m);
+	vector<int> is_pivot(m);
+	nmod_poly_t temp;
+	nmod_poly_init(temp, mod.n);
+
+	for (slong k = 0; k < sigma; k++) {
+		for (slong i = 0; i < m; i++)
+			order[i] = i;
+		stable_sort(order.begin(), order.end(), [shift](slong a, slong b) {
+			return shift[a] < shift[b];
+		});
+
+		// rows of the coefficient of x^k of R, reduced against the pivot
+		// rows of smaller shift, as combinations of the rows of P
+		slong num_pivots = 0;
+		for (slong t = 0; t < m; t++) {
+			slong i = order[t];
+			mp_limb_t *row = &comb[i * m];
+			for (slong j = 0; j < m; j++)
+				row[j] = 0;
+			row[i] = 1;
+			for (slong j = 0; j < n; j++)
+				delta[j] = nmod_poly_get_coeff_ui(nmod_poly_mat_entry(R, i, j), k);
+
+			for (slong q = 0; q < num_pivots; q++) {
+				mp_limb_t c = delta[pivot_col[q]];
+				if (c == 0)
+					continue;
+				c = nmod_neg(c, mod);
+				_nmod_vec_scalar_addmul_nmod(delta.data(), &reduced[q * n], n, c, mod);
+				_nmod_vec_scalar_addmul_nmod(row, &comb[pivot_row[q] * m], m, c, mod);
+			}
+
+			slong col = 0;
+			while (col < n && delta[col] == 0)
+				col++;
+			is_pivot[i] = col < n;
+			if (col < n) {
+				// normalised, so that the pivot entry is 1
+				mp_limb_t inv = n_invmod(delta[col], mod.n);
+				_nmod_vec_scalar_mul_nmod(&reduced[num_pivots * n], delta.data(), n, inv, mod);
+				_nmod_vec_scalar_mul_nmod(row, row, m, inv, mod);
+				pivot_col[num_pivots] = col;
+				pivot_row[num_pivots] = i;
+				num_pivots++;
+			}
+		}
+
+		// the other rows are cancelled by the pivot rows, which are left
+		// unchanged until all of them are done
+		for (slong i = 0; i < m; i++) {
+			if (is_pivot[i])
+				continue;
+			for (slong r = 0; r < m; r++) {
+				mp_limb_t c = comb[i * m + r];
+				if (r == i || c == 0)
+					continue;
+				for (slong j = 0; j < m; j++) {
+					nmod_poly_scalar_mul_nmod(temp, nmod_poly_mat_entry(P, r, j), c);
+					nmod_poly_add(nmod_poly_mat_entry(P, i, j), nmod_poly_mat_entry(P, i, j), temp);
+				}
+				for (slong j = 0; j < n; j++) {
+					nmod_poly_scalar_mul_nmod(temp, nmod_poly_mat_entry(R, r, j), c);
+					nmod_poly_add(nmod_poly_mat_entry(R, i, j), nmod_poly_mat_entry(R, i, j), temp);
+				}
+			}
+		}
+
+		// the pivot rows vanish at order k, and are multiplied by x
+		for (slong i = 0; i < m; i++) {
+			if (!is_pivot[i])
+				continue;
+			for (slong j = 0; j < m; j++)
+				nmod_poly_shift_left(nmod_poly_mat_entry(P, i, j), nmod_poly_mat_entry(P, i, j), 1);
+			for (slong j = 0; j < n; j++)
+				nmod_poly_shift_left(nmod_poly_mat_entry(R, i, j), nmod_poly_mat_entry(R, i, j), 1);
+			shift[i]++;
+		}
+	}
+
+	nmod_poly_clear(temp);
+}
+
+/**
+ * {@code G} = ({@code F} / x^start) mod x^length, entrywise.
+ */
+static void mat_slice(nmod_poly_mat_t G, const nmod_poly_mat_t F, slong start, slong length) {
+	for (slong i = 0; i < F->r; i++)
+		for (slong j = 0; j < F->c; j++) {
+			nmod_poly_shift_right(nmod_poly_mat_entry(G, i, j), nmod_poly_mat_entry(F, i, j), start);
+			nmod_poly_truncate(nmod_poly_mat_entry(G, i, j), length);
+		}
+}
+
+/**
+ * Computes an approximant basis {@code P} of {@code F} at order sigma, that
+ * is {@code P} F = 0 mod x^sigma, reduced for the shift {@code shift}, which
+ * is updated to the shifted row degrees of {@code P}: mbasis below
+ * PMBASIS_CUTOFF, halving the order above (pmbasis).
+ */
+static void pmbasis(nmod_poly_mat_t P, const nmod_poly_mat_t F, slong sigma, slong *shift, nmod_t mod) {
+	slong m = F->r;
+	slong n = F->c;
+
+	if (sigma <= PMBASIS_CUTOFF) {
+		nmod_poly_mat_t R;
+		nmod_poly_mat_init(R, m, n, mod.n);
+		mat_slice(R, F, 0, sigma);
+		nmod_poly_mat_one(P);
+		mbasis(P, R, sigma, shift, mod);
+		nmod_poly_mat_clear(R);
+		return;
+	}
+
+	slong half = sigma / 2;
+	nmod_poly_mat_t F_low, G, P1, P2;
+	nmod_poly_mat_init(F_low, m, n, mod.n);
+	nmod_poly_mat_init(G, m, n, mod.n);
+	nmod_poly_mat_init(P1, m, m, mod.n);
+	nmod_poly_mat_init(P2, m, m, mod.n);
+
+	mat_slice(F_low, F, 0, half);
+	pmbasis(P1, F_low, half, shift, mod);
+
+	mat_slice(F_low, F, 0, sigma);
+	nmod_poly_mat_mul(G, P1, F_low);
+	mat_slice(G, G, half, sigma - half);
+	pmbasis(P2, G, sigma - half, shift, mod);
+
+	nmod_poly_mat_mul(P, P2, P1);
+
+	nmod_poly_mat_clear(F_low);
+	nmod_poly_mat_clear(G);
+	nmod_poly_mat_clear(P1);
+	nmod_poly_mat_clear(P2);
+}
+
+/**
+ * Computes the minimal polynomial of {@code f} modulo {@code modulus} by
+ * block Wiedemann: the b x b matrices M_i = (u_j(v_k f^i)), for b random
+ * forms u_j and b random elements v_k, are computed for i < 2 deg / b + 4,
+ * the rows of forms on {@code num_threads} threads through the baby steps
+ * of one power projection; a minimal matrix generator of the M_i is read
+ * from an approximant basis of [S; -I], S = sum_i M_i x^i, and the minimal
+ * polynomial is its largest invariant factor, det / gcd of the adjugate.
+ * The result is accepted if it vanishes at f and its degree is at most
+ * both deg {@code modulus} and deg det G; otherwise (unlucky forms) the
+ * scalar algorithm is used.
+ *
+ * @param block_size	b, the scalar algorithm is used if b < 2
+ * @return		true if the result was found by block Wiedemann, false
+ *			if it comes from the scalar algorithm
+ */
+bool NmodMinPoly::minimal_polynomial_block(nmod_poly_t result, const nmod_poly_t f, const nmod_poly_t modulus,
+		const nmod_poly_t modulus_inv_rev, slong block_size, slong num_threads) {
+	slong degree = nmod_poly_degree(modulus);
+	if (modulus->mod.n == 2 || block_size < 2 || degree < 2) {
+		minimal_polynomial_scalar(result, f, modulus, modulus_inv_rev);
+		return false;
+	}
+
+	nmod_t mod = modulus->mod;
+	slong b = block_size;
+	slong sigma = 2 * ((degree + b - 1) / b) + 4;
+
+	flint_rand_t state;
+	flint_randinit(state);
+
+	// the forms u_j(v_k .), and their values on the powers of f
+	mp_limb_t **forms = new mp_limb_t*[b * b];
+	mp_limb_t **sequences = new mp_limb_t*[b * b];
+	mp_limb_t *u = _nmod_vec_init(degree);
+	nmod_poly_t v;
+	nmod_poly_init(v, mod.n);
+	for (slong j = 0; j < b; j++) {
+		_nmod_vec_randtest(u, state, degree, mod);
+		for (slong k = 0; k < b; k++) {
+			nmod_poly_randtest(v, state, degree);
+			forms[j * b + k] = _nmod_vec_init(degree);
+			sequences[j * b + k] = _nmod_vec_init(sigma);
+			transposed_mulmod(forms[j * b + k], u, v, modulus, modulus_inv_rev);
+		}
+	}
+
+	Nmod_poly_power_projection projection(f, modulus, modulus_inv_rev, n_sqrt(sigma) + 1);
+	{
+		ThreadPool pool(num_threads > 1 ? num_threads : 0);
+		for (slong j = 0; j < b; j++)
+			pool.submit([&projection, forms, sequences, j, b, sigma] {
+				projection.apply(sequences + j * b, forms + j * b, b, sigma);
+			});
+		pool.wait();
+	}
+
+	// F = [S; -I]
+	nmod_poly_mat_t F, P, G, G_adj;
+	nmod_poly_mat_init(F, 2 * b, b, mod.n);
+	nmod_poly_mat_init(P, 2 * b, 2 * b, mod.n);
+	nmod_poly_mat_init(G, b, b, mod.n);
+	nmod_poly_mat_init(G_adj, b, b, mod.n);
+	for (slong j = 0; j < b; j++) {
+		for (slong k = 0; k < b; k++) {
+			nmod_poly_struct *entry = nmod_poly_mat_entry(F, j, k);
+			nmod_poly_fit_length(entry, sigma);
+			_nmod_vec_set(entry->coeffs, sequences[j * b + k], sigma);
+			_nmod_poly_set_length(entry, sigma);
+			_nmod_poly_normalise(entry);
+		}
+		nmod_poly_set_coeff_ui(nmod_poly_mat_entry(F, b + j, j), 0, mod.n - 1);
+	}
+
+	// the rows [Q R] of P satisfy Q S = R mod x^sigma; the shift penalises
+	// the columns of R (those of -I) so that the b rows of least shifted
+	// degree have deg R < deg Q
+	vector<slong> shift(2 * b, 0);
+	for (slong i = b; i < 2 * b; i++)
+		shift[i] = 1;
+	pmbasis(P, F, sigma, shift.data(), mod);
+
+	vector<slong> rows(2 * b);
+	for (slong i = 0; i < 2 * b; i++)
+		rows[i] = i;
+	stable_sort(rows.begin(), rows.end(), [&shift](slong a, slong c) {
+		return shift[a] < shift[c];
+	});
+
+	// the generator, the Q part of those rows reversed to their shifted degree
+	for (slong i = 0; i < b; i++)
+		for (slong k = 0; k < b; k++)
+			nmod_poly_reverse(nmod_poly_mat_entry(G, i, k), nmod_poly_mat_entry(P, rows[i], k),
+					shift[rows[i]] + 1);
+
+	nmod_poly_t den, gcd, check;
+	nmod_poly_init(den, mod.n);
+	nmod_poly_init(gcd, mod.n);
+	nmod_poly_init(check, mod.n);
+
+	bool found = false;
+	if (nmod_poly_mat_inv(G_adj, den, G)) {
+		// G_adj / den = G^{-1}, so den / gcd(den, G_adj) = det G / gcd of its minors
+		nmod_poly_set(gcd, den);
+		for (slong i = 0; i < b; i++)
+			for (slong k = 0; k < b; k++)
+				nmod_poly_gcd(gcd, gcd, nmod_poly_mat_entry(G_adj, i, k));
+		nmod_poly_div(result, den, gcd);
+		nmod_poly_make_monic(result, result);
+
+		// the largest invariant factor of a generator of the projected
+		// sequence divides the minimal polynomial of f, and result(f) = 0
+		// makes it a multiple of it; a degree past deg det G or deg modulus
+		// means that G does not generate the sequence
+		slong result_degree = nmod_poly_degree(result);
+		if (result_degree > 0 && result_degree <= FLINT_MIN(degree, nmod_poly_degree(den))) {
+			NmodComposeEngine::compose_mod(check, result, f, modulus);
+			found = nmod_poly_is_zero(check);
+		}
+	}
+
+	if (!found)
+		minimal_polynomial_scalar(result, f, modulus, modulus_inv_rev);
+
+	for (slong i = 0; i < b * b; i++) {
+		_nmod_vec_clear(forms[i]);
+		_nmod_vec_clear(sequences[i]);
+	}
+	delete[] forms;
+	delete[] sequences;
+	_nmod_vec_clear(u);
+	nmod_poly_clear(v);
+	nmod_poly_clear(den);
+	nmod_poly_clear(gcd);
+	nmod_poly_clear(check);
+	nmod_poly_mat_clear(F);
+	nmod_poly_mat_clear(P);
+	nmod_poly_mat_clear(G);
+	nmod_poly_mat_clear(G_adj);
+	flint_randclear(state);
+
+	return found;
+}
+
 /**
  * Computes the power projection:
  * \[\langle v, 1 \rangle, \langle v, h \rangle, \dots, \langle v, h^{l - 1} \rangle\]
@@ -153,7 +607,16 @@ void NmodMinPoly::minimal_polynomial(nmod_poly_t result, const nmod_poly_t f, co
  */
 void NmodMinPoly::project_powers(mp_limb_t *result, const mp_limb_t *a, slong l, const nmod_poly_t h,
 		const nmod_poly_t modulus, const nmod_poly_t modulus_inv_rev) {
-	slong k = n_sqrt(l);
+	Nmod_poly_power_projection projection(h, modulus, modulus_inv_rev, n_sqrt(l) + 1);
+	projection.apply(result, a, l);
+}
+
+/**
+ * Same as above, with the powers $1, h, \dots, h^k$ given in {@code h_powers},
+ * so that they can be shared by several projections.
+ */
+void NmodMinPoly::project_powers(mp_limb_t *result, const mp_limb_t *a, slong l, const nmod_poly_struct *h_powers, slong k,
+		const nmod_poly_t modulus, const nmod_poly_t modulus_inv_rev) {
 	slong m = (slong) ceil((double) l / (double) k);
 	slong degree = nmod_poly_degree(modulus);
 
@@ -162,32 +625,18 @@ void NmodMinPoly::project_powers(mp_limb_t *result, const mp_limb_t *a, slong l,
 	for (slong i = 0; i < degree; i++)
 		temp_a[i] = a[i];
 
-	nmod_poly_t *h_powers = new nmod_poly_t[k + 1];
-	// initials h_powers
-	for (slong i = 0; i <= k; i++)
-		nmod_poly_init(h_powers[i], h->mod.n);
-
-	// compute 1, h, h^2, ... h^k
-	nmod_poly_set_coeff_ui(h_powers[0], 0, 1);
-	nmod_poly_set(h_powers[1], h);
-	for (slong i = 2; i <= k; i++)
-		nmod_poly_mulmod_preinv(h_powers[i], h_powers[i - 1], h, modulus, modulus_inv_rev);
-
 	slong base = 0;
 	for (slong i = 0; i < m; i++) {
 
 		for (slong j = 0; (j < k) && (base + j < l); j++)
-			result[base + j] = inner_product(temp_a, h_powers[j]);
+			result[base + j] = inner_product(temp_a, h_powers + j);
 
 		// todo: preconditioning on h_powers[k]
-		transposed_mulmod(temp_a, temp_a, h_powers[k], modulus, modulus_inv_rev);
+		transposed_mulmod(temp_a, temp_a, h_powers + k, modulus, modulus_inv_rev);
 		base += k;
 	}
 
 	_nmod_vec_clear(temp_a);
-	for (slong i = 0; i <= k; i++)
-		nmod_poly_clear(h_powers[i]);
-	delete[] h_powers;
 }
 
 /*
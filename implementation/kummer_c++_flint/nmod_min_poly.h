@@ -12,6 +12,8 @@
 #include <flint/nmod_poly.h>
 #include <flint/fq_nmod_poly.h>
 
+class Nmod_poly_power_projection;
+
 class NmodMinPoly {
 public:
     mp_limb_t inner_product(const nmod_poly_t a, const nmod_poly_t b);
@@ -26,12 +28,24 @@ public:
     void transposed_mulmod(nmod_poly_t result, const nmod_poly_t a, const nmod_poly_t b, const fq_nmod_ctx_t ctx);
     void transposed_mulmod(nmod_poly_t result, const nmod_poly_t a, const nmod_poly_t b, const nmod_poly_t mod, const nmod_poly_t mod_rev_inv);
     void minimal_polynomial(nmod_poly_t result, const mp_limb_t *sequence, slong length);
+    void minimal_polynomial_berlekamp_massey(nmod_poly_t result, const mp_limb_t *sequence, slong length);
+    void minimal_polynomial_hgcd(nmod_poly_t result, const mp_limb_t *sequence, slong length);
     void project_powers(mp_limb_t *result, const mp_limb_t *a, slong l, const nmod_poly_t h,
             const nmod_poly_t modulus, const nmod_poly_t modulus_inv_rev);
+    void project_powers(mp_limb_t *result, const mp_limb_t *a, slong l, const nmod_poly_struct *h_powers, slong k,
+            const nmod_poly_t modulus, const nmod_poly_t modulus_inv_rev);
     void minimal_polynomial(nmod_poly_t result, const nmod_poly_t f, const fq_nmod_ctx_t ctx);
     void minimal_polynomial(nmod_poly_t result, const nmod_poly_t f, const nmod_poly_t modulus);
     void minimal_polynomial(nmod_poly_t result, const nmod_poly_t f, const nmod_poly_t modulus,
+            const nmod_poly_t modulus_inv_rev, slong num_threads = 1);
+    void minimal_polynomial(nmod_poly_t result, const nmod_poly_t f, const nmod_poly_t modulus,
+            const nmod_poly_t modulus_inv_rev, const Nmod_poly_power_projection &projection);
+    void minimal_polynomial_scalar(nmod_poly_t result, const nmod_poly_t f, const nmod_poly_t modulus,
             const nmod_poly_t modulus_inv_rev);
+    void minimal_polynomial_of_degree(nmod_poly_t result, const nmod_poly_t f, const nmod_poly_t modulus,
+            const nmod_poly_t modulus_inv_rev, slong degree);
+    bool minimal_polynomial_block(nmod_poly_t result, const nmod_poly_t f, const nmod_poly_t modulus,
+            const nmod_poly_t modulus_inv_rev, slong block_size, slong num_threads);
 
     void transposed_mul(fq_nmod_poly_t result, const fq_nmod_poly_t a, const fq_nmod_poly_t b, const fq_nmod_ctx_t ctx, slong m);
     void transposed_rem(fq_nmod_poly_t result, const fq_nmod_poly_t a, 
@@ -10,30 +10,60 @@
 using namespace std;
 
 
-void Nmod_poly_automorphism_evaluation::_automorphism_evaluation_compose(mp_ptr res, 
-									 mp_srcptr a, slong len_a,
-									 mp_srcptr g, 
-									 mp_srcptr f, slong len_f,
-									 mp_srcptr f_inv, slong len_f_inv, nmod_t mod){
+Nmod_poly_automorphism_evaluation::Nmod_poly_automorphism_evaluation(){
+  prepared = false;
+  m = 0;
+  max_len = 0;
+}
+
+Nmod_poly_automorphism_evaluation::~Nmod_poly_automorphism_evaluation(){
+  if (prepared){
+    nmod_poly_clear(f);
+    nmod_poly_clear(f_inv);
+  }
+}
+
+/*------------------------------------------------------*/
+/* number of frobeniuses of g in the baby steps         */
+/*------------------------------------------------------*/
+static slong automorphism_baby_steps(slong len_a){
+  return 0.5*n_sqrt(len_a) + 1;
+}
 
+/*------------------------------------------------------*/
+/* h = x^{p^m} mod f                                    */
+/*------------------------------------------------------*/
+static void automorphism_giant_step(mp_ptr h, slong m, mp_srcptr f, slong len_f,
+				    mp_srcptr f_inv, slong len_f_inv, nmod_t mod){
+  mp_ptr t = _nmod_vec_init(len_f - 1);
+  _nmod_poly_powmod_x_ui_preinv(h, mod.n, f, len_f, f_inv, len_f_inv, mod);
+  for (slong i = 1; i < m; i++){
+    _nmod_poly_powmod_ui_binexp_preinv (t, h, mod.n, f, len_f, f_inv, len_f_inv, mod);
+    _nmod_vec_set(h, t, len_f - 1);
+  }
+  _nmod_vec_clear(t);
+}
 
+/*------------------------------------------------------*/
+/* the part of the evaluation that depends on g: baby   */
+/* steps g^{p^i}, i < m, their combinations by the      */
+/* segments of a, then Horner with compose_h            */
+/*------------------------------------------------------*/
+void Nmod_poly_automorphism_evaluation::_evaluate(mp_ptr res, mp_srcptr a, slong len_a, mp_srcptr g, slong m,
+						  const Nmod_poly_compose_mod & compose_h,
+						  Nmod_poly_compose_mod::Workspace & workspace,
+						  mp_srcptr f, slong len_f,
+						  mp_srcptr f_inv, slong len_f_inv, nmod_t mod){
     nmod_mat_t A, B, C;
-    mp_ptr t, h;
-    slong i, n, m;
+    slong i, n;
 
     n = len_f - 1;
-    m = 0.5*n_sqrt(len_a) + 1;
-    //    m = len_a;
-    //    m = len_a/2;
     long k = (len_a-1) / m + 1;
 
     nmod_mat_init(A, m, n, mod.n);
     nmod_mat_init(B, k, m, mod.n);
     nmod_mat_init(C, k, n, mod.n);
 
-    h = _nmod_vec_init(n);
-    t = _nmod_vec_init(n);
-
     /* Set rows of B to the segments of a */
     for (i = 0; i < k-1; i++)
         _nmod_vec_set(B->rows[i], a + i*m, m);
@@ -47,18 +77,7 @@ void Nmod_poly_automorphism_evaluation::_automorphism_evaluation_compose(mp_ptr
 
     nmod_mat_mul(C, B, A);
 
-    // get x^{p^m} mod f
-    _nmod_poly_powmod_x_ui_preinv(h, mod.n, f, len_f, f_inv, len_f_inv, mod);
-    for (i = 1; i < m; i++){
-      _nmod_poly_powmod_ui_binexp_preinv (t, h, mod.n, f, len_f, f_inv, len_f_inv, mod);
-      _nmod_vec_set(h, t, n);
-    }
-
     /* Evaluate block composition using the Horner scheme */
-    
-    Nmod_poly_compose_mod compose;
-    compose.nmod_poly_compose_mod_brent_kung_vec_preinv_prepare(h, n, f, len_f, f_inv, len_f_inv, mod, 2*n_sqrt(n)+1);
-
     nmod_poly_t input;
     nmod_poly_init2_preinv(input, mod.n, mod.ninv, n);
     nmod_poly_t output;
@@ -68,7 +87,7 @@ void Nmod_poly_automorphism_evaluation::_automorphism_evaluation_compose(mp_ptr
     _nmod_poly_normalise(input);
     
     for (i = k- 2; i >= 0; i--){
-      compose.nmod_poly_compose_mod_brent_kung_vec_preinv_precomp(output, input, 1);
+      compose_h.apply(output, input, workspace);
       _nmod_poly_add(input->coeffs, output->coeffs, n, C->rows[i], n, mod);
       input->length = n;
       _nmod_poly_normalise(input);
@@ -78,18 +97,91 @@ void Nmod_poly_automorphism_evaluation::_automorphism_evaluation_compose(mp_ptr
     nmod_poly_clear(output);
     nmod_poly_clear(input);
 
-    // _nmod_vec_set(res, C->rows[k - 1], n);
-    // for (i = k- 2; i >= 0; i--){
-    //   _nmod_poly_compose_mod_brent_kung_preinv(t, res, n, h, f, len_f, f_inv, len_f_inv, mod);
-    // }
+    nmod_mat_clear(A);
+    nmod_mat_clear(B);
+    nmod_mat_clear(C);
+}
+
+void Nmod_poly_automorphism_evaluation::_automorphism_evaluation_compose(mp_ptr res, 
+									 mp_srcptr a, slong len_a,
+									 mp_srcptr g, 
+									 mp_srcptr f, slong len_f,
+									 mp_srcptr f_inv, slong len_f_inv, nmod_t mod){
+    slong n = len_f - 1;
+    slong m = automorphism_baby_steps(len_a);
+
+    // get x^{p^m} mod f
+    mp_ptr h = _nmod_vec_init(n);
+    automorphism_giant_step(h, m, f, len_f, f_inv, len_f_inv, mod);
+
+    Nmod_poly_compose_mod compose;
+    Nmod_poly_compose_mod::Workspace workspace;
+    compose.prepare(h, n, f, len_f, f_inv, len_f_inv, mod, 2*n_sqrt(n)+1);
 
+    _evaluate(res, a, len_a, g, m, compose, workspace, f, len_f, f_inv, len_f_inv, mod);
 
     _nmod_vec_clear(h);
-    _nmod_vec_clear(t);
+}
 
-    nmod_mat_clear(A);
-    nmod_mat_clear(B);
-    nmod_mat_clear(C);
+void Nmod_poly_automorphism_evaluation::prepare(slong max_len, const nmod_poly_t f_in, const nmod_poly_t f_inv_in){
+  if (!prepared){
+    nmod_poly_init(f, f_in->mod.n);
+    nmod_poly_init(f_inv, f_in->mod.n);
+    prepared = true;
+  }
+  nmod_poly_set(f, f_in);
+  nmod_poly_set(f_inv, f_inv_in);
+
+  slong n = f->length - 1;
+  this->max_len = max_len;
+  m = automorphism_baby_steps(max_len);
+
+  mp_ptr h = _nmod_vec_init(n);
+  automorphism_giant_step(h, m, f->coeffs, f->length, f_inv->coeffs, f_inv->length, f->mod);
+  compose_h.prepare(h, n, f->coeffs, f->length, f_inv->coeffs, f_inv->length, f->mod, 2*n_sqrt(n)+1);
+  _nmod_vec_clear(h);
+}
+
+void Nmod_poly_automorphism_evaluation::apply(nmod_poly_t res, const nmod_poly_t A, const nmod_poly_t g){
+    slong len_A = A->length;
+
+    if (!prepared || len_A > max_len) {
+        flint_printf("Exception (Nmod_poly_automorphism_evaluation::apply). Not prepared for this length.\n");
+        abort();
+    }
+
+    slong len = f->length - 1;
+
+    if (len_A == 0 || len == 0) {
+        nmod_poly_zero(res);
+        return;
+    }
+
+    mp_ptr ptr2 = _nmod_vec_init(len);
+    if (g->length <= len){
+        flint_mpn_copyi(ptr2, g->coeffs, g->length);
+        flint_mpn_zero(ptr2 + g->length, len - g->length);
+    }
+    else {
+        _nmod_poly_rem(ptr2, g->coeffs, g->length, f->coeffs, f->length, f->mod);
+    }
+
+    if (len_A == 1){
+        nmod_poly_fit_length(res, len);
+        _nmod_vec_scalar_mul_nmod(res->coeffs, ptr2, len, A->coeffs[0], f->mod);
+    }
+    else {
+        // a temporary result, so that res may alias A or g
+        mp_ptr out = _nmod_vec_init(len);
+        _evaluate(out, A->coeffs, len_A, ptr2, m, compose_h, workspace,
+                  f->coeffs, f->length, f_inv->coeffs, f_inv->length, f->mod);
+        nmod_poly_fit_length(res, len);
+        _nmod_vec_set(res->coeffs, out, len);
+        _nmod_vec_clear(out);
+    }
+    res->length = len;
+    _nmod_poly_normalise(res);
+    _nmod_vec_clear(ptr2);
 }
 
 
@@ -4,9 +4,17 @@
 #include <flint/nmod_vec.h>
 #include <flint/nmod_poly.h>
 
+#include "nmod_poly_compose_mod.h"
+
 class Nmod_poly_automorphism_evaluation {
 public:
 
+  Nmod_poly_automorphism_evaluation();
+  ~Nmod_poly_automorphism_evaluation();
+
+  Nmod_poly_automorphism_evaluation(const Nmod_poly_automorphism_evaluation &) = delete;
+  Nmod_poly_automorphism_evaluation & operator=(const Nmod_poly_automorphism_evaluation &) = delete;
+
   void _automorphism_evaluation_compose(mp_ptr res, 
 					mp_srcptr a, slong len_a,
 					mp_srcptr g, 
@@ -15,6 +23,31 @@ public:
 
   void compose_naive(nmod_poly_t res, const nmod_poly_t A, const nmod_poly_t g, const nmod_poly_t f, const nmod_poly_t f_inv);
   void compose(nmod_poly_t res, const nmod_poly_t A, const nmod_poly_t g, const nmod_poly_t f, const nmod_poly_t f_inv);
+
+  /*------------------------------------------------------------------------*/
+  /* precomputes what compose needs that depends on f only: x^{p^m} mod f  */
+  /* and the composition by it, for A of length at most max_len            */
+  /*------------------------------------------------------------------------*/
+  void prepare(slong max_len, const nmod_poly_t f, const nmod_poly_t f_inv);
+
+  /*------------------------------------------------------------------------*/
+  /* res = A(sigma)(g) mod f as in compose, for the f given to prepare      */
+  /*------------------------------------------------------------------------*/
+  void apply(nmod_poly_t res, const nmod_poly_t A, const nmod_poly_t g);
+
+private:
+
+  void _evaluate(mp_ptr res, mp_srcptr a, slong len_a, mp_srcptr g, slong m,
+		 const Nmod_poly_compose_mod & compose_h, Nmod_poly_compose_mod::Workspace & workspace,
+		 mp_srcptr f, slong len_f, mp_srcptr f_inv, slong len_f_inv, nmod_t mod);
+
+  bool prepared;
+  slong m;
+  slong max_len;
+  nmod_poly_t f;
+  nmod_poly_t f_inv;
+  Nmod_poly_compose_mod compose_h;
+  Nmod_poly_compose_mod::Workspace workspace;
 };
 
 #endif
@@ -0,0 +1,247 @@
+/*
+ * nmod_poly_compose_engine.cpp
+ */
+
+#include "nmod_poly_compose_engine.h"
+#include "nmod_poly_compose_mod.h"
+#include "ff_isom_thresholds.h"
+#include "gf2_poly.h"
+#include "thread_pool.h"
+
+#include <flint/nmod_mat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+static mutex engine_mutex;
+static bool engine_ready = false;
+static slong current_engine = COMPOSE_ENGINE_AUTO;
+// per calling thread, so that concurrent tasks do not share it
+static thread_local slong engine_threads = 1;
+
+slong NmodComposeEngine::parse_engine(const char *name) {
+	if (strcmp(name, "auto") == 0)
+		return COMPOSE_ENGINE_AUTO;
+	if (strcmp(name, "flint") == 0)
+		return COMPOSE_ENGINE_FLINT;
+	if (strcmp(name, "brent_kung") == 0)
+		return COMPOSE_ENGINE_BRENT_KUNG;
+	if (strcmp(name, "rectangular") == 0)
+		return COMPOSE_ENGINE_RECTANGULAR;
+	return -1;
+}
+
+slong NmodComposeEngine::get_engine() {
+	lock_guard<mutex> lock(engine_mutex);
+	if (!engine_ready) {
+		const char *name = getenv("FFISOM_COMPOSE_ENGINE");
+		if (name != NULL) {
+			slong parsed = parse_engine(name);
+			if (parsed < 0)
+				flint_printf("Warning (NmodComposeEngine::get_engine). Unknown engine %s, using auto.\n", name);
+			else
+				current_engine = parsed;
+		}
+		engine_ready = true;
+	}
+	return current_engine;
+}
+
+void NmodComposeEngine::set_engine(slong value) {
+	if (value < COMPOSE_ENGINE_AUTO || value > COMPOSE_ENGINE_RECTANGULAR) {
+		flint_printf("Exception (NmodComposeEngine::set_engine). Unknown engine.\n");
+		abort();
+	}
+
+	lock_guard<mutex> lock(engine_mutex);
+	current_engine = value;
+	engine_ready = true;
+}
+
+void NmodComposeEngine::set_num_threads(slong num_threads) {
+	engine_threads = FLINT_MAX(num_threads, 1);
+}
+
+slong NmodComposeEngine::get_num_threads() {
+	return engine_threads;
+}
+
+void NmodComposeEngine::compose_mod(nmod_poly_t res, const nmod_poly_t a, const nmod_poly_t b, const nmod_poly_t f) {
+	compose_mod(res, a, b, f, get_engine());
+}
+
+void NmodComposeEngine::compose_mod(nmod_poly_t res, const nmod_poly_t a, const nmod_poly_t b, const nmod_poly_t f,
+		slong engine) {
+	slong n = nmod_poly_degree(f);
+
+	if (engine == COMPOSE_ENGINE_AUTO) {
+		if (f->mod.n == 2) {
+			Gf2PolyComposeMod::compose_mod(res, a, b, f);
+			return;
+		}
+		// on a single thread the rectangular engine only adds overhead
+		if (get_num_threads() > 1 && n >= FFIsomThresholds::get().rectangular_compose_threshold)
+			engine = COMPOSE_ENGINE_RECTANGULAR;
+		else
+			engine = COMPOSE_ENGINE_FLINT;
+	}
+
+	// both prepared engines want a reduced polynomial to compose
+	if (engine == COMPOSE_ENGINE_FLINT || n < 2 || a->length > n) {
+		nmod_poly_compose_mod(res, a, b, f);
+		return;
+	}
+
+	if (engine == COMPOSE_ENGINE_RECTANGULAR) {
+		slong num_threads = get_num_threads();
+		ThreadPool pool(num_threads > 1 ? num_threads : 0);
+		compose_mod_rectangular(res, a, b, f, pool);
+		return;
+	}
+
+	nmod_poly_t b_rem, f_inv;
+	nmod_poly_init(b_rem, f->mod.n);
+	nmod_poly_init(f_inv, f->mod.n);
+	nmod_poly_rem(b_rem, b, f);
+	nmod_poly_reverse(f_inv, f, n + 1);
+	nmod_poly_inv_series_newton(f_inv, f_inv, n);
+
+	Nmod_poly_compose_mod compose(b_rem, f, f_inv, n_sqrt(a->length) + 1);
+	Nmod_poly_compose_mod::Workspace workspace;
+	compose.apply(res, a, workspace);
+
+	nmod_poly_clear(b_rem);
+	nmod_poly_clear(f_inv);
+}
+
+/**
+ * Completes {@code rows}[0..count) to the powers of {@code rows}[1] modulo
+ * f, given {@code rows}[0] and {@code rows}[1]: each round multiplies the
+ * known powers by the largest one, the products of a round on the threads
+ * of {@code pool}.
+ */
+static void powers_by_doubling(mp_ptr *rows, slong count, slong n, mp_srcptr f, mp_srcptr f_inv, slong len_f_inv,
+		nmod_t mod, ThreadPool &pool) {
+	slong known = 2;
+	while (known < count) {
+		slong end = FLINT_MIN(2 * known - 1, count);
+		for (slong i = known; i < end; i++)
+			pool.submit([rows, i, known, n, f, f_inv, len_f_inv, mod] {
+				_nmod_poly_mulmod_preinv(rows[i], rows[i - known + 1], n, rows[known - 1], n,
+						f, n + 1, f_inv, len_f_inv, mod);
+			});
+		pool.wait();
+		known = end;
+	}
+}
+
+void NmodComposeEngine::compose_mod_rectangular(nmod_poly_t res, const nmod_poly_t a, const nmod_poly_t b,
+		const nmod_poly_t f, ThreadPool &pool) {
+	slong n = nmod_poly_degree(f);
+	if (n < 2 || a->length > n) {
+		nmod_poly_compose_mod(res, a, b, f);
+		return;
+	}
+
+	nmod_t mod = f->mod;
+	slong len = a->length;
+	if (len == 0) {
+		nmod_poly_zero(res);
+		return;
+	}
+
+	slong m = n_sqrt(len) + 1;
+	slong k = (len + m - 1) / m;
+	slong num_chunks = FLINT_MAX(pool.size(), 1);
+
+	nmod_poly_t b_rem, f_inv, result;
+	nmod_poly_init(b_rem, mod.n);
+	nmod_poly_init(f_inv, mod.n);
+	nmod_poly_init2(result, mod.n, n);
+	nmod_poly_rem(b_rem, b, f);
+	nmod_poly_reverse(f_inv, f, n + 1);
+	nmod_poly_inv_series_newton(f_inv, f_inv, n);
+	mp_srcptr fc = f->coeffs;
+	mp_srcptr fi = f_inv->coeffs;
+	slong len_f_inv = f_inv->length;
+
+	// baby steps b^i, i < m, as the rows of A
+	nmod_mat_t A;
+	nmod_mat_init(A, m, n, mod.n);
+	A->rows[0][0] = 1;
+	_nmod_vec_set(A->rows[1], b_rem->coeffs, b_rem->length);
+	powers_by_doubling(A->rows, m, n, fc, fi, len_f_inv, mod, pool);
+
+	// giant steps (b^m)^j, j < k
+	mp_ptr giant_buffer = _nmod_vec_init(FLINT_MAX(k, 2) * n);
+	vector<mp_ptr> giant(FLINT_MAX(k, 2));
+	for (slong j = 0; j < FLINT_MAX(k, 2); j++)
+		giant[j] = giant_buffer + j * n;
+	_nmod_vec_zero(giant_buffer, FLINT_MAX(k, 2) * n);
+	giant[0][0] = 1;
+	_nmod_poly_mulmod_preinv(giant[1], A->rows[m - 1], n, A->rows[1], n, fc, n + 1, fi, len_f_inv, mod);
+	powers_by_doubling(giant.data(), k, n, fc, fi, len_f_inv, mod, pool);
+
+	// the segments of a as the rows of S, and C = S A by tiles of m columns
+	nmod_mat_t S, C;
+	nmod_mat_init(S, k, m, mod.n);
+	nmod_mat_init(C, k, n, mod.n);
+	for (slong j = 0; j < k; j++)
+		_nmod_vec_set(S->rows[j], a->coeffs + j * m, FLINT_MIN(m, len - j * m));
+
+	nmod_mat_struct *Sp = S, *Ap = A, *Cp = C;
+	for (slong col = 0; col < n; col += m) {
+		slong end = FLINT_MIN(col + m, n);
+		pool.submit([Sp, Ap, Cp, col, end, m, k] {
+			nmod_mat_t A_tile, C_tile;
+			nmod_mat_window_init(A_tile, Ap, 0, col, m, end);
+			nmod_mat_window_init(C_tile, Cp, 0, col, k, end);
+			nmod_mat_mul(C_tile, Sp, A_tile);
+			nmod_mat_window_clear(A_tile);
+			nmod_mat_window_clear(C_tile);
+		});
+	}
+	pool.wait();
+
+	// sum_j C_j (b^m)^j, unreduced, by chunks of j
+	mp_ptr sums = _nmod_vec_init(num_chunks * (2 * n - 1));
+	_nmod_vec_zero(sums, num_chunks * (2 * n - 1));
+	slong chunk = (k + num_chunks - 1) / num_chunks;
+	for (slong c = 0; c * chunk < k; c++)
+		pool.submit([Cp, &giant, sums, c, chunk, k, n, mod] {
+			mp_ptr sum = sums + c * (2 * n - 1);
+			mp_ptr product = _nmod_vec_init(2 * n - 1);
+			for (slong j = c * chunk; j < FLINT_MIN((c + 1) * chunk, k); j++) {
+				if (j == 0) {
+					_nmod_vec_add(sum, sum, Cp->rows[0], n, mod);
+					continue;
+				}
+				_nmod_poly_mul(product, Cp->rows[j], n, giant[j], n, mod);
+				_nmod_vec_add(sum, sum, product, 2 * n - 1, mod);
+			}
+			_nmod_vec_clear(product);
+		});
+	pool.wait();
+
+	for (slong c = 1; c < num_chunks; c++)
+		_nmod_vec_add(sums, sums, sums + c * (2 * n - 1), 2 * n - 1, mod);
+
+	mp_ptr quotient = _nmod_vec_init(n);
+	_nmod_poly_divrem_newton_n_preinv(quotient, result->coeffs, sums, 2 * n - 1, fc, n + 1, fi, len_f_inv, mod);
+	_nmod_poly_set_length(result, n);
+	_nmod_poly_normalise(result);
+	nmod_poly_swap(res, result);
+
+	_nmod_vec_clear(quotient);
+	_nmod_vec_clear(sums);
+	_nmod_vec_clear(giant_buffer);
+	nmod_mat_clear(A);
+	nmod_mat_clear(S);
+	nmod_mat_clear(C);
+	nmod_poly_clear(b_rem);
+	nmod_poly_clear(f_inv);
+	nmod_poly_clear(result);
+}
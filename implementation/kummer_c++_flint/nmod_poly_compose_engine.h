@@ -0,0 +1,70 @@
+/*
+ * nmod_poly_compose_engine.h
+ *
+ *  The modular composition used by the semi-traces, the Artin-Schreier
+ *  solver and FFEmbedding, chosen at run time. The engine is AUTO unless
+ *  set by {@code NmodComposeEngine::set_engine} or by the environment
+ *  variable FFISOM_COMPOSE_ENGINE (flint, brent_kung or rectangular).
+ */
+
+#ifndef NMOD_POLY_COMPOSE_ENGINE_H_
+#define NMOD_POLY_COMPOSE_ENGINE_H_
+
+#include <flint/nmod_poly.h>
+
+class ThreadPool;
+
+enum {
+    // packed GF(2) for p = 2, the rectangular engine from
+    // rectangular_compose_threshold when more than one thread is set,
+    // FLINT's nmod_poly_compose_mod otherwise
+    COMPOSE_ENGINE_AUTO,
+    COMPOSE_ENGINE_FLINT,
+    // a prepared Nmod_poly_compose_mod
+    COMPOSE_ENGINE_BRENT_KUNG,
+    COMPOSE_ENGINE_RECTANGULAR
+};
+
+class NmodComposeEngine {
+public:
+
+    /**
+     * {@code res} = {@code a}({@code b}) mod {@code f}, with the engine in use.
+     * Supports aliasing.
+     */
+    static void compose_mod(nmod_poly_t res, const nmod_poly_t a, const nmod_poly_t b, const nmod_poly_t f);
+
+    /**
+     * The same with a given engine, AUTO resolved for the degree of {@code f}.
+     */
+    static void compose_mod(nmod_poly_t res, const nmod_poly_t a, const nmod_poly_t b, const nmod_poly_t f,
+            slong engine);
+
+    /**
+     * Brent-Kung composition with the product of the segments of {@code a}
+     * by the baby steps of {@code b} done in square tiles, as in the
+     * rectangular formulation of Nusken and Ziegler, and every phase spread
+     * over the threads of {@code pool}: the baby and giant steps by doubling,
+     * the tiles, and the sum of the blocks times the giant steps.
+     */
+    static void compose_mod_rectangular(nmod_poly_t res, const nmod_poly_t a, const nmod_poly_t b,
+            const nmod_poly_t f, ThreadPool &pool);
+
+    static void set_engine(slong engine);
+    static slong get_engine();
+
+    /**
+     * The number of threads of the rectangular engine for calls made from
+     * the calling thread, 1 by default. FFEmbedding sets it from its own
+     * {@code num_threads}.
+     */
+    static void set_num_threads(slong num_threads);
+    static slong get_num_threads();
+
+    /**
+     * Parses an engine name, as in FFISOM_COMPOSE_ENGINE; -1 if unknown.
+     */
+    static slong parse_engine(const char *name);
+};
+
+#endif /* NMOD_POLY_COMPOSE_ENGINE_H_ */
@@ -1,88 +1,329 @@
 #include <iostream>
 #include <flint/nmod_poly.h>
 #include "nmod_poly_compose_mod.h"
+#include "thread_pool.h"
+
+/*------------------------------------------------------*/
+/* workspace: nothing is allocated until the first use  */
+/*------------------------------------------------------*/
+Nmod_poly_compose_mod::Workspace::Workspace(){
+  rows = 0;
+  m = 0;
+  n = 0;
+  h = NULL;
+  t = NULL;
+}
+
+Nmod_poly_compose_mod::Workspace::~Workspace(){
+  if (h != NULL){
+    nmod_mat_clear(B);
+    nmod_mat_clear(C);
+    _nmod_vec_clear(h);
+    _nmod_vec_clear(t);
+  }
+}
+
+/*------------------------------------------------------*/
+/* makes room for rows x m segments and rows x n        */
+/* products; only reallocates when growing or when the  */
+/* shape of the composition changes                     */
+/*------------------------------------------------------*/
+void Nmod_poly_compose_mod::Workspace::fit(slong rows_in, slong m_in, slong n_in, nmod_t mod){
+  if (h != NULL && rows_in <= rows && m_in == m && n_in == n && mod.n == B->mod.n)
+    return;
+
+  if (h != NULL){
+    nmod_mat_clear(B);
+    nmod_mat_clear(C);
+    _nmod_vec_clear(h);
+    _nmod_vec_clear(t);
+  }
+
+  if (m_in != m || n_in != n || rows_in > rows)
+    rows = rows_in;
+  m = m_in;
+  n = n_in;
+  nmod_mat_init(B, rows, m, mod.n);
+  nmod_mat_init(C, rows, n, mod.n);
+  h = _nmod_vec_init(2*n);
+  t = _nmod_vec_init(2*n);
+}
+
+
+Nmod_poly_compose_mod::Nmod_poly_compose_mod(){
+  prepared = false;
+  n = 0;
+  k = 0;
+  m = 0;
+  len_f_inv = 0;
+  f = NULL;
+  f_inv = NULL;
+  giant = NULL;
+  mod.n = 0;
+  mod.ninv = 0;
+  mod.norm = 0;
+}
+
+Nmod_poly_compose_mod::Nmod_poly_compose_mod(const nmod_poly_t arg,
+					     const nmod_poly_t poly,
+					     const nmod_poly_t polyinv,
+					     long sz) : Nmod_poly_compose_mod(){
+  prepare(arg, poly, polyinv, sz);
+}
+
+Nmod_poly_compose_mod::Nmod_poly_compose_mod(Nmod_poly_compose_mod && other) : Nmod_poly_compose_mod(){
+  *this = std::move(other);
+}
+
+Nmod_poly_compose_mod & Nmod_poly_compose_mod::operator=(Nmod_poly_compose_mod && other){
+  if (this == &other)
+    return *this;
+
+  release();
+  prepared = other.prepared;
+  n = other.n;
+  k = other.k;
+  m = other.m;
+  len_f_inv = other.len_f_inv;
+  f = other.f;
+  f_inv = other.f_inv;
+  giant = other.giant;
+  *A = *other.A;
+  mod = other.mod;
+
+  // other no longer owns the buffers
+  other.prepared = false;
+  other.f = NULL;
+  other.f_inv = NULL;
+  other.giant = NULL;
+  return *this;
+}
+
+Nmod_poly_compose_mod::~Nmod_poly_compose_mod(){
+  release();
+}
+
+void Nmod_poly_compose_mod::release(){
+  if (!prepared)
+    return;
+  _nmod_vec_clear(f);
+  _nmod_vec_clear(f_inv);
+  _nmod_vec_clear(giant);
+  nmod_mat_clear(A);
+  f = NULL;
+  f_inv = NULL;
+  giant = NULL;
+  prepared = false;
+}
+
+bool Nmod_poly_compose_mod::is_prepared() const{
+  return prepared;
+}
+
+slong Nmod_poly_compose_mod::degree() const{
+  return n;
+}
+
 
 /*------------------------------------------------------*/
-/* helper function for modular composition              */
 /* computes res[i] = polys[i](arg) mod f, 0 <= i < len2 */
+/* all inputs are read before any output is written,    */
+/* hence res may alias polys                            */
 /*------------------------------------------------------*/
-void Nmod_poly_compose_mod::nmod_poly_compose_mod_brent_kung_vec_preinv_precomp(nmod_poly_struct * res,
-										const nmod_poly_struct * polys,
-										slong len2) const{
-    nmod_mat_t B, C;
-    mp_ptr t, h;
+void Nmod_poly_compose_mod::apply(nmod_poly_struct * res,
+				  const nmod_poly_struct * polys,
+				  slong len2,
+				  Workspace & workspace) const{
     slong len1;
 
-    h = _nmod_vec_init(2*n);
-    t = _nmod_vec_init(2*n);
+    if (len2 == 0)
+      return;
 
-    for (long i = 0; i < len2; i++){
-      nmod_poly_init2_preinv(res + i, mod.n, mod.ninv, n);
-      _nmod_poly_set_length(res + i, n);
-    }
+    workspace.fit(k * len2, m, n, mod);
+    mp_ptr h = workspace.h;
+    mp_ptr t = workspace.t;
 
-    nmod_mat_init(B, k * len2, m, mod.n);
-    nmod_mat_init(C, k * len2, n, mod.n);
+    // windows on the first k * len2 rows of the workspace matrices
+    nmod_mat_struct B = *workspace.B;
+    nmod_mat_struct C = *workspace.C;
+    B.r = k * len2;
+    C.r = k * len2;
 
     /* Set rows of B to the segments of polys */
     for (long j = 0; j < len2; j++) {
         len1 = (polys + j)->length;
-        for (long i = 0; i < len1 / m; i++)
-            _nmod_vec_set(B->rows[i + j * k], (polys + j)->coeffs + i * m, m);
-    	long i = len1 / m;
-        _nmod_vec_set(B->rows[i + j * k], (polys + j)->coeffs + i * m, len1 % m);
+        for (long i = 0; i < k; i++) {
+            slong len_seg = FLINT_MAX(0, FLINT_MIN(m, len1 - i * m));
+            _nmod_vec_set(B.rows[i + j * k], (polys + j)->coeffs + i * m, len_seg);
+            _nmod_vec_zero(B.rows[i + j * k] + len_seg, m - len_seg);
+        }
     }
 
-    nmod_mat_mul(C, B, A);
-      
+    nmod_mat_mul(&C, &B, A);
+
     /* Evaluate block composition using the Horner scheme */
     for (long j = 0; j < len2; j++) {
-      _nmod_vec_set(t, C->rows[j * k], n);
+      _nmod_vec_set(t, C.rows[j * k], n);
       for (long i = n; i < 2*n; i++)
     	t[i] = 0;
       for (long i = 1; i < k; i++){
-    	_nmod_poly_mul(h, C->rows[j * k + i], n, giant + (i-1)*n, n, mod);
+    	_nmod_poly_mul(h, C.rows[j * k + i], n, giant + (i-1)*n, n, mod);
     	_nmod_poly_add(t, h, 2*n-1, t, 2*n-1, mod);
       }
+      nmod_poly_fit_length(res + j, n);
       _nmod_poly_divrem_newton_n_preinv(h, (res + j)->coeffs, t, 2*n-1, f, n+1, f_inv, len_f_inv, mod);
+      _nmod_poly_set_length(res + j, n);
+      _nmod_poly_normalise(res + j);
     }
-      
+}
 
+/*------------------------------------------------------*/
+/* sets rows j k .. j k + k - 1 of B to the segments of */
+/* the dense row polys[j], 0 <= j < len2                */
+/*------------------------------------------------------*/
+void Nmod_poly_compose_mod::fill_segments(nmod_mat_struct * B, mp_srcptr const * polys, slong len2) const{
+    for (long j = 0; j < len2; j++) {
+        for (long i = 0; i < k; i++) {
+            slong len_seg = FLINT_MAX(0, FLINT_MIN(m, n - i * m));
+            _nmod_vec_set(B->rows[i + j * k], polys[j] + i * m, len_seg);
+            _nmod_vec_zero(B->rows[i + j * k] + len_seg, m - len_seg);
+        }
+    }
+}
 
-    for (long i = 0; i < len2; i++)
-      _nmod_poly_normalise(res + i);
-    
-    _nmod_vec_clear(h);
-    _nmod_vec_clear(t);
+/*------------------------------------------------------*/
+/* res = sum_i C[j k + i] giant^i mod f, by Horner      */
+/* h, t have room for 2n limbs                          */
+/*------------------------------------------------------*/
+void Nmod_poly_compose_mod::horner(mp_ptr res, const nmod_mat_struct * C, slong j, mp_ptr h, mp_ptr t) const{
+    _nmod_vec_set(t, C->rows[j * k], n);
+    for (long i = n; i < 2*n; i++)
+      t[i] = 0;
+    for (long i = 1; i < k; i++){
+      _nmod_poly_mul(h, C->rows[j * k + i], n, giant + (i-1)*n, n, mod);
+      _nmod_poly_add(t, h, 2*n-1, t, 2*n-1, mod);
+    }
+    _nmod_poly_divrem_newton_n_preinv(h, res, t, 2*n-1, f, n+1, f_inv, len_f_inv, mod);
+}
 
-    nmod_mat_clear(B);
-    nmod_mat_clear(C);
+void Nmod_poly_compose_mod::apply(mp_ptr const * res,
+				  mp_srcptr const * polys,
+				  slong len2,
+				  Workspace & workspace) const{
+    if (len2 == 0)
+      return;
+
+    workspace.fit(k * len2, m, n, mod);
+
+    nmod_mat_struct B = *workspace.B;
+    nmod_mat_struct C = *workspace.C;
+    B.r = k * len2;
+    C.r = k * len2;
+
+    /* the rows have length n, no normalisation needed */
+    fill_segments(&B, polys, len2);
+    nmod_mat_mul(&C, &B, A);
+
+    for (long j = 0; j < len2; j++)
+      horner(res[j], &C, j, workspace.h, workspace.t);
+}
+
+void Nmod_poly_compose_mod::apply(mp_ptr const * res,
+				  mp_srcptr const * polys,
+				  slong len2,
+				  Workspace * workspaces,
+				  ThreadPool & pool) const{
+    slong num_threads = pool.size();
+    if (num_threads <= 1 || len2 <= 1){
+      apply(res, polys, len2, workspaces[0]);
+      return;
+    }
+
+    // the matrices live in the first workspace, the others only lend
+    // their Horner buffers
+    workspaces[0].fit(k * len2, m, n, mod);
+    for (slong i = 1; i < num_threads; i++)
+      workspaces[i].fit(1, m, n, mod);
+
+    nmod_mat_struct B = *workspaces[0].B;
+    nmod_mat_struct C = *workspaces[0].C;
+    B.r = k * len2;
+    C.r = k * len2;
+
+    /* all inputs are read here, so res may alias polys */
+    fill_segments(&B, polys, len2);
+
+    /* blocks of rows of B times A */
+    slong rows = k * len2;
+    slong block = (rows + num_threads - 1) / num_threads;
+    for (slong start = 0; start < rows; start += block){
+      pool.submit([this, &B, &C, start, block, rows] {
+	nmod_mat_struct B_block = B;
+	nmod_mat_struct C_block = C;
+	B_block.rows = B.rows + start;
+	C_block.rows = C.rows + start;
+	B_block.r = FLINT_MIN(block, rows - start);
+	C_block.r = B_block.r;
+	nmod_mat_mul(&C_block, &B_block, A);
+      });
+    }
+    pool.wait();
+
+    /* chunks of outputs, one workspace each */
+    slong chunk = (len2 + num_threads - 1) / num_threads;
+    for (slong i = 0; i * chunk < len2; i++){
+      Workspace * workspace = workspaces + i;
+      pool.submit([this, res, &C, workspace, i, chunk, len2] {
+	for (slong j = i * chunk; j < FLINT_MIN((i + 1) * chunk, len2); j++)
+	  horner(res[j], &C, j, workspace->h, workspace->t);
+      });
+    }
+    pool.wait();
 }
 
+void Nmod_poly_compose_mod::apply(nmod_poly_t res, const nmod_poly_t poly, Workspace & workspace) const{
+  apply(res, poly, 1, workspace);
+}
 
 /*------------------------------------------------------*/
 /* setup for modular composition by arg mod poly        */
-/* precomputes baby steps and giant steps               */      
+/* precomputes baby steps and giant steps               */
 /*------------------------------------------------------*/
-void Nmod_poly_compose_mod::nmod_poly_compose_mod_brent_kung_vec_preinv_prepare(mp_srcptr arg, slong len_arg,
-										mp_srcptr poly, slong len_poly,
-										mp_srcptr polyinv, slong len_poly_inv,
-										nmod_t mod_in,
-										long sz){
-  n = len_poly - 1;
-  f = _nmod_vec_init(len_poly);
-  flint_mpn_copyi(f, poly, len_poly);
+void Nmod_poly_compose_mod::prepare(mp_srcptr arg, slong len_arg,
+				    mp_srcptr poly, slong len_poly,
+				    mp_srcptr polyinv, slong len_poly_inv,
+				    nmod_t mod_in,
+				    long sz, slong max_len){
+  if (max_len <= 0 || max_len > len_poly - 1)
+    max_len = len_poly - 1;
 
-  len_f_inv = len_poly_inv;
-  f_inv = _nmod_vec_init(len_f_inv);
-  flint_mpn_copyi(f_inv, polyinv, len_f_inv);
+  // at least two baby steps: A->rows[1] holds arg itself
+  long new_m = FLINT_MAX(FLINT_MIN(sz, max_len), 2);
+  long new_k = (max_len + new_m - 1) / new_m;
+
+  if (!prepared || len_poly - 1 != n || new_m != m || new_k != k || mod_in.n != mod.n){
+    release();
+    n = len_poly - 1;
+    m = new_m;
+    k = new_k;
+    f = _nmod_vec_init(len_poly);
+    f_inv = _nmod_vec_init(len_poly_inv);
+    len_f_inv = len_poly_inv;
+    giant = _nmod_vec_init(k*n);
+    nmod_mat_init(A, m, n, mod_in.n);
+    prepared = true;
+  } else if (len_poly_inv != len_f_inv){
+    _nmod_vec_clear(f_inv);
+    f_inv = _nmod_vec_init(len_poly_inv);
+    len_f_inv = len_poly_inv;
+  }
 
-  m = sz;
-  k = n / m + 1;
   mod = mod_in;
-  nmod_mat_init(A, m, n, mod.n);
+  flint_mpn_copyi(f, poly, len_poly);
+  flint_mpn_copyi(f_inv, polyinv, len_f_inv);
 
   /* baby steps: set rows of A to powers of arg */
+  _nmod_vec_zero(A->rows[0], n);
   A->rows[0][0] = UWORD(1);
   _nmod_vec_set(A->rows[1], arg, len_arg);
   flint_mpn_zero(A->rows[1] + len_arg, n - len_arg);
@@ -90,32 +331,46 @@ void Nmod_poly_compose_mod::nmod_poly_compose_mod_brent_kung_vec_preinv_prepare(
     _nmod_poly_mulmod_preinv(A->rows[i], A->rows[i - 1], n, A->rows[1], n, f, n+1, f_inv, len_f_inv, mod);
 
   /* giant steps */
-  giant = _nmod_vec_init(k*n);
   _nmod_poly_mulmod_preinv(giant, A->rows[m - 1], n, A->rows[1], n, f, n+1, f_inv, len_f_inv, mod);
   for (long i = 1; i < k-1; i++)
     _nmod_poly_mulmod_preinv(giant + i*n, giant + (i-1)*n, n, giant, n, f, n+1, f_inv, len_f_inv, mod);
- }
+}
+
+void Nmod_poly_compose_mod::prepare(const nmod_poly_t arg,
+				    const nmod_poly_t poly,
+				    const nmod_poly_t polyinv,
+				    long sz, slong max_len){
+  prepare(arg->coeffs, arg->length,
+	  poly->coeffs, poly->length,
+	  polyinv->coeffs, polyinv->length,
+	  arg->mod, sz, max_len);
+}
+
 
 /*------------------------------------------------------*/
-/* setup for modular composition by arg mod poly        */
-/* precomputes baby steps and giant steps               */      
+/* older interface, kept for existing callers           */
 /*------------------------------------------------------*/
-void Nmod_poly_compose_mod::nmod_poly_compose_mod_brent_kung_vec_preinv_prepare(const nmod_poly_t arg,
-										const nmod_poly_t poly,
-										const nmod_poly_t polyinv,
-										long sz){
+void Nmod_poly_compose_mod::nmod_poly_compose_mod_brent_kung_vec_preinv_precomp(nmod_poly_struct * res,
+										const nmod_poly_struct * polys,
+										slong len2) const{
+    for (long i = 0; i < len2; i++)
+      nmod_poly_init2_preinv(res + i, mod.n, mod.ninv, n);
 
-  nmod_poly_compose_mod_brent_kung_vec_preinv_prepare(arg->coeffs, arg->length,
-						      poly->coeffs, poly->length,
-						      polyinv->coeffs, polyinv->length,
-						      arg->mod, sz);
+    Workspace workspace;
+    apply(res, polys, len2, workspace);
 }
 
+void Nmod_poly_compose_mod::nmod_poly_compose_mod_brent_kung_vec_preinv_prepare(mp_srcptr arg, slong len_arg,
+										mp_srcptr poly, slong len_poly,
+										mp_srcptr polyinv, slong len_poly_inv,
+										nmod_t mod_in,
+										long sz){
+  prepare(arg, len_arg, poly, len_poly, polyinv, len_poly_inv, mod_in, sz);
+}
 
-
-Nmod_poly_compose_mod::~Nmod_poly_compose_mod(){
-  _nmod_vec_clear(f);
-  _nmod_vec_clear(f_inv);
-  _nmod_vec_clear(giant);
-  nmod_mat_clear(A);
+void Nmod_poly_compose_mod::nmod_poly_compose_mod_brent_kung_vec_preinv_prepare(const nmod_poly_t arg,
+										const nmod_poly_t poly,
+										const nmod_poly_t polyinv,
+										long sz){
+  prepare(arg, poly, polyinv, sz);
 }
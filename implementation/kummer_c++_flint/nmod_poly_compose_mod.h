@@ -2,6 +2,9 @@
 #define NMOD_POLY_COMPOSE_MOD_H_
 
 #include <flint/nmod_poly.h>
+#include <flint/nmod_mat.h>
+
+class ThreadPool;
 
 using namespace std;
 
@@ -9,13 +12,119 @@ class Nmod_poly_compose_mod {
  public:
 
 /*------------------------------------------------------------------------*/
-/* multiple modular composition                                           */
-/* res[i] = polys[i](arg) mod poly, i=0..len1-1                           */
-/* polyinv = 1 /rev(poly) mod x^n (or n-1?)                               */
+/* scratch space for apply                                                */
+/* grows on demand and is kept between calls, so that repeated            */
+/* compositions do not allocate; one workspace per thread                 */
+/*------------------------------------------------------------------------*/
+class Workspace {
+ public:
+  Workspace();
+  ~Workspace();
+
+  Workspace(const Workspace &) = delete;
+  Workspace & operator=(const Workspace &) = delete;
+
+ private:
+  friend class Nmod_poly_compose_mod;
+
+  void fit(slong rows, slong m, slong n, nmod_t mod);
+
+  slong rows, m, n;
+  nmod_mat_t B, C;
+  mp_ptr h, t;
+};
+
+ Nmod_poly_compose_mod();
+
+ /**
+  * Same as calling {@code prepare(arg, poly, polyinv, sz)} on an empty object.
+  */
+ Nmod_poly_compose_mod(const nmod_poly_t arg,
+		       const nmod_poly_t poly,
+		       const nmod_poly_t polyinv,
+		       long sz);
+
+ Nmod_poly_compose_mod(Nmod_poly_compose_mod && other);
+ Nmod_poly_compose_mod & operator=(Nmod_poly_compose_mod && other);
+
+ Nmod_poly_compose_mod(const Nmod_poly_compose_mod &) = delete;
+ Nmod_poly_compose_mod & operator=(const Nmod_poly_compose_mod &) = delete;
+
+ ~Nmod_poly_compose_mod();
+
+/*------------------------------------------------------------------------*/
+/* setup for modular composition by arg mod poly                          */
+/* polyinv = 1 /rev(poly) mod x^n                                         */
 /* sz is the number of baby steps                                         */
-/* (TODO: give it a default value?)                                       */
+/* max_len bounds the length of the polynomials to compose (0 means       */
+/* deg(poly)); a smaller bound saves giant steps, e.g. when composing     */
+/* elements of a subfield                                                 */
+/* may be called again; the buffers are reused when the sizes agree       */
 /*------------------------------------------------------------------------*/
+void prepare(mp_srcptr arg, slong len_arg,
+	     mp_srcptr poly, slong len_poly,
+	     mp_srcptr polyinv, slong len_poly_inv,
+	     nmod_t mod_in,
+	     long sz, slong max_len = 0);
+
+void prepare(const nmod_poly_t arg,
+	     const nmod_poly_t poly,
+	     const nmod_poly_t polyinv,
+	     long sz, slong max_len = 0);
 
+/*------------------------------------------------------------------------*/
+/* multiple modular composition                                           */
+/* res[i] = polys[i](arg) mod poly, i=0..len-1                            */
+/* len(polys[i]) <= max_len; res[i] must be initialized                   */
+/* res may alias polys                                                    */
+/* const: several threads may share one prepared object, as long as each */
+/* of them passes its own workspace                                       */
+/*------------------------------------------------------------------------*/
+void apply(nmod_poly_struct * res,
+	   const nmod_poly_struct * polys,
+	   slong len,
+	   Workspace & workspace) const;
+
+/*------------------------------------------------------------------------*/
+/* the same on dense rows of n = deg(poly) coefficients, e.g. the rows of */
+/* an NmodTowerElement: res[i] = polys[i](arg) mod poly, zero padded      */
+/* coefficients of polys[i] past the max_len of prepare must be zero     */
+/* res may alias polys                                                    */
+/*------------------------------------------------------------------------*/
+void apply(mp_ptr const * res,
+	   mp_srcptr const * polys,
+	   slong len,
+	   Workspace & workspace) const;
+
+/*------------------------------------------------------------------------*/
+/* the dense apply on the threads of pool: the product of the segments by */
+/* the baby steps is split in blocks of rows, the Horner evaluations in   */
+/* chunks of outputs                                                      */
+/* workspaces[i] serves the i-th chunk: at least max(1, pool.size()) of   */
+/* them; with fewer than two threads this is the serial dense apply       */
+/*------------------------------------------------------------------------*/
+void apply(mp_ptr const * res,
+	   mp_srcptr const * polys,
+	   slong len,
+	   Workspace * workspaces,
+	   ThreadPool & pool) const;
+
+/*------------------------------------------------------------------------*/
+/* res = poly(arg) mod poly                                               */
+/*------------------------------------------------------------------------*/
+void apply(nmod_poly_t res, const nmod_poly_t poly, Workspace & workspace) const;
+
+bool is_prepared() const;
+
+/*------------------------------------------------------------------------*/
+/* n = deg(poly), the length of the rows of the dense apply               */
+/*------------------------------------------------------------------------*/
+slong degree() const;
+
+/*------------------------------------------------------------------------*/
+/* older interface                                                        */
+/* precomp initializes the entries of res, which the caller must clear    */
+/*------------------------------------------------------------------------*/
 void nmod_poly_compose_mod_brent_kung_vec_preinv_precomp(nmod_poly_struct * res,
 							 const nmod_poly_struct * polys,
 							 slong len1) const;
@@ -30,12 +139,18 @@ void nmod_poly_compose_mod_brent_kung_vec_preinv_prepare(const nmod_poly_t arg,
 							 const nmod_poly_t poly,
 							 const nmod_poly_t polyinv,
 							 long sz);
- 
- ~Nmod_poly_compose_mod();
 
  private:
+ // shares the baby steps A
+ friend class Nmod_poly_power_projection;
+
+ void release();
+ void fill_segments(nmod_mat_struct * B, mp_srcptr const * polys, slong len) const;
+ void horner(mp_ptr res, const nmod_mat_struct * C, slong j, mp_ptr h, mp_ptr t) const;
+
+ bool prepared;
  long n, k, m, len_f_inv;
- mp_ptr f, f_inv, giant; 
+ mp_ptr f, f_inv, giant;
  nmod_mat_t A;  // baby steps
  nmod_t mod;
 };
@@ -0,0 +1,192 @@
+#include <flint/nmod_poly.h>
+#include "nmod_poly_power_projection.h"
+
+/*------------------------------------------------------*/
+/* empty object, to be prepared                         */
+/*------------------------------------------------------*/
+Nmod_poly_power_projection::Nmod_poly_power_projection(){
+  prepared = false;
+  compose = NULL;
+}
+
+Nmod_poly_power_projection::Nmod_poly_power_projection(const nmod_poly_t h,
+						       const nmod_poly_t poly,
+						       const nmod_poly_t polyinv,
+						       long sz){
+  prepared = false;
+  compose = NULL;
+  prepare(h, poly, polyinv, sz);
+}
+
+Nmod_poly_power_projection::Nmod_poly_power_projection(const Nmod_poly_compose_mod & compose){
+  prepared = false;
+  this->compose = NULL;
+  prepare(compose);
+}
+
+Nmod_poly_power_projection::~Nmod_poly_power_projection(){
+  release();
+}
+
+void Nmod_poly_power_projection::release(){
+  if (prepared){
+    nmod_poly_clear(f_rev);
+    nmod_poly_clear(f_rev_inv);
+    nmod_poly_clear(giant_rev);
+  }
+  prepared = false;
+  compose = NULL;
+}
+
+bool Nmod_poly_power_projection::is_prepared() const{
+  return prepared;
+}
+
+slong Nmod_poly_power_projection::degree() const{
+  return prepared ? compose->n : 0;
+}
+
+/*------------------------------------------------------*/
+/* baby steps of our own; only their number matters,    */
+/* so the composition is prepared without giant steps   */
+/*------------------------------------------------------*/
+void Nmod_poly_power_projection::prepare(const nmod_poly_t h,
+					 const nmod_poly_t poly,
+					 const nmod_poly_t polyinv,
+					 long sz){
+  if (nmod_poly_degree(poly) < 1){
+    flint_printf("Exception (Nmod_poly_power_projection::prepare). Modulus of degree < 1.\n");
+    abort();
+  }
+
+  sz = FLINT_MAX(sz, 2);
+  own.prepare(h, poly, polyinv, sz, sz);
+  prepare(own);
+}
+
+/*------------------------------------------------------*/
+/* the data of the transposed products by h^m mod f     */
+/*------------------------------------------------------*/
+void Nmod_poly_power_projection::prepare(const Nmod_poly_compose_mod & compose_in){
+  if (!compose_in.is_prepared()){
+    flint_printf("Exception (Nmod_poly_power_projection::prepare). Composition not prepared.\n");
+    abort();
+  }
+
+  release();
+  compose = &compose_in;
+
+  slong n = compose->n;
+  slong m = compose->m;
+  nmod_t mod = compose->mod;
+
+  nmod_poly_init(f_rev, mod.n);
+  nmod_poly_init(f_rev_inv, mod.n);
+  nmod_poly_init(giant_rev, mod.n);
+
+  nmod_poly_fit_length(f_rev, n + 1);
+  for (slong i = 0; i <= n; i++)
+    f_rev->coeffs[i] = compose->f[n - i];
+  _nmod_poly_set_length(f_rev, n + 1);
+  _nmod_poly_normalise(f_rev);
+
+  if (n > 1)
+    nmod_poly_inv_series_newton(f_rev_inv, f_rev, n - 1);
+
+  /* h^m = h^{m-1} h */
+  mp_ptr giant = _nmod_vec_init(n);
+  _nmod_poly_mulmod_preinv(giant, compose->A->rows[m - 1], n, compose->A->rows[1], n,
+			   compose->f, n+1, compose->f_inv, compose->len_f_inv, mod);
+  nmod_poly_fit_length(giant_rev, n);
+  for (slong i = 0; i < n; i++)
+    giant_rev->coeffs[i] = giant[n - 1 - i];
+  _nmod_poly_set_length(giant_rev, n);
+  _nmod_poly_normalise(giant_rev);
+  _nmod_vec_clear(giant);
+
+  prepared = true;
+}
+
+/*------------------------------------------------------*/
+/* w = w(h^m . mod f)                                   */
+/* first the values u_j = w(x^j mod f), j < 2n-1, by a  */
+/* transposed remainder; then w_i = sum_j u_{i+j} g_j   */
+/* for g = h^m, a middle product                        */
+/*------------------------------------------------------*/
+void Nmod_poly_power_projection::giant_step(nmod_poly_t w, nmod_poly_t temp) const{
+  slong n = compose->n;
+
+  nmod_poly_mullow(temp, w, f_rev, 2*n-1);
+  nmod_poly_shift_right(temp, temp, n);
+  nmod_poly_mullow(temp, temp, f_rev_inv, n-1);
+  nmod_poly_neg(temp, temp);
+  nmod_poly_shift_left(temp, temp, n);
+  nmod_poly_add(temp, temp, w);
+
+  nmod_poly_mullow(temp, temp, giant_rev, 2*n-1);
+  nmod_poly_shift_right(w, temp, n-1);
+  nmod_poly_truncate(w, n);
+}
+
+/*------------------------------------------------------*/
+/* forms are copied before any output is written,       */
+/* hence res may alias forms                            */
+/*------------------------------------------------------*/
+void Nmod_poly_power_projection::apply(mp_ptr const * res,
+				       mp_srcptr const * forms,
+				       slong len,
+				       slong l) const{
+  if (!prepared){
+    flint_printf("Exception (Nmod_poly_power_projection::apply). Not prepared.\n");
+    abort();
+  }
+
+  if (len <= 0 || l <= 0)
+    return;
+
+  slong n = compose->n;
+  slong m = compose->m;
+  nmod_t mod = compose->mod;
+
+  nmod_poly_struct * w = (nmod_poly_struct *) flint_malloc(len * sizeof(nmod_poly_struct));
+  nmod_poly_t temp;
+  nmod_poly_init(temp, mod.n);
+  for (slong j = 0; j < len; j++){
+    nmod_poly_init2(w + j, mod.n, n);
+    _nmod_vec_set((w + j)->coeffs, forms[j], n);
+    _nmod_poly_set_length(w + j, n);
+    _nmod_poly_normalise(w + j);
+  }
+
+  /* the forms as the columns of W, the values of a block in S = A W */
+  nmod_mat_t W, S;
+  nmod_mat_init(W, n, len, mod.n);
+  nmod_mat_init(S, m, len, mod.n);
+
+  for (slong base = 0; base < l; base += m){
+    for (slong j = 0; j < len; j++)
+      for (slong i = 0; i < n; i++)
+	W->rows[i][j] = (i < (w + j)->length) ? (w + j)->coeffs[i] : 0;
+
+    nmod_mat_mul(S, compose->A, W);
+
+    for (slong j = 0; j < len; j++)
+      for (slong i = 0; i < m && base + i < l; i++)
+	res[j][base + i] = S->rows[i][j];
+
+    if (base + m < l)
+      for (slong j = 0; j < len; j++)
+	giant_step(w + j, temp);
+  }
+
+  nmod_mat_clear(W);
+  nmod_mat_clear(S);
+  for (slong j = 0; j < len; j++)
+    nmod_poly_clear(w + j);
+  flint_free(w);
+  nmod_poly_clear(temp);
+}
+
+void Nmod_poly_power_projection::apply(mp_ptr res, mp_srcptr form, slong l) const{
+  apply(&res, &form, 1, l);
+}
@@ -0,0 +1,90 @@
+#ifndef NMOD_POLY_POWER_PROJECTION_H_
+#define NMOD_POLY_POWER_PROJECTION_H_
+
+#include <flint/nmod_poly.h>
+#include <flint/nmod_mat.h>
+#include "nmod_poly_compose_mod.h"
+
+/*------------------------------------------------------------------------*/
+/* power projection, the transpose of Brent-Kung composition:             */
+/* given linear forms v on F_p[x]/(f), computes v(h^i), 0 <= i < l        */
+/* the baby steps h^0 .. h^{m-1} are the rows of the matrix of a prepared */
+/* Nmod_poly_compose_mod; each block of m values of all the forms is one  */
+/* product by that matrix, and the giant steps are transposed products   */
+/* by h^m                                                                 */
+/*------------------------------------------------------------------------*/
+class Nmod_poly_power_projection {
+ public:
+
+ Nmod_poly_power_projection();
+
+ /**
+  * Same as calling {@code prepare(h, poly, polyinv, sz)} on an empty object.
+  */
+ Nmod_poly_power_projection(const nmod_poly_t h,
+			    const nmod_poly_t poly,
+			    const nmod_poly_t polyinv,
+			    long sz);
+
+ /**
+  * Same as calling {@code prepare(compose)} on an empty object.
+  */
+ explicit Nmod_poly_power_projection(const Nmod_poly_compose_mod & compose);
+
+ Nmod_poly_power_projection(const Nmod_poly_power_projection &) = delete;
+ Nmod_poly_power_projection & operator=(const Nmod_poly_power_projection &) = delete;
+
+ ~Nmod_poly_power_projection();
+
+/*------------------------------------------------------------------------*/
+/* setup for the powers of h mod poly, h reduced                          */
+/* polyinv = 1 / rev(poly) mod x^{n-1} at least                           */
+/* sz is the number of baby steps                                         */
+/*------------------------------------------------------------------------*/
+void prepare(const nmod_poly_t h,
+	     const nmod_poly_t poly,
+	     const nmod_poly_t polyinv,
+	     long sz);
+
+/*------------------------------------------------------------------------*/
+/* setup sharing the baby steps of a prepared composition by h            */
+/* compose must stay prepared, and unchanged, while this object is used  */
+/*------------------------------------------------------------------------*/
+void prepare(const Nmod_poly_compose_mod & compose);
+
+/*------------------------------------------------------------------------*/
+/* res[j][i] = forms[j](h^i), 0 <= i < l, 0 <= j < len                    */
+/* forms[j] holds the n = deg(poly) values of a form on the monomials    */
+/* res[j] has room for l limbs, and may alias forms[j]                    */
+/* const: several threads may share one prepared object                   */
+/*------------------------------------------------------------------------*/
+void apply(mp_ptr const * res,
+	   mp_srcptr const * forms,
+	   slong len,
+	   slong l) const;
+
+/*------------------------------------------------------------------------*/
+/* res[i] = form(h^i), 0 <= i < l                                         */
+/*------------------------------------------------------------------------*/
+void apply(mp_ptr res, mp_srcptr form, slong l) const;
+
+bool is_prepared() const;
+
+/*------------------------------------------------------------------------*/
+/* n = deg(poly), the length of the forms                                 */
+/*------------------------------------------------------------------------*/
+slong degree() const;
+
+ private:
+ void release();
+ void giant_step(nmod_poly_t w, nmod_poly_t temp) const;
+
+ bool prepared;
+ // the composition whose baby steps are used; own, or borrowed
+ Nmod_poly_compose_mod own;
+ const Nmod_poly_compose_mod * compose;
+ // rev(f), 1 / rev(f) mod x^{n-1}, and h^m reversed on n coefficients
+ nmod_poly_t f_rev, f_rev_inv, giant_rev;
+};
+
+#endif
@@ -0,0 +1,206 @@
+/*
+ * nmod_tower_element.cpp
+ */
+
+#include "nmod_tower_element.h"
+
+#include <flint/nmod_vec.h>
+
+// side of the square tiles of the transposition
+static const slong TRANSPOSE_TILE = 32;
+
+NmodTowerElement::NmodTowerElement(slong z_alloc, slong x_len, nmod_t mod) {
+	this->z_alloc = FLINT_MAX(z_alloc, 1);
+	this->z_len = z_alloc;
+	this->x_len = FLINT_MAX(x_len, 1);
+	this->mod = mod;
+	x_major = false;
+	coeffs = _nmod_vec_init(this->z_alloc * this->x_len);
+	scratch = _nmod_vec_init(this->z_alloc * this->x_len);
+	_nmod_vec_zero(coeffs, this->z_alloc * this->x_len);
+}
+
+NmodTowerElement::~NmodTowerElement() {
+	_nmod_vec_clear(coeffs);
+	_nmod_vec_clear(scratch);
+}
+
+slong NmodTowerElement::get_z_len() const {
+	return z_len;
+}
+
+slong NmodTowerElement::get_x_len() const {
+	return x_len;
+}
+
+bool NmodTowerElement::is_x_major() const {
+	return x_major;
+}
+
+mp_ptr NmodTowerElement::row(slong i) {
+	return coeffs + i * (x_major ? z_len : x_len);
+}
+
+mp_srcptr NmodTowerElement::row(slong i) const {
+	return coeffs + i * (x_major ? z_len : x_len);
+}
+
+void NmodTowerElement::zero() {
+	_nmod_vec_zero(coeffs, z_len * x_len);
+}
+
+void NmodTowerElement::set(const NmodTowerElement &other) {
+	if (other.z_len > z_alloc || other.x_len != x_len) {
+		flint_printf("Exception (NmodTowerElement::set). Shape mismatch.\n");
+		abort();
+	}
+	z_len = other.z_len;
+	x_major = other.x_major;
+	_nmod_vec_set(coeffs, other.coeffs, z_len * x_len);
+}
+
+void NmodTowerElement::set(const fq_nmod_poly_t a, const fq_nmod_ctx_t ctx) {
+	slong len = FLINT_MAX(a->length, 1);
+	if (len > z_alloc) {
+		flint_printf("Exception (NmodTowerElement::set). Too many coefficients.\n");
+		abort();
+	}
+	if (fq_nmod_ctx_degree(ctx) != x_len || ctx->mod.n != mod.n) {
+		flint_printf("Exception (NmodTowerElement::set). Element of another field.\n");
+		abort();
+	}
+
+	z_len = len;
+	x_major = false;
+	_nmod_vec_zero(coeffs, z_len * x_len);
+	for (slong i = 0; i < a->length; i++)
+		_nmod_vec_set(coeffs + i * x_len, (a->coeffs + i)->coeffs, FLINT_MIN((a->coeffs + i)->length, x_len));
+}
+
+void NmodTowerElement::get(fq_nmod_poly_t a, const fq_nmod_ctx_t ctx) const {
+	fq_nmod_poly_fit_length(a, z_len, ctx);
+	for (slong i = 0; i < z_len; i++) {
+		nmod_poly_struct *c = a->coeffs + i;
+		nmod_poly_fit_length(c, x_len);
+		for (slong j = 0; j < x_len; j++)
+			c->coeffs[j] = x_major ? coeffs[j * z_len + i] : coeffs[i * x_len + j];
+		_nmod_poly_set_length(c, x_len);
+		_nmod_poly_normalise(c);
+	}
+	_fq_nmod_poly_set_length(a, z_len, ctx);
+	_fq_nmod_poly_normalise(a, ctx);
+}
+
+/**
+ * Tiled out-of-place transposition into the scratch, then a swap of the
+ * two buffers.
+ */
+void NmodTowerElement::transpose() {
+	slong rows = x_major ? x_len : z_len;
+	slong cols = x_major ? z_len : x_len;
+
+	for (slong i0 = 0; i0 < rows; i0 += TRANSPOSE_TILE)
+		for (slong j0 = 0; j0 < cols; j0 += TRANSPOSE_TILE) {
+			slong i1 = FLINT_MIN(i0 + TRANSPOSE_TILE, rows);
+			slong j1 = FLINT_MIN(j0 + TRANSPOSE_TILE, cols);
+			for (slong i = i0; i < i1; i++)
+				for (slong j = j0; j < j1; j++)
+					scratch[j * rows + i] = coeffs[i * cols + j];
+		}
+
+	mp_ptr temp = coeffs;
+	coeffs = scratch;
+	scratch = temp;
+	x_major = !x_major;
+}
+
+void NmodTowerElement::reduce(const nmod_poly_t cyclo_mod) {
+	slong s = nmod_poly_degree(cyclo_mod);
+	if (z_len <= s) {
+		// pad with zero coefficients
+		if (s > z_alloc) {
+			flint_printf("Exception (NmodTowerElement::reduce). Too many coefficients.\n");
+			abort();
+		}
+		if (x_major) {
+			for (slong j = x_len - 1; j >= 0; j--) {
+				flint_mpn_copyd(coeffs + j * s, coeffs + j * z_len, z_len);
+				_nmod_vec_zero(coeffs + j * s + z_len, s - z_len);
+			}
+		} else
+			_nmod_vec_zero(coeffs + z_len * x_len, (s - z_len) * x_len);
+		z_len = s;
+		return;
+	}
+
+	mp_limb_t lead_inv = n_invmod(nmod_poly_get_coeff_ui(cyclo_mod, s), mod.n);
+
+	if (x_major) {
+		// each row is a polynomial in z
+		for (slong j = 0; j < x_len; j++)
+			_nmod_poly_rem(scratch + j * s, coeffs + j * z_len, z_len, cyclo_mod->coeffs, s + 1, mod);
+		mp_ptr temp = coeffs;
+		coeffs = scratch;
+		scratch = temp;
+	} else {
+		// eliminate the top rows, each against the whole modulus
+		for (slong i = z_len - 1; i >= s; i--) {
+			mp_ptr top = coeffs + i * x_len;
+			for (slong k = 0; k < s; k++) {
+				mp_limb_t coeff = nmod_poly_get_coeff_ui(cyclo_mod, k);
+				if (coeff != 0)
+					_nmod_vec_scalar_addmul_nmod(coeffs + (i - s + k) * x_len, top, x_len,
+							nmod_neg(nmod_mul(coeff, lead_inv, mod), mod), mod);
+			}
+		}
+	}
+	z_len = s;
+}
+
+void NmodTowerElement::mul_z_power(slong z_degree, const nmod_poly_t cyclo_mod) {
+	slong s = nmod_poly_degree(cyclo_mod);
+	if (z_len != s) {
+		flint_printf("Exception (NmodTowerElement::mul_z_power). Element not reduced.\n");
+		abort();
+	}
+
+	// z^{z_degree} mod cyclo_mod
+	nmod_poly_t z_pow;
+	nmod_poly_init(z_pow, mod.n);
+	nmod_poly_set_coeff_ui(z_pow, 1, 1);
+	nmod_poly_powmod_ui_binexp(z_pow, z_pow, z_degree, cyclo_mod);
+	if (z_pow->length == 0) {
+		nmod_poly_clear(z_pow);
+		zero();
+		return;
+	}
+
+	bool was_z_major = !x_major;
+	if (was_z_major)
+		transpose();
+
+	// each row is now a polynomial in z of length s
+	slong len = s + z_pow->length - 1;
+	mp_ptr product = _nmod_vec_init(len);
+	for (slong j = 0; j < x_len; j++) {
+		mp_ptr c = coeffs + j * s;
+		_nmod_poly_mul(product, c, s, z_pow->coeffs, z_pow->length, mod);
+		if (len > s)
+			_nmod_poly_rem(c, product, len, cyclo_mod->coeffs, s + 1, mod);
+		else
+			_nmod_vec_set(c, product, s);
+	}
+	_nmod_vec_clear(product);
+
+	if (was_z_major)
+		transpose();
+	nmod_poly_clear(z_pow);
+}
+
+void NmodTowerElement::add(const NmodTowerElement &other) {
+	if (other.z_len != z_len || other.x_len != x_len || other.x_major != x_major) {
+		flint_printf("Exception (NmodTowerElement::add). Shape mismatch.\n");
+		abort();
+	}
+	_nmod_vec_add(coeffs, coeffs, other.coeffs, z_len * x_len, mod);
+}
@@ -0,0 +1,92 @@
+/*
+ * nmod_tower_element.h
+ *
+ *  Dense elements of the tower F_p[x]/(f(x))[z], the ring where the
+ *  semi-traces of FFIsomPrimePower live, as one contiguous matrix of limbs
+ *  instead of an fq_nmod_poly_t with a separately allocated polynomial per
+ *  coefficient. The element $\sum_{i, j} c_{i, j} z^i x^j$ is stored with
+ *  $c_{i, j}$ at row i, column j ("z-major", each row a polynomial in x
+ *  of length x_len) or at row j, column i after {@code transpose}
+ *  ("x-major", each row a polynomial in z of length z_len).
+ */
+
+#ifndef NMOD_TOWER_ELEMENT_H_
+#define NMOD_TOWER_ELEMENT_H_
+
+#include <flint/nmod_poly.h>
+#include <flint/fq_nmod.h>
+#include <flint/fq_nmod_poly.h>
+
+class NmodTowerElement {
+    mp_ptr coeffs;
+    // scratch of the same size, for transpositions and products
+    mp_ptr scratch;
+    slong z_len;
+    slong z_alloc;
+    slong x_len;
+    bool x_major;
+    nmod_t mod;
+
+public:
+
+    /**
+     * A zero element with room for {@code z_alloc} coefficients in z,
+     * each a polynomial of length {@code x_len} in x. The z length is
+     * initially {@code z_alloc}.
+     */
+    NmodTowerElement(slong z_alloc, slong x_len, nmod_t mod);
+    ~NmodTowerElement();
+
+    NmodTowerElement(const NmodTowerElement &) = delete;
+    NmodTowerElement & operator=(const NmodTowerElement &) = delete;
+
+    slong get_z_len() const;
+    slong get_x_len() const;
+    bool is_x_major() const;
+
+    /**
+     * In z-major layout, the coefficient of z^i, x_len limbs; in x-major
+     * layout the coefficient of x^i, z_len limbs.
+     */
+    mp_ptr row(slong i);
+    mp_srcptr row(slong i) const;
+
+    void zero();
+
+    /**
+     * Copies {@code other}, layout included; the z length must fit.
+     */
+    void set(const NmodTowerElement &other);
+
+    /**
+     * Sets this element to {@code a}, in z-major layout; the z length
+     * becomes the length of {@code a}, which must fit. {@code ctx} must
+     * have degree x_len over the same prime.
+     */
+    void set(const fq_nmod_poly_t a, const fq_nmod_ctx_t ctx);
+    void get(fq_nmod_poly_t a, const fq_nmod_ctx_t ctx) const;
+
+    /**
+     * Switches between the z-major and x-major layouts.
+     */
+    void transpose();
+
+    /**
+     * Reduces modulo {@code cyclo_mod}(z), leaving a z length of its
+     * degree; works in both layouts.
+     */
+    void reduce(const nmod_poly_t cyclo_mod);
+
+    /**
+     * Multiplies by z^{z_degree} modulo {@code cyclo_mod}(z), for an element
+     * already reduced; the layout is kept.
+     */
+    void mul_z_power(slong z_degree, const nmod_poly_t cyclo_mod);
+
+    /**
+     * Adds {@code other}, which must have the same shape and layout.
+     */
+    void add(const NmodTowerElement &other);
+};
+
+#endif /* NMOD_TOWER_ELEMENT_H_ */
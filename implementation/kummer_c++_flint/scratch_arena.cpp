@@ -0,0 +1,118 @@
+/*
+ * scratch_arena.cpp
+ */
+
+#include "scratch_arena.h"
+
+#include <flint/nmod_vec.h>
+
+// sizes of the first blocks; later ones at least double
+static const slong POLY_BLOCK_SIZE = 64;
+static const slong LIMB_BLOCK_SIZE = 4096;
+
+ScratchArena::Frame::Frame(ScratchArena &arena) : arena(arena) {
+	poly_block = arena.poly_block;
+	poly_top = arena.poly_top;
+	limb_block = arena.limb_block;
+	limb_top = arena.limb_top;
+}
+
+ScratchArena::Frame::~Frame() {
+	arena.poly_block = poly_block;
+	arena.poly_top = poly_top;
+	arena.limb_block = limb_block;
+	arena.limb_top = limb_top;
+}
+
+ScratchArena::ScratchArena() {
+	poly_block = 0;
+	poly_top = 0;
+	limb_block = 0;
+	limb_top = 0;
+}
+
+ScratchArena::~ScratchArena() {
+	for (size_t i = 0; i < poly_blocks.size(); i++) {
+		for (slong j = 0; j < poly_blocks[i].alloc; j++)
+			nmod_poly_clear(poly_blocks[i].polys + j);
+		flint_free(poly_blocks[i].polys);
+	}
+	for (size_t i = 0; i < limb_blocks.size(); i++)
+		_nmod_vec_clear(limb_blocks[i].limbs);
+}
+
+/**
+ * Moves to the block after the current one, replacing it if it is too
+ * small for {@code len} polynomials; the blocks past the current one are
+ * unused, since frames are released in LIFO order.
+ */
+void ScratchArena::next_poly_block(slong len) {
+	slong next = poly_blocks.empty() ? 0 : poly_block + 1;
+	slong alloc = FLINT_MAX(len, poly_blocks.empty() ? POLY_BLOCK_SIZE : 2 * poly_blocks.back().alloc);
+
+	if (next < (slong) poly_blocks.size() && poly_blocks[next].alloc < len) {
+		for (slong j = 0; j < poly_blocks[next].alloc; j++)
+			nmod_poly_clear(poly_blocks[next].polys + j);
+		flint_free(poly_blocks[next].polys);
+		poly_blocks.erase(poly_blocks.begin() + next);
+	}
+
+	if (next >= (slong) poly_blocks.size() || poly_blocks[next].alloc < len) {
+		PolyBlock block;
+		block.alloc = alloc;
+		block.polys = (nmod_poly_struct *) flint_malloc(alloc * sizeof(nmod_poly_struct));
+		for (slong j = 0; j < alloc; j++)
+			nmod_poly_init(block.polys + j, 2);
+		poly_blocks.insert(poly_blocks.begin() + next, block);
+	}
+
+	poly_block = next;
+	poly_top = 0;
+}
+
+void ScratchArena::next_limb_block(slong len) {
+	slong next = limb_blocks.empty() ? 0 : limb_block + 1;
+	slong alloc = FLINT_MAX(len, limb_blocks.empty() ? LIMB_BLOCK_SIZE : 2 * limb_blocks.back().alloc);
+
+	if (next < (slong) limb_blocks.size() && limb_blocks[next].alloc < len) {
+		_nmod_vec_clear(limb_blocks[next].limbs);
+		limb_blocks.erase(limb_blocks.begin() + next);
+	}
+
+	if (next >= (slong) limb_blocks.size() || limb_blocks[next].alloc < len) {
+		LimbBlock block;
+		block.alloc = alloc;
+		block.limbs = _nmod_vec_init(alloc);
+		limb_blocks.insert(limb_blocks.begin() + next, block);
+	}
+
+	limb_block = next;
+	limb_top = 0;
+}
+
+nmod_poly_struct * ScratchArena::nmod_poly_vec(slong len, nmod_t mod) {
+	if (poly_blocks.empty() || poly_top + len > poly_blocks[poly_block].alloc)
+		next_poly_block(len);
+
+	nmod_poly_struct *res = poly_blocks[poly_block].polys + poly_top;
+	poly_top += len;
+
+	for (slong i = 0; i < len; i++) {
+		res[i].mod = mod;
+		res[i].length = 0;
+	}
+	return res;
+}
+
+fq_nmod_struct * ScratchArena::fq_nmod_vec(slong len, const fq_nmod_ctx_t ctx) {
+	return nmod_poly_vec(len, ctx->mod);
+}
+
+mp_ptr ScratchArena::limbs(slong len) {
+	if (limb_blocks.empty() || limb_top + len > limb_blocks[limb_block].alloc)
+		next_limb_block(len);
+
+	mp_ptr res = limb_blocks[limb_block].limbs + limb_top;
+	limb_top += len;
+	return res;
+}
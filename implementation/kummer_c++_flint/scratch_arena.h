@@ -0,0 +1,88 @@
+/*
+ * scratch_arena.h
+ *
+ *  A per-computation pool of scratch polynomials and limbs. Vectors of
+ *  polynomials handed out by the arena live on the heap instead of in
+ *  variable length arrays on the stack, and are returned in LIFO order
+ *  through {@code Frame}: the polynomials keep their coefficient storage
+ *  when returned, so that a routine called repeatedly (a recursion, or the
+ *  random retries of a semi-trace) reuses it instead of reallocating.
+ */
+
+#ifndef SCRATCH_ARENA_H_
+#define SCRATCH_ARENA_H_
+
+#include <flint/nmod_poly.h>
+#include <flint/fq_nmod.h>
+
+#include <vector>
+
+class ScratchArena {
+
+    struct PolyBlock {
+        nmod_poly_struct *polys;
+        slong alloc;
+    };
+
+    struct LimbBlock {
+        mp_ptr limbs;
+        slong alloc;
+    };
+
+    std::vector<PolyBlock> poly_blocks;
+    slong poly_block;
+    slong poly_top;
+
+    std::vector<LimbBlock> limb_blocks;
+    slong limb_block;
+    slong limb_top;
+
+    void next_poly_block(slong len);
+    void next_limb_block(slong len);
+
+public:
+
+    /**
+     * Marks the state of an arena; everything handed out after the mark is
+     * returned when the frame goes out of scope.
+     */
+    class Frame {
+        ScratchArena &arena;
+        slong poly_block;
+        slong poly_top;
+        slong limb_block;
+        slong limb_top;
+
+    public:
+        Frame(ScratchArena &arena);
+        ~Frame();
+
+        Frame(const Frame &) = delete;
+        Frame & operator=(const Frame &) = delete;
+    };
+
+    ScratchArena();
+    ~ScratchArena();
+
+    ScratchArena(const ScratchArena &) = delete;
+    ScratchArena & operator=(const ScratchArena &) = delete;
+
+    /**
+     * {@code len} contiguous zero polynomials modulo {@code mod.n}. They must
+     * not be cleared by the caller.
+     */
+    nmod_poly_struct * nmod_poly_vec(slong len, nmod_t mod);
+
+    /**
+     * {@code len} contiguous zero elements of {@code ctx}. They must not be
+     * cleared by the caller.
+     */
+    fq_nmod_struct * fq_nmod_vec(slong len, const fq_nmod_ctx_t ctx);
+
+    /**
+     * {@code len} contiguous limbs, uninitialized.
+     */
+    mp_ptr limbs(slong len);
+};
+
+#endif /* SCRATCH_ARENA_H_ */
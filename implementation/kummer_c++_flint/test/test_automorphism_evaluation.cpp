@@ -85,6 +85,17 @@ void test_automorphism_evaluate(mp_limb_t p, slong aut_degree, slong ext_degree)
   if (!nmod_poly_is_zero(res1))
     cout << "oops\n";
 
+  // prepared once for f, then applied to several g, also in place
+  Nmod_poly_automorphism_evaluation prepared;
+  prepared.prepare(A->length, f, finv);
+  for (slong i = 0; i < 3; i++) {
+    nmod_poly_rand_dense(g, state, ext_degree);
+    eval.compose(res2, A, g, f, finv);
+    prepared.apply(res1, A, g);
+    prepared.apply(g, A, g);
+    if (!nmod_poly_equal(res1, res2) || !nmod_poly_equal(g, res2))
+      cout << "oops\n";
+  }
   
   nmod_poly_clear(res1);
   nmod_poly_clear(res2);
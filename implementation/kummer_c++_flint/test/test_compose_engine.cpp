@@ -0,0 +1,72 @@
+#include <iostream>
+#include <flint/nmod_poly.h>
+#include "nmod_poly_compose_engine.h"
+#include "thread_pool.h"
+
+using namespace std;
+
+/*------------------------------------------------------------------------*/
+/* every engine, and the rectangular one on a pool, against FLINT         */
+/*------------------------------------------------------------------------*/
+void test_compose_engine(mp_limb_t p, slong degree, slong len_a) {
+  cout << "p: " << p << ", degree: " << degree << ", len: " << len_a << "\n";
+
+  flint_rand_t state;
+  flint_randinit(state);
+
+  nmod_poly_t f, a, b, expected, res;
+  nmod_poly_init(f, p);
+  nmod_poly_init(a, p);
+  nmod_poly_init(b, p);
+  nmod_poly_init(expected, p);
+  nmod_poly_init(res, p);
+  nmod_poly_randtest_monic(f, state, degree + 1);
+  nmod_poly_randtest(a, state, len_a);
+  nmod_poly_randtest(b, state, degree + 3);
+  nmod_poly_compose_mod(expected, a, b, f);
+
+  bool ok = true;
+  for (slong engine = COMPOSE_ENGINE_AUTO; engine <= COMPOSE_ENGINE_RECTANGULAR; engine++) {
+    NmodComposeEngine::compose_mod(res, a, b, f, engine);
+    ok = ok && nmod_poly_equal(res, expected);
+  }
+
+  ThreadPool pool(3);
+  NmodComposeEngine::compose_mod_rectangular(res, a, b, f, pool);
+  ok = ok && nmod_poly_equal(res, expected);
+
+  // in place
+  nmod_poly_set(res, a);
+  NmodComposeEngine::compose_mod(res, res, b, f, COMPOSE_ENGINE_RECTANGULAR);
+  ok = ok && nmod_poly_equal(res, expected);
+
+  if (ok)
+    cout << "ok\n";
+  else
+    cout << "ooops\n";
+
+  nmod_poly_clear(f);
+  nmod_poly_clear(a);
+  nmod_poly_clear(b);
+  nmod_poly_clear(expected);
+  nmod_poly_clear(res);
+  flint_randclear(state);
+}
+
+int main() {
+  if (NmodComposeEngine::parse_engine("rectangular") != COMPOSE_ENGINE_RECTANGULAR
+      || NmodComposeEngine::parse_engine("nusken") != -1)
+    cout << "ooops\n";
+
+  test_compose_engine(2, 100, 80);
+  test_compose_engine(3, 1, 1);
+  test_compose_engine(n_nextprime(1 << 20, 1), 2, 2);
+  test_compose_engine(n_nextprime(1 << 20, 1), 150, 150);
+  test_compose_engine(n_nextprime(1 << 20, 1), 150, 7);
+  test_compose_engine(n_nextprime(UWORD(1) << 62, 1), 300, 200);
+
+  NmodComposeEngine::set_num_threads(4);
+  test_compose_engine(n_nextprime(1 << 20, 1), 500, 500);
+
+  return 0;
+}
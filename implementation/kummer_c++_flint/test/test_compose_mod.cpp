@@ -0,0 +1,151 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <flint/nmod_poly.h>
+#include "nmod_poly_compose_mod.h"
+#include "thread_pool.h"
+
+using namespace std;
+
+/*------------------------------------------------------------------------*/
+/* checks res[i] = polys[i](g) mod f against FLINT                        */
+/*------------------------------------------------------------------------*/
+bool check_compose(const nmod_poly_struct * res, const nmod_poly_struct * polys, slong len,
+		   const nmod_poly_t g, const nmod_poly_t f) {
+  nmod_poly_t temp;
+  nmod_poly_init(temp, f->mod.n);
+  bool ok = true;
+  for (slong i = 0; i < len; i++) {
+    nmod_poly_compose_mod(temp, polys + i, g, f);
+    if (!nmod_poly_equal(temp, res + i))
+      ok = false;
+  }
+  nmod_poly_clear(temp);
+  return ok;
+}
+
+/*------------------------------------------------------------------------*/
+/* prepares, re-prepares, moves and shares one composition object         */
+/*------------------------------------------------------------------------*/
+void test_compose_mod(mp_limb_t p, slong degree, slong len) {
+  cout << "p: " << p << ", degree: " << degree << ", len: " << len << "\n";
+
+  flint_rand_t state;
+  flint_randinit(state);
+
+  nmod_poly_t f, finv, g1, g2;
+  nmod_poly_init(f, p);
+  nmod_poly_init(finv, p);
+  nmod_poly_init(g1, p);
+  nmod_poly_init(g2, p);
+  nmod_poly_randtest_monic(f, state, degree + 1);
+  nmod_poly_reverse(finv, f, f->length);
+  nmod_poly_inv_series(finv, finv, f->length);
+  nmod_poly_randtest(g1, state, degree);
+  nmod_poly_randtest(g2, state, degree);
+
+  nmod_poly_struct * polys = (nmod_poly_struct *) flint_malloc(len * sizeof(nmod_poly_struct));
+  nmod_poly_struct * res = (nmod_poly_struct *) flint_malloc(len * sizeof(nmod_poly_struct));
+  for (slong i = 0; i < len; i++) {
+    nmod_poly_init(polys + i, p);
+    nmod_poly_init(res + i, p);
+    nmod_poly_randtest(polys + i, state, degree);
+  }
+
+  bool ok = true;
+  Nmod_poly_compose_mod::Workspace workspace;
+
+  Nmod_poly_compose_mod compose(g1, f, finv, n_sqrt(degree * len) + 1);
+  compose.apply(res, polys, len, workspace);
+  ok = ok && check_compose(res, polys, len, g1, f);
+
+  // same sizes: the buffers of the first preparation are reused
+  compose.prepare(g2, f, finv, n_sqrt(degree * len) + 1);
+  compose.apply(res, polys, len, workspace);
+  ok = ok && check_compose(res, polys, len, g2, f);
+
+  // different number of baby steps, and a workspace that has to shrink
+  compose.prepare(g1, f, finv, 2);
+  compose.apply(res, polys, 1, workspace);
+  ok = ok && check_compose(res, polys, 1, g1, f);
+
+  // moved-to object keeps the preparation
+  Nmod_poly_compose_mod moved(std::move(compose));
+  ok = ok && moved.is_prepared() && !compose.is_prepared();
+  moved.apply(res, polys, len, workspace);
+  ok = ok && check_compose(res, polys, len, g1, f);
+
+  // one prepared object, several threads with their own workspaces
+  vector<thread> threads;
+  vector<int> thread_ok(4, 0);
+  for (slong t = 0; t < 4; t++)
+    threads.push_back(thread([&moved, &thread_ok, polys, len, g1, f, t, p] {
+      Nmod_poly_compose_mod::Workspace local;
+      nmod_poly_struct * out = (nmod_poly_struct *) flint_malloc(len * sizeof(nmod_poly_struct));
+      for (slong i = 0; i < len; i++)
+        nmod_poly_init(out + i, p);
+      moved.apply(out, polys, len, local);
+      thread_ok[t] = check_compose(out, polys, len, g1, f);
+      for (slong i = 0; i < len; i++)
+        nmod_poly_clear(out + i);
+      flint_free(out);
+      flint_cleanup();
+    }));
+  for (slong t = 0; t < 4; t++) {
+    threads[t].join();
+    ok = ok && thread_ok[t];
+  }
+
+  // dense rows, in place, on a pool of three threads
+  ThreadPool pool(3);
+  Nmod_poly_compose_mod::Workspace pool_workspaces[3];
+  mp_ptr * rows = (mp_ptr *) flint_malloc(len * sizeof(mp_ptr));
+  for (slong i = 0; i < len; i++) {
+    rows[i] = _nmod_vec_init(degree);
+    _nmod_vec_zero(rows[i], degree);
+    _nmod_vec_set(rows[i], (polys + i)->coeffs, (polys + i)->length);
+  }
+  moved.apply(rows, rows, len, pool_workspaces, pool);
+  for (slong i = 0; i < len; i++) {
+    nmod_poly_fit_length(res + i, degree);
+    _nmod_vec_set((res + i)->coeffs, rows[i], degree);
+    _nmod_poly_set_length(res + i, degree);
+    _nmod_poly_normalise(res + i);
+    _nmod_vec_clear(rows[i]);
+  }
+  flint_free(rows);
+  ok = ok && check_compose(res, polys, len, g1, f);
+
+  // in place
+  nmod_poly_set(res, polys);
+  moved.apply(res, res, workspace);
+  ok = ok && check_compose(res, polys, 1, g1, f);
+
+  if (ok)
+    cout << "ok\n";
+  else
+    cout << "oops\n";
+
+  for (slong i = 0; i < len; i++) {
+    nmod_poly_clear(polys + i);
+    nmod_poly_clear(res + i);
+  }
+  flint_free(polys);
+  flint_free(res);
+  nmod_poly_clear(f);
+  nmod_poly_clear(finv);
+  nmod_poly_clear(g1);
+  nmod_poly_clear(g2);
+  flint_randclear(state);
+}
+
+int main() {
+  for (ulong p = n_nextprime(6, 0); p < 1000; p = n_nextprime(p+100, 0)) {
+    for (slong degree = 2; degree < 200; degree += 37) {
+      test_compose_mod(p, degree, 1);
+      test_compose_mod(p, degree, 7);
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,147 @@
+#include "cyclotomic_context.h"
+#include "ff_isom_prime_power_ext.h"
+#include "nmod_cyclotomic_poly.h"
+#include "nmod_min_poly.h"
+#include "util.h"
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <flint/profiler.h>
+
+using namespace std;
+
+/**
+ * Checks the contexts of (p, r), and that the cache returns one context
+ * per (p, r), also to concurrent callers.
+ */
+void test_context(slong r, slong characteristic) {
+
+	cout << "characteristic: " << characteristic << "\n";
+	cout << "r: " << r << "\n";
+
+	mp_limb_t p = characteristic;
+	Util util;
+	NModCyclotomicPoly nModCyclotomicPoly;
+	bool ok = true;
+
+	timeit_t time;
+	timeit_start(time);
+	shared_ptr<const CyclotomicContext> context = CyclotomicContext::get(r, p);
+	timeit_stop(time);
+	cout << "build time: " << (double) time->wall / 1000.0 << "\n";
+
+	slong degree = util.compute_multiplicative_order(p, r);
+	ok = ok && context->get_degree() == degree && context->get_r() == r && context->get_p() == p;
+	ok = ok && nmod_poly_degree(context->get_modulus()) == degree;
+
+	// the modulus divides the r-th cyclotomic polynomial
+	nmod_poly_t cyclo_poly, temp;
+	nmod_poly_init(cyclo_poly, p);
+	nmod_poly_init(temp, p);
+	nModCyclotomicPoly.construct_cyclo(cyclo_poly, r);
+	nmod_poly_rem(temp, cyclo_poly, context->get_modulus());
+	ok = ok && nmod_poly_is_zero(temp);
+
+	if (degree == 1)
+		ok = ok && n_powmod(context->get_root(), r, p) == 1;
+	else
+		ok = ok && fq_nmod_ctx_degree(context->get_ctx()) == degree;
+
+	vector<thread> threads;
+	vector<const CyclotomicContext *> seen(4, NULL);
+	for (slong t = 0; t < 4; t++)
+		threads.push_back(thread([&seen, t, r, p] {
+			seen[t] = CyclotomicContext::get(r, p).get();
+			flint_cleanup();
+		}));
+	for (slong t = 0; t < 4; t++) {
+		threads[t].join();
+		ok = ok && seen[t] == context.get();
+	}
+
+	// a cleared cache builds a new context, the old one stays valid
+	CyclotomicContext::clear_cache();
+	ok = ok && CyclotomicContext::get(r, p).get() != context.get();
+	ok = ok && nmod_poly_degree(context->get_modulus()) == degree;
+
+	cout << "testing the cyclotomic context... ";
+	if (ok)
+		cout << "ok\n";
+	else
+		cout << "ooops\n";
+
+	nmod_poly_clear(cyclo_poly);
+	nmod_poly_clear(temp);
+}
+
+/**
+ * Computes isomorphisms between pairs of random fields of degree r, all
+ * sharing one context, and checks that the generators have the same
+ * minimal polynomial.
+ */
+void test_shared(slong r, slong characteristic, slong num) {
+
+	cout << "characteristic: " << characteristic << "\n";
+	cout << "extension degree: " << r << "\n";
+
+	mp_limb_t p = characteristic;
+
+	flint_rand_t state;
+	flint_randinit(state);
+
+	nmod_poly_t f1, f2, g1, g2, min_poly1, min_poly2;
+	nmod_poly_init(f1, p);
+	nmod_poly_init(f2, p);
+	nmod_poly_init(g1, p);
+	nmod_poly_init(g2, p);
+	nmod_poly_init(min_poly1, p);
+	nmod_poly_init(min_poly2, p);
+
+	shared_ptr<const CyclotomicContext> context = make_shared<CyclotomicContext>(r, p);
+	NmodMinPoly nmodMinPoly;
+	bool ok = true;
+
+	timeit_t time;
+	timeit_start(time);
+	for (slong i = 0; i < num; i++) {
+		nmod_poly_randtest_monic_irreducible(f1, state, r + 1);
+		nmod_poly_randtest_monic_irreducible(f2, state, r + 1);
+
+		FFIsomPrimePower ffIsomPrimePower(f1, f2, FORCE_NONE, 0, 1, context);
+		ffIsomPrimePower.compute_generators(g1, g2);
+
+		nmodMinPoly.minimal_polynomial(min_poly1, g1, f1);
+		nmodMinPoly.minimal_polynomial(min_poly2, g2, f2);
+		ok = ok && nmod_poly_degree(min_poly1) == r && nmod_poly_equal(min_poly1, min_poly2);
+	}
+	timeit_stop(time);
+	cout << "isomorphisms time: " << (double) time->wall / 1000.0 << "\n";
+	ok = ok && context.use_count() == 1;
+
+	cout << "testing shared contexts... ";
+	if (ok)
+		cout << "ok\n";
+	else
+		cout << "ooops\n";
+
+	flint_randclear(state);
+	nmod_poly_clear(f1);
+	nmod_poly_clear(f2);
+	nmod_poly_clear(g1);
+	nmod_poly_clear(g2);
+	nmod_poly_clear(min_poly1);
+	nmod_poly_clear(min_poly2);
+}
+
+int main() {
+
+	test_context(5, 11);
+	test_context(7, 13);
+	test_context(25, n_nth_prime(60));
+
+	test_shared(5, 11, 50);
+	test_shared(9, n_nth_prime(40), 50);
+	test_shared(13, n_nth_prime(50), 20);
+
+	return 0;
+}
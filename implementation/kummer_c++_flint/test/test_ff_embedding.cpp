@@ -62,6 +62,215 @@ void test_build_embedding(slong m, slong n, slong characteristic) {
 	nmod_poly_clear(temp);
 }
 
+/**
+ * The parallel computation of the generators must give the same result as 
+ * the sequential one.
+ */
+void test_parallel_generators(slong m, slong n, slong characteristic, slong num_threads) {
+
+	cout << "characteristic: " << characteristic << "\n";
+	cout << "extension degrees: " << m << ", " << n << "\n";
+	cout << "threads: " << num_threads << "\n";
+
+	mp_limb_t p = characteristic;
+
+	flint_rand_t state;
+	flint_randinit(state);
+
+	nmod_poly_t f1, f2, g1, g2, h1, h2;
+	nmod_poly_init(f1, p);
+	nmod_poly_init(f2, p);
+	nmod_poly_init(g1, p);
+	nmod_poly_init(g2, p);
+	nmod_poly_init(h1, p);
+	nmod_poly_init(h2, p);
+
+	nmod_poly_randtest_monic_irreducible(f1, state, m + 1);
+	nmod_poly_randtest_monic_irreducible(f2, state, n + 1);
+
+	timeit_t time;
+	timeit_start(time);
+	FFEmbedding sequential(f1, f2);
+	sequential.compute_generators(g1, g2);
+	timeit_stop(time);
+	cout << "sequential time: " << (double) time->wall / 1000.0 << "\n";
+
+	timeit_start(time);
+	FFEmbedding parallel(f1, f2, FORCE_NONE, 0, num_threads);
+	parallel.compute_generators(h1, h2);
+	timeit_stop(time);
+	cout << "parallel time: " << (double) time->wall / 1000.0 << "\n";
+
+	cout << "testing the generators... ";
+	if (nmod_poly_equal(g1, h1) && nmod_poly_equal(g2, h2))
+		cout << "ok\n";
+	else
+		cout << "ooops\n";
+
+	flint_randclear(state);
+	nmod_poly_clear(f1);
+	nmod_poly_clear(f2);
+	nmod_poly_clear(g1);
+	nmod_poly_clear(g2);
+	nmod_poly_clear(h1);
+	nmod_poly_clear(h2);
+}
+
+/**
+ * The batched images must agree with compute_image. {@code num} is chosen
+ * larger than one block.
+ */
+void test_compute_images(slong m, slong n, slong characteristic, slong num) {
+
+	cout << "characteristic: " << characteristic << "\n";
+	cout << "extension degrees: " << m << ", " << n << "\n";
+	cout << "elements: " << num << "\n";
+
+	mp_limb_t p = characteristic;
+
+	flint_rand_t state;
+	flint_randinit(state);
+
+	nmod_poly_t f1, f2, g1, g2, temp;
+	nmod_poly_init(f1, p);
+	nmod_poly_init(f2, p);
+	nmod_poly_init(g1, p);
+	nmod_poly_init(g2, p);
+	nmod_poly_init(temp, p);
+
+	nmod_poly_randtest_monic_irreducible(f1, state, m + 1);
+	nmod_poly_randtest_monic_irreducible(f2, state, n + 1);
+
+	FFEmbedding ffEmbedding(f1, f2);
+	ffEmbedding.compute_generators(g1, g2);
+	ffEmbedding.build_embedding(g1, g2);
+
+	nmod_poly_struct *elements = (nmod_poly_struct *) flint_malloc(num * sizeof(nmod_poly_struct));
+	nmod_poly_struct *images = (nmod_poly_struct *) flint_malloc(num * sizeof(nmod_poly_struct));
+	for (slong i = 0; i < num; i++) {
+		nmod_poly_init(elements + i, p);
+		nmod_poly_init(images + i, p);
+		nmod_poly_randtest(elements + i, state, m);
+	}
+
+	timeit_t time;
+	timeit_start(time);
+	ffEmbedding.compute_images(images, elements, num);
+	timeit_stop(time);
+	cout << "batch time: " << (double) time->wall / 1000.0 << "\n";
+
+	bool ok = true;
+	timeit_start(time);
+	for (slong i = 0; i < num; i++) {
+		ffEmbedding.compute_image(temp, elements + i);
+		if (!nmod_poly_equal(temp, images + i))
+			ok = false;
+	}
+	timeit_stop(time);
+	cout << "one by one time: " << (double) time->wall / 1000.0 << "\n";
+
+	// in place, and with the composition already prepared
+	ffEmbedding.compute_images(elements, elements, num);
+	for (slong i = 0; i < num; i++)
+		if (!nmod_poly_equal(elements + i, images + i))
+			ok = false;
+
+	cout << "testing the images... ";
+	if (ok)
+		cout << "ok\n";
+	else
+		cout << "ooops\n";
+
+	for (slong i = 0; i < num; i++) {
+		nmod_poly_clear(elements + i);
+		nmod_poly_clear(images + i);
+	}
+	flint_free(elements);
+	flint_free(images);
+	flint_randclear(state);
+	nmod_poly_clear(f1);
+	nmod_poly_clear(f2);
+	nmod_poly_clear(g1);
+	nmod_poly_clear(g2);
+	nmod_poly_clear(temp);
+}
+
+/**
+ * Mapping random elements of k to K and back must give the elements back.
+ */
+void test_compute_preimages(slong m, slong n, slong characteristic, slong num) {
+
+	cout << "characteristic: " << characteristic << "\n";
+	cout << "extension degrees: " << m << ", " << n << "\n";
+	cout << "elements: " << num << "\n";
+
+	mp_limb_t p = characteristic;
+
+	flint_rand_t state;
+	flint_randinit(state);
+
+	nmod_poly_t f1, f2, g1, g2, temp;
+	nmod_poly_init(f1, p);
+	nmod_poly_init(f2, p);
+	nmod_poly_init(g1, p);
+	nmod_poly_init(g2, p);
+	nmod_poly_init(temp, p);
+
+	nmod_poly_randtest_monic_irreducible(f1, state, m + 1);
+	nmod_poly_randtest_monic_irreducible(f2, state, n + 1);
+
+	FFEmbedding ffEmbedding(f1, f2);
+	ffEmbedding.compute_generators(g1, g2);
+	ffEmbedding.build_embedding(g1, g2);
+
+	nmod_poly_struct *elements = (nmod_poly_struct *) flint_malloc(num * sizeof(nmod_poly_struct));
+	nmod_poly_struct *images = (nmod_poly_struct *) flint_malloc(num * sizeof(nmod_poly_struct));
+	for (slong i = 0; i < num; i++) {
+		nmod_poly_init(elements + i, p);
+		nmod_poly_init(images + i, p);
+		nmod_poly_randtest(elements + i, state, m);
+	}
+	ffEmbedding.compute_images(images, elements, num);
+
+	timeit_t time;
+	timeit_start(time);
+	ffEmbedding.compute_preimages(images, images, num);
+	timeit_stop(time);
+	cout << "preimage time: " << (double) time->wall / 1000.0 << "\n";
+
+	bool ok = true;
+	for (slong i = 0; i < num; i++)
+		if (!nmod_poly_equal(elements + i, images + i))
+			ok = false;
+
+	// the image of x comes back to x
+	ffEmbedding.get_x_image(temp);
+	ffEmbedding.compute_preimage(temp, temp);
+	nmod_poly_zero(g1);
+	nmod_poly_set_coeff_ui(g1, 1, 1);
+	if (m > 1 && !nmod_poly_equal(temp, g1))
+		ok = false;
+
+	cout << "testing the preimages... ";
+	if (ok)
+		cout << "ok\n";
+	else
+		cout << "ooops\n";
+
+	for (slong i = 0; i < num; i++) {
+		nmod_poly_clear(elements + i);
+		nmod_poly_clear(images + i);
+	}
+	flint_free(elements);
+	flint_free(images);
+	flint_randclear(state);
+	nmod_poly_clear(f1);
+	nmod_poly_clear(f2);
+	nmod_poly_clear(g1);
+	nmod_poly_clear(g2);
+	nmod_poly_clear(temp);
+}
+
 int main() {
 
 	flint_rand_t state;
@@ -74,6 +283,25 @@ int main() {
 		test_build_embedding(m, n, p);
 	}
 
+	// characteristic 2: Artin-Schreier towers and packed compositions
+	test_build_embedding(8, 32, 2);
+	test_build_embedding(16, 64, 2);
+	test_build_embedding(12, 36, 2);
+
+	// degrees with several prime power factors
+	test_parallel_generators(60, 60, n_nth_prime(70), 4);
+	test_parallel_generators(30, 210, n_nth_prime(80), 4);
+	// a single prime power: only the two semi-traces run concurrently
+	test_parallel_generators(49, 98, n_nth_prime(60), 2);
+	test_parallel_generators(125, 125, n_nth_prime(90), 2);
+
+	test_compute_images(12, 36, n_nth_prime(60), 600);
+	test_compute_images(30, 60, n_nth_prime(75), 1000);
+
+	test_compute_preimages(12, 36, n_nth_prime(60), 100);
+	test_compute_preimages(25, 100, n_nth_prime(65), 100);
+	test_compute_preimages(7, 7, n_nth_prime(20), 10);
+
 	flint_randclear(state);
 
 	return 0;
@@ -0,0 +1,164 @@
+#include "ff_embedding.h"
+#include "ff_embedding_file.h"
+#include <iostream>
+#include <stdio.h>
+#include <flint/profiler.h>
+
+using namespace std;
+
+/**
+ * Saves an embedding, loads it back with and without mmap and compares the
+ * image of x, the generators and the preimages; then checks that a file
+ * with a flipped byte is rejected.
+ */
+void test_save_load(slong m, slong n, slong characteristic) {
+
+	cout << "characteristic: " << characteristic << "\n";
+	cout << "extension degrees: " << m << ", " << n << "\n";
+
+	mp_limb_t p = characteristic;
+	const char *filename = "test_ff_embedding_file.bin";
+
+	flint_rand_t state;
+	flint_randinit(state);
+
+	nmod_poly_t f1, f2, g1, g2, h1, h2, x_image, temp, a, b;
+	nmod_poly_init(f1, p);
+	nmod_poly_init(f2, p);
+	nmod_poly_init(g1, p);
+	nmod_poly_init(g2, p);
+	nmod_poly_init(h1, p);
+	nmod_poly_init(h2, p);
+	nmod_poly_init(x_image, p);
+	nmod_poly_init(temp, p);
+	nmod_poly_init(a, p);
+	nmod_poly_init(b, p);
+
+	nmod_poly_randtest_monic_irreducible(f1, state, m + 1);
+	nmod_poly_randtest_monic_irreducible(f2, state, n + 1);
+
+	timeit_t time;
+	timeit_start(time);
+	FFEmbedding ffEmbedding(f1, f2);
+	ffEmbedding.compute_generators(g1, g2);
+	ffEmbedding.build_embedding(g1, g2);
+	timeit_stop(time);
+	cout << "build time: " << (double) time->wall / 1000.0 << "\n";
+	ffEmbedding.get_x_image(x_image);
+
+	nmod_poly_randtest(a, state, m);
+	ffEmbedding.compute_image(b, a);
+
+	bool ok = ffEmbedding.save(filename, true);
+
+	for (int use_mmap = 0; use_mmap < 2 && ok; use_mmap++) {
+		timeit_start(time);
+		FFEmbedding *loaded = FFEmbedding::load(filename, use_mmap);
+		timeit_stop(time);
+		cout << "load time" << (use_mmap ? " (mmap): " : ": ") << (double) time->wall / 1000.0 << "\n";
+		if (loaded == NULL) {
+			ok = false;
+			break;
+		}
+
+		loaded->get_x_image(temp);
+		ok = ok && nmod_poly_equal(temp, x_image);
+
+		loaded->compute_generators(h1, h2);
+		ok = ok && nmod_poly_equal(h1, g1) && nmod_poly_equal(h2, g2);
+
+		loaded->compute_image(temp, a);
+		ok = ok && nmod_poly_equal(temp, b);
+		loaded->compute_preimage(temp, b);
+		ok = ok && nmod_poly_equal(temp, a);
+
+		// modifying a mapped embedding copies its data first
+		loaded->build_embedding(h1, h2);
+		loaded->get_x_image(temp);
+		ok = ok && nmod_poly_equal(temp, x_image);
+
+		delete loaded;
+	}
+
+	// flip one byte of the payload
+	FILE *file = fopen(filename, "r+b");
+	if (file != NULL) {
+		fseek(file, -16, SEEK_END);
+		int c = fgetc(file);
+		fseek(file, -16, SEEK_END);
+		fputc(c ^ 1, file);
+		fclose(file);
+	}
+	ok = ok && FFEmbedding::load(filename) == NULL && FFEmbedding::load(filename, false) == NULL;
+	ok = ok && FFEmbedding::load("no_such_file.bin") == NULL;
+	remove(filename);
+
+	cout << "testing save and load... ";
+	if (ok)
+		cout << "ok\n";
+	else
+		cout << "ooops\n";
+
+	flint_randclear(state);
+	nmod_poly_clear(f1);
+	nmod_poly_clear(f2);
+	nmod_poly_clear(g1);
+	nmod_poly_clear(g2);
+	nmod_poly_clear(h1);
+	nmod_poly_clear(h2);
+	nmod_poly_clear(x_image);
+	nmod_poly_clear(temp);
+	nmod_poly_clear(a);
+	nmod_poly_clear(b);
+}
+
+/**
+ * Files with a valid checksum but an inconsistent content are rejected.
+ */
+void test_invalid() {
+	const char *filename = "test_ff_embedding_file.bin";
+	mp_limb_t p = 101;
+	// x^2 + 1 | x^4 + 1 over F_101, x --> x^2
+	mp_limb_t f1[] = {1, 0, 1};
+	mp_limb_t f2[] = {1, 0, 0, 0, 1};
+	mp_limb_t x_image[] = {0, 0, 1};
+	mp_limb_t gen[] = {3, 4};
+	mp_limb_t large[] = {0, 0, 101};
+	mp_limb_t not_monic[] = {1, 0, 0, 0, 2};
+	bool ok = true;
+
+	for (int c = 0; c < 5; c++) {
+		FFEmbeddingFile file;
+		file.add_section(FF_EMBEDDING_SECTION_MODULUS1, 0, f1, 3);
+		file.add_section(FF_EMBEDDING_SECTION_MODULUS2, 0, c == 1 ? not_monic : f2, 5);
+		file.add_section(FF_EMBEDDING_SECTION_X_IMAGE, 0, c == 2 ? large : x_image, 3);
+		file.add_section(FF_EMBEDDING_SECTION_GENERATOR1, 2, gen, 2);
+		if (c != 3)
+			file.add_section(FF_EMBEDDING_SECTION_GENERATOR2, 2, gen, 2);
+		if (c == 4)
+			file.add_section(FF_EMBEDDING_SECTION_GENERATOR1, 3, gen, 2);
+		file.write(filename, p);
+
+		FFEmbedding *loaded = FFEmbedding::load(filename, false);
+		// only the first file is consistent
+		ok = ok && (c == 0) == (loaded != NULL);
+		delete loaded;
+	}
+	remove(filename);
+
+	cout << "testing invalid files... ";
+	if (ok)
+		cout << "ok\n";
+	else
+		cout << "ooops\n";
+}
+
+int main() {
+
+	test_invalid();
+
+	test_save_load(12, 36, n_nth_prime(60));
+	test_save_load(30, 60, n_nth_prime(75));
+
+	return 0;
+}
@@ -0,0 +1,114 @@
+#include "ff_embedding_lattice.h"
+#include <iostream>
+#include <flint/profiler.h>
+
+using namespace std;
+
+/**
+ * The image of x must be a root of f1 modulo f2.
+ */
+bool is_embedding(const nmod_poly_t x_image, const nmod_poly_t f1, const nmod_poly_t f2) {
+	nmod_poly_t temp;
+	nmod_poly_init(temp, f1->mod.n);
+	nmod_poly_compose_mod(temp, f1, x_image, f2);
+	bool ok = nmod_poly_is_zero(temp);
+	nmod_poly_clear(temp);
+	return ok;
+}
+
+/**
+ * Adds fields of the given degrees and checks that every embedding is one,
+ * and that the embeddings commute: k --> K --> L is k --> L.
+ */
+void test_lattice(const slong *degrees, slong num, slong characteristic) {
+
+	cout << "characteristic: " << characteristic << "\n";
+	cout << "extension degrees:";
+	for (slong i = 0; i < num; i++)
+		cout << " " << degrees[i];
+	cout << "\n";
+
+	mp_limb_t p = characteristic;
+
+	flint_rand_t state;
+	flint_randinit(state);
+
+	nmod_poly_struct *moduli = (nmod_poly_struct *) flint_malloc(num * sizeof(nmod_poly_struct));
+	nmod_poly_t x_image, inner, outer, temp;
+	nmod_poly_init(x_image, p);
+	nmod_poly_init(inner, p);
+	nmod_poly_init(outer, p);
+	nmod_poly_init(temp, p);
+
+	FFEmbeddingLattice lattice(p);
+	bool ok = true;
+
+	for (slong i = 0; i < num; i++) {
+		nmod_poly_init(moduli + i, p);
+		nmod_poly_randtest_monic_irreducible(moduli + i, state, degrees[i] + 1);
+		ok = ok && lattice.add_field(moduli + i) == i;
+	}
+	ok = ok && lattice.add_field(moduli + 0) == 0 && lattice.num_fields() == num;
+
+	timeit_t time;
+	timeit_start(time);
+	for (slong i = 0; i < num; i++)
+		for (slong j = 0; j < num; j++) {
+			bool divides = degrees[j] % degrees[i] == 0;
+			ok = ok && lattice.get_x_image(x_image, i, j) == divides;
+			if (divides)
+				ok = ok && is_embedding(x_image, moduli + i, moduli + j);
+		}
+	timeit_stop(time);
+	cout << "all embeddings time: " << (double) time->wall / 1000.0 << "\n";
+
+	for (slong i = 0; i < num; i++)
+		for (slong j = 0; j < num; j++)
+			for (slong k = 0; k < num; k++) {
+				if (i == j || j == k || degrees[j] % degrees[i] != 0 || degrees[k] % degrees[j] != 0)
+					continue;
+				lattice.get_x_image(inner, i, j);
+				lattice.get_x_image(outer, j, k);
+				lattice.get_x_image(x_image, i, k);
+				nmod_poly_compose_mod(temp, inner, outer, moduli + k);
+				ok = ok && nmod_poly_equal(temp, x_image);
+			}
+
+	// the generators are mapped to each other
+	lattice.get_generator(inner, 0, 2);
+	lattice.get_generator(outer, num - 1, 2);
+	lattice.get_x_image(x_image, 0, num - 1);
+	nmod_poly_compose_mod(temp, inner, x_image, moduli + num - 1);
+	ok = ok && nmod_poly_equal(temp, outer);
+
+	cout << "testing the lattice... ";
+	if (ok)
+		cout << "ok\n";
+	else
+		cout << "ooops\n";
+
+	for (slong i = 0; i < num; i++)
+		nmod_poly_clear(moduli + i);
+	flint_free(moduli);
+	flint_randclear(state);
+	nmod_poly_clear(x_image);
+	nmod_poly_clear(inner);
+	nmod_poly_clear(outer);
+	nmod_poly_clear(temp);
+}
+
+int main() {
+
+	// the first and last degrees must be even, the last one a multiple of the first
+	slong degrees1[] = {2, 4, 6, 12, 3, 24};
+	test_lattice(degrees1, 6, n_nth_prime(50));
+
+	slong degrees2[] = {10, 5, 20, 2, 30, 60};
+	test_lattice(degrees2, 6, n_nth_prime(70));
+
+	// the characteristic divides the degrees
+	slong degrees3[] = {6, 3, 2, 12, 18, 36};
+	test_lattice(degrees3, 6, 3);
+
+	return 0;
+}
@@ -0,0 +1,122 @@
+#include "ff_embedding_registry.h"
+#include "ff_embedding.h"
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <flint/profiler.h>
+
+using namespace std;
+
+/**
+ * The image of x must be a root of f1 modulo f2.
+ */
+bool is_embedding(const nmod_poly_t x_image, const nmod_poly_t f1, const nmod_poly_t f2) {
+	nmod_poly_t temp;
+	nmod_poly_init(temp, f1->mod.n);
+	nmod_poly_compose_mod(temp, f1, x_image, f2);
+	bool ok = nmod_poly_is_zero(temp);
+	nmod_poly_clear(temp);
+	return ok;
+}
+
+/**
+ * Builds a tower k --> K --> L of degrees m, m * a, m * a * b, and checks
+ * hits, composition, eviction and concurrent lookups.
+ */
+void test_registry(slong m, slong a, slong b, slong characteristic) {
+
+	cout << "characteristic: " << characteristic << "\n";
+	cout << "extension degrees: " << m << ", " << m * a << ", " << m * a * b << "\n";
+
+	mp_limb_t p = characteristic;
+
+	flint_rand_t state;
+	flint_randinit(state);
+
+	nmod_poly_t f1, f2, f3, x_image, temp;
+	nmod_poly_init(f1, p);
+	nmod_poly_init(f2, p);
+	nmod_poly_init(f3, p);
+	nmod_poly_init(x_image, p);
+	nmod_poly_init(temp, p);
+
+	nmod_poly_randtest_monic_irreducible(f1, state, m + 1);
+	nmod_poly_randtest_monic_irreducible(f2, state, m * a + 1);
+	nmod_poly_randtest_monic_irreducible(f3, state, m * a * b + 1);
+
+	FFEmbeddingRegistry registry;
+	bool ok = true;
+
+	timeit_t time;
+	timeit_start(time);
+	registry.get_x_image(x_image, f1, f2);
+	timeit_stop(time);
+	cout << "miss time: " << (double) time->wall / 1000.0 << "\n";
+	ok = ok && is_embedding(x_image, f1, f2);
+
+	timeit_start(time);
+	registry.get_x_image(temp, f1, f2);
+	timeit_stop(time);
+	cout << "hit time: " << (double) time->wall / 1000.0 << "\n";
+	ok = ok && nmod_poly_equal(temp, x_image) && registry.hits() == 1;
+
+	// k --> L from k --> K and K --> L
+	registry.compose(x_image, f1, f2, f3);
+	ok = ok && is_embedding(x_image, f1, f3) && registry.size() == 3;
+
+	// an embedding built from a cached image
+	FFEmbedding ffEmbedding(f1, f3);
+	ffEmbedding.set_x_image(x_image);
+	nmod_poly_zero(temp);
+	nmod_poly_set_coeff_ui(temp, 1, 1);
+	ffEmbedding.compute_image(temp, temp);
+	ok = ok && nmod_poly_equal(temp, x_image);
+
+	// concurrent lookups
+	vector<thread> threads;
+	vector<int> thread_ok(4, 0);
+	for (slong t = 0; t < 4; t++)
+		threads.push_back(thread([&registry, &thread_ok, &f1, &f3, &x_image, t, p] {
+			nmod_poly_t image;
+			nmod_poly_init(image, p);
+			thread_ok[t] = 1;
+			for (slong i = 0; i < 100; i++) {
+				if (!registry.lookup(image, f1, f3) || !nmod_poly_equal(image, x_image))
+					thread_ok[t] = 0;
+			}
+			nmod_poly_clear(image);
+			flint_cleanup();
+		}));
+	for (slong t = 0; t < 4; t++) {
+		threads[t].join();
+		ok = ok && thread_ok[t];
+	}
+
+	// the least recently used entries go first
+	registry.lookup(temp, f1, f2);
+	registry.set_max_bytes(registry.bytes() - 1);
+	ok = ok && registry.size() < 3 && registry.lookup(temp, f1, f2);
+	registry.set_max_bytes(0);
+	ok = ok && registry.size() == 0 && registry.bytes() == 0;
+
+	cout << "testing the registry... ";
+	if (ok)
+		cout << "ok\n";
+	else
+		cout << "ooops\n";
+
+	flint_randclear(state);
+	nmod_poly_clear(f1);
+	nmod_poly_clear(f2);
+	nmod_poly_clear(f3);
+	nmod_poly_clear(x_image);
+	nmod_poly_clear(temp);
+}
+
+int main() {
+
+	test_registry(6, 2, 3, n_nth_prime(50));
+	test_registry(10, 3, 2, n_nth_prime(60));
+
+	return 0;
+}
@@ -0,0 +1,207 @@
+#include "ff_embedding_fmpz.h"
+#include "ff_isom_prime_power_fmpz.h"
+#include "fmpz_mod_min_poly.h"
+#include "fmpz_mod_rth_root.h"
+#include <iostream>
+#include <flint/fmpz_poly.h>
+#include <flint/fmpz_mod_poly_factor.h>
+#include <flint/profiler.h>
+
+using namespace std;
+
+/**
+ * Checks r-th roots in the field defined by a factor of the r-th cyclotomic
+ * polynomial modulo p.
+ */
+void test_rth_root(slong r, const fmpz_t p) {
+	cout << "p: ";
+	fmpz_print(p);
+	cout << ", r: " << r << "\n";
+
+	flint_rand_t state;
+	flint_randinit(state);
+
+	fmpz_poly_t cyclotomic;
+	fmpz_poly_init(cyclotomic);
+	fmpz_poly_cyclotomic(cyclotomic, r);
+
+	fmpz_mod_poly_t f, a, root;
+	fmpz_mod_poly_init(f, p);
+	fmpz_mod_poly_init(a, p);
+	fmpz_mod_poly_init(root, p);
+	fmpz_mod_poly_set_fmpz_poly(f, cyclotomic);
+
+	fmpz_mod_poly_factor_t factors;
+	fmpz_mod_poly_factor_init(factors);
+	fmpz_mod_poly_factor(factors, f);
+	fmpz_mod_poly_set(f, factors->poly + 0);
+
+	fmpz_mod_poly_randtest_not_zero(a, state, fmpz_mod_poly_degree(f));
+	fmpz_mod_poly_powmod_ui_binexp(a, a, r, f);
+
+	FmpzModRthRoot fmpzModRthRoot;
+	fmpzModRthRoot.compute_rth_root(root, a, r, f);
+	fmpz_mod_poly_powmod_ui_binexp(root, root, r, f);
+
+	if (fmpz_mod_poly_equal(root, a))
+		cout << "ok\n";
+	else
+		cout << "ooops\n";
+
+	fmpz_mod_poly_factor_clear(factors);
+	fmpz_mod_poly_clear(f);
+	fmpz_mod_poly_clear(a);
+	fmpz_mod_poly_clear(root);
+	fmpz_poly_clear(cyclotomic);
+	flint_randclear(state);
+}
+
+/**
+ * Checks the isomorphisms of FFIsomPrimePowerFmpz through the minimal
+ * polynomials of the generators.
+ */
+void test_isom(slong r, const fmpz_t p, slong num_threads) {
+	cout << "p: ";
+	fmpz_print(p);
+	cout << ", r: " << r << ", threads: " << num_threads << "\n";
+
+	flint_rand_t state;
+	flint_randinit(state);
+
+	fmpz_mod_poly_t f1, f2, g1, g2, min_poly1, min_poly2;
+	fmpz_mod_poly_init(f1, p);
+	fmpz_mod_poly_init(f2, p);
+	fmpz_mod_poly_init(g1, p);
+	fmpz_mod_poly_init(g2, p);
+	fmpz_mod_poly_init(min_poly1, p);
+	fmpz_mod_poly_init(min_poly2, p);
+
+	fmpz_mod_poly_randtest_monic_irreducible(f1, state, r + 1);
+	fmpz_mod_poly_randtest_monic_irreducible(f2, state, r + 1);
+
+	timeit_t time;
+	timeit_start(time);
+	FFIsomPrimePowerFmpz ffIsomPrimePowerFmpz(f1, f2, num_threads);
+	ffIsomPrimePowerFmpz.compute_generators(g1, g2);
+	timeit_stop(time);
+	cout << "time: " << (double) time->wall / 1000.0 << "\n";
+
+	FmpzModMinPoly fmpzModMinPoly;
+	fmpzModMinPoly.minimal_polynomial(min_poly1, g1, f1);
+	fmpzModMinPoly.minimal_polynomial(min_poly2, g2, f2);
+
+	if (fmpz_mod_poly_degree(min_poly1) == r && fmpz_mod_poly_equal(min_poly1, min_poly2))
+		cout << "ok\n";
+	else
+		cout << "ooops\n";
+
+	fmpz_mod_poly_clear(f1);
+	fmpz_mod_poly_clear(f2);
+	fmpz_mod_poly_clear(g1);
+	fmpz_mod_poly_clear(g2);
+	fmpz_mod_poly_clear(min_poly1);
+	fmpz_mod_poly_clear(min_poly2);
+	flint_randclear(state);
+}
+
+/**
+ * Checks the embedding of an extension of degree m into one of degree n,
+ * for a composite m: the image of x must be a root of the first modulus,
+ * and the image of a product the product of the images.
+ */
+void test_embedding(slong m, slong n, const fmpz_t p, slong num_threads) {
+	cout << "p: ";
+	fmpz_print(p);
+	cout << ", m: " << m << ", n: " << n << ", threads: " << num_threads << "\n";
+
+	flint_rand_t state;
+	flint_randinit(state);
+
+	fmpz_mod_poly_t f1, f2, g1, g2, x_image, check, a, b, ab;
+	fmpz_mod_poly_init(f1, p);
+	fmpz_mod_poly_init(f2, p);
+	fmpz_mod_poly_init(g1, p);
+	fmpz_mod_poly_init(g2, p);
+	fmpz_mod_poly_init(x_image, p);
+	fmpz_mod_poly_init(check, p);
+	fmpz_mod_poly_init(a, p);
+	fmpz_mod_poly_init(b, p);
+	fmpz_mod_poly_init(ab, p);
+
+	fmpz_mod_poly_randtest_monic_irreducible(f1, state, m + 1);
+	fmpz_mod_poly_randtest_monic_irreducible(f2, state, n + 1);
+
+	timeit_t time;
+	timeit_start(time);
+	FFEmbeddingFmpz ffEmbeddingFmpz(f1, f2, num_threads);
+	ffEmbeddingFmpz.compute_generators(g1, g2);
+	ffEmbeddingFmpz.build_embedding(g1, g2);
+	timeit_stop(time);
+	cout << "time: " << (double) time->wall / 1000.0 << "\n";
+
+	ffEmbeddingFmpz.get_x_image(x_image);
+	fmpz_mod_poly_compose_mod(check, f1, x_image, f2);
+
+	fmpz_mod_poly_randtest(a, state, m);
+	fmpz_mod_poly_randtest(b, state, m);
+	fmpz_mod_poly_mulmod(ab, a, b, f1);
+	ffEmbeddingFmpz.compute_image(a, a);
+	ffEmbeddingFmpz.compute_image(b, b);
+	ffEmbeddingFmpz.compute_image(ab, ab);
+	fmpz_mod_poly_mulmod(a, a, b, f2);
+
+	if (fmpz_mod_poly_is_zero(check) && fmpz_mod_poly_equal(a, ab))
+		cout << "ok\n";
+	else
+		cout << "ooops\n";
+
+	fmpz_mod_poly_clear(f1);
+	fmpz_mod_poly_clear(f2);
+	fmpz_mod_poly_clear(g1);
+	fmpz_mod_poly_clear(g2);
+	fmpz_mod_poly_clear(x_image);
+	fmpz_mod_poly_clear(check);
+	fmpz_mod_poly_clear(a);
+	fmpz_mod_poly_clear(b);
+	fmpz_mod_poly_clear(ab);
+	flint_randclear(state);
+}
+
+int main() {
+
+	fmpz_t p, q;
+	fmpz_init(p);
+	fmpz_init(q);
+
+	// a 128 bit prime, and a 256 bit prime congruent to 1 mod 25, for
+	// which the cyclotomic extension is trivial
+	fmpz_one(p);
+	fmpz_mul_2exp(p, p, 127);
+	fmpz_nextprime(p, p, 1);
+	fmpz_one(q);
+	fmpz_mul_2exp(q, q, 255);
+	do
+		fmpz_nextprime(q, q, 1);
+	while (fmpz_fdiv_ui(q, 25) != 1);
+
+	test_rth_root(7, p);
+	test_rth_root(25, p);
+	test_rth_root(25, q);
+	test_rth_root(32, q);
+
+	test_isom(2, p, 1);
+	test_isom(7, p, 1);
+	test_isom(9, p, 2);
+	test_isom(25, p, 2);
+	test_isom(5, q, 1);
+	test_isom(25, q, 2);
+
+	test_embedding(6, 6, p, 1);
+	test_embedding(6, 12, p, 2);
+	test_embedding(10, 20, q, 2);
+
+	fmpz_clear(p);
+	fmpz_clear(q);
+
+	return 0;
+}
@@ -0,0 +1,126 @@
+#include "gf2_poly.h"
+#include "nmod_min_poly.h"
+#include <iostream>
+
+using namespace std;
+
+/**
+ * Checks products, reductions, compositions and transposed products of
+ * packed polynomials against nmod_poly, for a random modulus of the given
+ * degree.
+ */
+bool test_arithmetic(slong degree, flint_rand_t state) {
+	nmod_poly_t f, a, b, c, res;
+	nmod_poly_init(f, 2);
+	nmod_poly_init(a, 2);
+	nmod_poly_init(b, 2);
+	nmod_poly_init(c, 2);
+	nmod_poly_init(res, 2);
+
+	nmod_poly_randtest_monic(f, state, degree + 1);
+	nmod_poly_randtest(a, state, 3 * degree);
+	nmod_poly_randtest(b, state, 2 * degree);
+
+	bool ok = true;
+	Gf2Poly a_gf2(a), b_gf2(b), res_gf2;
+
+	Gf2Poly::mul(res_gf2, a_gf2, b_gf2);
+	res_gf2.get(res);
+	nmod_poly_mul(c, a, b);
+	ok = ok && nmod_poly_equal(res, c);
+
+	Gf2PolyModulus modulus(f);
+	modulus.rem(res_gf2, a_gf2);
+	res_gf2.get(res);
+	nmod_poly_rem(c, a, f);
+	ok = ok && nmod_poly_equal(res, c);
+
+	nmod_poly_rem(a, a, f);
+	nmod_poly_rem(b, b, f);
+	Gf2PolyComposeMod::compose_mod(res, a, b, f);
+	nmod_poly_compose_mod(c, a, b, f);
+	ok = ok && nmod_poly_equal(res, c);
+
+	// v(b x^i mod f) for the transposed product
+	nmod_poly_randtest(a, state, degree);
+	a_gf2.set(a);
+	b_gf2.set(b);
+	modulus.transposed_mulmod(res_gf2, a_gf2, b_gf2);
+	nmod_poly_set(c, b);
+	for (slong i = 0; i < degree; i++) {
+		mp_limb_t value = 0;
+		for (slong j = 0; j < c->length && j < a->length; j++)
+			value ^= c->coeffs[j] & a->coeffs[j];
+		ok = ok && (int) value == res_gf2.get_coeff(i);
+		nmod_poly_shift_left(c, c, 1);
+		nmod_poly_rem(c, c, f);
+	}
+
+	nmod_poly_clear(f);
+	nmod_poly_clear(a);
+	nmod_poly_clear(b);
+	nmod_poly_clear(c);
+	nmod_poly_clear(res);
+	return ok;
+}
+
+/**
+ * Checks the minimal polynomial of a random element against the nmod one.
+ */
+bool test_min_poly(slong degree, flint_rand_t state) {
+	nmod_poly_t f, a, min_poly, min_poly_gf2, temp;
+	nmod_poly_init(f, 2);
+	nmod_poly_init(a, 2);
+	nmod_poly_init(min_poly, 2);
+	nmod_poly_init(min_poly_gf2, 2);
+	nmod_poly_init(temp, 2);
+
+	nmod_poly_randtest_monic_irreducible(f, state, degree + 1);
+	nmod_poly_randtest(a, state, degree);
+
+	Gf2MinPoly gf2MinPoly;
+	gf2MinPoly.minimal_polynomial(min_poly_gf2, a, f);
+
+	// the minimal polynomial of an element of a field is irreducible, and
+	// its degree divides that of the field
+	nmod_poly_compose_mod(temp, min_poly_gf2, a, f);
+	bool ok = nmod_poly_is_zero(temp) && nmod_poly_is_irreducible(min_poly_gf2)
+			&& degree % nmod_poly_degree(min_poly_gf2) == 0;
+
+	// NmodMinPoly hands p = 2 over to the packed code, the same answer is expected
+	NmodMinPoly nmodMinPoly;
+	nmodMinPoly.minimal_polynomial(min_poly, a, f);
+	ok = ok && nmod_poly_equal(min_poly, min_poly_gf2);
+
+	nmod_poly_clear(f);
+	nmod_poly_clear(a);
+	nmod_poly_clear(min_poly);
+	nmod_poly_clear(min_poly_gf2);
+	nmod_poly_clear(temp);
+	return ok;
+}
+
+int main() {
+
+	flint_rand_t state;
+	flint_randinit(state);
+
+	// with the carry-less multiplication instruction when there is one,
+	// then with the portable limb product
+	for (int pclmul = 1; pclmul >= 0; pclmul--) {
+		cout << "pclmul: " << Gf2Poly::use_pclmul(pclmul) << "\n";
+
+		slong degrees[] = {1, 63, 64, 65, 200, 1500, 4000};
+		for (slong degree : degrees) {
+			cout << "degree: " << degree << " ";
+			if (test_arithmetic(degree, state) && test_min_poly(FLINT_MIN(degree, 1500), state))
+				cout << "ok\n";
+			else
+				cout << "ooops\n";
+		}
+	}
+
+	flint_randclear(state);
+
+	return 0;
+}
@@ -0,0 +1,74 @@
+#include "ff_isom_prime_power_ext.h"
+#include "nmod_min_poly.h"
+#include <iostream>
+#include <flint/profiler.h>
+
+using namespace std;
+
+/**
+ * Checks the isomorphisms computed by the linear algebra semi-traces, on
+ * one thread and on a pool, through the minimal polynomials of the
+ * generators.
+ */
+void test_linalg(slong r, mp_limb_t p, slong force_algo, slong num_threads, bool wiedemann = false) {
+
+	cout << "p: " << p << ", r: " << r << ", algorithm: " << force_algo << ", threads: " << num_threads << "\n";
+
+	flint_rand_t state;
+	flint_randinit(state);
+
+	nmod_poly_t f1, f2, g1, g2, min_poly1, min_poly2;
+	nmod_poly_init(f1, p);
+	nmod_poly_init(f2, p);
+	nmod_poly_init(g1, p);
+	nmod_poly_init(g2, p);
+	nmod_poly_init(min_poly1, p);
+	nmod_poly_init(min_poly2, p);
+
+	nmod_poly_randtest_monic_irreducible(f1, state, r + 1);
+	nmod_poly_randtest_monic_irreducible(f2, state, r + 1);
+
+	timeit_t time;
+	timeit_start(time);
+	FFIsomPrimePower ffIsomPrimePower(f1, f2, force_algo, 0, num_threads);
+	ffIsomPrimePower.compute_generators(g1, g2);
+	timeit_stop(time);
+	cout << "time: " << (double) time->wall / 1000.0 << "\n";
+
+	NmodMinPoly nmodMinPoly;
+	nmodMinPoly.minimal_polynomial(min_poly1, g1, f1);
+	nmodMinPoly.minimal_polynomial(min_poly2, g2, f2);
+
+	if (nmod_poly_degree(min_poly1) == r && nmod_poly_equal(min_poly1, min_poly2)
+			&& (ffIsomPrimePower.get_wiedemann_kernels() > 0) == wiedemann)
+		cout << "ok\n";
+	else
+		cout << "ooops\n";
+
+	nmod_poly_clear(f1);
+	nmod_poly_clear(f2);
+	nmod_poly_clear(g1);
+	nmod_poly_clear(g2);
+	nmod_poly_clear(min_poly1);
+	nmod_poly_clear(min_poly2);
+	flint_randclear(state);
+}
+
+int main() {
+
+	slong algorithms[] = {FORCE_LINALG_CYCLO, FORCE_LINALG_ONLY, FORCE_LINALG};
+
+	for (slong i = 0; i < 3; i++) {
+		test_linalg(7, 29, algorithms[i], 1);
+		test_linalg(25, n_nth_prime(60), algorithms[i], 1);
+		test_linalg(25, n_nth_prime(60), algorithms[i], 4);
+		test_linalg(101, 9001, algorithms[i], 4);
+	}
+
+	// past the dense cutoff, the kernel is found by Wiedemann's algorithm;
+	// p = -1 mod r so that the cyclotomic extension has degree 2
+	test_linalg(1031, 28867, FORCE_LINALG_ONLY, 1, true);
+	test_linalg(1031, 28867, FORCE_LINALG, 4, true);
+
+	return 0;
+}
@@ -41,8 +41,137 @@ void test_minpoly(slong degree) {
 	nmod_poly_clear(modulus);
 }
 
+/**
+ * Both Berlekamp-Massey algorithms on a nonzero sequence of irreducible
+ * recurrence of degree {@code l} <= {@code degree}, and on the zero sequence.
+ */
+void test_sequence(mp_limb_t p, slong degree, slong l) {
+	cout << "p: " << p << ", degree: " << degree << ", recurrence: " << l << "\n";
+
+	flint_rand_t state;
+	flint_randinit(state);
+
+	nmod_poly_t recurrence, bm, hgcd;
+	nmod_poly_init(recurrence, p);
+	nmod_poly_init(bm, p);
+	nmod_poly_init(hgcd, p);
+	nmod_poly_randtest_monic_irreducible(recurrence, state, l + 1);
+
+	// s_{i+l} = -sum_{j<l} r_j s_{i+j} from random initial terms
+	mp_limb_t *sequence = _nmod_vec_init(2 * degree);
+	_nmod_vec_randtest(sequence, state, l, recurrence->mod);
+	if (_nmod_vec_is_zero(sequence, l))
+		sequence[0] = 1;
+	for (slong i = l; i < 2 * degree; i++)
+		sequence[i] = nmod_neg(_nmod_vec_dot(recurrence->coeffs, sequence + i - l, l, recurrence->mod,
+				_nmod_vec_dot_bound_limbs(l, recurrence->mod)), recurrence->mod);
+
+	NmodMinPoly nmodMinPoly;
+	nmodMinPoly.minimal_polynomial_berlekamp_massey(bm, sequence, degree);
+	nmodMinPoly.minimal_polynomial_hgcd(hgcd, sequence, degree);
+	bool ok = nmod_poly_equal(bm, recurrence) && nmod_poly_equal(hgcd, recurrence);
+
+	_nmod_vec_zero(sequence, 2 * degree);
+	nmodMinPoly.minimal_polynomial_berlekamp_massey(bm, sequence, degree);
+	nmodMinPoly.minimal_polynomial_hgcd(hgcd, sequence, degree);
+	ok = ok && nmod_poly_is_one(bm) && nmod_poly_is_one(hgcd);
+
+	if (ok)
+		cout << "ok\n";
+	else
+		cout << "oops\n";
+
+	_nmod_vec_clear(sequence);
+	flint_randclear(state);
+	nmod_poly_clear(recurrence);
+	nmod_poly_clear(bm);
+	nmod_poly_clear(hgcd);
+}
+
+/**
+ * Block Wiedemann, and the projection on 2 deg terms when the degree is
+ * known, against the scalar algorithm, for a random element, its trace to
+ * the subfield of degree {@code subdegree}, and a constant.
+ */
+void test_block(mp_limb_t p, slong degree, slong subdegree, slong block_size) {
+	cout << "p: " << p << ", degree: " << degree << ", subfield: " << subdegree << ", block: " << block_size << "\n";
+
+	flint_rand_t state;
+	flint_randinit(state);
+
+	nmod_poly_t modulus, modulus_inv_rev, f, trace, frobenius, scalar, block;
+	nmod_poly_init(modulus, p);
+	nmod_poly_init(modulus_inv_rev, p);
+	nmod_poly_init(f, p);
+	nmod_poly_init(trace, p);
+	nmod_poly_init(frobenius, p);
+	nmod_poly_init(scalar, p);
+	nmod_poly_init(block, p);
+	nmod_poly_randtest_monic_irreducible(modulus, state, degree + 1);
+	nmod_poly_reverse(modulus_inv_rev, modulus, degree + 1);
+	nmod_poly_inv_series_newton(modulus_inv_rev, modulus_inv_rev, degree - 1);
+	nmod_poly_randtest(f, state, degree);
+
+	// x^{p^subdegree}, and the trace of f to the subfield
+	nmod_poly_zero(frobenius);
+	nmod_poly_set_coeff_ui(frobenius, 1, 1);
+	nmod_poly_powmod_ui_binexp(frobenius, frobenius, p, modulus);
+	nmod_poly_set(trace, frobenius);
+	for (slong i = 1; i < subdegree; i++)
+		nmod_poly_compose_mod(frobenius, frobenius, trace, modulus);
+	nmod_poly_set(trace, f);
+	for (slong i = 1; i < degree / subdegree; i++) {
+		nmod_poly_compose_mod(f, f, frobenius, modulus);
+		nmod_poly_add(trace, trace, f);
+	}
+
+	NmodMinPoly nmodMinPoly;
+	bool ok = true;
+	for (slong i = 0; i < 3; i++) {
+		if (i == 1)
+			nmod_poly_set(f, trace);
+		else if (i == 2) {
+			nmod_poly_zero(f);
+			nmod_poly_set_coeff_ui(f, 0, 5);
+		}
+		nmodMinPoly.minimal_polynomial(scalar, f, modulus, modulus_inv_rev);
+		// p is large, so the block algorithm should not need the fallback
+		bool by_block = nmodMinPoly.minimal_polynomial_block(block, f, modulus, modulus_inv_rev, block_size, block_size);
+		ok = ok && by_block && nmod_poly_equal(scalar, block);
+		nmodMinPoly.minimal_polynomial_of_degree(block, f, modulus, modulus_inv_rev, nmod_poly_degree(scalar));
+		ok = ok && nmod_poly_equal(scalar, block);
+	}
+
+	if (ok)
+		cout << "ok\n";
+	else
+		cout << "oops\n";
+
+	flint_randclear(state);
+	nmod_poly_clear(modulus);
+	nmod_poly_clear(modulus_inv_rev);
+	nmod_poly_clear(f);
+	nmod_poly_clear(trace);
+	nmod_poly_clear(frobenius);
+	nmod_poly_clear(scalar);
+	nmod_poly_clear(block);
+}
+
 int main() {
 
+	test_block(9001, 60, 12, 2);
+	test_block(9001, 101, 1, 3);
+	test_block(9001, 300, 20, 4);
+	test_block(n_nextprime(UWORD(1) << 62, 1), 128, 32, 8);
+	cout << "----------------------\n";
+
+	test_sequence(9001, 1, 1);
+	test_sequence(9001, 50, 50);
+	test_sequence(9001, 300, 211);
+	test_sequence(3, 400, 400);
+	test_sequence(n_nextprime(UWORD(1) << 62, 1), 120, 97);
+	cout << "----------------------\n";
+
 	for (slong i = 100; i < 120; i++) {
 		test_minpoly(i);
 		cout << "----------------------\n";
@@ -0,0 +1,128 @@
+#include <iostream>
+#include "fq_nmod_poly_ks.h"
+#include <flint/profiler.h>
+
+using namespace std;
+
+/**
+ * Checks the Kronecker substitution arithmetic against FLINT's, for both
+ * packings.
+ */
+void test_ks(slong degree, slong length, mp_limb_t p) {
+	cout << "p: " << p << ", degree: " << degree << ", length: " << length << "\n";
+
+	flint_rand_t state;
+	flint_randinit(state);
+
+	nmod_poly_t f;
+	nmod_poly_init(f, p);
+	nmod_poly_randtest_monic_irreducible(f, state, degree + 1);
+
+	fq_nmod_ctx_t ctx;
+	fq_nmod_ctx_init_modulus(ctx, f, "x");
+
+	fq_nmod_poly_t a, b, m, m_inv, res, expected;
+	fq_nmod_poly_init(a, ctx);
+	fq_nmod_poly_init(b, ctx);
+	fq_nmod_poly_init(m, ctx);
+	fq_nmod_poly_init(m_inv, ctx);
+	fq_nmod_poly_init(res, ctx);
+	fq_nmod_poly_init(expected, ctx);
+
+	fq_nmod_t one;
+	fq_nmod_init(one, ctx);
+	fq_nmod_one(one, ctx);
+
+	bool ok = true;
+	FqNmodPolyKS::Variant variants[] = {FqNmodPolyKS::KS_SINGLE, FqNmodPolyKS::KS_RECIPROCAL, FqNmodPolyKS::KS_AUTO};
+
+	for (slong v = 0; v < 3; v++) {
+		FqNmodPolyKS ks(ctx, variants[v]);
+
+		fq_nmod_poly_randtest(a, state, length, ctx);
+		fq_nmod_poly_randtest(b, state, length / 2 + 1, ctx);
+
+		// products, also in place and squarings
+		fq_nmod_poly_mul(expected, a, b, ctx);
+		ks.mul(res, a, b);
+		ok = ok && fq_nmod_poly_equal(res, expected, ctx);
+
+		fq_nmod_poly_set(res, a, ctx);
+		ks.mul(res, res, res);
+		fq_nmod_poly_mul(expected, a, a, ctx);
+		ok = ok && fq_nmod_poly_equal(res, expected, ctx);
+
+		fq_nmod_poly_mullow(expected, a, b, length / 3 + 1, ctx);
+		ks.mullow(res, a, b, length / 3 + 1);
+		ok = ok && fq_nmod_poly_equal(res, expected, ctx);
+
+		// a monic modulus, and the inverse of its reverse
+		fq_nmod_poly_randtest(m, state, length / 2 + 2, ctx);
+		fq_nmod_poly_set_coeff(m, length / 2 + 2, one, ctx);
+		fq_nmod_poly_reverse(m_inv, m, m->length, ctx);
+		fq_nmod_poly_inv_series_newton(expected, m_inv, m->length, ctx);
+		ks.inv_series(m_inv, m_inv, m->length);
+		ok = ok && fq_nmod_poly_equal(m_inv, expected, ctx);
+
+		fq_nmod_poly_rem(expected, a, m, ctx);
+		ks.rem(res, a, m);
+		ok = ok && fq_nmod_poly_equal(res, expected, ctx);
+		ks.rem_preinv(res, a, m, m_inv);
+		ok = ok && fq_nmod_poly_equal(res, expected, ctx);
+
+		fq_nmod_poly_rem(a, a, m, ctx);
+		fq_nmod_poly_rem(b, b, m, ctx);
+		fq_nmod_poly_mulmod(expected, a, b, m, ctx);
+		ks.mulmod_preinv(res, a, b, m, m_inv);
+		ok = ok && fq_nmod_poly_equal(res, expected, ctx);
+
+		fq_nmod_poly_reverse(expected, m, m->length, ctx);
+		fq_nmod_poly_inv_series_newton(expected, expected, m->length, ctx);
+		fq_nmod_poly_powmod_ui_binexp_preinv(expected, a, 2 * degree + 1, m, expected, ctx);
+		ks.powmod_ui_preinv(res, a, 2 * degree + 1, m, m_inv);
+		ok = ok && fq_nmod_poly_equal(res, expected, ctx);
+	}
+
+	// timings of a large product
+	fq_nmod_poly_randtest(a, state, 4 * length, ctx);
+	fq_nmod_poly_randtest(b, state, 4 * length, ctx);
+	timeit_t time;
+	timeit_start(time);
+	fq_nmod_poly_mul(expected, a, b, ctx);
+	timeit_stop(time);
+	cout << "flint time: " << (double) time->wall / 1000.0 << "\n";
+
+	FqNmodPolyKS ks(ctx);
+	timeit_start(time);
+	ks.mul(res, a, b);
+	timeit_stop(time);
+	cout << "ks time: " << (double) time->wall / 1000.0 << "\n";
+	ok = ok && fq_nmod_poly_equal(res, expected, ctx);
+
+	if (ok)
+		cout << "ok\n";
+	else
+		cout << "ooops\n";
+
+	fq_nmod_clear(one, ctx);
+	fq_nmod_poly_clear(a, ctx);
+	fq_nmod_poly_clear(b, ctx);
+	fq_nmod_poly_clear(m, ctx);
+	fq_nmod_poly_clear(m_inv, ctx);
+	fq_nmod_poly_clear(res, ctx);
+	fq_nmod_poly_clear(expected, ctx);
+	fq_nmod_ctx_clear(ctx);
+	nmod_poly_clear(f);
+	flint_randclear(state);
+}
+
+int main() {
+
+	test_ks(1, 30, 101);
+	test_ks(2, 17, 3);
+	test_ks(7, 40, 9001);
+	test_ks(30, 100, 9001);
+	test_ks(61, 200, n_nth_prime(1000));
+
+	return 0;
+}
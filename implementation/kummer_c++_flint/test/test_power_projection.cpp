@@ -0,0 +1,107 @@
+#include <iostream>
+#include <flint/nmod_poly.h>
+#include "nmod_poly_compose_mod.h"
+#include "nmod_poly_power_projection.h"
+
+using namespace std;
+
+/*------------------------------------------------------------------------*/
+/* checks res[j][i] = forms[j](h^i mod f) against the definition          */
+/*------------------------------------------------------------------------*/
+bool check_projection(mp_limb_t ** res, mp_limb_t ** forms, slong len, slong l,
+		      const nmod_poly_t h, const nmod_poly_t f) {
+  nmod_poly_t power;
+  nmod_poly_init(power, f->mod.n);
+  nmod_poly_one(power);
+
+  bool ok = true;
+  for (slong i = 0; i < l; i++) {
+    for (slong j = 0; j < len; j++) {
+      mp_limb_t value = 0;
+      for (slong t = 0; t < power->length; t++)
+	value = nmod_add(value, nmod_mul(forms[j][t], power->coeffs[t], f->mod), f->mod);
+      if (value != res[j][i])
+	ok = false;
+    }
+    nmod_poly_mulmod(power, power, h, f);
+  }
+
+  nmod_poly_clear(power);
+  return ok;
+}
+
+/*------------------------------------------------------------------------*/
+/* projects several forms at once, with baby steps of its own and with    */
+/* those of a prepared composition                                        */
+/*------------------------------------------------------------------------*/
+void test_power_projection(mp_limb_t p, slong degree, slong len, slong l) {
+  cout << "p: " << p << ", degree: " << degree << ", forms: " << len << ", l: " << l << "\n";
+
+  flint_rand_t state;
+  flint_randinit(state);
+
+  nmod_poly_t f, finv, h;
+  nmod_poly_init(f, p);
+  nmod_poly_init(finv, p);
+  nmod_poly_init(h, p);
+  nmod_poly_randtest_monic(f, state, degree + 1);
+  nmod_poly_reverse(finv, f, f->length);
+  nmod_poly_inv_series(finv, finv, f->length);
+  nmod_poly_randtest(h, state, degree);
+
+  mp_limb_t ** forms = new mp_limb_t*[len];
+  mp_limb_t ** res = new mp_limb_t*[len];
+  mp_limb_t ** copies = new mp_limb_t*[len];
+  for (slong j = 0; j < len; j++) {
+    forms[j] = _nmod_vec_init(degree);
+    copies[j] = _nmod_vec_init(FLINT_MAX(degree, l));
+    res[j] = _nmod_vec_init(l);
+    _nmod_vec_randtest(forms[j], state, degree, f->mod);
+    _nmod_vec_set(copies[j], forms[j], degree);
+  }
+
+  bool ok = true;
+
+  Nmod_poly_power_projection projection(h, f, finv, n_sqrt(l) + 1);
+  projection.apply(res, forms, len, l);
+  ok = ok && check_projection(res, forms, len, l, h, f);
+
+  // in place
+  projection.apply(copies, copies, len, l);
+  for (slong j = 0; j < len; j++)
+    ok = ok && _nmod_vec_equal(copies[j], res[j], l);
+
+  // sharing the baby steps of a composition
+  Nmod_poly_compose_mod compose(h, f, finv, n_sqrt(degree) + 1);
+  Nmod_poly_power_projection shared(compose);
+  shared.apply(res, forms, len, l);
+  ok = ok && check_projection(res, forms, len, l, h, f);
+
+  if (ok)
+    cout << "ok\n";
+  else
+    cout << "ooops\n";
+
+  for (slong j = 0; j < len; j++) {
+    _nmod_vec_clear(forms[j]);
+    _nmod_vec_clear(copies[j]);
+    _nmod_vec_clear(res[j]);
+  }
+  delete[] forms;
+  delete[] copies;
+  delete[] res;
+  nmod_poly_clear(f);
+  nmod_poly_clear(finv);
+  nmod_poly_clear(h);
+  flint_randclear(state);
+}
+
+int main() {
+  test_power_projection(n_nextprime(1 << 20, 1), 1, 1, 5);
+  test_power_projection(n_nextprime(1 << 20, 1), 40, 1, 80);
+  test_power_projection(n_nextprime(1 << 20, 1), 100, 7, 200);
+  test_power_projection(n_nextprime(UWORD(1) << 62, 1), 150, 16, 37);
+  test_power_projection(3, 500, 5, 1000);
+
+  return 0;
+}
@@ -0,0 +1,68 @@
+#include "scratch_arena.h"
+#include <flint/nmod_vec.h>
+#include <iostream>
+
+using namespace std;
+
+/**
+ * Checks that the vectors of ScratchArena are zero, usable and distinct,
+ * and that a released frame hands out the same storage again, also across
+ * block boundaries.
+ */
+void test_scratch_arena(slong len, mp_limb_t p) {
+	cout << "p: " << p << ", len: " << len << "\n";
+
+	flint_rand_t state;
+	flint_randinit(state);
+
+	nmod_poly_t f;
+	nmod_poly_init(f, p);
+	nmod_poly_randtest_monic_irreducible(f, state, 8);
+	fq_nmod_ctx_t ctx;
+	fq_nmod_ctx_init_modulus(ctx, f, "x");
+
+	bool ok = true;
+	ScratchArena arena;
+	mp_ptr limbs = arena.limbs(len);
+	_nmod_vec_zero(limbs, len);
+
+	fq_nmod_struct *first = NULL;
+	for (slong k = 0; k < 3; k++) {
+		ScratchArena::Frame frame(arena);
+
+		fq_nmod_struct *a = arena.fq_nmod_vec(len, ctx);
+		nmod_poly_struct *b = arena.nmod_poly_vec(len, f->mod);
+		mp_ptr c = arena.limbs(3 * len);
+		if (k == 0)
+			first = a;
+		ok = ok && a == first;
+
+		for (slong i = 0; i < len; i++) {
+			ok = ok && fq_nmod_is_zero(a + i, ctx) && nmod_poly_is_zero(b + i);
+			fq_nmod_randtest(a + i, state, ctx);
+			nmod_poly_set(b + i, a + i);
+			c[3 * i] = i;
+		}
+		for (slong i = 0; i < len; i++)
+			ok = ok && nmod_poly_equal(a + i, b + i) && c[3 * i] == (mp_limb_t) i;
+	}
+	ok = ok && _nmod_vec_is_zero(limbs, len);
+
+	if (ok)
+		cout << "ok\n";
+	else
+		cout << "ooops\n";
+
+	fq_nmod_ctx_clear(ctx);
+	nmod_poly_clear(f);
+	flint_randclear(state);
+}
+
+int main() {
+
+	test_scratch_arena(1, 3);
+	test_scratch_arena(50, 101);
+	test_scratch_arena(1000, 9001);
+
+	return 0;
+}
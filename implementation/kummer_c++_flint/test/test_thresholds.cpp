@@ -0,0 +1,140 @@
+#include "ff_isom_thresholds.h"
+#include "ff_embedding.h"
+#include <iostream>
+#include <stdio.h>
+
+using namespace std;
+
+bool same(const FFIsomThresholds &a, const FFIsomThresholds &b) {
+	return a.linalg_threshold == b.linalg_threshold && a.linalg_cyclo_threshold == b.linalg_cyclo_threshold
+			&& a.linalg_only_threshold == b.linalg_only_threshold && a.cofactor_threshold == b.cofactor_threshold
+			&& a.iterfrob_threshold == b.iterfrob_threshold && a.mpe_threshold == b.mpe_threshold
+			&& a.ext_comp_exponent == b.ext_comp_exponent
+			&& a.rectangular_compose_threshold == b.rectangular_compose_threshold
+			&& a.berlekamp_massey_threshold == b.berlekamp_massey_threshold
+			&& a.block_min_poly_threshold == b.block_min_poly_threshold;
+}
+
+void write(const char *filename, const char *text) {
+	FILE *file = fopen(filename, "w");
+	fputs(text, file);
+	fclose(file);
+}
+
+/**
+ * Round trip of a profile, partial and malformed profiles.
+ */
+void test_profile() {
+	const char *filename = "test_thresholds.txt";
+	bool ok = true;
+
+	FFIsomThresholds defaults;
+	FFIsomThresholds tuned;
+	tuned.linalg_threshold = 50;
+	tuned.linalg_cyclo_threshold = 20;
+	tuned.linalg_only_threshold = 300;
+	tuned.cofactor_threshold = 1234;
+	tuned.iterfrob_threshold = WORD_MAX;
+	tuned.mpe_threshold = WORD_MAX;
+	tuned.ext_comp_exponent = 0.35;
+	tuned.rectangular_compose_threshold = 80000;
+	tuned.berlekamp_massey_threshold = 64;
+	tuned.block_min_poly_threshold = 3000;
+
+	FFIsomThresholds loaded;
+	ok = ok && tuned.save(filename) && loaded.load(filename) && same(loaded, tuned);
+
+	// missing names keep their value
+	write(filename, "# partial\ncofactor_threshold 77  # comment\n\n");
+	loaded = FFIsomThresholds();
+	ok = ok && loaded.load(filename) && loaded.cofactor_threshold == 77
+			&& loaded.linalg_threshold == defaults.linalg_threshold;
+
+	// a bad line changes nothing
+	write(filename, "linalg_threshold 5\niterfrob_threshold -3\n");
+	loaded = FFIsomThresholds();
+	ok = ok && !loaded.load(filename) && same(loaded, defaults);
+	write(filename, "no_such_threshold 5\n");
+	ok = ok && !loaded.load(filename) && same(loaded, defaults);
+	write(filename, "mpe_threshold 5 6\n");
+	ok = ok && !loaded.load(filename) && same(loaded, defaults);
+	ok = ok && !loaded.load("no_such_file.txt");
+
+	remove(filename);
+
+	cout << "testing threshold profiles... ";
+	if (ok)
+		cout << "ok\n";
+	else
+		cout << "ooops\n";
+}
+
+/**
+ * Embeddings built with extreme thresholds in use.
+ */
+void test_set(slong m, slong n, slong characteristic) {
+
+	cout << "characteristic: " << characteristic << "\n";
+	cout << "extension degrees: " << m << ", " << n << "\n";
+
+	mp_limb_t p = characteristic;
+	bool ok = true;
+
+	flint_rand_t state;
+	flint_randinit(state);
+
+	nmod_poly_t f1, f2, g1, g2, x_image, temp;
+	nmod_poly_init(f1, p);
+	nmod_poly_init(f2, p);
+	nmod_poly_init(g1, p);
+	nmod_poly_init(g2, p);
+	nmod_poly_init(x_image, p);
+	nmod_poly_init(temp, p);
+	nmod_poly_randtest_monic_irreducible(f1, state, m + 1);
+	nmod_poly_randtest_monic_irreducible(f2, state, n + 1);
+
+	FFIsomThresholds saved = FFIsomThresholds::get();
+	FFIsomThresholds thresholds;
+	for (slong i = 0; i < 2; i++) {
+		// everything by linear algebra, then everything by composition
+		slong bound = i == 0 ? WORD_MAX : 0;
+		thresholds.linalg_threshold = bound;
+		thresholds.linalg_cyclo_threshold = bound;
+		thresholds.linalg_only_threshold = bound;
+		thresholds.ext_comp_exponent = i == 0 ? 100.0 : 0.0;
+		FFIsomThresholds::set(thresholds);
+		ok = ok && same(FFIsomThresholds::get(), thresholds);
+
+		FFEmbedding ffEmbedding(f1, f2);
+		ffEmbedding.compute_generators(g1, g2);
+		ffEmbedding.build_embedding(g1, g2);
+		ffEmbedding.get_x_image(x_image);
+		nmod_poly_compose_mod(temp, f1, x_image, f2);
+		ok = ok && nmod_poly_is_zero(temp);
+	}
+	FFIsomThresholds::set(saved);
+
+	cout << "testing thresholds in use... ";
+	if (ok)
+		cout << "ok\n";
+	else
+		cout << "ooops\n";
+
+	flint_randclear(state);
+	nmod_poly_clear(f1);
+	nmod_poly_clear(f2);
+	nmod_poly_clear(g1);
+	nmod_poly_clear(g2);
+	nmod_poly_clear(x_image);
+	nmod_poly_clear(temp);
+}
+
+int main() {
+
+	test_profile();
+
+	test_set(15, 30, n_nth_prime(60));
+	test_set(21, 42, n_nth_prime(80));
+
+	return 0;
+}
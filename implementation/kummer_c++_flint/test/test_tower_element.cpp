@@ -0,0 +1,147 @@
+#include "nmod_tower_element.h"
+#include "nmod_poly_compose_mod.h"
+#include "cyclotomic_context.h"
+#include <iostream>
+#include <flint/fq_nmod_poly.h>
+
+using namespace std;
+
+/**
+ * Checks the layouts, the reduction and the multiplication by powers of z
+ * of NmodTowerElement against fq_nmod_poly_t arithmetic, and the dense
+ * composition on its rows against nmod_poly_compose_mod.
+ */
+void test_tower_element(slong r, mp_limb_t p) {
+
+	cout << "p: " << p << ", r: " << r << "\n";
+
+	flint_rand_t state;
+	flint_randinit(state);
+
+	nmod_poly_t modulus, cyclo_mod, temp;
+	nmod_poly_init(modulus, p);
+	nmod_poly_init(cyclo_mod, p);
+	nmod_poly_init(temp, p);
+	nmod_poly_randtest_monic_irreducible(modulus, state, r + 1);
+
+	fq_nmod_ctx_t ctx;
+	fq_nmod_ctx_init_modulus(ctx, modulus, "x");
+
+	// a factor of the r-th cyclotomic polynomial
+	nmod_poly_set(cyclo_mod, CyclotomicContext::get(r, p)->get_modulus());
+	slong s = nmod_poly_degree(cyclo_mod);
+
+	fq_nmod_poly_t a, b, cyclo_mod_lift, z_pow;
+	fq_nmod_poly_init(a, ctx);
+	fq_nmod_poly_init(b, ctx);
+	fq_nmod_poly_init(cyclo_mod_lift, ctx);
+	fq_nmod_poly_init(z_pow, ctx);
+	for (slong i = 0; i <= s; i++) {
+		nmod_poly_zero(temp);
+		nmod_poly_set_coeff_ui(temp, 0, nmod_poly_get_coeff_ui(cyclo_mod, i));
+		fq_nmod_poly_set_coeff(cyclo_mod_lift, i, temp, ctx);
+	}
+
+	bool ok = true;
+	slong len = 2 * s + 3;
+	NmodTowerElement element(len, r, ctx->mod);
+
+	// round trip, in both layouts
+	fq_nmod_poly_randtest(a, state, len, ctx);
+	element.set(a, ctx);
+	element.get(b, ctx);
+	ok = ok && fq_nmod_poly_equal(a, b, ctx);
+	element.transpose();
+	element.get(b, ctx);
+	ok = ok && element.is_x_major() && fq_nmod_poly_equal(a, b, ctx);
+	element.transpose();
+	element.get(b, ctx);
+	ok = ok && !element.is_x_major() && fq_nmod_poly_equal(a, b, ctx);
+
+	// reduction, in both layouts
+	fq_nmod_poly_rem(a, a, cyclo_mod_lift, ctx);
+	element.reduce(cyclo_mod);
+	element.get(b, ctx);
+	ok = ok && element.get_z_len() == s && fq_nmod_poly_equal(a, b, ctx);
+
+	fq_nmod_poly_randtest(a, state, len, ctx);
+	element.set(a, ctx);
+	element.transpose();
+	fq_nmod_poly_rem(a, a, cyclo_mod_lift, ctx);
+	element.reduce(cyclo_mod);
+	element.get(b, ctx);
+	ok = ok && element.is_x_major() && fq_nmod_poly_equal(a, b, ctx);
+
+	// multiplication by z^k, in both layouts
+	for (slong k = 0; k < 2 * r; k += r / 3 + 1) {
+		nmod_poly_zero(temp);
+		nmod_poly_set_coeff_ui(temp, 0, 1);
+		fq_nmod_poly_zero(z_pow, ctx);
+		fq_nmod_poly_set_coeff(z_pow, k, temp, ctx);
+
+		fq_nmod_poly_randtest(a, state, s, ctx);
+		element.set(a, ctx);
+		element.reduce(cyclo_mod);
+		if (k % 2)
+			element.transpose();
+		element.mul_z_power(k, cyclo_mod);
+		fq_nmod_poly_mulmod(a, a, z_pow, cyclo_mod_lift, ctx);
+		element.get(b, ctx);
+		ok = ok && fq_nmod_poly_equal(a, b, ctx);
+	}
+
+	// dense composition of the rows, in place
+	nmod_poly_t finv, g;
+	nmod_poly_init(finv, p);
+	nmod_poly_init(g, p);
+	nmod_poly_reverse(finv, modulus, modulus->length);
+	nmod_poly_inv_series(finv, finv, modulus->length);
+	nmod_poly_randtest(g, state, r);
+
+	Nmod_poly_compose_mod compose(g, modulus, finv, n_sqrt(r * s) + 1);
+	Nmod_poly_compose_mod::Workspace workspace;
+
+	fq_nmod_poly_randtest(a, state, s, ctx);
+	element.set(a, ctx);
+	element.reduce(cyclo_mod);
+	mp_ptr *rows = (mp_ptr *) flint_malloc(s * sizeof(mp_ptr));
+	for (slong i = 0; i < s; i++)
+		rows[i] = element.row(i);
+	compose.apply(rows, rows, s, workspace);
+	element.get(b, ctx);
+	for (slong i = 0; i < a->length; i++) {
+		fq_nmod_poly_get_coeff(temp, a, i, ctx);
+		nmod_poly_compose_mod(temp, temp, g, modulus);
+		nmod_poly_set(a->coeffs + i, temp);
+	}
+	_fq_nmod_poly_normalise(a, ctx);
+	ok = ok && compose.degree() == r && fq_nmod_poly_equal(a, b, ctx);
+	flint_free(rows);
+
+	if (ok)
+		cout << "ok\n";
+	else
+		cout << "ooops\n";
+
+	nmod_poly_clear(finv);
+	nmod_poly_clear(g);
+	fq_nmod_poly_clear(a, ctx);
+	fq_nmod_poly_clear(b, ctx);
+	fq_nmod_poly_clear(cyclo_mod_lift, ctx);
+	fq_nmod_poly_clear(z_pow, ctx);
+	fq_nmod_ctx_clear(ctx);
+	nmod_poly_clear(modulus);
+	nmod_poly_clear(cyclo_mod);
+	nmod_poly_clear(temp);
+	flint_randclear(state);
+}
+
+int main() {
+
+	test_tower_element(5, 11);
+	test_tower_element(7, 13);
+	test_tower_element(11, 23);
+	test_tower_element(13, 53);
+
+	return 0;
+}
@@ -0,0 +1,73 @@
+/*
+ * thread_pool.cpp
+ */
+
+#include "thread_pool.h"
+
+using namespace std;
+
+void ThreadPool::work() {
+	while (true) {
+		function<void()> task;
+		{
+			unique_lock<std::mutex> lock(queue_mutex);
+			task_available.wait(lock, [this] { return stopping || !tasks.empty(); });
+			if (tasks.empty())
+				break;
+			task = tasks.front();
+			tasks.pop();
+		}
+
+		task();
+
+		{
+			lock_guard<std::mutex> lock(queue_mutex);
+			pending--;
+			if (pending == 0)
+				tasks_done.notify_all();
+		}
+	}
+
+	// release the thread local caches of FLINT
+	flint_cleanup();
+}
+
+ThreadPool::ThreadPool(slong num_threads) {
+	pending = 0;
+	stopping = false;
+	for (slong i = 0; i < num_threads; i++)
+		workers.push_back(thread(&ThreadPool::work, this));
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		lock_guard<std::mutex> lock(queue_mutex);
+		stopping = true;
+	}
+	task_available.notify_all();
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+}
+
+void ThreadPool::submit(const function<void()> &task) {
+	if (workers.empty()) {
+		task();
+		return;
+	}
+
+	{
+		lock_guard<std::mutex> lock(queue_mutex);
+		tasks.push(task);
+		pending++;
+	}
+	task_available.notify_one();
+}
+
+void ThreadPool::wait() {
+	unique_lock<std::mutex> lock(queue_mutex);
+	tasks_done.wait(lock, [this] { return pending == 0; });
+}
+
+slong ThreadPool::size() const {
+	return workers.size();
+}
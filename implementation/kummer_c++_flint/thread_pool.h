@@ -0,0 +1,56 @@
+/*
+ * thread_pool.h
+ *
+ *  A fixed-size pool of worker threads used to run independent
+ *  sub-computations (e.g. one per prime power factor) concurrently.
+ */
+
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+#include <flint/flint.h>
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()> > tasks;
+    std::mutex queue_mutex;
+    std::condition_variable task_available;
+    std::condition_variable tasks_done;
+    slong pending;
+    bool stopping;
+
+    void work();
+
+public:
+
+    /**
+     * Starts {@code num_threads} workers. A pool of size zero is valid and
+     * runs every submitted task in the calling thread.
+     */
+    ThreadPool(slong num_threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool & operator=(const ThreadPool &) = delete;
+
+    /**
+     * Queues {@code task} for execution by one of the workers.
+     */
+    void submit(const std::function<void()> &task);
+
+    /**
+     * Blocks until every task submitted so far has completed.
+     */
+    void wait();
+
+    slong size() const;
+};
+
+#endif /* THREAD_POOL_H_ */
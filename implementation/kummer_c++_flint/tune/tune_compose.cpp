@@ -0,0 +1,121 @@
+/*
+ * tune_compose.cpp
+ *
+ *  Times the modular composition engines of NmodComposeEngine (FLINT's
+ *  nmod_poly_compose_mod, the prepared Brent-Kung composition and the
+ *  rectangular engine) on random polynomials of growing degree, checks
+ *  that they agree, and writes the degree from which the rectangular
+ *  engine wins as rectangular_compose_threshold of a threshold profile
+ *  (see ff_isom_thresholds.h). The other entries of an existing profile
+ *  are kept.
+ *
+ *    tune_compose [profile [max_degree [num_threads [p]]]]
+ *
+ *  The engines are timed with num_threads threads, which should be the
+ *  num_threads given to FFEmbedding: AUTO only uses the rectangular engine
+ *  with more than one thread. Without a crossover below max_degree the
+ *  threshold is WORD_MAX.
+ *
+ *  Force an engine with
+ *
+ *    FFISOM_COMPOSE_ENGINE=flint|brent_kung|rectangular ./program
+ */
+
+#include "nmod_poly_compose_engine.h"
+#include "ff_isom_thresholds.h"
+#include <iostream>
+#include <stdlib.h>
+#include <flint/profiler.h>
+
+using namespace std;
+
+static const slong NUM_ENGINES = COMPOSE_ENGINE_RECTANGULAR + 1;
+
+/**
+ * Seconds taken by {@code engine} for a({@code b}) mod {@code f}, with
+ * {@code res} the result.
+ */
+double time_engine(nmod_poly_t res, const nmod_poly_t a, const nmod_poly_t b, const nmod_poly_t f, slong engine) {
+	timeit_t time;
+	timeit_start(time);
+	NmodComposeEngine::compose_mod(res, a, b, f, engine);
+	timeit_stop(time);
+	return (double) time->wall / 1000.0;
+}
+
+int main(int argc, char **argv) {
+	const char *filename = argc > 1 ? argv[1] : "ffisom_thresholds.txt";
+	slong max_degree = argc > 2 ? atol(argv[2]) : 200000;
+	slong num_threads = argc > 3 ? atol(argv[3]) : 2;
+	mp_limb_t p = argc > 4 ? atol(argv[4]) : n_nextprime(UWORD(1) << 20, 1);
+
+	NmodComposeEngine::set_num_threads(num_threads);
+
+	flint_rand_t state;
+	flint_randinit(state);
+
+	const char *names[NUM_ENGINES] = {"auto", "flint", "brent_kung", "rectangular"};
+	// the smallest degree from which rectangular beats both others
+	slong threshold = max_degree + 1;
+	bool agree = true;
+
+	cout << "degree";
+	for (slong engine = COMPOSE_ENGINE_FLINT; engine < NUM_ENGINES; engine++)
+		cout << " " << names[engine];
+	cout << "\n";
+
+	for (slong degree = 1000; degree <= max_degree; degree = degree * 3 / 2) {
+		nmod_poly_t f, a, b, expected, res;
+		nmod_poly_init(f, p);
+		nmod_poly_init(a, p);
+		nmod_poly_init(b, p);
+		nmod_poly_init(expected, p);
+		nmod_poly_init(res, p);
+		nmod_poly_randtest_monic(f, state, degree + 1);
+		nmod_poly_randtest(a, state, degree);
+		nmod_poly_randtest(b, state, degree);
+
+		double time[NUM_ENGINES];
+		cout << degree << flush;
+		for (slong engine = COMPOSE_ENGINE_FLINT; engine < NUM_ENGINES; engine++) {
+			time[engine] = time_engine(res, a, b, f, engine);
+			if (engine == COMPOSE_ENGINE_FLINT)
+				nmod_poly_set(expected, res);
+			else if (!nmod_poly_equal(res, expected))
+				agree = false;
+			cout << " " << time[engine] << flush;
+		}
+		cout << "\n";
+
+		if (time[COMPOSE_ENGINE_RECTANGULAR] < time[COMPOSE_ENGINE_FLINT]
+				&& time[COMPOSE_ENGINE_RECTANGULAR] < time[COMPOSE_ENGINE_BRENT_KUNG]) {
+			if (threshold > max_degree)
+				threshold = degree;
+		} else
+			threshold = max_degree + 1;
+
+		nmod_poly_clear(f);
+		nmod_poly_clear(a);
+		nmod_poly_clear(b);
+		nmod_poly_clear(expected);
+		nmod_poly_clear(res);
+	}
+	flint_randclear(state);
+
+	if (!agree) {
+		cout << "engines disagree\n";
+		return 1;
+	}
+
+	FFIsomThresholds tuned;
+	tuned.load(filename);
+	tuned.rectangular_compose_threshold = threshold > max_degree ? WORD_MAX : threshold;
+	if (!tuned.save(filename)) {
+		cout << "cannot write " << filename << "\n";
+		return 1;
+	}
+	cout << "rectangular_compose_threshold " << tuned.rectangular_compose_threshold << "\n";
+	cout << "profile written to " << filename << "\n";
+
+	return 0;
+}
@@ -0,0 +1,170 @@
+/*
+ * tune_min_poly.cpp
+ *
+ *  Times the minimal polynomial of a sequence of 2 * degree terms by the
+ *  quadratic Berlekamp-Massey algorithm and by half-gcd over growing
+ *  degrees, checks that they agree, and writes the degree from which
+ *  half-gcd wins as berlekamp_massey_threshold of a threshold profile
+ *  (see ff_isom_thresholds.h). Then times the minimal polynomial of an
+ *  element modulo an irreducible polynomial by the scalar algorithm and by
+ *  block Wiedemann on num_threads threads, up to max_degree / 10, and
+ *  writes the degree from which the block algorithm wins as
+ *  block_min_poly_threshold, WORD_MAX if it never does. The other entries
+ *  of an existing profile are kept.
+ *
+ *    tune_min_poly [profile [max_degree [p [num_threads]]]]
+ *
+ *  The quadratic algorithm is not timed past the degree where it is ten
+ *  times slower than half-gcd.
+ */
+
+#include "nmod_min_poly.h"
+#include "ff_isom_thresholds.h"
+#include <iostream>
+#include <stdlib.h>
+#include <flint/profiler.h>
+
+using namespace std;
+
+static const double NOT_TIMED = -1;
+
+/**
+ * Seconds per call of {@code hgcd} ? half-gcd : Berlekamp-Massey on
+ * {@code sequence}, repeated for at least 0.1 second.
+ */
+double time_sequence(nmod_poly_t result, const mp_limb_t *sequence, slong degree, bool hgcd) {
+	NmodMinPoly nmodMinPoly;
+	slong reps = 0;
+	double seconds = 0;
+	do {
+		timeit_t time;
+		timeit_start(time);
+		if (hgcd)
+			nmodMinPoly.minimal_polynomial_hgcd(result, sequence, degree);
+		else
+			nmodMinPoly.minimal_polynomial_berlekamp_massey(result, sequence, degree);
+		timeit_stop(time);
+		seconds += (double) time->wall / 1000.0;
+		reps++;
+	} while (seconds < 0.1);
+	return seconds / reps;
+}
+
+/**
+ * Seconds taken by the minimal polynomial of {@code f} modulo
+ * {@code modulus}, by block Wiedemann on {@code num_threads} threads if
+ * {@code block}, by the scalar algorithm otherwise.
+ */
+double time_element(nmod_poly_t result, const nmod_poly_t f, const nmod_poly_t modulus,
+		const nmod_poly_t modulus_inv_rev, bool block, slong num_threads) {
+	NmodMinPoly nmodMinPoly;
+	timeit_t time;
+	timeit_start(time);
+	if (block)
+		nmodMinPoly.minimal_polynomial_block(result, f, modulus, modulus_inv_rev, num_threads, num_threads);
+	else
+		nmodMinPoly.minimal_polynomial_scalar(result, f, modulus, modulus_inv_rev);
+	timeit_stop(time);
+	return (double) time->wall / 1000.0;
+}
+
+int main(int argc, char **argv) {
+	const char *filename = argc > 1 ? argv[1] : "ffisom_thresholds.txt";
+	slong max_degree = argc > 2 ? atol(argv[2]) : 100000;
+	mp_limb_t p = argc > 3 ? atol(argv[3]) : n_nextprime(UWORD(1) << 20, 1);
+	slong num_threads = argc > 4 ? atol(argv[4]) : 4;
+
+	flint_rand_t state;
+	flint_randinit(state);
+	nmod_t mod;
+	nmod_init(&mod, p);
+
+	FFIsomThresholds defaults;
+	// the smallest degree from which half-gcd stays faster
+	slong threshold = max_degree + 1;
+	bool agree = true;
+	bool dropped = false;
+
+	cout << "degree berlekamp_massey hgcd\n";
+	for (slong degree = 8; degree <= max_degree; degree = degree * 3 / 2) {
+		mp_limb_t *sequence = _nmod_vec_init(2 * degree);
+		_nmod_vec_randtest(sequence, state, 2 * degree, mod);
+
+		nmod_poly_t bm, hgcd;
+		nmod_poly_init(bm, p);
+		nmod_poly_init(hgcd, p);
+
+		double time_bm = NOT_TIMED;
+		if (!dropped)
+			time_bm = time_sequence(bm, sequence, degree, false);
+		double time_hgcd = time_sequence(hgcd, sequence, degree, true);
+		if (!dropped && !nmod_poly_equal(bm, hgcd))
+			agree = false;
+		cout << degree << " " << time_bm << " " << time_hgcd << "\n" << flush;
+
+		if (dropped || time_hgcd < time_bm) {
+			if (threshold > max_degree)
+				threshold = degree;
+		} else
+			threshold = max_degree + 1;
+		dropped = dropped || time_bm > 10 * time_hgcd;
+
+		nmod_poly_clear(bm);
+		nmod_poly_clear(hgcd);
+		_nmod_vec_clear(sequence);
+	}
+
+	// the smallest degree from which block Wiedemann stays faster
+	slong block_threshold = WORD_MAX;
+	cout << "degree scalar block\n";
+	for (slong degree = 50; degree <= max_degree / 10; degree = degree * 3 / 2) {
+		nmod_poly_t modulus, modulus_inv_rev, f, scalar, block;
+		nmod_poly_init(modulus, p);
+		nmod_poly_init(modulus_inv_rev, p);
+		nmod_poly_init(f, p);
+		nmod_poly_init(scalar, p);
+		nmod_poly_init(block, p);
+		nmod_poly_randtest_monic_irreducible(modulus, state, degree + 1);
+		nmod_poly_reverse(modulus_inv_rev, modulus, degree + 1);
+		nmod_poly_inv_series_newton(modulus_inv_rev, modulus_inv_rev, degree - 1);
+		nmod_poly_randtest(f, state, degree);
+
+		double time_scalar = time_element(scalar, f, modulus, modulus_inv_rev, false, num_threads);
+		double time_block = time_element(block, f, modulus, modulus_inv_rev, true, num_threads);
+		if (!nmod_poly_equal(scalar, block))
+			agree = false;
+		cout << degree << " " << time_scalar << " " << time_block << "\n" << flush;
+
+		if (time_block < time_scalar) {
+			if (block_threshold == WORD_MAX)
+				block_threshold = degree;
+		} else
+			block_threshold = WORD_MAX;
+
+		nmod_poly_clear(modulus);
+		nmod_poly_clear(modulus_inv_rev);
+		nmod_poly_clear(f);
+		nmod_poly_clear(scalar);
+		nmod_poly_clear(block);
+	}
+	flint_randclear(state);
+
+	if (!agree) {
+		cout << "algorithms disagree\n";
+		return 1;
+	}
+
+	FFIsomThresholds tuned;
+	tuned.load(filename);
+	tuned.berlekamp_massey_threshold = threshold > max_degree ? defaults.berlekamp_massey_threshold : threshold;
+	tuned.block_min_poly_threshold = block_threshold;
+	if (!tuned.save(filename)) {
+		cout << "cannot write " << filename << "\n";
+		return 1;
+	}
+	cout << "berlekamp_massey_threshold " << tuned.berlekamp_massey_threshold << "\n";
+	cout << "block_min_poly_threshold " << tuned.block_min_poly_threshold << "\n";
+	cout << "profile written to " << filename << "\n";
+
+	return 0;
+}
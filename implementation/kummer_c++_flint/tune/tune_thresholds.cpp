@@ -0,0 +1,326 @@
+/*
+ * tune_thresholds.cpp
+ *
+ *  Times every FORCE_* algorithm of FFIsomPrimePower over a grid of
+ *  (p, r, s), where r is the extension degree and s the degree of the
+ *  cyclotomic extension, and writes the crossovers as a threshold profile
+ *  (see ff_isom_thresholds.h).
+ *
+ *    tune_thresholds [profile [max_r [time_limit [min_p]]]]
+ *
+ *  An algorithm that takes more than time_limit seconds is not timed on
+ *  larger instances. The entries measured by tune_compose and tune_min_poly
+ *  are kept from an existing profile. Use the profile with
+ *
+ *    FFISOM_THRESHOLDS=profile ./program
+ */
+
+#include "ff_isom_prime_power_ext.h"
+#include "ff_isom_thresholds.h"
+#include "cyclotomic_ext_rth_root.h"
+#include "nmod_cyclotomic_poly.h"
+#include "util.h"
+#include <iostream>
+#include <algorithm>
+#include <math.h>
+#include <stdlib.h>
+#include <vector>
+#include <flint/profiler.h>
+
+using namespace std;
+
+static const double NOT_TIMED = -1;
+
+struct Sample {
+	mp_limb_t p;
+	slong r;
+	slong s;
+	// seconds per algorithm, indexed by FORCE_*, or NOT_TIMED
+	double time[FORCE_NONE];
+	// seconds for the r-th root with the small and the large extension variant
+	double root_small;
+	double root_large;
+};
+
+/**
+ * Seconds taken by {@code compute_generators} for two random fields of
+ * degree r, the best of {@code reps} runs.
+ */
+double time_generators(mp_limb_t p, slong r, slong algo, slong reps, flint_rand_t state) {
+	nmod_poly_t f1, f2, g1, g2;
+	nmod_poly_init(f1, p);
+	nmod_poly_init(f2, p);
+	nmod_poly_init(g1, p);
+	nmod_poly_init(g2, p);
+
+	double best = NOT_TIMED;
+	for (slong i = 0; i < reps; i++) {
+		nmod_poly_randtest_monic_irreducible(f1, state, r + 1);
+		nmod_poly_randtest_monic_irreducible(f2, state, r + 1);
+
+		timeit_t time;
+		timeit_start(time);
+		FFIsomPrimePower ffIsomPrimePower(f1, f2, algo);
+		ffIsomPrimePower.compute_generators(g1, g2);
+		timeit_stop(time);
+
+		double seconds = (double) time->wall / 1000.0;
+		if (best == NOT_TIMED || seconds < best)
+			best = seconds;
+	}
+
+	nmod_poly_clear(f1);
+	nmod_poly_clear(f2);
+	nmod_poly_clear(g1);
+	nmod_poly_clear(g2);
+	return best;
+}
+
+/**
+ * Seconds taken by an r-th root in the cyclotomic extension, with the
+ * given exponent deciding between the small and large extension variants.
+ */
+double time_rth_root(mp_limb_t p, slong r, double exponent, flint_rand_t state) {
+	FFIsomThresholds thresholds = FFIsomThresholds::get();
+	FFIsomThresholds forced = thresholds;
+	forced.ext_comp_exponent = exponent;
+	FFIsomThresholds::set(forced);
+
+	Util util;
+	slong s = util.compute_multiplicative_order(p, r);
+	nmod_poly_t f;
+	nmod_poly_init(f, p);
+	NModCyclotomicPoly nModCyclotomicPoly;
+	nModCyclotomicPoly.construct_cyclo_prime_degree(f, r);
+	nmod_poly_factor_t factors;
+	nmod_poly_factor_init(factors);
+	nmod_poly_factor_equal_deg(factors, f, s);
+
+	fq_nmod_ctx_t ctx;
+	fq_nmod_ctx_init_modulus(ctx, &factors->p[0], "z");
+	fq_nmod_t root, rth_power;
+	fq_nmod_init(root, ctx);
+	fq_nmod_init(rth_power, ctx);
+	fq_nmod_randtest_not_zero(rth_power, state, ctx);
+	fq_nmod_pow_ui(rth_power, rth_power, r, ctx);
+
+	timeit_t time;
+	timeit_start(time);
+	CyclotomicExtRthRoot cyclotomicExtRthRoot;
+	cyclotomicExtRthRoot.compute_rth_root(root, rth_power, r, ctx);
+	timeit_stop(time);
+
+	fq_nmod_clear(root, ctx);
+	fq_nmod_clear(rth_power, ctx);
+	fq_nmod_ctx_clear(ctx);
+	nmod_poly_factor_clear(factors);
+	nmod_poly_clear(f);
+
+	FFIsomThresholds::set(thresholds);
+	return (double) time->wall / 1000.0;
+}
+
+/**
+ * The smallest key from which the algorithm {@code b} is never slower than
+ * {@code a} on the samples where one of them was timed. If {@code b} never
+ * wins, the default is kept when it lies past the samples.
+ */
+slong crossover(const vector<Sample> &samples, bool key_is_rs, slong a, slong b, slong fallback) {
+	vector<pair<slong, bool> > wins;
+	for (size_t i = 0; i < samples.size(); i++) {
+		const Sample &sample = samples[i];
+		double ta = sample.time[a], tb = sample.time[b];
+		if (sample.s == 1 || (ta == NOT_TIMED && tb == NOT_TIMED))
+			continue;
+		bool b_wins = tb != NOT_TIMED && (ta == NOT_TIMED || tb <= ta);
+		wins.push_back(make_pair(key_is_rs ? sample.r * sample.s : sample.s, b_wins));
+	}
+	if (wins.empty())
+		return fallback;
+
+	sort(wins.begin(), wins.end());
+	slong threshold = wins.back().first + 1;
+	for (slong i = wins.size() - 1; i >= 0 && wins[i].second; i--)
+		threshold = wins[i].first;
+
+	if (threshold > wins.back().first && fallback > threshold)
+		return fallback;
+	return threshold;
+}
+
+/**
+ * The same for the trivial cyclotomic extension, keyed on r.
+ */
+slong crossover_trivial(const vector<Sample> &samples, slong fallback) {
+	vector<pair<slong, bool> > wins;
+	for (size_t i = 0; i < samples.size(); i++) {
+		const Sample &sample = samples[i];
+		double ta = sample.time[FORCE_LINALG], tb = sample.time[FORCE_MODCOMP];
+		if (sample.s != 1 || (ta == NOT_TIMED && tb == NOT_TIMED))
+			continue;
+		wins.push_back(make_pair(sample.r, tb != NOT_TIMED && (ta == NOT_TIMED || tb <= ta)));
+	}
+	if (wins.empty())
+		return fallback;
+
+	sort(wins.begin(), wins.end());
+	slong threshold = wins.back().first + 1;
+	for (slong i = wins.size() - 1; i >= 0 && wins[i].second; i--)
+		threshold = wins[i].first;
+
+	if (threshold > wins.back().first && fallback > threshold)
+		return fallback;
+	return threshold;
+}
+
+/**
+ * The exponent w misclassifying the fewest samples, where the small
+ * variant is used when s < r^w.
+ */
+double fit_exponent(const vector<Sample> &samples, double fallback) {
+	vector<double> candidates;
+	candidates.push_back(fallback);
+	for (size_t i = 0; i < samples.size(); i++)
+		if (samples[i].root_small != NOT_TIMED && samples[i].s > 1)
+			// just above log_r(s), so that this sample counts as small
+			candidates.push_back(log((double) samples[i].s) / log((double) samples[i].r) + 1e-9);
+
+	double best = fallback;
+	slong best_errors = WORD_MAX;
+	for (size_t j = 0; j < candidates.size(); j++) {
+		slong errors = 0;
+		for (size_t i = 0; i < samples.size(); i++) {
+			const Sample &sample = samples[i];
+			if (sample.root_small == NOT_TIMED || sample.s == 1)
+				continue;
+			bool small = sample.s < pow((double) sample.r, candidates[j]);
+			if (small != (sample.root_small <= sample.root_large))
+				errors++;
+		}
+		if (errors < best_errors) {
+			best_errors = errors;
+			best = candidates[j];
+		}
+	}
+	return best;
+}
+
+/**
+ * The first prime at least {@code min_p} whose order modulo r is s.
+ */
+mp_limb_t prime_of_order(slong r, slong s, mp_limb_t min_p) {
+	Util util;
+	mp_limb_t p = n_nextprime(min_p - 1, 1);
+	for (slong tries = 0; tries < 100000; tries++, p = n_nextprime(p, 1))
+		if (p % r != 0 && (slong) util.compute_multiplicative_order(p, r) == s)
+			return p;
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	const char *filename = argc > 1 ? argv[1] : "ffisom_thresholds.txt";
+	slong max_r = argc > 2 ? atol(argv[2]) : 200;
+	double time_limit = argc > 3 ? atof(argv[3]) : 2.0;
+	mp_limb_t min_p = argc > 4 ? atol(argv[4]) : 1000;
+
+	flint_rand_t state;
+	flint_randinit(state);
+
+	// the grid: prime degrees r, and for each r a few orders s | r - 1
+	vector<Sample> samples;
+	for (slong r = 3; r <= max_r; r = n_nextprime(FLINT_MAX(r + 1, r * 5 / 4), 1)) {
+		n_factor_t factors;
+		n_factor_init(&factors);
+		n_factor(&factors, r - 1, 1);
+
+		vector<slong> orders;
+		orders.push_back(1);
+		for (slong i = 0; i < factors.num; i++) {
+			slong count = orders.size();
+			for (slong j = 0; j < count; j++)
+				for (slong e = 1, q = factors.p[i]; e <= (slong) factors.exp[i]; e++, q *= factors.p[i])
+					orders.push_back(orders[j] * q);
+		}
+		sort(orders.begin(), orders.end());
+
+		// at most six orders, spread out
+		slong step = FLINT_MAX(1, (slong) (orders.size() + 5) / 6);
+		for (size_t i = 0; i < orders.size(); i += step) {
+			Sample sample;
+			sample.r = r;
+			sample.s = orders[i];
+			sample.p = prime_of_order(r, orders[i], min_p);
+			if (sample.p != 0)
+				samples.push_back(sample);
+		}
+	}
+
+	// cheap instances first, so that slow algorithms are dropped early
+	sort(samples.begin(), samples.end(), [](const Sample &a, const Sample &b) {
+		return a.r * a.s < b.r * b.s;
+	});
+
+	const char *names[FORCE_NONE] = {"linalg_cyclo", "linalg_only", "linalg", "modcomp", "cofactor", "iterfrob", "mpe"};
+	vector<int> dropped(FORCE_NONE, 0);
+	bool root_dropped[2] = {false, false};
+
+	cout << "p r s";
+	for (slong algo = 0; algo < FORCE_NONE; algo++)
+		cout << " " << names[algo];
+	cout << " root_small root_large\n";
+
+	for (size_t i = 0; i < samples.size(); i++) {
+		Sample &sample = samples[i];
+		cout << sample.p << " " << sample.r << " " << sample.s << flush;
+
+		for (slong algo = 0; algo < FORCE_NONE; algo++) {
+			sample.time[algo] = NOT_TIMED;
+			// in the trivial case only linalg and modcomp differ; linalg_only is
+			// never picked unless forced
+			bool relevant = sample.s == 1 ? (algo == FORCE_LINALG || algo == FORCE_MODCOMP) : algo != FORCE_LINALG_ONLY;
+			if (relevant && !dropped[algo]) {
+				sample.time[algo] = time_generators(sample.p, sample.r, algo, 3, state);
+				if (sample.time[algo] > time_limit)
+					dropped[algo] = 1;
+			}
+			cout << " " << sample.time[algo] << flush;
+		}
+
+		sample.root_small = NOT_TIMED;
+		sample.root_large = NOT_TIMED;
+		if (sample.s > 1 && !root_dropped[0] && !root_dropped[1]) {
+			sample.root_small = time_rth_root(sample.p, sample.r, 100.0, state);
+			sample.root_large = time_rth_root(sample.p, sample.r, 0.0, state);
+			root_dropped[0] = sample.root_small > time_limit;
+			root_dropped[1] = sample.root_large > time_limit;
+		}
+		cout << " " << sample.root_small << " " << sample.root_large << "\n";
+	}
+
+	FFIsomThresholds defaults;
+	FFIsomThresholds tuned;
+	tuned.load(filename);
+	tuned.linalg_threshold = crossover_trivial(samples, defaults.linalg_threshold);
+	tuned.linalg_cyclo_threshold = crossover(samples, true, FORCE_LINALG_CYCLO, FORCE_LINALG,
+			defaults.linalg_cyclo_threshold);
+	tuned.linalg_only_threshold = crossover(samples, true, FORCE_LINALG, FORCE_MODCOMP,
+			defaults.linalg_only_threshold);
+	tuned.cofactor_threshold = crossover(samples, false, FORCE_MODCOMP, FORCE_COFACTOR, defaults.cofactor_threshold);
+	tuned.iterfrob_threshold = crossover(samples, false, FORCE_COFACTOR, FORCE_ITERFROB, defaults.iterfrob_threshold);
+	tuned.mpe_threshold = crossover(samples, false, FORCE_ITERFROB, FORCE_MPE, defaults.mpe_threshold);
+	tuned.ext_comp_exponent = fit_exponent(samples, defaults.ext_comp_exponent);
+
+	// the algorithms are tried in order, keep the ladder monotone
+	tuned.linalg_only_threshold = FLINT_MAX(tuned.linalg_only_threshold, tuned.linalg_cyclo_threshold);
+	tuned.iterfrob_threshold = FLINT_MAX(tuned.iterfrob_threshold, tuned.cofactor_threshold);
+	tuned.mpe_threshold = FLINT_MAX(tuned.mpe_threshold, tuned.iterfrob_threshold);
+
+	if (!tuned.save(filename)) {
+		cout << "cannot write " << filename << "\n";
+		return 1;
+	}
+	cout << "profile written to " << filename << "\n";
+
+	flint_randclear(state);
+	return 0;
+}
@@ -35,8 +35,8 @@ ulong Util::compute_multiplicative_order(ulong a, ulong modulus) {
 	return order;
 }
 
-bool Util::is_small_cyclotomic_ext(ulong degree, ulong p) {
+bool Util::is_small_cyclotomic_ext(ulong degree, ulong p, double exponent) {
 	slong s = compute_multiplicative_order(p, degree);
 
-	return (s < pow(degree, EXT_COMP_EXPONENT));
+	return (s < pow(degree, exponent));
 }
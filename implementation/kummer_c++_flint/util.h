@@ -11,8 +11,6 @@
 #include <flint/ulong_extras.h>
 
 class Util {
-    static constexpr double EXT_COMP_EXPONENT = 0.2;
-
 public:
 
     /**
@@ -26,9 +24,10 @@ public:
      * Checks if an extension of degree {@degree} over $\mathbb{F}_p$ is small.
      * We consider a cyclotomic extension small if the multiplicative order $d$ of {@code p} in
      * the group $\mathbb{Z}/r\mathbb{Z}$ is such that $d < r^{2 - w}$ where $w$ is the
-     * exponent of modular composition.
+     * exponent of modular composition; $2 - w$ is {@code exponent}, e.g.
+     * {@code ext_comp_exponent} of {@code FFIsomThresholds}.
      */
-    bool is_small_cyclotomic_ext(ulong degree, const ulong p);
+    bool is_small_cyclotomic_ext(ulong degree, const ulong p, double exponent);
 
 };
 